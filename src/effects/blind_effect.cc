@@ -30,6 +30,7 @@
 #include <cstdlib>
 
 #include "systems/base/surface.h"
+#include "systems/base/transition.h"
 
 // -----------------------------------------------------------------------
 // BlindEffect
@@ -48,9 +49,8 @@ BlindEffect::~BlindEffect() {}
 void BlindEffect::ComputeGrowing(RLMachine& machine,
                                  int maxSize,
                                  int currentTime) {
-  int num_blinds = maxSize / blind_size() + 1;
-  int rows_to_display =
-      int((float(currentTime) / duration()) * (blind_size() + num_blinds));
+  int num_blinds = GetNumBlinds(maxSize);
+  int rows_to_display = GetRowsToDisplay(maxSize, currentTime);
 
   for (int currentBlind = 0; currentBlind < num_blinds; ++currentBlind) {
     if (currentBlind <= rows_to_display) {
@@ -67,9 +67,8 @@ void BlindEffect::ComputeGrowing(RLMachine& machine,
 void BlindEffect::ComputeDecreasing(RLMachine& machine,
                                     int maxSize,
                                     int currentTime) {
-  int num_blinds = maxSize / blind_size() + 1;
-  int rows_to_display =
-      int((float(currentTime) / duration()) * (blind_size() + num_blinds));
+  int num_blinds = GetNumBlinds(maxSize);
+  int rows_to_display = GetRowsToDisplay(maxSize, currentTime);
 
   for (int currentBlind = num_blinds; currentBlind >= 0; --currentBlind) {
     if ((num_blinds - currentBlind) < rows_to_display) {
@@ -85,6 +84,15 @@ void BlindEffect::ComputeDecreasing(RLMachine& machine,
   }
 }
 
+int BlindEffect::GetNumBlinds(int maxSize) const {
+  return maxSize / blind_size() + 1;
+}
+
+int BlindEffect::GetRowsToDisplay(int maxSize, int currentTime) const {
+  return int((float(currentTime) / duration()) *
+             (blind_size() + GetNumBlinds(maxSize)));
+}
+
 bool BlindEffect::BlitOriginalImage() const { return true; }
 
 // -----------------------------------------------------------------------
@@ -106,6 +114,14 @@ void BlindTopToBottomEffect::PerformEffectForTime(RLMachine& machine,
   ComputeGrowing(machine, height(), currentTime);
 }
 
+bool BlindTopToBottomEffect::GetTransition(int currentTime,
+                                           Transition* transition) {
+  int rows_to_display = GetRowsToDisplay(height(), currentTime);
+  *transition =
+      Transition::Blind(0, 1, 0, blind_size(), rows_to_display);
+  return true;
+}
+
 void BlindTopToBottomEffect::RenderPolygon(int polyStart, int polyEnd) {
   src_surface().RenderToScreen(Rect::GRP(0, polyStart, width(), polyEnd),
                                Rect::GRP(0, polyStart, width(), polyEnd),
@@ -131,6 +147,16 @@ void BlindBottomToTopEffect::PerformEffectForTime(RLMachine& machine,
   ComputeDecreasing(machine, height(), currentTime);
 }
 
+bool BlindBottomToTopEffect::GetTransition(int currentTime,
+                                           Transition* transition) {
+  int rows_to_display = GetRowsToDisplay(height(), currentTime);
+  *transition = Transition::Blind(0, -1,
+                                  GetNumBlinds(height()) * blind_size(),
+                                  blind_size(),
+                                  rows_to_display);
+  return true;
+}
+
 void BlindBottomToTopEffect::RenderPolygon(int polyStart, int polyEnd) {
   // Render polygon
   src_surface().RenderToScreen(Rect::GRP(0, polyEnd, width(), polyStart),
@@ -157,6 +183,14 @@ void BlindLeftToRightEffect::PerformEffectForTime(RLMachine& machine,
   ComputeGrowing(machine, width(), currentTime);
 }
 
+bool BlindLeftToRightEffect::GetTransition(int currentTime,
+                                           Transition* transition) {
+  int rows_to_display = GetRowsToDisplay(width(), currentTime);
+  *transition =
+      Transition::Blind(1, 0, 0, blind_size(), rows_to_display);
+  return true;
+}
+
 void BlindLeftToRightEffect::RenderPolygon(int polyStart, int polyEnd) {
   src_surface().RenderToScreen(Rect::GRP(polyStart, 0, polyEnd, height()),
                                Rect::GRP(polyStart, 0, polyEnd, height()),
@@ -182,6 +216,16 @@ void BlindRightToLeftEffect::PerformEffectForTime(RLMachine& machine,
   ComputeDecreasing(machine, width(), currentTime);
 }
 
+bool BlindRightToLeftEffect::GetTransition(int currentTime,
+                                           Transition* transition) {
+  int rows_to_display = GetRowsToDisplay(width(), currentTime);
+  *transition = Transition::Blind(-1, 0,
+                                  GetNumBlinds(width()) * blind_size(),
+                                  blind_size(),
+                                  rows_to_display);
+  return true;
+}
+
 void BlindRightToLeftEffect::RenderPolygon(int polyStart, int polyEnd) {
   src_surface().RenderToScreen(Rect::GRP(polyEnd, 0, polyStart, height()),
                                Rect::GRP(polyEnd, 0, polyStart, height()),
@@ -47,6 +47,12 @@ class BlindEffect : public Effect {
   void ComputeGrowing(RLMachine& machine, int maxSize, int currentTime);
   void ComputeDecreasing(RLMachine& machine, int maxSize, int currentTime);
 
+  // The number of blinds across |maxSize|, and how far the blinds have
+  // opened at |currentTime|, shared by the Compute*() methods and the
+  // Transitions that describe them.
+  int GetNumBlinds(int maxSize) const;
+  int GetRowsToDisplay(int maxSize, int currentTime) const;
+
   virtual void RenderPolygon(int polyStart, int polyEnd) = 0;
 
  private:
@@ -68,6 +74,8 @@ class BlindTopToBottomEffect : public BlindEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) override;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) override;
   virtual void RenderPolygon(int polyStart, int polyEnd) override;
 };
 
@@ -84,6 +92,8 @@ class BlindBottomToTopEffect : public BlindEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
   virtual void RenderPolygon(int polyStart, int polyEnd) final;
 };
 
@@ -100,6 +110,8 @@ class BlindLeftToRightEffect : public BlindEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
   virtual void RenderPolygon(int polyStart, int polyEnd) final;
 };
 
@@ -116,6 +128,8 @@ class BlindRightToLeftEffect : public BlindEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
   virtual void RenderPolygon(int polyStart, int polyEnd) final;
 };
 
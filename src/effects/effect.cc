@@ -32,6 +32,7 @@
 #include "systems/base/graphics_system.h"
 #include "systems/base/surface.h"
 #include "systems/base/system.h"
+#include "systems/base/transition.h"
 
 // -----------------------------------------------------------------------
 // Effect
@@ -56,7 +57,13 @@ Effect::~Effect() {
 }
 
 bool Effect::operator()(RLMachine& machine) {
-  unsigned int time = machine.system().event().GetTicks();
+  GraphicsSystem& graphics = machine.system().graphics();
+
+  // Step the effect by when this frame will be seen rather than when it's
+  // drawn, so that it moves evenly however the game loop lines up with the
+  // display.
+  unsigned int time = graphics.presentation_clock().Predict(
+      machine.system().event().GetTicks());
   unsigned int current_frame = time - start_time_;
 
   bool fast_forward = machine.system().ShouldFastForward();
@@ -64,21 +71,28 @@ bool Effect::operator()(RLMachine& machine) {
   if (current_frame >= duration_ || fast_forward) {
     return true;
   } else {
-    GraphicsSystem& graphics = machine.system().graphics();
     graphics.BeginFrame();
 
-    if (BlitOriginalImage()) {
-      dst_surface().RenderToScreen(
-          Rect(Point(0, 0), size()), Rect(Point(0, 0), size()), 255);
-    }
+    Transition transition;
+    if (!GetTransition(current_frame, &transition) ||
+        !graphics.DrawTransition(dst_surface(), src_surface(), transition)) {
+      if (BlitOriginalImage()) {
+        dst_surface().RenderToScreen(
+            Rect(Point(0, 0), size()), Rect(Point(0, 0), size()), 255);
+      }
 
-    PerformEffectForTime(machine, current_frame);
+      PerformEffectForTime(machine, current_frame);
+    }
 
     graphics.EndFrame();
     return false;
   }
 }
 
+bool Effect::GetTransition(int currentTime, Transition* transition) {
+  return false;
+}
+
 // -----------------------------------------------------------------------
 // BlitAfterEffectFinishes
 // -----------------------------------------------------------------------
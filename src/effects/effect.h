@@ -35,6 +35,7 @@
 
 class Surface;
 class RLMachine;
+struct Transition;
 
 // SEL/SELR transition effects:
 //
@@ -68,9 +69,13 @@ class Effect : public LongOperation {
   virtual ~Effect();
 
   // Implements the LongOperation calling interface. This simply keeps
-  // track of the current time and calls PerformEffectForTime() until
+  // track of the current time and draws a frame of the effect until
   // time > duration_, when the default implementation simply sets
   // the current dc0 to the original dc0, then blits dc1 onto it.
+  //
+  // Frames are timed by when the graphics system expects them to be
+  // presented, and drawn in one pass with GraphicsSystem::DrawTransition()
+  // when possible, falling back on PerformEffectForTime().
   virtual bool operator()(RLMachine& machine);
 
   // Accessors for which surfaces we're composing. These are public as
@@ -88,6 +93,12 @@ class Effect : public LongOperation {
   // overriden, other then the public constructor.
   virtual void PerformEffectForTime(RLMachine& machine, int currentTime) = 0;
 
+  // Describes the frame at |currentTime| for GraphicsSystem::DrawTransition(),
+  // with dst_surface() as the FROM_IMAGE and src_surface() as the TO_IMAGE.
+  // It must look the same as what PerformEffectForTime() draws. Returns false
+  // if the effect can't be described that way, which is the default.
+  virtual bool GetTransition(int currentTime, Transition* transition);
+
  private:
   // Whether the orriginal dc0 should be blitted onto the target
   // surface before we pass control to the effect
@@ -113,6 +113,9 @@ Effect* EffectFactory::Build(RLMachine& machine,
     case 120:
       return BuildBlindEffect(
           machine, src, dst, screen_size, time, direction, xsize, ysize);
+    case 130:
+      return BuildDiagonalWipeEffect(
+          machine, src, dst, screen_size, time, direction, interpolation);
     case 0:
     case 50:
     default:
@@ -161,6 +164,25 @@ Effect* EffectFactory::BuildWipeEffect(RLMachine& machine,
   }
 }
 
+Effect* EffectFactory::BuildDiagonalWipeEffect(RLMachine& machine,
+                                               std::shared_ptr<Surface> src,
+                                               std::shared_ptr<Surface> dst,
+                                               const Size& screen_size,
+                                               int time,
+                                               int direction,
+                                               int interpolation) {
+  // Directions are the four corners; see WipeDiagonalEffect.
+  if (direction < 0 || direction > 3) {
+    std::cerr << "WARNING! Unsupported direction " << direction
+              << " in EffectFactory::buildDiagonalWipeEffect. Returning Top"
+              << " Left to Bottom Right effect." << std::endl;
+    direction = 0;
+  }
+
+  return new WipeDiagonalEffect(
+      machine, src, dst, screen_size, time, interpolation, direction);
+}
+
 Effect* EffectFactory::BuildBlindEffect(RLMachine& machine,
                                         std::shared_ptr<Surface> src,
                                         std::shared_ptr<Surface> dst,
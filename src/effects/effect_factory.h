@@ -79,6 +79,15 @@ class EffectFactory {
                                  int direction,
                                  int interpolation);
 
+  // Creates a WipeDiagonalEffect for \#SEL #130, Diagonal wipe.
+  static Effect* BuildDiagonalWipeEffect(RLMachine& machine,
+                                         std::shared_ptr<Surface> src,
+                                         std::shared_ptr<Surface> dst,
+                                         const Size& screen_size,
+                                         int time,
+                                         int direction,
+                                         int interpolation);
+
   // Creates a specific subclass of BlindEffect for \#SEL #120, Blind.
   static Effect* BuildBlindEffect(RLMachine& machine,
                                   std::shared_ptr<Surface> src,
@@ -28,6 +28,7 @@
 #include "effects/fade_effect.h"
 
 #include "systems/base/surface.h"
+#include "systems/base/transition.h"
 
 // -----------------------------------------------------------------------
 // FadeEffect
@@ -44,9 +45,17 @@ FadeEffect::~FadeEffect() {}
 
 void FadeEffect::PerformEffectForTime(RLMachine& machine, int currentTime) {
   // Blit the source image to the screen with the opacity
-  int opacity = int((float(currentTime) / duration()) * 255);
+  src_surface().RenderToScreen(
+      Rect(0, 0, size()), Rect(0, 0, size()), GetOpacity(currentTime));
+}
 
-  src_surface().RenderToScreen(Rect(0, 0, size()), Rect(0, 0, size()), opacity);
+bool FadeEffect::GetTransition(int currentTime, Transition* transition) {
+  *transition = Transition::Fade(GetOpacity(currentTime));
+  return true;
 }
 
 bool FadeEffect::BlitOriginalImage() const { return true; }
+
+int FadeEffect::GetOpacity(int currentTime) const {
+  return int((float(currentTime) / duration()) * 255);
+}
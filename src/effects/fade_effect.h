@@ -43,9 +43,14 @@ class FadeEffect : public Effect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
 
  private:
   virtual bool BlitOriginalImage() const final;
+
+  // The opacity of the new image at |currentTime|.
+  int GetOpacity(int currentTime) const;
 };
 
 #endif  // SRC_EFFECTS_FADE_EFFECT_H_
@@ -30,9 +30,8 @@
 #include <cmath>
 
 #include "machine/rlmachine.h"
-#include "systems/base/system.h"
-#include "systems/base/graphics_system.h"
 #include "systems/base/surface.h"
+#include "systems/base/transition.h"
 
 // -----------------------------------------------------------------------
 // ScrollOnScrollOff base class
@@ -60,10 +59,28 @@ bool ScrollSquashSlideBaseEffect::BlitOriginalImage() const { return false; }
 
 void ScrollSquashSlideBaseEffect::PerformEffectForTime(RLMachine& machine,
                                                        int current_time) {
-  GraphicsSystem& graphics = machine.system().graphics();
+  Transition transition;
+  ComposeFrame(current_time, &transition);
+  for (int i = 0; i < transition.pane_count; ++i) {
+    const Transition::Pane& pane = transition.panes[i];
+    Surface& surface = pane.image == Transition::TO_IMAGE ? src_surface()
+                                                          : dst_surface();
+    surface.RenderToScreen(pane.src, pane.dst, 255);
+  }
+}
+
+bool ScrollSquashSlideBaseEffect::GetTransition(int current_time,
+                                                Transition* transition) {
+  ComposeFrame(current_time, transition);
+  return true;
+}
+
+void ScrollSquashSlideBaseEffect::ComposeFrame(int current_time,
+                                               Transition* transition) {
   int amount_visible =
-      CalculateAmountVisible(current_time, drawer_->GetMaxSize(graphics));
-  effect_type_->ComposeEffectsFor(graphics, *this, *drawer_, amount_visible);
+      CalculateAmountVisible(current_time, drawer_->GetMaxSize(size()));
+  effect_type_->ComposeEffectsFor(size(), *drawer_, amount_visible,
+                                  transition);
 }
 
 // -----------------------------------------------------------------------
@@ -77,200 +94,154 @@ ScrollSquashSlideDrawer::~ScrollSquashSlideDrawer() {}
 
 // ------------------------------------------------- [ TopToBottomDrawer ]
 
-int TopToBottomDrawer::GetMaxSize(GraphicsSystem& gs) {
-  return gs.screen_size().height();
+int TopToBottomDrawer::GetMaxSize(const Size& screen) {
+  return screen.height();
 }
 
-void TopToBottomDrawer::ScrollOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height - amount_visible),
-      Rect::GRP(0, amount_visible, width, height),
-      255);
+Transition::Pane TopToBottomDrawer::ScrollOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, 0, width, height - amount_visible),
+                          Rect::GRP(0, amount_visible, width, height));
 }
 
-void TopToBottomDrawer::ScrollOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(
-      Rect::GRP(0, height - amount_visible, width, height),
-      Rect::GRP(0, 0, width, amount_visible),
-      255);
+Transition::Pane TopToBottomDrawer::ScrollOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, height - amount_visible, width, height),
+                          Rect::GRP(0, 0, width, amount_visible));
 }
 
-void TopToBottomDrawer::SquashOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height),
-      Rect::GRP(0, amount_visible, width, height),
-      255);
+Transition::Pane TopToBottomDrawer::SquashOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(0, amount_visible, width, height));
 }
 
-void TopToBottomDrawer::SquashOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(Rect::GRP(0, 0, width, height),
-                                      Rect::GRP(0, 0, width, amount_visible),
-                                      255);
+Transition::Pane TopToBottomDrawer::SquashOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(0, 0, width, amount_visible));
 }
 
 // ------------------------------------------------- [ BottomToTopDrawer ]
 
-int BottomToTopDrawer::GetMaxSize(GraphicsSystem& gs) {
-  return gs.screen_size().height();
+int BottomToTopDrawer::GetMaxSize(const Size& screen) {
+  return screen.height();
 }
 
-void BottomToTopDrawer::ScrollOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, amount_visible),
-      Rect::GRP(0, height - amount_visible, width, height),
-      255);
+Transition::Pane BottomToTopDrawer::ScrollOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, 0, width, amount_visible),
+                          Rect::GRP(0, height - amount_visible, width, height));
 }
 
-void BottomToTopDrawer::ScrollOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, amount_visible, width, height),
-      Rect::GRP(0, 0, width, height - amount_visible),
-      255);
+Transition::Pane BottomToTopDrawer::ScrollOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, amount_visible, width, height),
+                          Rect::GRP(0, 0, width, height - amount_visible));
 }
 
-void BottomToTopDrawer::SquashOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height),
-      Rect::GRP(0, height - amount_visible, width, height),
-      255);
+Transition::Pane BottomToTopDrawer::SquashOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(0, height - amount_visible, width, height));
 }
 
-void BottomToTopDrawer::SquashOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height),
-      Rect::GRP(0, 0, width, height - amount_visible),
-      255);
+Transition::Pane BottomToTopDrawer::SquashOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(0, 0, width, height - amount_visible));
 }
 
 // ------------------------------------------------- [ LeftToRightDrawer ]
 
-int LeftToRightDrawer::GetMaxSize(GraphicsSystem& gs) {
-  return gs.screen_size().width();
+int LeftToRightDrawer::GetMaxSize(const Size& screen) {
+  return screen.width();
 }
 
-void LeftToRightDrawer::ScrollOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(
-      Rect::GRP(width - amount_visible, 0, width, height),
-      Rect::GRP(0, 0, amount_visible, height),
-      255);
+Transition::Pane LeftToRightDrawer::ScrollOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(width - amount_visible, 0, width, height),
+                          Rect::GRP(0, 0, amount_visible, height));
 }
 
-void LeftToRightDrawer::ScrollOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, 0, width - amount_visible, height),
-      Rect::GRP(amount_visible, 0, width, height),
-      255);
+Transition::Pane LeftToRightDrawer::ScrollOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, 0, width - amount_visible, height),
+                          Rect::GRP(amount_visible, 0, width, height));
 }
 
-void LeftToRightDrawer::SquashOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(Rect::GRP(0, 0, width, height),
-                                      Rect::GRP(0, 0, amount_visible, height),
-                                      255);
+Transition::Pane LeftToRightDrawer::SquashOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(0, 0, amount_visible, height));
 }
 
-void LeftToRightDrawer::SquashOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height),
-      Rect::GRP(amount_visible, 0, width, height),
-      255);
+Transition::Pane LeftToRightDrawer::SquashOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(amount_visible, 0, width, height));
 }
 
 // ------------------------------------------------- [ RightToLeftDrawer ]
 
-int RightToLeftDrawer::GetMaxSize(GraphicsSystem& gs) {
-  return gs.screen_size().width();
+int RightToLeftDrawer::GetMaxSize(const Size& screen) {
+  return screen.width();
 }
 
-void RightToLeftDrawer::ScrollOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(amount_visible, 0, width, height),
-      Rect::GRP(0, 0, width - amount_visible, height),
-      255);
+Transition::Pane RightToLeftDrawer::ScrollOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(amount_visible, 0, width, height),
+                          Rect::GRP(0, 0, width - amount_visible, height));
 }
 
-void RightToLeftDrawer::ScrollOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(
-      Rect::GRP(0, 0, amount_visible, height),
-      Rect::GRP(width - amount_visible, 0, width, height),
-      255);
+Transition::Pane RightToLeftDrawer::ScrollOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, 0, amount_visible, height),
+                          Rect::GRP(width - amount_visible, 0, width, height));
 }
 
-void RightToLeftDrawer::SquashOff(GraphicsSystem& graphics,
-                                  ScrollSquashSlideBaseEffect& effect,
-                                  int amount_visible,
-                                  int width,
-                                  int height) {
-  effect.dst_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height),
-      Rect::GRP(0, 0, width - amount_visible, height),
-      255);
+Transition::Pane RightToLeftDrawer::SquashOff(int amount_visible,
+                                              int width,
+                                              int height) {
+  return Transition::Pane(Transition::FROM_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(0, 0, width - amount_visible, height));
 }
 
-void RightToLeftDrawer::SquashOn(GraphicsSystem& graphics,
-                                 ScrollSquashSlideBaseEffect& effect,
-                                 int amount_visible,
-                                 int width,
-                                 int height) {
-  effect.src_surface().RenderToScreen(
-      Rect::GRP(0, 0, width, height),
-      Rect::GRP(width - amount_visible, 0, width, height),
-      255);
+Transition::Pane RightToLeftDrawer::SquashOn(int amount_visible,
+                                             int width,
+                                             int height) {
+  return Transition::Pane(Transition::TO_IMAGE,
+                          Rect::GRP(0, 0, width, height),
+                          Rect::GRP(width - amount_visible, 0, width, height));
 }
 
 // -----------------------------------------------------------------------
@@ -279,63 +250,73 @@ void RightToLeftDrawer::SquashOn(GraphicsSystem& graphics,
 
 ScrollSquashSlideEffectTypeBase::~ScrollSquashSlideEffectTypeBase() {}
 
-void ScrollOnScrollOff::ComposeEffectsFor(GraphicsSystem& system,
-                                          ScrollSquashSlideBaseEffect& effect,
+// static
+void ScrollSquashSlideEffectTypeBase::AddPane(Transition* transition,
+                                              const Transition::Pane& pane) {
+  transition->AddPane(pane.image, pane.src, pane.dst);
+}
+
+void ScrollOnScrollOff::ComposeEffectsFor(const Size& s,
                                           ScrollSquashSlideDrawer& drawer,
-                                          int amount_visible) {
-  Size s = system.screen_size();
-  drawer.ScrollOn(system, effect, amount_visible, s.width(), s.height());
-  drawer.ScrollOff(system, effect, amount_visible, s.width(), s.height());
+                                          int amount_visible,
+                                          Transition* transition) {
+  AddPane(transition,
+          drawer.ScrollOn(amount_visible, s.width(), s.height()));
+  AddPane(transition,
+          drawer.ScrollOff(amount_visible, s.width(), s.height()));
 }
 
-void ScrollOnSquashOff::ComposeEffectsFor(GraphicsSystem& system,
-                                          ScrollSquashSlideBaseEffect& effect,
+void ScrollOnSquashOff::ComposeEffectsFor(const Size& s,
                                           ScrollSquashSlideDrawer& drawer,
-                                          int amount_visible) {
-  Size s = system.screen_size();
-  drawer.ScrollOn(system, effect, amount_visible, s.width(), s.height());
-  drawer.SquashOff(system, effect, amount_visible, s.width(), s.height());
+                                          int amount_visible,
+                                          Transition* transition) {
+  AddPane(transition,
+          drawer.ScrollOn(amount_visible, s.width(), s.height()));
+  AddPane(transition,
+          drawer.SquashOff(amount_visible, s.width(), s.height()));
 }
 
-void SquashOnScrollOff::ComposeEffectsFor(GraphicsSystem& system,
-                                          ScrollSquashSlideBaseEffect& effect,
+void SquashOnScrollOff::ComposeEffectsFor(const Size& s,
                                           ScrollSquashSlideDrawer& drawer,
-                                          int amount_visible) {
-  Size s = system.screen_size();
-  drawer.SquashOn(system, effect, amount_visible, s.width(), s.height());
-  drawer.ScrollOff(system, effect, amount_visible, s.width(), s.height());
+                                          int amount_visible,
+                                          Transition* transition) {
+  AddPane(transition,
+          drawer.SquashOn(amount_visible, s.width(), s.height()));
+  AddPane(transition,
+          drawer.ScrollOff(amount_visible, s.width(), s.height()));
 }
 
-void SquashOnSquashOff::ComposeEffectsFor(GraphicsSystem& system,
-                                          ScrollSquashSlideBaseEffect& effect,
+void SquashOnSquashOff::ComposeEffectsFor(const Size& s,
                                           ScrollSquashSlideDrawer& drawer,
-                                          int amount_visible) {
-  Size s = system.screen_size();
-  drawer.SquashOn(system, effect, amount_visible, s.width(), s.height());
-  drawer.SquashOff(system, effect, amount_visible, s.width(), s.height());
+                                          int amount_visible,
+                                          Transition* transition) {
+  AddPane(transition,
+          drawer.SquashOn(amount_visible, s.width(), s.height()));
+  AddPane(transition,
+          drawer.SquashOff(amount_visible, s.width(), s.height()));
 }
 
-void SlideOn::ComposeEffectsFor(GraphicsSystem& system,
-                                ScrollSquashSlideBaseEffect& effect,
+void SlideOn::ComposeEffectsFor(const Size& s,
                                 ScrollSquashSlideDrawer& drawer,
-                                int amount_visible) {
-  Size s = system.screen_size();
-  Rect screen_rect = system.screen_rect();
+                                int amount_visible,
+                                Transition* transition) {
+  Rect screen_rect(Point(0, 0), s);
 
   // Draw the old image
-  effect.dst_surface().RenderToScreen(screen_rect, screen_rect, 255);
+  transition->AddPane(Transition::FROM_IMAGE, screen_rect, screen_rect);
 
-  drawer.ScrollOn(system, effect, amount_visible, s.width(), s.height());
+  AddPane(transition,
+          drawer.ScrollOn(amount_visible, s.width(), s.height()));
 }
 
-void SlideOff::ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& effect,
+void SlideOff::ComposeEffectsFor(const Size& s,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) {
-  Size s = system.screen_size();
-  Rect screen_rect = system.screen_rect();
+                                 int amount_visible,
+                                 Transition* transition) {
+  Rect screen_rect(Point(0, 0), s);
 
-  effect.src_surface().RenderToScreen(screen_rect, screen_rect, 255);
+  transition->AddPane(Transition::TO_IMAGE, screen_rect, screen_rect);
 
-  drawer.ScrollOff(system, effect, amount_visible, s.width(), s.height());
+  AddPane(transition,
+          drawer.ScrollOff(amount_visible, s.width(), s.height()));
 }
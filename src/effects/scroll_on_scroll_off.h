@@ -29,8 +29,8 @@
 #define SRC_EFFECTS_SCROLL_ON_SCROLL_OFF_H_
 
 #include "effects/effect.h"
+#include "systems/base/transition.h"
 
-class GraphicsSystem;
 class ScrollSquashSlideDrawer;
 class ScrollSquashSlideEffectTypeBase;
 
@@ -45,7 +45,8 @@ class ScrollSquashSlideEffectTypeBase;
 // subclassess of ScrollSquashSlideDrawer, which describe the
 // direction to draw in. The second is
 // ScrollSquashSlideEffectTypeBase, which defines what combination of
-// primitives to use.
+// primitives to use. Each primitive is a Transition::Pane, so a frame is a
+// Transition of at most two panes.
 //
 // There are four drawer classes:
 // - TopToBottomDrawer
@@ -82,6 +83,11 @@ class ScrollSquashSlideBaseEffect : public Effect {
   // Implement the Effect interface
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int current_time) final;
+  virtual bool GetTransition(int current_time,
+                             Transition* transition) final;
+
+  // Builds the panes of the frame at |current_time|.
+  void ComposeFrame(int current_time, Transition* transition);
 
   // Drawer behavior class
   std::unique_ptr<ScrollSquashSlideDrawer> drawer_;
@@ -105,127 +111,87 @@ class ScrollSquashSlideDrawer {
   ScrollSquashSlideDrawer();
   virtual ~ScrollSquashSlideDrawer();
 
-  virtual int GetMaxSize(GraphicsSystem& gs) = 0;
-  virtual void ScrollOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) = 0;
-  virtual void ScrollOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) = 0;
-  virtual void SquashOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) = 0;
-  virtual void SquashOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) = 0;
+  virtual int GetMaxSize(const Size& screen) = 0;
+  virtual Transition::Pane ScrollOn(int amount_visible,
+                                    int width,
+                                    int height) = 0;
+  virtual Transition::Pane ScrollOff(int amount_visible,
+                                     int width,
+                                     int height) = 0;
+  virtual Transition::Pane SquashOn(int amount_visible,
+                                    int width,
+                                    int height) = 0;
+  virtual Transition::Pane SquashOff(int amount_visible,
+                                     int width,
+                                     int height) = 0;
 };
 
 class TopToBottomDrawer : public ScrollSquashSlideDrawer {
  public:
-  virtual int GetMaxSize(GraphicsSystem& gs) final;
-  virtual void ScrollOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void ScrollOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
-  virtual void SquashOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void SquashOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
+  virtual int GetMaxSize(const Size& screen) final;
+  virtual Transition::Pane ScrollOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane ScrollOff(int amount_visible,
+                                     int width,
+                                     int height) final;
+  virtual Transition::Pane SquashOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane SquashOff(int amount_visible,
+                                     int width,
+                                     int height) final;
 };
 
 class BottomToTopDrawer : public ScrollSquashSlideDrawer {
  public:
-  virtual int GetMaxSize(GraphicsSystem& gs) final;
-  virtual void ScrollOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void ScrollOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
-  virtual void SquashOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void SquashOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
+  virtual int GetMaxSize(const Size& screen) final;
+  virtual Transition::Pane ScrollOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane ScrollOff(int amount_visible,
+                                     int width,
+                                     int height) final;
+  virtual Transition::Pane SquashOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane SquashOff(int amount_visible,
+                                     int width,
+                                     int height) final;
 };
 
 class LeftToRightDrawer : public ScrollSquashSlideDrawer {
  public:
-  virtual int GetMaxSize(GraphicsSystem& gs) final;
-  virtual void ScrollOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void ScrollOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
-  virtual void SquashOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void SquashOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
+  virtual int GetMaxSize(const Size& screen) final;
+  virtual Transition::Pane ScrollOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane ScrollOff(int amount_visible,
+                                     int width,
+                                     int height) final;
+  virtual Transition::Pane SquashOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane SquashOff(int amount_visible,
+                                     int width,
+                                     int height) final;
 };
 
 class RightToLeftDrawer : public ScrollSquashSlideDrawer {
  public:
-  virtual int GetMaxSize(GraphicsSystem& gs) final;
-  virtual void ScrollOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void ScrollOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
-  virtual void SquashOn(GraphicsSystem&,
-                        ScrollSquashSlideBaseEffect&,
-                        int amount_visible,
-                        int width,
-                        int height) final;
-  virtual void SquashOff(GraphicsSystem&,
-                         ScrollSquashSlideBaseEffect&,
-                         int amount_visible,
-                         int width,
-                         int height) final;
+  virtual int GetMaxSize(const Size& screen) final;
+  virtual Transition::Pane ScrollOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane ScrollOff(int amount_visible,
+                                     int width,
+                                     int height) final;
+  virtual Transition::Pane SquashOn(int amount_visible,
+                                    int width,
+                                    int height) final;
+  virtual Transition::Pane SquashOff(int amount_visible,
+                                     int width,
+                                     int height) final;
 };
 
 // Effect Types
@@ -236,58 +202,61 @@ class RightToLeftDrawer : public ScrollSquashSlideDrawer {
 class ScrollSquashSlideEffectTypeBase {
  public:
   virtual ~ScrollSquashSlideEffectTypeBase();
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) = 0;
+                                 int amount_visible,
+                                 Transition* transition) = 0;
+
+ protected:
+  static void AddPane(Transition* transition, const Transition::Pane& pane);
 };
 
 class ScrollOnScrollOff : public ScrollSquashSlideEffectTypeBase {
  public:
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) final;
+                                 int amount_visible,
+                                 Transition* transition) final;
 };
 
 class ScrollOnSquashOff : public ScrollSquashSlideEffectTypeBase {
  public:
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) final;
+                                 int amount_visible,
+                                 Transition* transition) final;
 };
 
 class SquashOnScrollOff : public ScrollSquashSlideEffectTypeBase {
  public:
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) final;
+                                 int amount_visible,
+                                 Transition* transition) final;
 };
 
 class SquashOnSquashOff : public ScrollSquashSlideEffectTypeBase {
  public:
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) final;
+                                 int amount_visible,
+                                 Transition* transition) final;
 };
 
 class SlideOn : public ScrollSquashSlideEffectTypeBase {
  public:
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) final;
+                                 int amount_visible,
+                                 Transition* transition) final;
 };
 
 class SlideOff : public ScrollSquashSlideEffectTypeBase {
  public:
-  virtual void ComposeEffectsFor(GraphicsSystem& system,
-                                 ScrollSquashSlideBaseEffect& event,
+  virtual void ComposeEffectsFor(const Size& screen,
                                  ScrollSquashSlideDrawer& drawer,
-                                 int amount_visible) final;
+                                 int amount_visible,
+                                 Transition* transition) final;
 };
 
 #endif  // SRC_EFFECTS_SCROLL_ON_SCROLL_OFF_H_
@@ -27,12 +27,14 @@
 
 #include "effects/wipe_effect.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "machine/rlmachine.h"
 #include "systems/base/graphics_system.h"
 #include "systems/base/surface.h"
 #include "systems/base/system.h"
+#include "systems/base/transition.h"
 
 // -----------------------------------------------------------------------
 // WipeEffect base class
@@ -125,6 +127,15 @@ void WipeTopToBottomEffect::PerformEffectForTime(RLMachine& machine,
   }
 }
 
+bool WipeTopToBottomEffect::GetTransition(int currentTime,
+                                          Transition* transition) {
+  int sizeOfInterpolation, sizeOfMainPolygon;
+  CalculateSizes(currentTime, sizeOfInterpolation, sizeOfMainPolygon, height());
+  *transition = Transition::Wipe(
+      0, 1, 0, sizeOfMainPolygon, sizeOfInterpolation);
+  return true;
+}
+
 // -----------------------------------------------------------------------
 // WipeBottomToTopEffect
 // -----------------------------------------------------------------------
@@ -167,6 +178,15 @@ void WipeBottomToTopEffect::PerformEffectForTime(RLMachine& machine,
   }
 }
 
+bool WipeBottomToTopEffect::GetTransition(int currentTime,
+                                          Transition* transition) {
+  int sizeOfInterpolation, sizeOfMainPolygon;
+  CalculateSizes(currentTime, sizeOfInterpolation, sizeOfMainPolygon, height());
+  *transition = Transition::Wipe(
+      0, -1, height(), sizeOfMainPolygon, sizeOfInterpolation);
+  return true;
+}
+
 // -----------------------------------------------------------------------
 // WipeFromLeftToRightEffect
 // -----------------------------------------------------------------------
@@ -209,6 +229,15 @@ void WipeLeftToRightEffect::PerformEffectForTime(RLMachine& machine,
   }
 }
 
+bool WipeLeftToRightEffect::GetTransition(int currentTime,
+                                          Transition* transition) {
+  int sizeOfInterpolation, sizeOfMainPolygon;
+  CalculateSizes(currentTime, sizeOfInterpolation, sizeOfMainPolygon, width());
+  *transition = Transition::Wipe(
+      1, 0, 0, sizeOfMainPolygon, sizeOfInterpolation);
+  return true;
+}
+
 // -----------------------------------------------------------------------
 // WipeFromRightToLeftEffect
 // -----------------------------------------------------------------------
@@ -249,3 +278,124 @@ void WipeRightToLeftEffect::PerformEffectForTime(RLMachine& machine,
         opacity);
   }
 }
+
+bool WipeRightToLeftEffect::GetTransition(int currentTime,
+                                          Transition* transition) {
+  int sizeOfInterpolation, sizeOfMainPolygon;
+  CalculateSizes(currentTime, sizeOfInterpolation, sizeOfMainPolygon, width());
+  *transition = Transition::Wipe(
+      -1, 0, width(), sizeOfMainPolygon, sizeOfInterpolation);
+  return true;
+}
+
+// -----------------------------------------------------------------------
+// WipeDiagonalEffect
+// -----------------------------------------------------------------------
+
+WipeDiagonalEffect::WipeDiagonalEffect(RLMachine& machine,
+                                       std::shared_ptr<Surface> src,
+                                       std::shared_ptr<Surface> dst,
+                                       const Size& screen_size,
+                                       int time,
+                                       int interpolation,
+                                       int direction)
+    : WipeEffect(machine, src, dst, screen_size, time, interpolation),
+      direction_(direction) {}
+
+WipeDiagonalEffect::~WipeDiagonalEffect() {}
+
+void WipeDiagonalEffect::PerformEffectForTime(RLMachine& machine,
+                                              int currentTime) {
+  int sizeOfInterpolation, sizeOfMainPolygon;
+  CalculateSizes(currentTime, sizeOfInterpolation, sizeOfMainPolygon,
+                 width() + height());
+
+  float axis_x, axis_y, axis_origin;
+  GetAxis(&axis_x, &axis_y, &axis_origin);
+
+  // There's no way to draw a diagonal gradient with RenderToScreen(), so draw
+  // the wipe a column at a time. Down each column, the position along the
+  // axis changes by one per pixel, and the origins in GetAxis() put every
+  // whole position on a pixel edge.
+  auto opacity_at = [&](int position) {
+    return std::min(255, std::max(0, (sizeOfMainPolygon + sizeOfInterpolation -
+                                      position) * 255 / sizeOfInterpolation));
+  };
+
+  for (int x = 0; x < width(); ++x) {
+    // Position of the top edge of the column.
+    int top = int(std::lround(axis_x * (x + 0.5f) + axis_origin));
+    int solid_top, solid_bottom, band_top, band_bottom;
+    if (axis_y > 0) {
+      solid_top = 0;
+      solid_bottom = sizeOfMainPolygon - top;
+      band_top = solid_bottom;
+      band_bottom = band_top + sizeOfInterpolation;
+    } else {
+      solid_top = top - sizeOfMainPolygon;
+      solid_bottom = height();
+      band_bottom = solid_top;
+      band_top = band_bottom - sizeOfInterpolation;
+    }
+
+    solid_top = std::max(0, solid_top);
+    solid_bottom = std::min(height(), solid_bottom);
+    if (solid_top < solid_bottom) {
+      Rect column = Rect::GRP(x, solid_top, x + 1, solid_bottom);
+      src_surface().RenderToScreen(column, column, 255);
+    }
+
+    band_top = std::max(0, band_top);
+    band_bottom = std::min(height(), band_bottom);
+    if (band_top < band_bottom) {
+      int top_opacity = opacity_at(top + int(axis_y) * band_top);
+      int bottom_opacity = opacity_at(top + int(axis_y) * band_bottom);
+      int opacity[4] = {top_opacity, top_opacity, bottom_opacity,
+                        bottom_opacity};
+      Rect column = Rect::GRP(x, band_top, x + 1, band_bottom);
+      src_surface().RenderToScreen(column, column, opacity);
+    }
+  }
+}
+
+bool WipeDiagonalEffect::GetTransition(int currentTime,
+                                       Transition* transition) {
+  int sizeOfInterpolation, sizeOfMainPolygon;
+  CalculateSizes(currentTime, sizeOfInterpolation, sizeOfMainPolygon,
+                 width() + height());
+
+  float axis_x, axis_y, axis_origin;
+  GetAxis(&axis_x, &axis_y, &axis_origin);
+  *transition = Transition::Wipe(
+      axis_x, axis_y, axis_origin, sizeOfMainPolygon, sizeOfInterpolation);
+  return true;
+}
+
+void WipeDiagonalEffect::GetAxis(float* axis_x,
+                                 float* axis_y,
+                                 float* axis_origin) const {
+  // The half pixel origins line the wipe up with pixel edges; see
+  // PerformEffectForTime().
+  switch (direction_) {
+    case 0:
+      *axis_x = 1;
+      *axis_y = 1;
+      *axis_origin = -0.5f;
+      break;
+    case 1:
+      *axis_x = 1;
+      *axis_y = -1;
+      *axis_origin = height() - 0.5f;
+      break;
+    case 2:
+      *axis_x = -1;
+      *axis_y = 1;
+      *axis_origin = width() - 0.5f;
+      break;
+    default:
+      *axis_x = -1;
+      *axis_y = -1;
+      *axis_origin = width() + height() - 0.5f;
+      break;
+  }
+}
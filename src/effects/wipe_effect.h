@@ -74,6 +74,8 @@ class WipeTopToBottomEffect : public WipeEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
 };
 
 // Implements SEL #10, Wipe, with direction 1, bottom to top.
@@ -90,6 +92,8 @@ class WipeBottomToTopEffect : public WipeEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
 };
 
 // Implements SEL #10, Wipe, with direction 2, left to right.
@@ -106,6 +110,8 @@ class WipeLeftToRightEffect : public WipeEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
 };
 
 // Implements SEL #10, Wipe, with direction 3, right to left.
@@ -122,6 +128,35 @@ class WipeRightToLeftEffect : public WipeEffect {
  protected:
   virtual void PerformEffectForTime(RLMachine& machine,
                                     int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
+};
+
+// Implements SEL #130, Wipe along a diagonal, with direction 0 from top left
+// to bottom right, 1 from bottom left to top right, 2 from top right to
+// bottom left and 3 from bottom right to top left.
+class WipeDiagonalEffect : public WipeEffect {
+ public:
+  WipeDiagonalEffect(RLMachine& machine,
+                     std::shared_ptr<Surface> src,
+                     std::shared_ptr<Surface> dst,
+                     const Size& screen_size,
+                     int time,
+                     int interpolation,
+                     int direction);
+  virtual ~WipeDiagonalEffect();
+
+ protected:
+  virtual void PerformEffectForTime(RLMachine& machine,
+                                    int currentTime) final;
+  virtual bool GetTransition(int currentTime,
+                             Transition* transition) final;
+
+ private:
+  // The Transition axis that the wipe moves along.
+  void GetAxis(float* axis_x, float* axis_y, float* axis_origin) const;
+
+  int direction_;
 };
 
 #endif  // SRC_EFFECTS_WIPE_EFFECT_H_
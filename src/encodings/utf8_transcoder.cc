@@ -0,0 +1,294 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "encodings/utf8_transcoder.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+#include <functional>
+#include <memory>
+
+#include "encodings/codepage.h"
+#include "encodings/cp932.h"
+#include "encodings/cp936.h"
+#include "encodings/cp949.h"
+#include "encodings/western.h"
+#include "utilities/string_utilities.h"
+
+namespace {
+
+// Used for byte sequences which the codepage tables don't cover.
+const uint16_t kReplacementCharacter = 0xfffd;
+
+// A single byte can expand to at most a three byte BMP character.
+const size_t kMaxExpansion = 3;
+
+// Maps a transformation number onto the ones we have tables for; anything
+// unknown is treated as Cp932, matching Cp::instance().
+int NormalizeTransformation(int transformation) {
+  return transformation >= 1 && transformation <= 3 ? transformation : 0;
+}
+
+std::unique_ptr<Codepage> MakeCodepage(int transformation) {
+  switch (transformation) {
+    case 1:
+      return std::unique_ptr<Codepage>(new Cp936);
+    case 2:
+      return std::unique_ptr<Codepage>(new Cp1252);
+    case 3:
+      return std::unique_ptr<Codepage>(new Cp949);
+    default:
+      return std::unique_ptr<Codepage>(new Cp932);
+  }
+}
+
+// Whether |c| starts a two byte sequence. This is wider than the tables: a
+// lead byte they don't cover still takes its trail byte with it, so that one
+// unknown character doesn't throw off everything after it.
+bool IsLeadByte(int transformation, int c) {
+  switch (transformation) {
+    case 1:
+    case 3:
+      return c >= 0x81 && c <= 0xfe;
+    case 2:
+      return false;
+    default:
+      return shiftjis_lead_byte(c);
+  }
+}
+
+// Whether |c| is inside the codepage's table when it is a lead byte. Cp949's
+// table stops before the hanja and user defined rows.
+bool IsMappedLeadByte(int transformation, int c) {
+  switch (transformation) {
+    case 3:
+      return c <= 0xc8;
+    default:
+      return true;
+  }
+}
+
+// Whether |c| is inside the codepage's table when it isn't a lead byte.
+bool IsMappedSingleByte(int transformation, int c) {
+  switch (transformation) {
+    case 1:
+      return c <= 0x80;
+    case 3:
+      return c <= 0x7f;
+    default:
+      return true;
+  }
+}
+
+// Whether |c| is inside the codepage's table when it follows a lead byte.
+bool IsMappedTrailByte(int transformation, int c) {
+  switch (transformation) {
+    case 1:
+      return c >= 0x40 && c <= 0xfe;
+    case 3:
+      return c >= 0x41 && c <= 0xfe;
+    default:
+      return true;
+  }
+}
+
+// Copies the run of ASCII starting at |s| to |d|, advancing both past it. The
+// run ends at the first byte that is either NUL or has its high bit set. |d|
+// must have room for kMaxExpansion times the remaining input.
+inline void CopyAsciiRun(const uint8_t*& s, const uint8_t* end, char*& d) {
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  while (end - s >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d), v);
+    int stop = _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+    if (stop) {
+      int run = __builtin_ctz(stop);
+      s += run;
+      d += run;
+      return;
+    }
+    s += 16;
+    d += 16;
+  }
+#endif
+  while (s < end && *s != 0 && *s < 0x80)
+    *d++ = *s++;
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// Utf8Transcoder
+// -----------------------------------------------------------------------
+
+Utf8Transcoder::Utf8Transcoder(int transformation)
+    : transformation_(NormalizeTransformation(transformation)),
+      ascii_is_identity_(true),
+      memo_(kMemoSlots),
+      memo_hits_(0),
+      memo_misses_(0) {
+  BuildTables();
+}
+
+Utf8Transcoder::~Utf8Transcoder() {}
+
+// static
+Utf8Transcoder& Utf8Transcoder::ForTransformation(int transformation) {
+  static std::unique_ptr<Utf8Transcoder> transcoders[4];
+  std::unique_ptr<Utf8Transcoder>& transcoder =
+      transcoders[NormalizeTransformation(transformation)];
+  if (!transcoder)
+    transcoder.reset(new Utf8Transcoder(transformation));
+  return *transcoder;
+}
+
+void Utf8Transcoder::Append(const char* data,
+                            size_t size,
+                            std::string* out) const {
+  // Write into space reserved for the worst case and trim afterwards, so the
+  // loop below never has to check for room. Each character is copied as four
+  // bytes, hence the one byte of slack.
+  size_t start = out->size();
+  out->resize(start + size * kMaxExpansion + 1);
+  char* begin = &(*out)[start];
+  char* d = begin;
+
+  const uint8_t* s = reinterpret_cast<const uint8_t*>(data);
+  const uint8_t* end = s + size;
+  while (s < end) {
+    if (ascii_is_identity_ && *s < 0x80) {
+      CopyAsciiRun(s, end, d);
+      if (s == end)
+        break;
+    }
+
+    uint8_t c = *s;
+    if (c == 0)
+      break;
+
+    const Utf8Char* ch = &single_byte_[c];
+    if (ch->length == 0) {
+      if (end - s < 2 || s[1] == 0)
+        break;
+      ch = &double_byte_[((c & 0x7f) << 8) | s[1]];
+      s += 2;
+    } else {
+      s++;
+    }
+
+    memcpy(d, ch, sizeof(Utf8Char));
+    d += ch->length;
+  }
+
+  out->resize(start + (d - begin));
+}
+
+std::string Utf8Transcoder::Transcode(const std::string& in) {
+  std::string out;
+  if (in.empty())
+    return out;
+
+  if (in.size() > kMaxMemoBytes) {
+    Append(in.data(), in.size(), &out);
+    return out;
+  }
+
+  MemoEntry& entry = memo_[std::hash<std::string>()(in) % kMemoSlots];
+  if (entry.key == in) {
+    memo_hits_++;
+    return entry.value;
+  }
+
+  memo_misses_++;
+  Append(in.data(), in.size(), &out);
+  entry.key = in;
+  entry.value = out;
+  return out;
+}
+
+// static
+Utf8Transcoder::Utf8Char Utf8Transcoder::EncodeCodepoint(
+    uint16_t codepoint) {
+  Utf8Char out = {{0, 0, 0}, 0};
+  if (codepoint < 0x80) {
+    out.bytes[0] = codepoint;
+    out.length = 1;
+  } else if (codepoint < 0x800) {
+    out.bytes[0] = 0xc0 | (codepoint >> 6);
+    out.bytes[1] = 0x80 | (codepoint & 0x3f);
+    out.length = 2;
+  } else {
+    out.bytes[0] = 0xe0 | (codepoint >> 12);
+    out.bytes[1] = 0x80 | ((codepoint >> 6) & 0x3f);
+    out.bytes[2] = 0x80 | (codepoint & 0x3f);
+    out.length = 3;
+  }
+  return out;
+}
+
+void Utf8Transcoder::BuildTables() {
+  std::unique_ptr<Codepage> codepage = MakeCodepage(transformation_);
+  const Utf8Char replacement = EncodeCodepoint(kReplacementCharacter);
+
+  bool has_double_bytes = false;
+  for (int c = 0; c < 256; ++c) {
+    if (IsLeadByte(transformation_, c)) {
+      single_byte_[c] = Utf8Char();
+      has_double_bytes = true;
+    } else if (IsMappedSingleByte(transformation_, c)) {
+      single_byte_[c] = EncodeCodepoint(codepage->Convert(c));
+    } else {
+      single_byte_[c] = replacement;
+    }
+
+    if (c < 0x80 && (single_byte_[c].length != 1 ||
+                     uint8_t(single_byte_[c].bytes[0]) != c)) {
+      ascii_is_identity_ = false;
+    }
+  }
+
+  if (!has_double_bytes)
+    return;
+
+  double_byte_.assign(0x80 * 0x100, replacement);
+  for (int lead = 0x80; lead < 0x100; ++lead) {
+    if (!IsLeadByte(transformation_, lead) ||
+        !IsMappedLeadByte(transformation_, lead)) {
+      continue;
+    }
+
+    for (int trail = 0; trail < 0x100; ++trail) {
+      if (IsMappedTrailByte(transformation_, trail)) {
+        double_byte_[((lead & 0x7f) << 8) | trail] =
+            EncodeCodepoint(codepage->Convert((lead << 8) | trail));
+      }
+    }
+  }
+}
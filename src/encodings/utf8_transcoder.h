@@ -0,0 +1,110 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_ENCODINGS_UTF8_TRANSCODER_H_
+#define SRC_ENCODINGS_UTF8_TRANSCODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Converts text in one of the game encodings (see TransformationName())
+// straight to UTF-8 in a single pass.
+//
+// The per-character work is done up front: on first use, every single byte
+// and every lead/trail byte pair of the encoding is run through the matching
+// Codepage and the resulting UTF-8 bytes are stored in flat tables, so
+// transcoding is a table load and a short copy per character. Runs of ASCII
+// are copied sixteen bytes at a time where SSE2 is available.
+//
+// Like Codepage::ConvertString(), conversion stops at the first NUL. A lead
+// byte with no trail byte after it is dropped.
+class Utf8Transcoder {
+ public:
+  explicit Utf8Transcoder(int transformation);
+  ~Utf8Transcoder();
+
+  // Returns the shared transcoder for |transformation|, building its tables
+  // the first time it is asked for.
+  static Utf8Transcoder& ForTransformation(int transformation);
+
+  // Appends the UTF-8 form of the |size| bytes at |data| to |out|.
+  void Append(const char* data, size_t size, std::string* out) const;
+
+  // Returns the UTF-8 form of |in|. Short strings go through a small memo
+  // cache, since names, window titles and the like are converted over and
+  // over again.
+  std::string Transcode(const std::string& in);
+
+  int transformation() const { return transformation_; }
+
+  // Memo cache statistics since construction.
+  int memo_hits() const { return memo_hits_; }
+  int memo_misses() const { return memo_misses_; }
+
+  // Strings longer than this bypass the memo cache.
+  static const size_t kMaxMemoBytes = 64;
+
+ private:
+  // The UTF-8 bytes of one character. |length| of 0 marks a lead byte, whose
+  // character is in |double_byte_| instead.
+  struct Utf8Char {
+    char bytes[3];
+    uint8_t length;
+  };
+
+  struct MemoEntry {
+    std::string key;
+    std::string value;
+  };
+
+  static const int kMemoSlots = 64;
+
+  static Utf8Char EncodeCodepoint(uint16_t codepoint);
+
+  void BuildTables();
+
+  int transformation_;
+
+  // Indexed by byte.
+  Utf8Char single_byte_[256];
+
+  // Indexed by ((lead & 0x7f) << 8) | trail. Empty for encodings without
+  // double byte characters.
+  std::vector<Utf8Char> double_byte_;
+
+  // True if every byte below 0x80 converts to itself, which is what allows
+  // the ASCII fast path.
+  bool ascii_is_identity_;
+
+  // Direct mapped on the hash of the input.
+  std::vector<MemoEntry> memo_;
+  int memo_hits_;
+  int memo_misses_;
+};
+
+#endif  // SRC_ENCODINGS_UTF8_TRANSCODER_H_
@@ -27,8 +27,9 @@
 
 #include "long_operations/textout_long_operation.h"
 
-#include <string>
 #include <algorithm>
+#include <climits>
+#include <string>
 
 #include "long_operations/pause_long_operation.h"
 #include "machine/rlmachine.h"
@@ -39,7 +40,6 @@
 #include "systems/base/text_page.h"
 #include "systems/base/text_system.h"
 #include "utilities/exception.h"
-#include "utf8cpp/utf8.h"
 
 // Timing information must stay the same between individual
 // TextoutLongOperations. rlBabel compiled games will always display one
@@ -53,20 +53,10 @@ int TextoutLongOperation::next_character_countdown_ = 0;
 
 TextoutLongOperation::TextoutLongOperation(RLMachine& machine,
                                            const std::string& utf8string)
-    : utf8_string_(utf8string),
-      current_codepoint_(0),
-      current_position_(utf8_string_.begin()),
+    : layout_(utf8string),
+      index_(0),
+      current_codepoint_(layout_.codepoint(0)),
       no_wait_(false) {
-  // Retrieve the first character (prime the loop in operator())
-  string::iterator tmp = current_position_;
-  if (tmp == utf8_string_.end()) {
-    current_char_ = "";
-  } else {
-    current_codepoint_ = utf8::next(tmp, utf8_string_.end());
-    current_char_ = string(current_position_, tmp);
-    current_position_ = tmp;
-  }
-
   // If we are inside a ruby gloss right now, don't delay at
   // all. Render the entire gloss!
   if (machine.system().text().GetCurrentPage().in_ruby_gloss())
@@ -96,7 +86,7 @@ bool TextoutLongOperation::KeyStateChanged(KeyCode keyCode, bool pressed) {
 
 bool TextoutLongOperation::DisplayAsMuchAsWeCanThenPause(RLMachine& machine) {
   bool paused = false;
-  while (!DisplayOneMoreCharacter(machine, paused))
+  while (!DisplayCharacters(machine, INT_MAX, paused))
     if (paused)
       return false;
 
@@ -108,88 +98,59 @@ bool TextoutLongOperation::DisplayName(RLMachine& machine) {
   // name, even though character names are one of the places where that's
   // evaluated.
 
-  // Ignore the starting bracket
-  string::iterator it = current_position_;
-  string::iterator curend = it;
-  string::iterator strend = utf8_string_.end();
-  int codepoint = utf8::next(it, strend);
+  // Ignore the starting bracket and find the closing one.
+  int end = index_ + 1;
+  while (end < layout_.size() && layout_.codepoint(end) != 0x3011)
+    ++end;
 
-  // Eat all characters between the name brackets
-  while (codepoint != 0x3011 && it != strend) {
-    curend = it;
-    codepoint = utf8::next(it, strend);
-  }
-
-  if (codepoint != 0x3011 && it == strend) {
+  if (end == layout_.size()) {
     throw SystemError(
         "Malformed string code. Opening bracket in \\{name}"
         " construct,  but missing closing bracket.");
   }
 
-  // Grab the name
-  string name(current_position_, curend);
-
-  // Consume the next character
-  current_position_ = it;
-
-  if (it != strend) {
-    current_codepoint_ = utf8::next(it, strend);
-    current_char_ = string(current_position_, it);
-    current_position_ = it;
-  }
+  // Grab the name, and consume the character after it.
+  std::string name = layout_.Characters(index_ + 1, end);
+  index_ = end + 1;
+  current_codepoint_ = layout_.codepoint(index_);
 
   TextPage& page = machine.system().text().GetCurrentPage();
-  page.Name(name, current_char_);
+  page.Name(name, layout_.Character(index_));
 
   // Stop if this was the end of input
-  return it == strend;
+  return index_ + 1 >= layout_.size();
 }
 
-bool TextoutLongOperation::DisplayOneMoreCharacter(RLMachine& machine,
-                                                   bool& paused) {
+bool TextoutLongOperation::DisplayCharacters(RLMachine& machine,
+                                             int count,
+                                             bool& paused) {
   if (current_codepoint_ == 0x3010) {
     // The current character is the opening character for a name. We
     // treat names as a single display operation
     return DisplayName(machine);
-  } else {
-    // Isolate the next character
-    string::iterator it = current_position_;
-    string::iterator strend = utf8_string_.end();
-
-    if (it != strend) {
-      int codepoint = utf8::next(it, strend);
-      TextPage& page = machine.system().text().GetCurrentPage();
-      if (codepoint) {
-        string rest(current_position_, strend);
-        bool rendered = page.Character(current_char_, rest);
-
-        // Check to see if this character was rendered to the screen. If
-        // this is false, then the page is probably full and the check
-        // later on will do something about that.
-        if (rendered) {
-          current_char_ = std::string(current_position_, it);
-          current_position_ = it;
-        }
-      } else {
-        // advance to the next character if we've somehow hit an
-        // embedded NULL that isn't the end of the string
-        current_position_ = it;
-      }
-
-      // Call the pause operation if we've filled up the current page.
-      if (page.IsFull()) {
-        paused = true;
-        machine.system().graphics().MarkScreenAsDirty(GUT_TEXTSYS);
-        machine.PushLongOperation(
-            new NewPageAfterLongop(new PauseLongOperation(machine)));
-      }
-
-      return false;
-    } else {
-      machine.system().text().GetCurrentPage().Character(current_char_, "");
+  }
 
-      return true;
+  TextPage& page = machine.system().text().GetCurrentPage();
+  int last = layout_.size() - 1;
+  if (index_ < last) {
+    // Characters that weren't rendered to the screen didn't fit; the page is
+    // probably full and the check below will do something about that.
+    int end = index_ + std::min(count, last - index_);
+    index_ += page.Characters(layout_, index_, end);
+
+    // Call the pause operation if we've filled up the current page.
+    if (page.IsFull()) {
+      paused = true;
+      machine.system().graphics().MarkScreenAsDirty(GUT_TEXTSYS);
+      machine.PushLongOperation(
+          new NewPageAfterLongop(new PauseLongOperation(machine)));
     }
+
+    return false;
+  } else {
+    page.Character(layout_, index_);
+
+    return true;
   }
 }
 
@@ -209,7 +170,7 @@ bool TextoutLongOperation::operator()(RLMachine& machine) {
     if (next_character_countdown_ <= 0) {
       bool paused = false;
       next_character_countdown_ = machine.system().text().message_speed();
-      return DisplayOneMoreCharacter(machine, paused);
+      return DisplayCharacters(machine, 1, paused);
     } else {
       // Let's sleep a bit and then try again.
       return false;
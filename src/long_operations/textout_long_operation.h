@@ -32,6 +32,7 @@
 
 #include "machine/long_operation.h"
 #include "systems/base/event_listener.h"
+#include "systems/base/text_layout.h"
 
 class RLMachine;
 
@@ -55,13 +56,19 @@ class TextoutLongOperation : public LongOperation {
   // Extract a name and send it to the text system as an automic
   // operation.
   bool DisplayName(RLMachine& machine);
-  bool DisplayOneMoreCharacter(RLMachine& machine, bool& paused);
 
-  std::string utf8_string_;
+  // Displays up to |count| more characters, stopping early at the end of the
+  // page.
+  bool DisplayCharacters(RLMachine& machine, int count, bool& paused);
 
+  // The whole message, split into characters once up front.
+  TextLayout layout_;
+
+  // The character we display next.
+  int index_;
+
+  // The codepoint at |index_| when we started or just finished a name.
   int current_codepoint_;
-  std::string current_char_;
-  std::string::iterator current_position_;
 
   // Sets whether we should display as much text as we can immediately.
   bool no_wait_;
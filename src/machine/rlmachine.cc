@@ -58,6 +58,7 @@
 #include "machine/rloperation.h"
 #include "machine/serialization.h"
 #include "machine/stack_frame.h"
+#include "systems/base/event_system.h"
 #include "systems/base/graphics_system.h"
 #include "systems/base/system.h"
 #include "systems/base/system_error.h"
@@ -316,6 +317,32 @@ void RLMachine::ExecuteUntilHalted() {
   }
 }
 
+unsigned int RLMachine::ExecuteTimeSlice() {
+  // While fast forwarding, most long operations finish straight away, so
+  // keep going through them until the next frame is due to be presented.
+  // One that is still on the stack after it ran is waiting for something
+  // (input, a movie, ...) and needs events pumped before it can progress.
+  unsigned int start_ticks = system().event().GetTicks();
+  unsigned int end_ticks = start_ticks;
+  unsigned int time_slice = 10;
+  bool fast_forward = false;
+  bool waiting = false;
+  do {
+    std::shared_ptr<LongOperation> before = CurrentLongOperation();
+    ExecuteNextInstruction();
+    end_ticks = system().event().GetTicks();
+
+    std::shared_ptr<LongOperation> after = CurrentLongOperation();
+    fast_forward = system().ShouldFastForward();
+    waiting = after && (!fast_forward || after == before);
+    time_slice =
+        fast_forward ? system().graphics().skip_frame_interval() : 10;
+  } while (!waiting && !halted() && !system().force_wait() &&
+           (end_ticks - start_ticks < time_slice));
+
+  return end_ticks - start_ticks;
+}
+
 void RLMachine::AdvanceInstructionPointer() {
   if (!replaying_graphics_stack()) {
     std::vector<StackFrame>::reverse_iterator it =
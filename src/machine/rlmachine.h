@@ -278,6 +278,12 @@ class RLMachine {
   // fire between RLMachine instructions.
   void ExecuteUntilHalted();
 
+  // Runs instructions for one slice of the main loop: 10ms normally, or
+  // until the next frame is due while fast forwarding. Stops early when a
+  // long operation is waiting on the user, or when the system asks for a
+  // wait. Returns the number of ticks spent.
+  unsigned int ExecuteTimeSlice();
+
   // Increments the stack pointer in the current frame. If we have run
   // off the end of the current scenario, set the halted bit.
   void AdvanceInstructionPointer();
@@ -67,7 +67,14 @@ RLVMInstance::RLVMInstance()
       count_undefined_copcodes_(false),
       tracing_(false),
       load_save_(-1),
-      dump_seen_(-1) {
+      dump_seen_(-1),
+      image_cache_mb_(0),
+      skip_fps_(0),
+      backlog_kb_(0),
+      backlog_on_disk_(false),
+      no_damage_tracking_(false),
+      no_layer_cache_(false),
+      no_texture_atlas_(false) {
   srand(time(NULL));
 }
 
@@ -103,6 +110,27 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
       gameexe("__GAMEFONT") = custom_font_;
     }
 
+    if (image_cache_mb_ > 0)
+      gameexe("__IMAGE_CACHE_MB") = image_cache_mb_;
+
+    if (skip_fps_ > 0)
+      gameexe("__SKIP_FPS") = skip_fps_;
+
+    if (backlog_kb_ > 0)
+      gameexe("__BACKLOG_KB") = backlog_kb_;
+
+    if (backlog_on_disk_)
+      gameexe("__BACKLOG_SPILL") = 1;
+
+    if (no_damage_tracking_)
+      gameexe("__NO_DAMAGE_TRACKING") = 1;
+
+    if (no_layer_cache_)
+      gameexe("__NO_LAYER_CACHE") = 1;
+
+    if (no_texture_atlas_)
+      gameexe("__NO_TEXTURE_ATLAS") = 1;
+
     libreallive::Archive arc(seenPath.string(), gameexe("REGNAME"));
     SDLSystem sdlSystem(gameexe);
     RLMachine rlmachine(sdlSystem, arc);
@@ -158,21 +186,13 @@ void RLVMInstance::Run(const boost::filesystem::path& gamerootPath) {
       sdlSystem.Run(rlmachine);
 
       // Run the rlmachine through as many instructions as we can in a 10ms time
-      // slice. Bail out if we switch to long operation mode, or if the screen
-      // is marked as dirty.
-      unsigned int start_ticks = sdlSystem.event().GetTicks();
-      unsigned int end_ticks = start_ticks;
-      do {
-        rlmachine.ExecuteNextInstruction();
-        end_ticks = sdlSystem.event().GetTicks();
-      } while (!rlmachine.CurrentLongOperation() &&
-               !sdlSystem.force_wait() &&
-               (end_ticks - start_ticks < 10));
+      // slice (or up to the next skipped frame while fast forwarding).
+      unsigned int elapsed = rlmachine.ExecuteTimeSlice();
 
       // Sleep to be nice to the processor and to give the GPU a chance to
       // catch up.
       if (!sdlSystem.ShouldFastForward()) {
-        int real_sleep_time = 10 - (end_ticks - start_ticks);
+        int real_sleep_time = 10 - elapsed;
         if (real_sleep_time < 1)
           real_sleep_time = 1;
         sdlSystem.event().Wait(real_sleep_time);
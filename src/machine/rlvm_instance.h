@@ -51,6 +51,13 @@ class RLVMInstance {
   void set_tracing() { tracing_ = true; }
   void set_load_save(int in) { load_save_ = in; }
   void set_custom_font(const std::string& font) { custom_font_ = font; }
+  void set_image_cache_size(int megabytes) { image_cache_mb_ = megabytes; }
+  void set_skip_fps(int fps) { skip_fps_ = fps; }
+  void set_backlog_size(int kilobytes) { backlog_kb_ = kilobytes; }
+  void set_backlog_on_disk() { backlog_on_disk_ = true; }
+  void set_no_damage_tracking() { no_damage_tracking_ = true; }
+  void set_no_layer_cache() { no_layer_cache_ = true; }
+  void set_no_texture_atlas() { no_texture_atlas_ = true; }
 
   void set_dump_seen(int in) { dump_seen_ = in; }
 
@@ -110,6 +117,27 @@ class RLVMInstance {
 
   // Dumps pseudo-kepago of the current seen to stdout and exit if not -1.
   int dump_seen_;
+
+  // Size cap of the on disk decoded image cache, in megabytes. 0 disables it.
+  int image_cache_mb_;
+
+  // Frames per second presented while skipping. 0 uses the default.
+  int skip_fps_;
+
+  // Memory budget of the message backlog in kilobytes. 0 uses the default.
+  int backlog_kb_;
+
+  // Whether the message backlog lives in a mapped file.
+  bool backlog_on_disk_;
+
+  // Whether every refresh should redraw the whole screen.
+  bool no_damage_tracking_;
+
+  // Whether every refresh should draw every object.
+  bool no_layer_cache_;
+
+  // Whether every small image should get a texture of its own.
+  bool no_texture_atlas_;
 };
 
 #endif  // SRC_MACHINE_RLVM_INSTANCE_H_
@@ -206,6 +206,7 @@ void loadGameFrom(std::istream& iss, RLMachine& machine) {
 
     machine.system().graphics().ReplayGraphicsStack(machine);
 
+    machine.system().graphics().InvalidateScreen();
     machine.system().graphics().ForceRefresh();
   }
   catch (std::exception& e) {
@@ -386,13 +386,12 @@ class objEveAdjust : public RLOpcode<IntConstant_T,
       return new AdjustMutator(*this);
     }
 
-    virtual void PerformSetting(RLMachine& machine,
+    virtual void PerformSetting(ObjectMutatorBatch& batch,
                                 GraphicsObject& object) override {
-      int x = GetValueForTime(machine, start_x_, end_x_);
-      object.SetXAdjustment(repno_, x);
-
-      int y = GetValueForTime(machine, start_y_, end_y_);
-      object.SetYAdjustment(repno_, y);
+      AddSetting(batch, object, &GraphicsObject::SetXAdjustment, repno_,
+                 start_x_, end_x_);
+      AddSetting(batch, object, &GraphicsObject::SetYAdjustment, repno_,
+                 start_y_, end_y_);
     }
 
     int repno_;
@@ -517,23 +516,20 @@ class DisplayMutator : public ObjectMutator {
     return new DisplayMutator(*this);
   }
 
-  virtual void PerformSetting(RLMachine& machine,
+  virtual void PerformSetting(ObjectMutatorBatch& batch,
                               GraphicsObject& object) override {
     // While performing whatever visual transition, the object should be
     // displayed.
-    object.SetVisible(true);
+    AddSetting(batch, object, &GraphicsObject::SetVisible, 1, 1);
 
-    if (tr_mod_) {
-      int alpha = GetValueForTime(machine, tr_start_, tr_end_);
-      object.SetAlpha(alpha);
-    }
+    if (tr_mod_)
+      AddSetting(batch, object, &GraphicsObject::SetAlpha, tr_start_, tr_end_);
 
     if (move_mod_) {
-      int x = GetValueForTime(machine, move_start_x_, move_end_x_);
-      object.SetX(x);
-
-      int y = GetValueForTime(machine, move_start_y_, move_end_y_);
-      object.SetY(y);
+      AddSetting(batch, object, &GraphicsObject::SetX, move_start_x_,
+                 move_end_x_);
+      AddSetting(batch, object, &GraphicsObject::SetY, move_start_y_,
+                 move_end_y_);
     }
   }
 
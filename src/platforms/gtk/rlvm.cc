@@ -87,7 +87,16 @@ int main(int argc, char* argv[]) {
   opts.add_options()("help", "Produce help message")(
       "help-debug", "Print help message for people working on rlvm")(
       "version", "Display version and license information")(
-      "font", po::value<string>(), "Specifies TrueType font to use.");
+      "font", po::value<string>(), "Specifies TrueType font to use.")(
+      "image-cache", po::value<int>(),
+      "Keeps up to this many megabytes of decoded images on disk so they "
+      "load faster next time")(
+      "skip-fps", po::value<int>(),
+      "How many frames a second to show while skipping text (default 15)")(
+      "backlog-kb", po::value<int>(),
+      "Keeps up to this many kilobytes of message backlog (default 256)")(
+      "backlog-on-disk",
+      "Keeps the message backlog in a mapped file instead of in memory");
 
   po::options_description debugOpts("Debugging Options");
   debugOpts.add_options()(
@@ -98,7 +107,16 @@ int main(int argc, char* argv[]) {
       "undefined-opcodes", "Display a message on undefined opcodes")(
       "count-undefined",
       "On exit, present a summary table about how many times each undefined "
-      "opcode was called")("trace", "Prints opcodes as they are run)");
+      "opcode was called")("trace", "Prints opcodes as they are run)")(
+      "no-damage-tracking",
+      "Redraws the whole screen on every refresh instead of only what "
+      "changed")(
+      "no-layer-cache",
+      "Draws every object on every refresh instead of caching the unchanging "
+      "background and objects beneath the animating ones")(
+      "no-texture-atlas",
+      "Gives every small image its own texture instead of packing them into "
+      "shared ones");
 
   // Declare the final option to be game-root
   po::options_description hidden("Hidden");
@@ -216,6 +234,27 @@ int main(int argc, char* argv[]) {
   if (vm.count("font"))
     instance.set_custom_font(vm["font"].as<string>());
 
+  if (vm.count("image-cache"))
+    instance.set_image_cache_size(vm["image-cache"].as<int>());
+
+  if (vm.count("skip-fps"))
+    instance.set_skip_fps(vm["skip-fps"].as<int>());
+
+  if (vm.count("backlog-kb"))
+    instance.set_backlog_size(vm["backlog-kb"].as<int>());
+
+  if (vm.count("backlog-on-disk"))
+    instance.set_backlog_on_disk();
+
+  if (vm.count("no-damage-tracking"))
+    instance.set_no_damage_tracking();
+
+  if (vm.count("no-layer-cache"))
+    instance.set_no_layer_cache();
+
+  if (vm.count("no-texture-atlas"))
+    instance.set_no_texture_atlas();
+
   instance.Run(gamerootPath);
 
   return 0;
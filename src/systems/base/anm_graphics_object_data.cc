@@ -63,6 +63,21 @@ static const int ANM_MAGIC_SIZE = 12;
 static const char ANM_MAGIC[ANM_MAGIC_SIZE] = {'A', 'N', 'M', '3', '2', 0,
                                                0,   0,   0,   1,   0,   0};
 
+// -----------------------------------------------------------------------
+// AnmDefinition
+// -----------------------------------------------------------------------
+
+size_t AnmDefinition::MemoryUsage() const {
+  size_t bytes = sizeof(*this) + frames.capacity() * sizeof(Frame) +
+                 (framelist.capacity() + animation_set.capacity()) *
+                     sizeof(std::vector<int>);
+  for (const std::vector<int>& list : framelist)
+    bytes += list.capacity() * sizeof(int);
+  for (const std::vector<int>& list : animation_set)
+    bytes += list.capacity() * sizeof(int);
+  return bytes;
+}
+
 // -----------------------------------------------------------------------
 // AnmGraphicsObjectData
 // -----------------------------------------------------------------------
@@ -83,6 +98,11 @@ bool AnmGraphicsObjectData::TestFileMagic(std::unique_ptr<char[]>& anm_data) {
 }
 
 void AnmGraphicsObjectData::LoadAnmFile() {
+  definition_ = system_.graphics().anm_definitions().Get(
+      filename_, [this]() { return ParseAnmFile(); });
+}
+
+std::shared_ptr<const AnmDefinition> AnmGraphicsObjectData::ParseAnmFile() {
   fs::path file = system_.FindFile(filename_, ANM_FILETYPES);
   if (file.empty()) {
     std::ostringstream oss;
@@ -104,11 +124,14 @@ void AnmGraphicsObjectData::LoadAnmFile() {
     throw rlvm::Exception(oss.str());
   }
 
-  LoadAnmFileFromData(anm_data);
+  std::shared_ptr<AnmDefinition> definition(new AnmDefinition);
+  LoadAnmFileFromData(anm_data, definition.get());
+  return definition;
 }
 
 void AnmGraphicsObjectData::LoadAnmFileFromData(
-    const std::unique_ptr<char[]>& anm_data) {
+    const std::unique_ptr<char[]>& anm_data,
+    AnmDefinition* definition) {
   const char* data = anm_data.get();
 
   // Read the header
@@ -122,8 +145,8 @@ void AnmGraphicsObjectData::LoadAnmFileFromData(
 
   // Read the corresponding image file we read from, and load the image.
   string raw_file_name = data + 0x1c;
-  image_ = system_.graphics().GetSurfaceNamed(raw_file_name);
-  image_->EnsureUploaded();
+  definition->image = system_.graphics().GetSurfaceNamed(raw_file_name);
+  definition->image->EnsureUploaded();
 
   // Read the frame list
   const char* buf = data + 0xb8;
@@ -138,17 +161,18 @@ void AnmGraphicsObjectData::LoadAnmFileFromData(
     f.dest_y = read_i32(buf + 20);
     f.time = read_i32(buf + 0x38);
     FixAxis(f, screen_size.width(), screen_size.height());
-    frames.push_back(f);
+    definition->frames.push_back(f);
 
     buf += 0x60;
   }
 
   ReadIntegerList(
-      data + 0xb8 + frames_len * 0x60, 0x68, framelist_len, framelist_);
+      data + 0xb8 + frames_len * 0x60, 0x68, framelist_len,
+      definition->framelist);
   ReadIntegerList(data + 0xb8 + frames_len * 0x60 + framelist_len * 0x68,
                   0x78,
                   animation_set_len,
-                  animation_set_);
+                  definition->animation_set);
 }
 
 void AnmGraphicsObjectData::ReadIntegerList(
@@ -202,6 +226,7 @@ bool AnmGraphicsObjectData::IsAnimation() const {
 
 void AnmGraphicsObjectData::AdvanceFrame() {
   // Do things that advance the state
+  const std::vector<Frame>& frames = definition_->frames;
   int time_since_last_frame_change =
       system_.event().GetTicks() - time_at_last_frame_change_;
   bool done = false;
@@ -218,8 +243,8 @@ void AnmGraphicsObjectData::AdvanceFrame() {
         if (cur_frame_set_ == cur_frame_set_end_) {
           set_is_currently_playing(false);
         } else {
-          cur_frame_ = framelist_.at(*cur_frame_set_).begin();
-          cur_frame_end_ = framelist_.at(*cur_frame_set_).end();
+          cur_frame_ = definition_->framelist.at(*cur_frame_set_).begin();
+          cur_frame_end_ = definition_->framelist.at(*cur_frame_set_).end();
           current_frame_ = *cur_frame_;
         }
       } else {
@@ -234,13 +259,13 @@ void AnmGraphicsObjectData::AdvanceFrame() {
 // I am not entirely sure these methods even make sense given the
 // context...
 int AnmGraphicsObjectData::PixelWidth(const GraphicsObject& rp) {
-  const Surface::GrpRect& rect = image_->GetPattern(rp.GetPattNo());
+  const Surface::GrpRect& rect = definition_->image->GetPattern(rp.GetPattNo());
   int width = rect.rect.width();
   return int(rp.GetWidthScaleFactor() * width);
 }
 
 int AnmGraphicsObjectData::PixelHeight(const GraphicsObject& rp) {
-  const Surface::GrpRect& rect = image_->GetPattern(rp.GetPattNo());
+  const Surface::GrpRect& rect = definition_->image->GetPattern(rp.GetPattNo());
   int height = rect.rect.height();
   return int(rp.GetHeightScaleFactor() * height);
 }
@@ -253,10 +278,10 @@ void AnmGraphicsObjectData::PlaySet(int set) {
   set_is_currently_playing(true);
   time_at_last_frame_change_ = system_.event().GetTicks();
 
-  cur_frame_set_ = animation_set_.at(set).begin();
-  cur_frame_set_end_ = animation_set_.at(set).end();
-  cur_frame_ = framelist_.at(*cur_frame_set_).begin();
-  cur_frame_end_ = framelist_.at(*cur_frame_set_).end();
+  cur_frame_set_ = definition_->animation_set.at(set).begin();
+  cur_frame_set_end_ = definition_->animation_set.at(set).end();
+  cur_frame_ = definition_->framelist.at(*cur_frame_set_).begin();
+  cur_frame_end_ = definition_->framelist.at(*cur_frame_set_).end();
   current_frame_ = *cur_frame_;
 
   system_.graphics().MarkScreenAsDirty(GUT_DISPLAY_OBJ);
@@ -264,12 +289,12 @@ void AnmGraphicsObjectData::PlaySet(int set) {
 
 std::shared_ptr<const Surface> AnmGraphicsObjectData::CurrentSurface(
     const GraphicsObject& rp) {
-  return image_;
+  return definition_->image;
 }
 
 Rect AnmGraphicsObjectData::SrcRect(const GraphicsObject& go) {
   if (current_frame_ != -1) {
-    const Frame& frame = frames.at(current_frame_);
+    const Frame& frame = definition_->frames.at(current_frame_);
     return Rect::GRP(frame.src_x1, frame.src_y1, frame.src_x2, frame.src_y2);
   }
 
@@ -280,7 +305,7 @@ Rect AnmGraphicsObjectData::DstRect(const GraphicsObject& go,
                                     const GraphicsObject* parent) {
   if (current_frame_ != -1) {
     // TODO(erg): Should this account for either |go| or |parent|?
-    const Frame& frame = frames.at(current_frame_);
+    const Frame& frame = definition_->frames.at(current_frame_);
     return Rect::REC(frame.dest_x,
                      frame.dest_y,
                      (frame.src_x2 - frame.src_x1),
@@ -310,13 +335,13 @@ void AnmGraphicsObjectData::load(Archive& ar, unsigned int version) {
   int cur_frame_set, current_frame;
   ar& cur_frame_set& current_frame;
 
-  cur_frame_set_ = animation_set_.at(current_set_).begin();
+  cur_frame_set_ = definition_->animation_set.at(current_set_).begin();
   advance(cur_frame_set_, cur_frame_set);
-  cur_frame_set_end_ = animation_set_.at(current_set_).end();
+  cur_frame_set_end_ = definition_->animation_set.at(current_set_).end();
 
-  cur_frame_ = framelist_.at(*cur_frame_set_).begin();
+  cur_frame_ = definition_->framelist.at(*cur_frame_set_).begin();
   advance(cur_frame_, current_frame);
-  cur_frame_end_ = framelist_.at(*cur_frame_set_).end();
+  cur_frame_end_ = definition_->framelist.at(*cur_frame_set_).end();
 }
 
 template <class Archive>
@@ -325,10 +350,10 @@ void AnmGraphicsObjectData::save(Archive& ar, unsigned int version) const {
   ar& filename_& currently_playing_& current_set_;
 
   // Figure out what set we're playing, which
-  int cur_frame_set =
-      distance(animation_set_.at(current_set_).begin(), cur_frame_set_);
+  int cur_frame_set = distance(
+      definition_->animation_set.at(current_set_).begin(), cur_frame_set_);
   int current_frame =
-      distance(framelist_.at(*cur_frame_set_).begin(), cur_frame_);
+      distance(definition_->framelist.at(*cur_frame_set_).begin(), cur_frame_);
 
   ar& cur_frame_set& current_frame;
 }
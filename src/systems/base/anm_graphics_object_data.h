@@ -41,9 +41,32 @@
 class Surface;
 class System;
 
+// The parsed contents of an ANM file. Immutable once loaded, and shared by
+// every object playing the same file (see GraphicsSystem::anm_definitions()).
+struct AnmDefinition {
+  struct Frame {
+    int src_x1, src_y1;
+    int src_x2, src_y2;
+    int dest_x, dest_y;
+    int time;
+  };
+
+  // Animation Data (This structure was stolen from xkanon.)
+  std::vector<Frame> frames;
+  std::vector<std::vector<int>> framelist;
+  std::vector<std::vector<int>> animation_set;
+
+  // The image the above coordinates map into.
+  std::shared_ptr<const Surface> image;
+
+  // Approximate heap usage, for statistics.
+  size_t MemoryUsage() const;
+};
+
 // Executable, in-memory representation of an ANM file. This internal structure
 // is heavily based off of xkanon's ANM file implementation, but has been
-// changed to be all C++ like.
+// changed to be all C++ like. The file itself lives in a shared AnmDefinition;
+// this object only tracks where in the animation it is.
 class AnmGraphicsObjectData : public GraphicsObjectData {
  public:
   explicit AnmGraphicsObjectData(System& system);
@@ -74,19 +97,18 @@ class AnmGraphicsObjectData : public GraphicsObjectData {
   // Advance the position in the animation.
   void AdvanceFrame();
 
-  struct Frame {
-    int src_x1, src_y1;
-    int src_x2, src_y2;
-    int dest_x, dest_y;
-    int time;
-  };
+  typedef AnmDefinition::Frame Frame;
+
+  // Reads and parses |filename_|. Called through the definition cache.
+  std::shared_ptr<const AnmDefinition> ParseAnmFile();
 
   bool TestFileMagic(std::unique_ptr<char[]>& anm_data);
   void ReadIntegerList(const char* start,
                        int offset,
                        int iterations,
                        std::vector<std::vector<int>>& dest);
-  void LoadAnmFileFromData(const std::unique_ptr<char[]>& anm_data);
+  void LoadAnmFileFromData(const std::unique_ptr<char[]>& anm_data,
+                           AnmDefinition* definition);
   void FixAxis(Frame& frame, int width, int height);
 
   // The system we are a part of.
@@ -95,13 +117,9 @@ class AnmGraphicsObjectData : public GraphicsObjectData {
   // Raw, short name for the ANM file.
   std::string filename_;
 
-  // Animation Data (This structure was stolen from xkanon.)
-  std::vector<Frame> frames;
-  std::vector<std::vector<int>> framelist_;
-  std::vector<std::vector<int>> animation_set_;
-
-  // The image the above coordinates map into.
-  std::shared_ptr<const Surface> image_;
+  // The frames, frame lists and image. The cur_* iterators below point into
+  // it, which stays valid across Clone() since it is shared.
+  std::shared_ptr<const AnmDefinition> definition_;
 
   bool currently_playing_;
 
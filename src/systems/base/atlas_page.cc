@@ -0,0 +1,49 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/atlas_page.h"
+
+// static
+const int AtlasPage::kPageSize;
+// static
+const int AtlasPage::kPadding;
+// static
+const int AtlasPage::kMaxPackedSize;
+
+AtlasPage::AtlasPage(int size) : packer_(size, size, kPadding) {}
+
+AtlasPage::~AtlasPage() {}
+
+// static
+bool AtlasPage::IsPackable(int width, int height) {
+  return width <= kMaxPackedSize && height <= kMaxPackedSize;
+}
+
+bool AtlasPage::AllocateSlot(int width, int height, Rect* slot) {
+  return packer_.Allocate(width, height, slot);
+}
+
+void AtlasPage::Free(const Rect& slot) { packer_.Free(slot); }
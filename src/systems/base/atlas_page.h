@@ -0,0 +1,72 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_ATLAS_PAGE_H_
+#define SRC_SYSTEMS_BASE_ATLAS_PAGE_H_
+
+#include "systems/base/rect.h"
+#include "systems/base/shelf_packer.h"
+
+// The bookkeeping half of a shared texture page: how big pages are, which
+// images may go on them, and which parts of a page are taken. The SDL
+// TexturePage adds the GL texture on top.
+class AtlasPage {
+ public:
+  // Four megabytes at 32 bits per pixel.
+  static const int kPageSize = 1024;
+
+  // One texel of padding is enough for GL_LINEAR magnification.
+  static const int kPadding = 1;
+
+  // Images bigger than this in either direction get their own texture. Two
+  // of the largest still fit across and down a page with their padding, so a
+  // page holds at least four of them; a 512 pixel image would have a whole
+  // page to itself. This also keeps out the 512 pixel tiles large CGs are cut
+  // into on drivers without non power of two textures.
+  static const int kMaxPackedSize = (kPageSize - kPadding) / 2;
+
+  explicit AtlasPage(int size);
+  virtual ~AtlasPage();
+
+  // Whether a |width| x |height| image is small enough to share a page.
+  static bool IsPackable(int width, int height);
+
+  // Finds room for a |width| x |height| image and writes it to |slot|.
+  // Returns false if the page is full.
+  bool AllocateSlot(int width, int height, Rect* slot);
+
+  // Returns a slot handed out by AllocateSlot().
+  void Free(const Rect& slot);
+
+  int width() const { return packer_.width(); }
+  int height() const { return packer_.height(); }
+  int slot_count() const { return packer_.allocation_count(); }
+
+ private:
+  ShelfPacker packer_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_ATLAS_PAGE_H_
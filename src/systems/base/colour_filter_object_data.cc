@@ -75,6 +75,16 @@ void ColourFilterObjectData::Render(const GraphicsObject& go,
   }
 }
 
+bool ColourFilterObjectData::GetDamageInfo(const GraphicsObject& go,
+                                           const GraphicsObject* parent,
+                                           Rect* rect,
+                                           uint64_t* signature) {
+  // Everything that changes the fill is a property of |go|.
+  *rect = screen_rect_;
+  *signature = 0;
+  return true;
+}
+
 int ColourFilterObjectData::PixelWidth(
     const GraphicsObject& rendering_properties) {
   throw rlvm::Exception("There is no sane value for this!");
@@ -63,6 +63,10 @@ class ColourFilterObjectData : public GraphicsObjectData {
   virtual void Execute(RLMachine& machine) override;
   virtual bool IsAnimation() const override;
   virtual void PlaySet(int set) override;
+  virtual bool GetDamageInfo(const GraphicsObject& go,
+                             const GraphicsObject* parent,
+                             Rect* rect,
+                             uint64_t* signature) override;
 
  protected:
   virtual std::shared_ptr<const Surface> CurrentSurface(
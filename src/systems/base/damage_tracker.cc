@@ -0,0 +1,130 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/base/damage_tracker.h"
+
+const float DamageTracker::kMaxPartialCoverage = 0.5f;
+
+DamageTracker::DamageTracker()
+    : full_(true),
+      generation_(0),
+      skipped_frames_(0),
+      partial_frames_(0),
+      full_frames_(0) {}
+
+DamageTracker::~DamageTracker() {}
+
+void DamageTracker::Add(const Rect& area) {
+  if (full_ || IsEmpty(area))
+    return;
+
+  Rect clipped = IsEmpty(screen_) ? area : area.Intersection(screen_);
+  if (IsEmpty(clipped))
+    return;
+
+  bounds_ = IsEmpty(bounds_) ? clipped : bounds_.RectUnion(clipped);
+}
+
+void DamageTracker::AddFull() {
+  full_ = true;
+}
+
+void DamageTracker::Track(uint64_t key, const Rect& rect, uint64_t signature) {
+  std::unordered_map<uint64_t, Tracked>::iterator it = tracked_.find(key);
+  if (it == tracked_.end()) {
+    Tracked tracked = {rect, signature, generation_};
+    tracked_.insert(std::make_pair(key, tracked));
+    if (IsEmpty(rect))
+      AddFull();
+    else
+      Add(rect);
+    return;
+  }
+
+  Tracked& tracked = it->second;
+  if (tracked.rect != rect || tracked.signature != signature) {
+    if (IsEmpty(rect) || IsEmpty(tracked.rect)) {
+      AddFull();
+    } else {
+      Add(tracked.rect);
+      Add(rect);
+    }
+    tracked.rect = rect;
+    tracked.signature = signature;
+  }
+  tracked.generation = generation_;
+}
+
+void DamageTracker::FinishTracking() {
+  for (std::unordered_map<uint64_t, Tracked>::iterator it = tracked_.begin();
+       it != tracked_.end();) {
+    if (it->second.generation != generation_) {
+      if (IsEmpty(it->second.rect))
+        AddFull();
+      else
+        Add(it->second.rect);
+      it = tracked_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  generation_++;
+}
+
+DamageTracker::Plan DamageTracker::Decide() const {
+  if (full_)
+    return FULL;
+  if (IsEmpty(bounds_))
+    return SKIP;
+
+  if (!IsEmpty(screen_)) {
+    float coverage = float(bounds_.width()) * bounds_.height() /
+                     (float(screen_.width()) * screen_.height());
+    if (coverage > kMaxPartialCoverage)
+      return FULL;
+  }
+
+  return PARTIAL;
+}
+
+void DamageTracker::FrameDrawn(Plan plan) {
+  switch (plan) {
+    case SKIP:
+      skipped_frames_++;
+      break;
+    case PARTIAL:
+      partial_frames_++;
+      break;
+    case FULL:
+      full_frames_++;
+      break;
+  }
+
+  full_ = false;
+  bounds_ = Rect();
+}
@@ -0,0 +1,129 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_BASE_DAMAGE_TRACKER_H_
+#define SRC_SYSTEMS_BASE_DAMAGE_TRACKER_H_
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "systems/base/rect.h"
+
+// Works out which part of the screen has to be redrawn for the next frame.
+//
+// Damage comes from two places. Code that changes something on screen can
+// report the area directly (Add(), or AddFull() when it doesn't know), and
+// every object that gets drawn is Track()ed with its screen rectangle and a
+// signature of everything that affects how it looks; an object whose
+// rectangle or signature changed since the last frame damages both its old
+// and new rectangles, and so does one that stopped being drawn.
+//
+// Damage is kept as a single bounding rectangle, since that's what a scissor
+// test can clip a redraw to.
+class DamageTracker {
+ public:
+  // What the renderer should do with the next frame.
+  enum Plan {
+    // Nothing changed; don't draw anything.
+    SKIP,
+    // Redraw only bounds(); everything else is still in the back buffer.
+    PARTIAL,
+    // Redraw the whole screen.
+    FULL
+  };
+
+  DamageTracker();
+  ~DamageTracker();
+
+  void set_screen(const Rect& screen) { screen_ = screen; }
+
+  // Marks |area| (in screen coordinates) as needing a redraw.
+  void Add(const Rect& area);
+
+  // Marks the whole screen as needing a redraw.
+  void AddFull();
+
+  // Records the on screen state of the renderable |key| for this frame.
+  // Passing an empty |rect| means the renderable can't say where it draws,
+  // which damages the whole screen if it changed.
+  void Track(uint64_t key, const Rect& rect, uint64_t signature);
+
+  // Damages everything that was tracked last frame but not this one. Call
+  // after the last Track() of a frame.
+  void FinishTracking();
+
+  // Returns what to do with the damage collected so far.
+  Plan Decide() const;
+
+  // Forgets the collected damage once a frame has been drawn for |plan|, and
+  // counts it.
+  void FrameDrawn(Plan plan);
+
+  // Mixes |value| into the signature |seed|.
+  static uint64_t Combine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+  }
+
+  bool full() const { return full_; }
+  const Rect& bounds() const { return bounds_; }
+
+  // Frames are redrawn in full once damage covers more than this fraction
+  // of the screen, since the partial path has a fixed cost of its own.
+  static const float kMaxPartialCoverage;
+
+  // Statistics since construction.
+  int skipped_frames() const { return skipped_frames_; }
+  int partial_frames() const { return partial_frames_; }
+  int full_frames() const { return full_frames_; }
+
+ private:
+  struct Tracked {
+    Rect rect;
+    uint64_t signature;
+    int generation;
+  };
+
+  static bool IsEmpty(const Rect& rect) {
+    return rect.width() <= 0 || rect.height() <= 0;
+  }
+
+  Rect screen_;
+  Rect bounds_;
+  bool full_;
+
+  std::unordered_map<uint64_t, Tracked> tracked_;
+
+  // Bumped by every FinishTracking(); entries with an older value weren't
+  // drawn this frame.
+  int generation_;
+
+  int skipped_frames_;
+  int partial_frames_;
+  int full_frames_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_DAMAGE_TRACKER_H_
@@ -0,0 +1,320 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/decoded_image_cache.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "libreallive/filemap.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Bump the trailing digit whenever the layout below changes; old entries then
+// fail validation and get replaced.
+const char kMagic[8] = {'R', 'L', 'V', 'M', 'D', 'I', 'C', '1'};
+
+const char kEntryExtension[] = ".dic";
+
+// Pixel data starts on a multiple of this so it can be used in place.
+const uint32_t kPixelAlignment = 16;
+
+// On disk layout of a cache entry, in native byte order (the cache is never
+// shared between machines):
+//
+//   FileHeader
+//   source path, |path_bytes| long
+//   |region_count| RegionRecords
+//   padding up to |pixel_offset|
+//   |width| * |height| 32-bit pixels
+struct FileHeader {
+  char magic[8];
+  uint32_t pixel_offset;
+  uint32_t width;
+  uint32_t height;
+  uint32_t has_alpha;
+  uint32_t region_count;
+  uint32_t path_bytes;
+  uint64_t source_size;
+  int64_t source_mtime;
+};
+
+struct RegionRecord {
+  int32_t x, y, width, height, origin_x, origin_y;
+};
+
+uint32_t AlignUp(uint32_t value) {
+  return (value + kPixelAlignment - 1) & ~(kPixelAlignment - 1);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// DecodedImageCache::Entry
+// -----------------------------------------------------------------------
+
+DecodedImageCache::Entry::Entry()
+    : width_(0), height_(0), has_alpha_(false), pixels_(NULL) {}
+
+DecodedImageCache::Entry::~Entry() {}
+
+// -----------------------------------------------------------------------
+// DecodedImageCache
+// -----------------------------------------------------------------------
+
+DecodedImageCache::DecodedImageCache(const fs::path& directory,
+                                     uintmax_t max_bytes)
+    : directory_(directory),
+      max_bytes_(max_bytes),
+      current_bytes_(0),
+      hits_(0),
+      misses_(0) {
+  boost::system::error_code ec;
+  fs::create_directories(directory_, ec);
+  EvictToFit();
+}
+
+DecodedImageCache::~DecodedImageCache() {}
+
+std::unique_ptr<DecodedImageCache::Entry> DecodedImageCache::Lookup(
+    const fs::path& source) {
+  std::unique_ptr<Entry> entry;
+
+  uintmax_t source_size;
+  int64_t source_mtime;
+  fs::path entry_path = EntryPathFor(source, &source_size, &source_mtime);
+  boost::system::error_code ec;
+  if (entry_path.empty() || !fs::exists(entry_path, ec)) {
+    misses_++;
+    return entry;
+  }
+
+  std::unique_ptr<libreallive::Mapping> mapping;
+  try {
+    mapping.reset(
+        new libreallive::Mapping(entry_path.string(), libreallive::Read));
+  } catch (std::exception& e) {
+    misses_++;
+    return entry;
+  }
+
+  // Validate everything before trusting any offsets in the file.
+  const char* data = mapping->get();
+  size_t len = mapping->size();
+  FileHeader header;
+  if (len < sizeof(header)) {
+    misses_++;
+    return entry;
+  }
+  memcpy(&header, data, sizeof(header));
+
+  std::string source_string = source.string();
+  uint64_t pixel_bytes = uint64_t(header.width) * header.height * 4;
+  uint64_t records_end = sizeof(header) + uint64_t(header.path_bytes) +
+                         uint64_t(header.region_count) * sizeof(RegionRecord);
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.source_size != source_size ||
+      header.source_mtime != source_mtime ||
+      header.pixel_offset % kPixelAlignment != 0 ||
+      records_end > header.pixel_offset ||
+      header.pixel_offset + pixel_bytes > len ||
+      header.path_bytes != source_string.size() ||
+      memcmp(data + sizeof(header), source_string.data(),
+             source_string.size()) != 0) {
+    misses_++;
+    return entry;
+  }
+
+  entry.reset(new Entry);
+  entry->width_ = header.width;
+  entry->height_ = header.height;
+  entry->has_alpha_ = header.has_alpha;
+
+  const char* region_data = data + sizeof(header) + header.path_bytes;
+  for (uint32_t i = 0; i < header.region_count; ++i) {
+    RegionRecord record;
+    memcpy(&record, region_data + i * sizeof(record), sizeof(record));
+    Surface::GrpRect rect;
+    rect.rect = Rect::REC(record.x, record.y, record.width, record.height);
+    rect.originX = record.origin_x;
+    rect.originY = record.origin_y;
+    entry->region_table_.push_back(rect);
+  }
+
+  entry->pixels_ = mapping->get() + header.pixel_offset;
+  entry->mapping_ = std::move(mapping);
+
+  // Touch the entry so that eviction sees it as recently used.
+  fs::last_write_time(entry_path, std::time(NULL), ec);
+
+  hits_++;
+  return entry;
+}
+
+void DecodedImageCache::Store(
+    const fs::path& source,
+    int width,
+    int height,
+    bool has_alpha,
+    const char* pixels,
+    const std::vector<Surface::GrpRect>& region_table) {
+  uintmax_t source_size;
+  int64_t source_mtime;
+  fs::path entry_path = EntryPathFor(source, &source_size, &source_mtime);
+  if (entry_path.empty() || width <= 0 || height <= 0)
+    return;
+
+  std::string source_string = source.string();
+  FileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.width = width;
+  header.height = height;
+  header.has_alpha = has_alpha;
+  header.region_count = region_table.size();
+  header.path_bytes = source_string.size();
+  header.source_size = source_size;
+  header.source_mtime = source_mtime;
+  header.pixel_offset =
+      AlignUp(sizeof(header) + header.path_bytes +
+              header.region_count * sizeof(RegionRecord));
+
+  uintmax_t pixel_bytes = uintmax_t(width) * height * 4;
+  uintmax_t entry_bytes = header.pixel_offset + pixel_bytes;
+  if (entry_bytes > max_bytes_)
+    return;
+
+  // Write to a temporary name and rename into place, so a crash (or a second
+  // rlvm instance) never sees a half written entry.
+  fs::path temp_path = entry_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out(temp_path.string().c_str(),
+                      std::ios::binary | std::ios::trunc);
+    if (!out)
+      return;
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(source_string.data(), source_string.size());
+    for (const Surface::GrpRect& rect : region_table) {
+      RegionRecord record = {rect.rect.x(),      rect.rect.y(),
+                             rect.rect.width(),  rect.rect.height(),
+                             rect.originX,       rect.originY};
+      out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    std::vector<char> padding(header.pixel_offset - out.tellp(), 0);
+    out.write(padding.data(), padding.size());
+    out.write(pixels, pixel_bytes);
+    if (!out) {
+      out.close();
+      boost::system::error_code ec;
+      fs::remove(temp_path, ec);
+      return;
+    }
+  }
+
+  boost::system::error_code ec;
+  uintmax_t replaced_bytes = fs::exists(entry_path, ec) ?
+      fs::file_size(entry_path, ec) : 0;
+  if (ec)
+    replaced_bytes = 0;
+  fs::rename(temp_path, entry_path, ec);
+  if (ec) {
+    fs::remove(temp_path, ec);
+    return;
+  }
+
+  current_bytes_ += entry_bytes;
+  current_bytes_ -= std::min(current_bytes_, replaced_bytes);
+  if (current_bytes_ > max_bytes_)
+    EvictToFit();
+}
+
+void DecodedImageCache::EvictToFit() {
+  typedef std::tuple<std::time_t, uintmax_t, fs::path> CacheFile;
+  std::vector<CacheFile> files;
+  uintmax_t total = 0;
+
+  boost::system::error_code ec;
+  fs::directory_iterator it(directory_, ec), end;
+  for (; !ec && it != end; it.increment(ec)) {
+    const fs::path& path = it->path();
+    if (path.extension() != kEntryExtension)
+      continue;
+
+    boost::system::error_code attr_ec;
+    uintmax_t size = fs::file_size(path, attr_ec);
+    std::time_t mtime = fs::last_write_time(path, attr_ec);
+    if (attr_ec)
+      continue;
+
+    files.emplace_back(mtime, size, path);
+    total += size;
+  }
+
+  // Oldest first.
+  std::sort(files.begin(), files.end());
+  for (const CacheFile& file : files) {
+    if (total <= max_bytes_)
+      break;
+
+    boost::system::error_code remove_ec;
+    if (fs::remove(std::get<2>(file), remove_ec))
+      total -= std::get<1>(file);
+  }
+
+  current_bytes_ = total;
+}
+
+fs::path DecodedImageCache::EntryPathFor(const fs::path& source,
+                                         uintmax_t* size,
+                                         int64_t* mtime) const {
+  boost::system::error_code ec;
+  *size = fs::file_size(source, ec);
+  if (ec)
+    return fs::path();
+  *mtime = fs::last_write_time(source, ec);
+  if (ec)
+    return fs::path();
+
+  std::ostringstream key;
+  key << source.string() << '\0' << *size << '\0' << *mtime;
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0')
+       << uint64_t(std::hash<std::string>()(key.str())) << kEntryExtension;
+  return directory_ / name.str();
+}
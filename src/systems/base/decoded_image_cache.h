@@ -0,0 +1,132 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_DECODED_IMAGE_CACHE_H_
+#define SRC_SYSTEMS_BASE_DECODED_IMAGE_CACHE_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "systems/base/surface.h"
+
+namespace libreallive {
+class Mapping;
+}  // namespace libreallive
+
+// An on disk cache of decoded images, so that the CGs a game opens every
+// session don't have to go through G00/PDT decompression each time.
+//
+// Each entry is keyed by the source file's path, size and modification time,
+// and is stored uncompressed with the pixel data at an aligned offset, so a
+// hit is a single read only mmap() which can be handed straight to the
+// texture upload. Entries are touched on every hit and the least recently
+// used ones are deleted once the cache grows past its size cap.
+//
+// Every failure inside the cache is swallowed; the worst that can happen is
+// that the caller decodes the image itself.
+class DecodedImageCache {
+ public:
+  // A decoded image read back from the cache. The pixel data lives in a
+  // mapping of the cache file and is valid for the lifetime of this object.
+  class Entry {
+   public:
+    ~Entry();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    bool has_alpha() const { return has_alpha_; }
+    const std::vector<Surface::GrpRect>& region_table() const {
+      return region_table_;
+    }
+
+    // 32-bit native ARGB pixels, width() * height() of them. (Non-const only
+    // because SDL_CreateRGBSurfaceFrom() doesn't take const data; the mapping
+    // is read only.)
+    char* pixels() const { return pixels_; }
+
+   private:
+    friend class DecodedImageCache;
+    Entry();
+
+    std::unique_ptr<libreallive::Mapping> mapping_;
+    int width_;
+    int height_;
+    bool has_alpha_;
+    std::vector<Surface::GrpRect> region_table_;
+    char* pixels_;
+  };
+
+  DecodedImageCache(const boost::filesystem::path& directory,
+                    uintmax_t max_bytes);
+  ~DecodedImageCache();
+
+  // Returns the cached decoding of |source|, or NULL if there isn't one or
+  // |source| has changed since it was stored.
+  std::unique_ptr<Entry> Lookup(const boost::filesystem::path& source);
+
+  // Writes the decoded form of |source| to the cache, evicting old entries if
+  // this pushes the cache over its size cap.
+  void Store(const boost::filesystem::path& source,
+             int width,
+             int height,
+             bool has_alpha,
+             const char* pixels,
+             const std::vector<Surface::GrpRect>& region_table);
+
+  // Deletes least recently used entries until the cache fits in |max_bytes_|.
+  void EvictToFit();
+
+  const boost::filesystem::path& directory() const { return directory_; }
+  uintmax_t max_bytes() const { return max_bytes_; }
+  uintmax_t current_bytes() const { return current_bytes_; }
+
+  // Statistics since construction.
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+
+ private:
+  // Returns the cache file for |source|, or an empty path if |source| can't
+  // be stat()ed. Fills out |size| and |mtime| with the source's attributes.
+  boost::filesystem::path EntryPathFor(const boost::filesystem::path& source,
+                                       uintmax_t* size,
+                                       int64_t* mtime) const;
+
+  boost::filesystem::path directory_;
+
+  uintmax_t max_bytes_;
+
+  // Total size of all entries on disk, as of the last directory scan plus
+  // everything we've written since.
+  uintmax_t current_bytes_;
+
+  int hits_;
+  int misses_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_DECODED_IMAGE_CACHE_H_
@@ -41,21 +41,6 @@
 #include "systems/base/system.h"
 #include "utilities/graphics.h"
 
-namespace {
-
-double ScaleAmplitude(int amplitude) {
-  // So the amplitude of the curve in RealLive is weird. Some value close to
-  // 100 means one width of the screen, 1 is a vary large amount that I can't
-  // reliably measure, and values greater than 100 are increasingly smaller.  I
-  // can't reliably measure this because I suspect that RL deliberately
-  // introduces some randomness here. Oh well. There's probably some curve that
-  // fits this, but whatever. I think this might be a valid approximation:
-  int x = amplitude / 100;
-  return 1 / static_cast<double>(x);
-}
-
-}  // namespace
-
 DriftGraphicsObject::DriftGraphicsObject(System& system)
     : system_(system), filename_(), surface_(), last_rendered_time_(0) {}
 
@@ -83,89 +68,60 @@ void DriftGraphicsObject::Render(const GraphicsObject& go,
     last_rendered_time_ = current_time;
 
     size_t count = go.GetDriftParticleCount();
-    bool use_animation = go.GetDriftUseAnimation();
-    int start_pattern = go.GetDriftStartPattern();
-    int end_pattern = go.GetDriftEndPattern();
-    int animation_time = go.GetDriftAnimationTime();
-    int yspeed = go.GetDriftYSpeed();
-    int period = go.GetDriftPeriod();
-    int amplitude = go.GetDriftAmplitude();
-    int use_drift = go.GetDriftUseDrift();
-    int drift_speed = go.GetDriftDriftSpeed();
-
-    Rect bounding_box = go.GetDriftArea();
-    if (bounding_box.x() == -1) {
-      bounding_box = system_.graphics().screen_rect();
-    }
 
-    double scaled_amplitude =
-        bounding_box.size().width() * ScaleAmplitude(amplitude);
+    DriftParticles::Motion motion;
+    motion.use_animation = go.GetDriftUseAnimation();
+    motion.start_pattern = go.GetDriftStartPattern();
+    motion.end_pattern = go.GetDriftEndPattern();
+    motion.animation_time = go.GetDriftAnimationTime();
+    motion.yspeed = go.GetDriftYSpeed();
+    motion.period = go.GetDriftPeriod();
+    motion.amplitude = go.GetDriftAmplitude();
+    motion.use_drift = go.GetDriftUseDrift();
+    motion.drift_speed = go.GetDriftDriftSpeed();
+
+    motion.area = go.GetDriftArea();
+    if (motion.area.x() == -1) {
+      motion.area = system_.graphics().screen_rect();
+    }
+    if (motion.area.width() <= 0 || motion.area.height() <= 0)
+      return;
 
     // Grab the drift object
-    if (particles_.size() < count) {
-      Particle p;
-      p.x = rand() % bounding_box.size().width();   // NOLINT
-      p.y = rand() % bounding_box.size().height();  // NOLINT
-      p.alpha = 255;
-      p.start_time = current_time;
-
-      particles_.push_back(p);
+    if (static_cast<size_t>(particles_.size()) < count) {
+      particles_.Add(rand() % motion.area.width(),   // NOLINT
+                     rand() % motion.area.height(),  // NOLINT
+                     current_time);
     }
 
-    // Now that we have all the particles, update state and render each
-    // particle.
-    for (const Particle& particle : particles_) {
-      int pattern = start_pattern;
-      if (use_animation && end_pattern > start_pattern) {
-        int number_of_patterns = end_pattern - start_pattern + 1;
-        int frame_time = animation_time / number_of_patterns;
-        int frame_number = ((current_time - particle.start_time) / frame_time) %
-                           number_of_patterns;
-        pattern = start_pattern + frame_number;
-      }
-      Rect src = surface->GetPattern(pattern).rect;
-
-      int dest_x = particle.x;
-      int dest_y = particle.y;
-
-      // Add the base yspeed.
-      dest_y +=
-          bounding_box.size().height() *
-          (static_cast<double>((current_time - particle.start_time) % yspeed) /
-           static_cast<double>(yspeed));
-
-      // Add the sine wave that defines how the particle moves back and forth.
-      if (period != 0 && amplitude != 0) {
-        double result = sin(
-            (static_cast<double>(current_time - particle.start_time) / period) *
-            (2 * 3.14));
-        dest_x += scaled_amplitude * result;
+    // Now that we have all the particles, update state and render them all
+    // in one go.
+    particles_.Update(motion, current_time);
+
+    const int* dest_x = particles_.dest_x();
+    const int* dest_y = particles_.dest_y();
+    const int* pattern = particles_.pattern();
+    int last_pattern = -1;
+    Rect pattern_rect;
+    srcs_.clear();
+    dsts_.clear();
+    for (int i = 0; i < particles_.size(); ++i) {
+      if (pattern[i] != last_pattern) {
+        last_pattern = pattern[i];
+        pattern_rect = surface->GetPattern(last_pattern).rect;
       }
-
-      // Add the left drift if we have this bit set.
-      if (use_drift) {
-        dest_x -= bounding_box.size().width() *
-                  (static_cast<double>((current_time - particle.start_time) %
-                                       drift_speed) /
-                   static_cast<double>(drift_speed));
-      }
-
-      if (dest_x < 0)
-        dest_x += bounding_box.size().width();
-      else
-        dest_x %= bounding_box.size().width();
-
-      if (dest_y < 0)
-        dest_y += bounding_box.size().height();
-      else
-        dest_y %= bounding_box.size().height();
-      Rect dest(bounding_box.origin() + Size(dest_x, dest_y), src.size());
+      Rect src = pattern_rect;
+      Rect dest(motion.area.origin() + Size(dest_x[i], dest_y[i]),
+                src.size());
 
       if (go.has_clip_rect())
         ClipDestination(go.clip_rect(), src, dest);
 
-      surface->RenderToScreen(src, dest, particle.alpha);
+      srcs_.push_back(src);
+      dsts_.push_back(dest);
     }
+
+    surface->RenderManyToScreen(srcs_, dsts_, 255);
   }
 }
 
@@ -183,6 +139,19 @@ GraphicsObjectData* DriftGraphicsObject::Clone() const {
   return new DriftGraphicsObject(*this);
 }
 
+bool DriftGraphicsObject::GetDamageInfo(const GraphicsObject& go,
+                                        const GraphicsObject* parent,
+                                        Rect* rect,
+                                        uint64_t* signature) {
+  if (!surface_)
+    return false;
+
+  // Particles move on every frame and can wander anywhere.
+  *rect = Rect();
+  *signature = system_.event().GetTicks();
+  return true;
+}
+
 void DriftGraphicsObject::Execute(RLMachine& machine) {
   // We could theoretically redraw every time around the game loop, so
   // throttle to once every 100ms.
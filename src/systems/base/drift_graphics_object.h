@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "machine/rlmachine.h"
+#include "systems/base/drift_particles.h"
 #include "systems/base/graphics_object_data.h"
 #include "machine/serialization.h"
 
@@ -66,6 +67,10 @@ class DriftGraphicsObject : public GraphicsObjectData {
   virtual int PixelHeight(const GraphicsObject& rendering_properties) override;
   virtual GraphicsObjectData* Clone() const override;
   virtual void Execute(RLMachine& machine) override;
+  virtual bool GetDamageInfo(const GraphicsObject& go,
+                             const GraphicsObject* parent,
+                             Rect* rect,
+                             uint64_t* signature) override;
 
  protected:
   virtual std::shared_ptr<const Surface> CurrentSurface(
@@ -73,19 +78,6 @@ class DriftGraphicsObject : public GraphicsObjectData {
   virtual void ObjectInfo(std::ostream& tree) override;
 
  private:
-  // Individual particle on screen.
-  struct Particle {
-    // Randomly generated starting location for this particle.
-    int x;
-    int y;
-
-    // Current alpha
-    int alpha;
-
-    // The number of ticks when this particle was first
-    int start_time;
-  };
-
   // Private constructor for cloning.
   DriftGraphicsObject(const DriftGraphicsObject& system);
 
@@ -102,7 +94,12 @@ class DriftGraphicsObject : public GraphicsObjectData {
   std::shared_ptr<const Surface> surface_;
 
   // The individual particles that make up this drift object.
-  std::vector<Particle> particles_;
+  DriftParticles particles_;
+
+  // Where each particle is drawn from and to this frame; kept between frames
+  // to reuse the allocations.
+  std::vector<Rect> srcs_;
+  std::vector<Rect> dsts_;
 
   // The last time we were rendered. We keep track of this to make sure we
   // don't force refresh in a loop.
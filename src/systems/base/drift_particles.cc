@@ -0,0 +1,330 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/drift_particles.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RLVM_DRIFT_SSE2 1
+#endif
+
+#include <cmath>
+
+namespace {
+
+// One turn of sin(), plus a copy of the first entry at the end so that a
+// lookup can always read the entry after the one it lands on. Linear
+// interpolation between entries is good to about 5e-6, which is well under a
+// pixel for any sway that fits on screen.
+const int kSineTableSize = 1024;
+
+struct SineTable {
+  SineTable() {
+    for (int i = 0; i <= kSineTableSize; ++i)
+      value[i] = sin(2 * M_PI * i / kSineTableSize);
+  }
+
+  double value[kSineTableSize + 1];
+};
+
+const SineTable& GetSineTable() {
+  static const SineTable table;
+  return table;
+}
+
+// What RealLive's period means in radians; this used to be sin()'s argument.
+const double kSwayRadians = 2 * 3.14;
+
+double SineOfTurns(const SineTable& table, double turns) {
+  double position = (turns - floor(turns)) * kSineTableSize;
+  int index = static_cast<int>(position);
+  if (index >= kSineTableSize)
+    index = kSineTableSize - 1;
+  double fraction = position - index;
+  return table.value[index] +
+         (table.value[index + 1] - table.value[index]) * fraction;
+}
+
+// The remainder of |a| / |b|, rounding towards zero like C++'s %. Exact for
+// doubles holding ints.
+inline double Remainder(double a, double b) {
+  return a - std::trunc(a / b) * b;
+}
+
+// The per frame parameters, converted once. A divisor of zero turns the
+// motion it drives off, where the per particle code used to divide by zero.
+struct Frame {
+  Frame(const DriftParticles::Motion& motion, int current_time)
+      : now(current_time),
+        width(motion.area.width()),
+        height(motion.area.height()),
+        yspeed(motion.yspeed),
+        period(motion.period),
+        amplitude(0),
+        drift_speed(motion.use_drift ? motion.drift_speed : 0),
+        start_pattern(motion.start_pattern),
+        pattern_count(0),
+        frame_time(0) {
+    if (motion.period != 0 && motion.amplitude != 0) {
+      amplitude = width * DriftParticles::ScaleAmplitude(motion.amplitude);
+      if (!std::isfinite(amplitude))
+        amplitude = 0;
+    }
+
+    if (motion.use_animation && motion.end_pattern > motion.start_pattern) {
+      int patterns = motion.end_pattern - motion.start_pattern + 1;
+      pattern_count = patterns;
+      frame_time = motion.animation_time / patterns;
+    }
+  }
+
+  int now;
+  double width;
+  double height;
+  double yspeed;
+  double period;
+  double amplitude;
+  double drift_speed;
+  int start_pattern;
+  double pattern_count;
+  double frame_time;
+};
+
+void UpdateScalar(const Frame& frame,
+                  const int* x,
+                  const int* y,
+                  const int* start_time,
+                  int* dest_x,
+                  int* dest_y,
+                  int* pattern,
+                  int begin,
+                  int end) {
+  const SineTable& table = GetSineTable();
+  int width = frame.width;
+  for (int i = begin; i < end; ++i) {
+    double elapsed = frame.now - start_time[i];
+
+    pattern[i] = frame.start_pattern;
+    if (frame.frame_time != 0) {
+      double frame_number = std::trunc(elapsed / frame.frame_time);
+      pattern[i] += static_cast<int>(
+          Remainder(frame_number, frame.pattern_count));
+    }
+
+    int dy = y[i];
+    if (frame.yspeed != 0) {
+      dy = static_cast<int>(
+          dy + frame.height * (Remainder(elapsed, frame.yspeed) /
+                               frame.yspeed));
+    }
+
+    int dx = x[i];
+    if (frame.amplitude != 0) {
+      double radians = (elapsed / frame.period) * kSwayRadians;
+      dx = static_cast<int>(
+          dx + frame.amplitude *
+                   SineOfTurns(table, radians * (1 / (2 * M_PI))));
+    }
+    if (frame.drift_speed != 0) {
+      dx = static_cast<int>(
+          dx - frame.width * (Remainder(elapsed, frame.drift_speed) /
+                              frame.drift_speed));
+    }
+
+    dest_x[i] = dx < 0 ? dx + width : dx % width;
+    dest_y[i] = dy < 0 ? dy + int(frame.height) : dy % int(frame.height);
+  }
+}
+
+#if defined(RLVM_DRIFT_SSE2)
+
+inline __m128d LoadPair(const int* p) {
+  return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+
+inline void StorePair(int* p, __m128i v) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(p), v);
+}
+
+inline __m128d Trunc(__m128d v) {
+  return _mm_cvtepi32_pd(_mm_cvttpd_epi32(v));
+}
+
+inline __m128d RemainderSSE2(__m128d a, __m128d b) {
+  return _mm_sub_pd(a, _mm_mul_pd(Trunc(_mm_div_pd(a, b)), b));
+}
+
+// |value| wrapped into [0, |size|) the way UpdateScalar() does it.
+inline __m128i WrapSSE2(__m128i value, __m128d size) {
+  __m128i negative = _mm_cmplt_epi32(value, _mm_setzero_si128());
+  __m128d v = _mm_cvtepi32_pd(value);
+  __m128i added = _mm_cvttpd_epi32(_mm_add_pd(v, size));
+  __m128i reduced = _mm_cvttpd_epi32(RemainderSSE2(v, size));
+  return _mm_or_si128(_mm_and_si128(negative, added),
+                      _mm_andnot_si128(negative, reduced));
+}
+
+// Two particles at a time, with the same operations in the same order as
+// UpdateScalar() so the results are identical. Only the sine table lookup
+// is done lane by lane. Returns how many particles it handled.
+int UpdateSSE2(const Frame& frame,
+               const int* x,
+               const int* y,
+               const int* start_time,
+               int* dest_x,
+               int* dest_y,
+               int* pattern,
+               int count) {
+  const SineTable& table = GetSineTable();
+  const __m128i now = _mm_set1_epi32(frame.now);
+  const __m128d width = _mm_set1_pd(frame.width);
+  const __m128d height = _mm_set1_pd(frame.height);
+  const __m128d yspeed = _mm_set1_pd(frame.yspeed);
+  const __m128d period = _mm_set1_pd(frame.period);
+  const __m128d amplitude = _mm_set1_pd(frame.amplitude);
+  const __m128d drift_speed = _mm_set1_pd(frame.drift_speed);
+  const __m128d pattern_count = _mm_set1_pd(frame.pattern_count);
+  const __m128d frame_time = _mm_set1_pd(frame.frame_time);
+  const __m128i start_pattern = _mm_set1_epi32(frame.start_pattern);
+  const __m128d sway_radians = _mm_set1_pd(kSwayRadians);
+  const __m128d turns_per_radian = _mm_set1_pd(1 / (2 * M_PI));
+
+  int i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128i start =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(start_time + i));
+    __m128d elapsed = _mm_cvtepi32_pd(_mm_sub_epi32(now, start));
+
+    __m128i p = start_pattern;
+    if (frame.frame_time != 0) {
+      __m128d frame_number = Trunc(_mm_div_pd(elapsed, frame_time));
+      p = _mm_add_epi32(p, _mm_cvttpd_epi32(
+                               RemainderSSE2(frame_number, pattern_count)));
+    }
+    StorePair(pattern + i, p);
+
+    __m128i dy =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i));
+    if (frame.yspeed != 0) {
+      __m128d fall = _mm_mul_pd(
+          height, _mm_div_pd(RemainderSSE2(elapsed, yspeed), yspeed));
+      dy = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtepi32_pd(dy), fall));
+    }
+
+    __m128i dx =
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(x + i));
+    if (frame.amplitude != 0) {
+      double turns[2];
+      _mm_storeu_pd(turns,
+                    _mm_mul_pd(_mm_mul_pd(_mm_div_pd(elapsed, period),
+                                          sway_radians),
+                               turns_per_radian));
+      __m128d sine = _mm_set_pd(SineOfTurns(table, turns[1]),
+                                SineOfTurns(table, turns[0]));
+      dx = _mm_cvttpd_epi32(
+          _mm_add_pd(_mm_cvtepi32_pd(dx), _mm_mul_pd(amplitude, sine)));
+    }
+    if (frame.drift_speed != 0) {
+      __m128d drift = _mm_mul_pd(
+          width,
+          _mm_div_pd(RemainderSSE2(elapsed, drift_speed), drift_speed));
+      dx = _mm_cvttpd_epi32(_mm_sub_pd(_mm_cvtepi32_pd(dx), drift));
+    }
+
+    StorePair(dest_x + i, WrapSSE2(dx, width));
+    StorePair(dest_y + i, WrapSSE2(dy, height));
+  }
+  return i;
+}
+
+#endif  // RLVM_DRIFT_SSE2
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// DriftParticles::Motion
+// -----------------------------------------------------------------------
+
+DriftParticles::Motion::Motion()
+    : area(),
+      use_animation(false),
+      start_pattern(0),
+      end_pattern(0),
+      animation_time(0),
+      yspeed(0),
+      period(0),
+      amplitude(0),
+      use_drift(false),
+      drift_speed(0) {}
+
+// -----------------------------------------------------------------------
+// DriftParticles
+// -----------------------------------------------------------------------
+
+DriftParticles::DriftParticles() {}
+
+DriftParticles::~DriftParticles() {}
+
+void DriftParticles::Add(int x, int y, int start_time) {
+  x_.push_back(x);
+  y_.push_back(y);
+  start_time_.push_back(start_time);
+}
+
+void DriftParticles::Update(const Motion& motion, int current_time) {
+  int count = size();
+  dest_x_.resize(count);
+  dest_y_.resize(count);
+  pattern_.resize(count);
+  if (count == 0 || motion.area.width() <= 0 || motion.area.height() <= 0)
+    return;
+
+  Frame frame(motion, current_time);
+  int done = 0;
+#if defined(RLVM_DRIFT_SSE2)
+  done = UpdateSSE2(frame, &x_[0], &y_[0], &start_time_[0], &dest_x_[0],
+                    &dest_y_[0], &pattern_[0], count);
+#endif
+  UpdateScalar(frame, &x_[0], &y_[0], &start_time_[0], &dest_x_[0],
+               &dest_y_[0], &pattern_[0], done, count);
+}
+
+// static
+double DriftParticles::ScaleAmplitude(int amplitude) {
+  // So the amplitude of the curve in RealLive is weird. Some value close to
+  // 100 means one width of the screen, 1 is a vary large amount that I can't
+  // reliably measure, and values greater than 100 are increasingly smaller.  I
+  // can't reliably measure this because I suspect that RL deliberately
+  // introduces some randomness here. Oh well. There's probably some curve that
+  // fits this, but whatever. I think this might be a valid approximation:
+  int x = amplitude / 100;
+  return 1 / static_cast<double>(x);
+}
+
+// static
+double DriftParticles::TableSine(double radians) {
+  return SineOfTurns(GetSineTable(), radians * (1 / (2 * M_PI)));
+}
@@ -0,0 +1,70 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/font_metrics.h"
+
+#include <algorithm>
+
+// -----------------------------------------------------------------------
+// FontMetrics
+// -----------------------------------------------------------------------
+
+// static
+const int FontMetrics::kUnknown;
+
+FontMetrics::FontMetrics() : page_count_(0) {}
+
+FontMetrics::~FontMetrics() {}
+
+void FontMetrics::SetAdvance(int size,
+                             int style,
+                             uint32_t codepoint,
+                             int advance) {
+  if (!IsDense(size, style, codepoint)) {
+    sparse_[SparseKey(size, style, codepoint)] = advance;
+    return;
+  }
+
+  std::unique_ptr<SizeTable>& table = dense_[size];
+  if (!table)
+    table.reset(new SizeTable);
+
+  std::unique_ptr<int[]>& page = table->pages[codepoint >> kPageBits];
+  if (!page) {
+    page.reset(new int[kPageSize]);
+    std::fill(page.get(), page.get() + kPageSize, int(kUnknown));
+    page_count_++;
+  }
+
+  page[codepoint & (kPageSize - 1)] = advance;
+}
+
+void FontMetrics::Clear() {
+  for (std::unique_ptr<SizeTable>& table : dense_)
+    table.reset();
+  page_count_ = 0;
+  sparse_.clear();
+}
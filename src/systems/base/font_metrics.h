@@ -0,0 +1,97 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_FONT_METRICS_H_
+#define SRC_SYSTEMS_BASE_FONT_METRICS_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+
+// Advance widths of the characters of one font, for line breaking and
+// rlBabel's width queries, which ask for every character of every line.
+//
+// Plain style BMP characters at the usual font sizes go in dense tables: one
+// per size, split into 256 character pages which are allocated the first time
+// a character on them is stored. A lookup is then two array indexes. Anything
+// else (italics, huge sizes, characters outside the BMP) goes in a map.
+class FontMetrics {
+ public:
+  // Returned by Advance() for characters that haven't been stored.
+  static const int kUnknown = -1;
+
+  FontMetrics();
+  ~FontMetrics();
+
+  int Advance(int size, int style, uint32_t codepoint) const;
+  void SetAdvance(int size, int style, uint32_t codepoint, int advance);
+
+  void Clear();
+
+  // Number of dense pages allocated, across all sizes.
+  int page_count() const { return page_count_; }
+
+ private:
+  // Sizes at or above this go to |sparse_|.
+  static const int kMaxDenseSize = 256;
+  static const int kPageBits = 8;
+  static const int kPageSize = 1 << kPageBits;
+  static const int kPagesPerSize = 0x10000 >> kPageBits;
+
+  struct SizeTable {
+    std::unique_ptr<int[]> pages[kPagesPerSize];
+  };
+
+  static bool IsDense(int size, int style, uint32_t codepoint) {
+    return style == 0 && size >= 0 && size < kMaxDenseSize &&
+           codepoint <= 0xffff;
+  }
+
+  std::unique_ptr<SizeTable> dense_[kMaxDenseSize];
+  int page_count_;
+
+  typedef std::tuple<int, int, uint32_t> SparseKey;
+  std::map<SparseKey, int> sparse_;
+};
+
+inline int FontMetrics::Advance(int size,
+                                int style,
+                                uint32_t codepoint) const {
+  if (IsDense(size, style, codepoint)) {
+    const SizeTable* table = dense_[size].get();
+    if (!table)
+      return kUnknown;
+    const int* page = table->pages[codepoint >> kPageBits].get();
+    return page ? page[codepoint & (kPageSize - 1)] : kUnknown;
+  }
+
+  std::map<SparseKey, int>::const_iterator it =
+      sparse_.find(SparseKey(size, style, codepoint));
+  return it == sparse_.end() ? kUnknown : it->second;
+}
+
+#endif  // SRC_SYSTEMS_BASE_FONT_METRICS_H_
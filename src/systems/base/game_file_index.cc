@@ -0,0 +1,337 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/game_file_index.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/archive/text_iarchive.hpp>
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Bump whenever the saved format changes.
+const int kSavedIndexVersion = 1;
+
+int64_t MTimeOf(const fs::path& path) {
+  boost::system::error_code ec;
+  std::time_t mtime = fs::last_write_time(path, ec);
+  return ec ? -1 : static_cast<int64_t>(mtime);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// GameFileIndex
+// -----------------------------------------------------------------------
+
+GameFileIndex::GameFileIndex(const std::vector<std::string>& file_types)
+    : file_types_(file_types),
+      build_started_(false),
+      loaded_from_saved_index_(false) {}
+
+GameFileIndex::~GameFileIndex() {
+  // Don't leave the build thread writing to a destroyed object.
+  if (build_.valid())
+    build_.wait();
+}
+
+void GameFileIndex::RegisterExtensionList(
+    const std::vector<std::string>* extensions) {
+  extension_lists_.emplace_back(extensions, ResolveExtensions(*extensions));
+}
+
+void GameFileIndex::StartBuild(const fs::path& game_root,
+                               const std::vector<std::string>& folders,
+                               const fs::path& saved_index) {
+  WaitUntilBuilt();
+  build_started_ = true;
+  build_ = std::async(std::launch::async,
+                      &GameFileIndex::Build,
+                      this,
+                      game_root,
+                      folders,
+                      saved_index);
+}
+
+void GameFileIndex::WaitUntilBuilt() {
+  if (build_.valid())
+    build_.get();
+}
+
+fs::path GameFileIndex::Find(const std::string& name,
+                             const std::vector<std::string>& extensions) {
+  WaitUntilBuilt();
+
+  std::unordered_map<std::string, Slots>::const_iterator file =
+      files_.find(name);
+  if (file == files_.end())
+    return fs::path();
+
+  const std::vector<int>* types = NULL;
+  for (const auto& list : extension_lists_) {
+    if (list.first == &extensions) {
+      types = &list.second;
+      break;
+    }
+  }
+
+  std::vector<int> resolved;
+  if (!types) {
+    resolved = ResolveExtensions(extensions);
+    types = &resolved;
+  }
+
+  for (int type : *types) {
+    int record = file->second[type];
+    if (record != -1)
+      return fs::path(records_[record].path);
+  }
+
+  return fs::path();
+}
+
+void GameFileIndex::Build(fs::path game_root,
+                          std::vector<std::string> folders,
+                          fs::path saved_index) {
+  records_.clear();
+  directories_.clear();
+  files_.clear();
+  loaded_from_saved_index_ = false;
+
+  std::string game_root_string = game_root.string();
+  if (!saved_index.empty() &&
+      LoadSavedIndex(saved_index, game_root_string, folders)) {
+    loaded_from_saved_index_ = true;
+    BuildHashTable();
+    return;
+  }
+
+  // The top level is only stamped so that a newly created #FOLDNAME
+  // directory invalidates the saved index.
+  directories_.push_back({game_root_string, MTimeOf(game_root)});
+
+  std::vector<fs::path> roots;
+  fs::directory_iterator dir_end;
+  for (fs::directory_iterator dir(game_root); dir != dir_end; ++dir) {
+    if (fs::is_directory(dir->status())) {
+      std::string lowername = dir->path().filename().string();
+      boost::to_lower(lowername);
+      if (std::find(folders.begin(), folders.end(), lowername) !=
+          folders.end()) {
+        roots.push_back(dir->path());
+      }
+    }
+  }
+
+  // Walk each top level directory on its own thread; most of the time is
+  // spent waiting on the disk.
+  std::vector<WalkResult> results(roots.size());
+  std::atomic<size_t> next_root(0);
+  auto worker = [&]() {
+    size_t i;
+    while ((i = next_root++) < roots.size())
+      Walk(roots[i], &results[i]);
+  };
+
+  unsigned int thread_count = std::min<size_t>(
+      std::max(std::thread::hardware_concurrency(), 2u), roots.size());
+  std::vector<std::future<void>> threads;
+  for (unsigned int t = 1; t < thread_count; ++t) {
+    try {
+      threads.push_back(std::async(std::launch::async, worker));
+    } catch (std::system_error&) {
+      break;
+    }
+  }
+  worker();
+  for (std::future<void>& thread : threads)
+    thread.get();
+
+  // Merge in directory order so that the first file found still wins.
+  for (WalkResult& result : results) {
+    records_.insert(records_.end(),
+                    std::make_move_iterator(result.records.begin()),
+                    std::make_move_iterator(result.records.end()));
+    directories_.insert(directories_.end(),
+                        std::make_move_iterator(result.directories.begin()),
+                        std::make_move_iterator(result.directories.end()));
+  }
+
+  BuildHashTable();
+
+  if (!saved_index.empty())
+    SaveIndex(saved_index, game_root_string, folders);
+}
+
+void GameFileIndex::Walk(const fs::path& directory, WalkResult* result) const {
+  result->directories.push_back({directory.string(), MTimeOf(directory)});
+
+  fs::directory_iterator dir_end;
+  for (fs::directory_iterator dir(directory); dir != dir_end; ++dir) {
+    if (fs::is_directory(dir->status())) {
+      Walk(dir->path(), result);
+    } else {
+      std::string extension = dir->path().extension().string();
+      if (extension.size() > 1 && extension[0] == '.')
+        extension = extension.substr(1);
+      boost::to_lower(extension);
+
+      int type = TypeOf(extension);
+      if (type != -1) {
+        std::string stem = dir->path().stem().string();
+        boost::to_lower(stem);
+        result->records.push_back({stem, type, dir->path().string()});
+      }
+    }
+  }
+}
+
+int GameFileIndex::TypeOf(const std::string& extension) const {
+  std::vector<std::string>::const_iterator it =
+      std::find(file_types_.begin(), file_types_.end(), extension);
+  return it == file_types_.end() ? -1 : it - file_types_.begin();
+}
+
+std::vector<int> GameFileIndex::ResolveExtensions(
+    const std::vector<std::string>& extensions) const {
+  std::vector<int> types;
+  for (const std::string& extension : extensions) {
+    int type = TypeOf(extension);
+    if (type != -1)
+      types.push_back(type);
+  }
+  return types;
+}
+
+void GameFileIndex::BuildHashTable() {
+  files_.reserve(records_.size());
+  for (size_t i = 0; i < records_.size(); ++i) {
+    Slots& slots = files_[records_[i].stem];
+    if (slots.empty())
+      slots.assign(file_types_.size(), -1);
+    if (slots[records_[i].type] == -1)
+      slots[records_[i].type] = i;
+  }
+}
+
+bool GameFileIndex::LoadSavedIndex(const fs::path& saved_index,
+                                   const std::string& game_root,
+                                   const std::vector<std::string>& folders) {
+  fs::ifstream file(saved_index);
+  if (!file)
+    return false;
+
+  int version;
+  std::string saved_root;
+  std::vector<std::string> saved_folders, saved_types, stems, paths,
+      directories;
+  std::vector<int> types;
+  std::vector<int64_t> mtimes;
+  try {
+    boost::archive::text_iarchive ia(file);
+    ia >> version;
+    if (version != kSavedIndexVersion)
+      return false;
+    ia >> saved_root >> saved_folders >> saved_types >> directories >>
+        mtimes >> stems >> types >> paths;
+  } catch (std::exception&) {
+    return false;
+  }
+
+  if (saved_root != game_root || saved_folders != folders ||
+      saved_types != file_types_ || directories.size() != mtimes.size() ||
+      stems.size() != types.size() || stems.size() != paths.size()) {
+    return false;
+  }
+
+  // Adding or removing a file changes its directory's modification time, so
+  // the index is good as long as no directory has changed.
+  for (size_t i = 0; i < directories.size(); ++i) {
+    if (MTimeOf(directories[i]) != mtimes[i])
+      return false;
+  }
+
+  for (size_t i = 0; i < directories.size(); ++i)
+    directories_.push_back({directories[i], mtimes[i]});
+  for (size_t i = 0; i < stems.size(); ++i) {
+    if (types[i] < 0 || types[i] >= static_cast<int>(file_types_.size())) {
+      records_.clear();
+      directories_.clear();
+      return false;
+    }
+    records_.push_back({stems[i], types[i], paths[i]});
+  }
+
+  return true;
+}
+
+void GameFileIndex::SaveIndex(const fs::path& saved_index,
+                              const std::string& game_root,
+                              const std::vector<std::string>& folders) const {
+  std::vector<std::string> stems, paths, directories;
+  std::vector<int> types;
+  std::vector<int64_t> mtimes;
+  for (const Record& record : records_) {
+    stems.push_back(record.stem);
+    types.push_back(record.type);
+    paths.push_back(record.path);
+  }
+  for (const DirectoryStamp& directory : directories_) {
+    directories.push_back(directory.path);
+    mtimes.push_back(directory.mtime);
+  }
+
+  // Failing to save only costs the next startup a directory walk.
+  try {
+    fs::path temp_path = saved_index;
+    temp_path += ".tmp";
+    {
+      fs::ofstream file(temp_path);
+      if (!file)
+        return;
+      boost::archive::text_oarchive oa(file);
+      oa << kSavedIndexVersion << game_root << folders << file_types_
+         << directories << mtimes << stems << types << paths;
+    }
+    fs::rename(temp_path, saved_index);
+  } catch (std::exception&) {
+  }
+}
@@ -0,0 +1,150 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_GAME_FILE_INDEX_H_
+#define SRC_SYSTEMS_BASE_GAME_FILE_INDEX_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// An index of every game file that FindFile() can return, mapping a
+// lowercase basename and extension to the file on disk.
+//
+// Each basename is hashed once per lookup; its entry holds a slot per known
+// file type, and the extension lists passed to Find() are resolved to slot
+// numbers ahead of time, so a lookup never compares strings.
+//
+// Building the index means walking every #FOLDNAME directory, which can take
+// a while on a slow disk. The walk runs on a background thread (one per top
+// level directory) started as soon as the game root is known, and the result
+// is saved to disk. The next run reuses the saved index as long as none of
+// the indexed directories have a different modification time.
+class GameFileIndex {
+ public:
+  // |file_types| is every (lowercase) extension worth indexing.
+  explicit GameFileIndex(const std::vector<std::string>& file_types);
+  ~GameFileIndex();
+
+  // Precomputes the slots for |extensions|, which must outlive this object.
+  // Find() calls passing the same vector then skip resolving the extensions.
+  void RegisterExtensionList(const std::vector<std::string>* extensions);
+
+  // Starts indexing the subdirectories of |game_root| whose lowercase names
+  // are in |folders|. If |saved_index| isn't empty, an index saved there is
+  // used if it is still valid, and a freshly built index is written there.
+  void StartBuild(const boost::filesystem::path& game_root,
+                  const std::vector<std::string>& folders,
+                  const boost::filesystem::path& saved_index);
+
+  bool build_started() const { return build_started_; }
+
+  // Blocks until the build started by StartBuild() has finished. Rethrows
+  // anything the build threw.
+  void WaitUntilBuilt();
+
+  // Returns the file called |name| (case insensitive, without extension)
+  // with the first of |extensions| it exists with, or an empty path.
+  boost::filesystem::path Find(const std::string& name,
+                               const std::vector<std::string>& extensions);
+
+  // Number of files indexed.
+  size_t size() const { return records_.size(); }
+
+  // Whether the index was read back from disk instead of walking the game
+  // directories.
+  bool loaded_from_saved_index() const { return loaded_from_saved_index_; }
+
+ private:
+  struct Record {
+    std::string stem;
+    int type;
+    std::string path;
+  };
+
+  struct DirectoryStamp {
+    std::string path;
+    int64_t mtime;
+  };
+
+  // Everything found under a single top level directory.
+  struct WalkResult {
+    std::vector<Record> records;
+    std::vector<DirectoryStamp> directories;
+  };
+
+  // An index into files_ per known file type; -1 where there's no file.
+  typedef std::vector<int> Slots;
+
+  // Body of the build thread.
+  void Build(boost::filesystem::path game_root,
+             std::vector<std::string> folders,
+             boost::filesystem::path saved_index);
+
+  // Recursively adds everything under |directory| to |result|.
+  void Walk(const boost::filesystem::path& directory, WalkResult* result) const;
+
+  // Returns the slot for |extension|, or -1 if it isn't a known file type.
+  int TypeOf(const std::string& extension) const;
+
+  std::vector<int> ResolveExtensions(
+      const std::vector<std::string>& extensions) const;
+
+  // Fills files_ from records_.
+  void BuildHashTable();
+
+  bool LoadSavedIndex(const boost::filesystem::path& saved_index,
+                      const std::string& game_root,
+                      const std::vector<std::string>& folders);
+  void SaveIndex(const boost::filesystem::path& saved_index,
+                 const std::string& game_root,
+                 const std::vector<std::string>& folders) const;
+
+  std::vector<std::string> file_types_;
+
+  // Precomputed results of ResolveExtensions() for registered lists.
+  std::vector<std::pair<const std::vector<std::string>*, std::vector<int>>>
+      extension_lists_;
+
+  // Every indexed file, in the order FindFile() should prefer duplicates.
+  std::vector<Record> records_;
+
+  // Every directory that was walked, including the game root.
+  std::vector<DirectoryStamp> directories_;
+
+  std::unordered_map<std::string, Slots> files_;
+
+  bool build_started_;
+  std::future<void> build_;
+  bool loaded_from_saved_index_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_GAME_FILE_INDEX_H_
@@ -59,6 +59,18 @@ using std::vector;
 
 namespace fs = boost::filesystem;
 
+// -----------------------------------------------------------------------
+// GanDefinition
+// -----------------------------------------------------------------------
+
+size_t GanDefinition::MemoryUsage() const {
+  size_t bytes = sizeof(*this) +
+                 animation_sets.capacity() * sizeof(std::vector<Frame>);
+  for (const std::vector<Frame>& set : animation_sets)
+    bytes += set.capacity() * sizeof(Frame);
+  return bytes;
+}
+
 // -----------------------------------------------------------------------
 // GanGraphicsObjectData
 // -----------------------------------------------------------------------
@@ -84,8 +96,15 @@ GanGraphicsObjectData::GanGraphicsObjectData(System& system,
 GanGraphicsObjectData::~GanGraphicsObjectData() {}
 
 void GanGraphicsObjectData::LoadGANData() {
-  image_ = system_.graphics().GetSurfaceNamed(img_filename_);
-  image_->EnsureUploaded();
+  definition_ = system_.graphics().gan_definitions().Get(
+      gan_filename_ + '\0' + img_filename_,
+      [this]() { return ParseGANData(); });
+}
+
+std::shared_ptr<const GanDefinition> GanGraphicsObjectData::ParseGANData() {
+  std::shared_ptr<GanDefinition> definition(new GanDefinition);
+  definition->image = system_.graphics().GetSurfaceNamed(img_filename_);
+  definition->image->EnsureUploaded();
 
   fs::path gan_file_path = system_.FindFile(gan_filename_, GAN_FILETYPES);
   if (gan_file_path.empty()) {
@@ -103,7 +122,8 @@ void GanGraphicsObjectData::LoadGANData() {
   }
 
   TestFileMagic(gan_filename_, gan_data, file_size);
-  ReadData(gan_filename_, gan_data, file_size);
+  ReadData(gan_filename_, gan_data, file_size, definition.get());
+  return definition;
 }
 
 void GanGraphicsObjectData::TestFileMagic(const std::string& file_name,
@@ -120,7 +140,8 @@ void GanGraphicsObjectData::TestFileMagic(const std::string& file_name,
 
 void GanGraphicsObjectData::ReadData(const std::string& file_name,
                                      std::unique_ptr<char[]>& gan_data,
-                                     int file_size) {
+                                     int file_size,
+                                     GanDefinition* definition) {
   const char* data = gan_data.get();
   int file_name_length = read_i32(data + 0xc);
   string raw_file_name = data + 0x10;
@@ -154,14 +175,14 @@ void GanGraphicsObjectData::ReadData(const std::string& file_name,
     vector<Frame> animation_set;
     for (int j = 0; j < frame_count; ++j)
       animation_set.push_back(ReadSetFrame(file_name, data));
-    animation_sets.push_back(animation_set);
+    definition->animation_sets.push_back(animation_set);
   }
 }
 
 GanGraphicsObjectData::Frame GanGraphicsObjectData::ReadSetFrame(
     const std::string& file_name,
     const char*& data) {
-  GanGraphicsObjectData::Frame frame;
+  Frame frame;
 
   int tag = read_i32(data);
   data += 4;
@@ -202,6 +223,11 @@ GanGraphicsObjectData::Frame GanGraphicsObjectData::ReadSetFrame(
   return frame;
 }
 
+const GanGraphicsObjectData::Frame& GanGraphicsObjectData::CurrentFrame()
+    const {
+  return definition_->animation_sets.at(current_set_).at(current_frame_);
+}
+
 void GanGraphicsObjectData::ThrowBadFormat(const std::string& file_name,
                                            const std::string& error) {
   ostringstream oss;
@@ -213,9 +239,10 @@ void GanGraphicsObjectData::ThrowBadFormat(const std::string& file_name,
 int GanGraphicsObjectData::PixelWidth(
     const GraphicsObject& rendering_properties) {
   if (current_set_ != -1 && current_frame_ != -1) {
-    const Frame& frame = animation_sets.at(current_set_).at(current_frame_);
+    const Frame& frame = CurrentFrame();
     if (frame.pattern != -1) {
-      const Surface::GrpRect& rect = image_->GetPattern(frame.pattern);
+      const Surface::GrpRect& rect =
+          definition_->image->GetPattern(frame.pattern);
       return int(rendering_properties.GetWidthScaleFactor() *
                  rect.rect.width());
     }
@@ -227,9 +254,10 @@ int GanGraphicsObjectData::PixelWidth(
 int GanGraphicsObjectData::PixelHeight(
     const GraphicsObject& rendering_properties) {
   if (current_set_ != -1 && current_frame_ != -1) {
-    const Frame& frame = animation_sets.at(current_set_).at(current_frame_);
+    const Frame& frame = CurrentFrame();
     if (frame.pattern != -1) {
-      const Surface::GrpRect& rect = image_->GetPattern(frame.pattern);
+      const Surface::GrpRect& rect =
+          definition_->image->GetPattern(frame.pattern);
       return int(rendering_properties.GetHeightScaleFactor() *
                  rect.rect.height());
     }
@@ -248,7 +276,8 @@ void GanGraphicsObjectData::Execute(RLMachine& machine) {
     unsigned int time_since_last_frame_change =
         current_time - time_at_last_frame_change_;
 
-    const vector<Frame>& current_set = animation_sets.at(current_set_);
+    const vector<Frame>& current_set =
+        definition_->animation_sets.at(current_set_);
     unsigned int frame_time = (unsigned int)(current_set[current_frame_].time);
     if (time_since_last_frame_change > frame_time) {
       current_frame_++;
@@ -270,12 +299,12 @@ void GanGraphicsObjectData::LoopAnimation() { current_frame_ = 0; }
 std::shared_ptr<const Surface> GanGraphicsObjectData::CurrentSurface(
     const GraphicsObject& go) {
   if (current_set_ != -1 && current_frame_ != -1) {
-    const Frame& frame = animation_sets.at(current_set_).at(current_frame_);
+    const Frame& frame = CurrentFrame();
 
     if (frame.pattern != -1) {
       // We are currently rendering an animation AND the current frame says to
       // render something to the screen.
-      return image_;
+      return definition_->image;
     }
   }
 
@@ -283,22 +312,22 @@ std::shared_ptr<const Surface> GanGraphicsObjectData::CurrentSurface(
 }
 
 Rect GanGraphicsObjectData::SrcRect(const GraphicsObject& go) {
-  const Frame& frame = animation_sets.at(current_set_).at(current_frame_);
+  const Frame& frame = CurrentFrame();
   if (frame.pattern != -1) {
-    return image_->GetPattern(frame.pattern).rect;
+    return definition_->image->GetPattern(frame.pattern).rect;
   }
 
   return Rect();
 }
 
 Point GanGraphicsObjectData::DstOrigin(const GraphicsObject& go) {
-  const Frame& frame = animation_sets.at(current_set_).at(current_frame_);
+  const Frame& frame = CurrentFrame();
   return GraphicsObjectData::DstOrigin(go) - Size(frame.x, frame.y);
 }
 
 int GanGraphicsObjectData::GetRenderingAlpha(const GraphicsObject& go,
                                              const GraphicsObject* parent) {
-  const Frame& frame = animation_sets.at(current_set_).at(current_frame_);
+  const Frame& frame = CurrentFrame();
   if (frame.pattern != -1) {
     // Calculate the combination of our frame alpha with the current object
     // alpha.
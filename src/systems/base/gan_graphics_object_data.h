@@ -47,8 +47,35 @@ class GraphicsObject;
 
 // -----------------------------------------------------------------------
 
+// The parsed contents of a GAN file along with the image it animates.
+// Immutable once loaded, and shared by every object playing the same pair of
+// files (see GraphicsSystem::gan_definitions()).
+struct GanDefinition {
+  struct Frame {
+    int pattern;
+    int x;
+    int y;
+    int time;
+    int alpha;
+    int other;  // No idea what this is.
+  };
+
+  typedef std::vector<std::vector<Frame>> AnimationSets;
+
+  AnimationSets animation_sets;
+
+  // The image the above coordinates map into.
+  std::shared_ptr<const Surface> image;
+
+  // Approximate heap usage, for statistics.
+  size_t MemoryUsage() const;
+};
+
+// -----------------------------------------------------------------------
+
 // In-memory representation of a GAN file. Responsible for reading in,
-// storing, and rendering GAN data as a GraphicsObjectData.
+// storing, and rendering GAN data as a GraphicsObjectData. The parsed file is
+// a shared GanDefinition; this object only tracks the playback position.
 class GanGraphicsObjectData : public GraphicsObjectData {
  public:
   explicit GanGraphicsObjectData(System& system);
@@ -81,31 +108,30 @@ class GanGraphicsObjectData : public GraphicsObjectData {
   virtual void ObjectInfo(std::ostream& tree) override;
 
  private:
-  struct Frame {
-    int pattern;
-    int x;
-    int y;
-    int time;
-    int alpha;
-    int other;  // No idea what this is.
-  };
+  typedef GanDefinition::Frame Frame;
 
-  typedef std::vector<std::vector<Frame>> AnimationSets;
+  // Reads and parses the GAN and image files. Called through the definition
+  // cache.
+  std::shared_ptr<const GanDefinition> ParseGANData();
 
   void TestFileMagic(const std::string& file_name,
                      std::unique_ptr<char[]>& gan_data,
                      int file_size);
   void ReadData(const std::string& file_name,
                 std::unique_ptr<char[]>& gan_data,
-                int file_size);
+                int file_size,
+                GanDefinition* definition);
   Frame ReadSetFrame(const std::string& filename, const char*& data);
 
+  // The frame at |current_set_|, |current_frame_|.
+  const Frame& CurrentFrame() const;
+
   // Throws an error on bad GAN files.
   void ThrowBadFormat(const std::string& filename, const std::string& error);
 
   System& system_;
 
-  AnimationSets animation_sets;
+  std::shared_ptr<const GanDefinition> definition_;
 
   std::string gan_filename_;
   std::string img_filename_;
@@ -114,9 +140,6 @@ class GanGraphicsObjectData : public GraphicsObjectData {
   int current_frame_;
   int time_at_last_frame_change_;
 
-  // The image the above coordinates map into.
-  std::shared_ptr<const Surface> image_;
-
   friend class boost::serialization::access;
 
   // boost::serialization forward declaration
@@ -0,0 +1,276 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/glyph_cache.h"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "systems/base/colour.h"
+
+namespace {
+
+// The source colour and destination layout of a Composite() call.
+struct Blend {
+  Blend(const RGBColour& colour, const GlyphCache::Target& target)
+      : red(colour.r()),
+        green(colour.g()),
+        blue(colour.b()),
+        red_shift(target.red_shift),
+        green_shift(target.green_shift),
+        blue_shift(target.blue_shift),
+        alpha_shift(target.alpha_shift),
+        has_alpha(target.has_alpha),
+        colour_mask((0xffu << red_shift) | (0xffu << green_shift) |
+                    (0xffu << blue_shift)),
+        alpha_mask(has_alpha ? 0xffu << alpha_shift : 0) {}
+
+  int red, green, blue;
+  int red_shift, green_shift, blue_shift, alpha_shift;
+  bool has_alpha;
+  uint32_t colour_mask;
+  uint32_t alpha_mask;
+};
+
+// pygame's ALPHA_BLEND for one 32-bit pixel. A fully transparent pixel takes
+// the source colour outright, even where the source has no coverage.
+inline uint32_t BlendPixel(uint32_t value, int alpha, const Blend& blend) {
+  int dest_alpha = blend.has_alpha ? (value >> blend.alpha_shift) & 0xff : 255;
+  int r, g, b, a;
+  if (dest_alpha) {
+    int dest_red = (value >> blend.red_shift) & 0xff;
+    int dest_green = (value >> blend.green_shift) & 0xff;
+    int dest_blue = (value >> blend.blue_shift) & 0xff;
+    r = ((dest_red << 8) + (blend.red - dest_red) * alpha + blend.red) >> 8;
+    g = ((dest_green << 8) + (blend.green - dest_green) * alpha +
+         blend.green) >> 8;
+    b = ((dest_blue << 8) + (blend.blue - dest_blue) * alpha + blend.blue) >>
+        8;
+    a = alpha + dest_alpha - ((alpha * dest_alpha) / 255);
+  } else {
+    r = blend.red;
+    g = blend.green;
+    b = blend.blue;
+    a = alpha;
+  }
+
+  return (value & ~(blend.colour_mask | blend.alpha_mask)) |
+         (uint32_t(r) << blend.red_shift) |
+         (uint32_t(g) << blend.green_shift) |
+         (uint32_t(b) << blend.blue_shift) |
+         ((uint32_t(a) << blend.alpha_shift) & blend.alpha_mask);
+}
+
+// Pixels with no coverage only change if they're fully transparent.
+inline void BlendBlank(uint32_t* pixels, int count, const Blend& blend) {
+  if (!blend.has_alpha)
+    return;
+  for (int i = 0; i < count; ++i) {
+    if ((pixels[i] & blend.alpha_mask) == 0)
+      pixels[i] = BlendPixel(pixels[i], 0, blend);
+  }
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// GlyphCache::Key
+// -----------------------------------------------------------------------
+
+GlyphCache::Key::Key(int size, int style, uint32_t codepoint)
+    : size(size), style(style), codepoint(codepoint) {}
+
+bool GlyphCache::Key::operator<(const Key& rhs) const {
+  return std::tie(size, style, codepoint) <
+         std::tie(rhs.size, rhs.style, rhs.codepoint);
+}
+
+// -----------------------------------------------------------------------
+// GlyphCache::Target
+// -----------------------------------------------------------------------
+
+GlyphCache::Target::Target()
+    : pixels(NULL),
+      pitch(0),
+      size(),
+      red_shift(16),
+      green_shift(8),
+      blue_shift(0),
+      alpha_shift(24),
+      has_alpha(true) {}
+
+// -----------------------------------------------------------------------
+// GlyphCache::Page
+// -----------------------------------------------------------------------
+
+GlyphCache::Page::Page(int size)
+    : packer(size, size, 0), coverage(size * size) {}
+
+// -----------------------------------------------------------------------
+// GlyphCache
+// -----------------------------------------------------------------------
+
+GlyphCache::GlyphCache(int page_size, int max_pages)
+    : page_size_(page_size),
+      max_pages_(max_pages),
+      hits_(0),
+      misses_(0),
+      flushes_(0) {}
+
+GlyphCache::~GlyphCache() {}
+
+const GlyphCache::Glyph* GlyphCache::Find(const Key& key) {
+  std::map<Key, Glyph>::const_iterator it = glyphs_.find(key);
+  if (it == glyphs_.end()) {
+    misses_++;
+    return NULL;
+  }
+
+  hits_++;
+  return &it->second;
+}
+
+const GlyphCache::Glyph* GlyphCache::Store(const Key& key,
+                                           int width,
+                                           int height,
+                                           const uint8_t* coverage,
+                                           int pitch) {
+  // Trim the cell down to the pixels with any coverage.
+  int x1 = width, y1 = height, x2 = 0, y2 = 0;
+  for (int y = 0; y < height; ++y) {
+    const uint8_t* row = coverage + y * pitch;
+    for (int x = 0; x < width; ++x) {
+      if (row[x]) {
+        x1 = std::min(x1, x);
+        x2 = std::max(x2, x + 1);
+        y1 = std::min(y1, y);
+        y2 = std::max(y2, y + 1);
+      }
+    }
+  }
+
+  Glyph glyph;
+  glyph.cell = Size(width, height);
+  glyph.page = -1;
+  if (x1 < x2) {
+    glyph.ink = Rect::GRP(x1, y1, x2, y2);
+
+    Rect slot;
+    if (!Allocate(glyph.ink.width(), glyph.ink.height(), &glyph.page,
+                  &slot)) {
+      // Too big for a page; callers will just keep rasterizing it.
+      return NULL;
+    }
+    glyph.atlas_origin = slot.origin();
+
+    std::vector<uint8_t>& page = pages_[glyph.page].coverage;
+    for (int y = 0; y < glyph.ink.height(); ++y) {
+      std::copy(coverage + (y1 + y) * pitch + x1,
+                coverage + (y1 + y) * pitch + x2,
+                page.begin() + (slot.y() + y) * page_size_ + slot.x());
+    }
+  }
+
+  return &(glyphs_[key] = glyph);
+}
+
+void GlyphCache::Composite(const Glyph& glyph,
+                           const RGBColour& colour,
+                           const Point& origin,
+                           const Target& target) const {
+  Rect cell(origin, glyph.cell);
+  Rect area = cell.Intersection(Rect(Point(0, 0), target.size));
+  if (area.is_empty())
+    return;
+
+  Blend blend(colour, target);
+  const Rect& ink = glyph.ink;
+  for (int y = area.y(); y < area.y2(); ++y) {
+    uint32_t* row =
+        reinterpret_cast<uint32_t*>(target.pixels + y * target.pitch);
+    int cell_y = y - origin.y();
+    if (cell_y < ink.y() || cell_y >= ink.y2()) {
+      BlendBlank(row + area.x(), area.width(), blend);
+      continue;
+    }
+
+    // Split the row into the blank parts either side of the ink, and the
+    // ink itself.
+    int ink_x1 =
+        std::min(area.x2(), std::max(area.x(), origin.x() + ink.x()));
+    int ink_x2 = std::max(ink_x1, std::min(area.x2(), origin.x() + ink.x2()));
+    BlendBlank(row + area.x(), ink_x1 - area.x(), blend);
+    BlendBlank(row + ink_x2, area.x2() - ink_x2, blend);
+    if (ink_x1 == ink_x2)
+      continue;
+
+    const Page& page = pages_[glyph.page];
+    const uint8_t* coverage =
+        &page.coverage[(glyph.atlas_origin.y() + cell_y - ink.y()) *
+                           page_size_ +
+                       glyph.atlas_origin.x()] +
+        (ink_x1 - origin.x() - ink.x());
+    for (int x = ink_x1; x < ink_x2; ++x)
+      row[x] = BlendPixel(row[x], *coverage++, blend);
+  }
+}
+
+int GlyphCache::CoverageAt(const Glyph& glyph, int x, int y) const {
+  if (x < glyph.ink.x() || x >= glyph.ink.x2() || y < glyph.ink.y() ||
+      y >= glyph.ink.y2()) {
+    return 0;
+  }
+
+  const Page& page = pages_[glyph.page];
+  return page.coverage[(glyph.atlas_origin.y() + y - glyph.ink.y()) *
+                           page_size_ +
+                       glyph.atlas_origin.x() + x - glyph.ink.x()];
+}
+
+bool GlyphCache::Allocate(int width, int height, int* page, Rect* out) {
+  if (width > page_size_ || height > page_size_)
+    return false;
+
+  for (size_t i = 0; i < pages_.size(); ++i) {
+    if (pages_[i].packer.Allocate(width, height, out)) {
+      *page = i;
+      return true;
+    }
+  }
+
+  if (static_cast<int>(pages_.size()) == max_pages_) {
+    // Everything still in use will be rasterized again the next time it's
+    // shown, which is cheap next to tracking per glyph use.
+    pages_.clear();
+    glyphs_.clear();
+    flushes_++;
+  }
+
+  pages_.push_back(Page(page_size_));
+  *page = pages_.size() - 1;
+  return pages_.back().packer.Allocate(width, height, out);
+}
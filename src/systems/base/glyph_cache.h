@@ -0,0 +1,141 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_GLYPH_CACHE_H_
+#define SRC_SYSTEMS_BASE_GLYPH_CACHE_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "systems/base/rect.h"
+#include "systems/base/shelf_packer.h"
+
+class RGBColour;
+
+// Rasterized glyphs of one font file, so that text doesn't go back to
+// FreeType for every character on every page.
+//
+// Glyphs are keyed by (size, style, codepoint) and stored as 8-bit coverage
+// masks on atlas pages, trimmed to the pixels that have any coverage. Colour
+// is applied when a glyph is composited, so a glyph and its shadow share one
+// mask. When the atlas is full, every mask is thrown away and the pages
+// start over; a page of dialogue uses a small fraction of one page.
+class GlyphCache {
+ public:
+  struct Key {
+    Key(int size, int style, uint32_t codepoint);
+
+    bool operator<(const Key& rhs) const;
+
+    int size;
+    int style;
+    uint32_t codepoint;
+  };
+
+  struct Glyph {
+    // The size of the cell the rasterizer drew the glyph in.
+    Size cell;
+
+    // The part of |cell| with any coverage, and where its mask is. Empty for
+    // glyphs like spaces, which don't get any atlas space.
+    Rect ink;
+    int page;
+    Point atlas_origin;
+  };
+
+  // A 32-bit surface with 8-bit channels at the given bit positions.
+  struct Target {
+    Target();
+
+    uint8_t* pixels;
+    int pitch;
+    Size size;
+    int red_shift;
+    int green_shift;
+    int blue_shift;
+    int alpha_shift;
+    bool has_alpha;
+  };
+
+  GlyphCache(int page_size, int max_pages);
+  ~GlyphCache();
+
+  // Returns the glyph for |key|, or NULL if it isn't cached. The pointers
+  // Find() and Store() return are valid until the next Store().
+  const Glyph* Find(const Key& key);
+
+  // Caches a glyph drawn in a |width| x |height| cell. |coverage| has one
+  // byte per pixel, with rows |pitch| bytes apart.
+  const Glyph* Store(const Key& key,
+                     int width,
+                     int height,
+                     const uint8_t* coverage,
+                     int pitch);
+
+  // Draws |glyph|'s cell in |colour| with its top left corner at |origin|,
+  // clipped to |target|. Blends exactly like pygame_AlphaBlit() blending a
+  // TTF_RenderUTF8_Blended() surface, which is what text used to do.
+  void Composite(const Glyph& glyph,
+                 const RGBColour& colour,
+                 const Point& origin,
+                 const Target& target) const;
+
+  // Coverage of the pixel at |x|, |y| in |glyph|'s cell.
+  int CoverageAt(const Glyph& glyph, int x, int y) const;
+
+  int page_count() const { return pages_.size(); }
+  int glyph_count() const { return glyphs_.size(); }
+
+  // Statistics since construction.
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+  int flushes() const { return flushes_; }
+
+ private:
+  struct Page {
+    explicit Page(int size);
+
+    ShelfPacker packer;
+    std::vector<uint8_t> coverage;
+  };
+
+  // Finds room for a |width| x |height| mask, adding a page if needed.
+  // Returns false if the atlas is full.
+  bool Allocate(int width, int height, int* page, Rect* out);
+
+  int page_size_;
+  int max_pages_;
+  std::vector<Page> pages_;
+
+  std::map<Key, Glyph> glyphs_;
+
+  int hits_;
+  int misses_;
+  int flushes_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_GLYPH_CACHE_H_
@@ -42,8 +42,13 @@
 #include <string>
 #include <vector>
 
+#include "machine/rlmachine.h"
+#include "systems/base/damage_tracker.h"
+#include "systems/base/event_system.h"
 #include "systems/base/graphics_object_data.h"
+#include "systems/base/graphics_system.h"
 #include "systems/base/object_mutator.h"
+#include "systems/base/system.h"
 #include "utilities/exception.h"
 
 const int DEFAULT_TEXT_SIZE = 14;
@@ -89,6 +94,8 @@ const Rect EMPTY_CLIP = Rect(Point(0, 0), Size(-1, -1));
 const boost::shared_ptr<GraphicsObject::Impl> GraphicsObject::s_empty_impl(
     new GraphicsObject::Impl);
 
+unsigned GraphicsObject::s_render_list_revision = 0;
+
 // -----------------------------------------------------------------------
 // GraphicsObject::TextProperties
 // -----------------------------------------------------------------------
@@ -137,9 +144,14 @@ GraphicsObject::Impl::ButtonProperties::ButtonProperties()
 // -----------------------------------------------------------------------
 // GraphicsObject
 // -----------------------------------------------------------------------
-GraphicsObject::GraphicsObject() : impl_(s_empty_impl) {}
+GraphicsObject::GraphicsObject() : impl_(s_empty_impl) {
+  BumpRevision();
+  BumpRenderListRevision();
+}
 
 GraphicsObject::GraphicsObject(const GraphicsObject& rhs) : impl_(rhs.impl_) {
+  BumpRevision();
+  BumpRenderListRevision();
   if (rhs.object_data_) {
     object_data_.reset(rhs.object_data_->Clone());
     object_data_->set_owned_by(*this);
@@ -151,10 +163,15 @@ GraphicsObject::GraphicsObject(const GraphicsObject& rhs) : impl_(rhs.impl_) {
     object_mutators_.emplace_back(mutator->Clone());
 }
 
-GraphicsObject::~GraphicsObject() { DeleteObjectMutators(); }
+GraphicsObject::~GraphicsObject() {
+  BumpRenderListRevision();
+  DeleteObjectMutators();
+}
 
 GraphicsObject& GraphicsObject::operator=(const GraphicsObject& obj) {
   DeleteObjectMutators();
+  BumpRevision();
+  BumpRenderListRevision();
   impl_ = obj.impl_;
 
   if (obj.object_data_) {
@@ -171,11 +188,15 @@ GraphicsObject& GraphicsObject::operator=(const GraphicsObject& obj) {
 }
 
 void GraphicsObject::SetObjectData(GraphicsObjectData* obj) {
+  BumpRevision();
+  BumpRenderListRevision();
   object_data_.reset(obj);
   object_data_->set_owned_by(*this);
 }
 
 void GraphicsObject::SetVisible(const int in) {
+  if (in != impl_->visible_)
+    BumpRenderListRevision();
   MakeImplUnique();
   impl_->visible_ = in;
 }
@@ -370,16 +391,22 @@ void GraphicsObject::SetScrollRateY(const int y) {
 }
 
 void GraphicsObject::SetZOrder(const int in) {
+  if (in != impl_->z_order_)
+    BumpRenderListRevision();
   MakeImplUnique();
   impl_->z_order_ = in;
 }
 
 void GraphicsObject::SetZLayer(const int in) {
+  if (in != impl_->z_layer_)
+    BumpRenderListRevision();
   MakeImplUnique();
   impl_->z_layer_ = in;
 }
 
 void GraphicsObject::SetZDepth(const int in) {
+  if (in != impl_->z_depth_)
+    BumpRenderListRevision();
   MakeImplUnique();
   impl_->z_depth_ = in;
 }
@@ -853,6 +880,7 @@ std::vector<std::string> GraphicsObject::GetMutatorNames() const {
 }
 
 void GraphicsObject::MakeImplUnique() {
+  BumpRevision();
   if (!impl_.unique()) {
     impl_.reset(new Impl(*impl_));
   }
@@ -862,6 +890,11 @@ void GraphicsObject::DeleteObjectMutators() {
   object_mutators_.clear();
 }
 
+void GraphicsObject::BumpRevision() {
+  static uint64_t next_revision = 0;
+  revision_ = ++next_revision;
+}
+
 void GraphicsObject::Render(int objNum,
                             const GraphicsObject* parent,
                             std::ostream* tree) {
@@ -874,17 +907,36 @@ void GraphicsObject::Render(int objNum,
   }
 }
 
+bool GraphicsObject::GetDamageInfo(const GraphicsObject* parent,
+                                   Rect* rect,
+                                   uint64_t* signature) const {
+  if (!object_data_ || !visible())
+    return false;
+
+  if (!object_data_->GetDamageInfo(*this, parent, rect, signature))
+    return false;
+
+  *signature = DamageTracker::Combine(*signature, revision_);
+  return true;
+}
+
 void GraphicsObject::FreeObjectData() {
+  BumpRevision();
+  BumpRenderListRevision();
   object_data_.reset();
   DeleteObjectMutators();
 }
 
 void GraphicsObject::InitializeParams() {
+  BumpRevision();
+  BumpRenderListRevision();
   impl_ = s_empty_impl;
   DeleteObjectMutators();
 }
 
 void GraphicsObject::FreeDataAndInitializeParams() {
+  BumpRevision();
+  BumpRenderListRevision();
   object_data_.reset();
   impl_ = s_empty_impl;
   DeleteObjectMutators();
@@ -895,20 +947,36 @@ void GraphicsObject::Execute(RLMachine& machine) {
     object_data_->Execute(machine);
   }
 
+  if (object_mutators_.empty())
+    return;
+
+  // Mutators add their values to the frame's batch, which
+  // GraphicsSystem::ExecuteGraphicsSystem() applies once every object has
+  // run. Outside of that, we're our own batch.
+  GraphicsSystem& graphics = machine.system().graphics();
+  ObjectMutatorBatch& batch = graphics.object_mutator_batch();
+  bool owns_batch = !batch.is_open();
+  if (owns_batch)
+    batch.Begin(machine.system().event().GetTicks());
+
   // Run each mutator. If it returns true, remove it.
   std::vector<std::unique_ptr<ObjectMutator>>::iterator it =
       object_mutators_.begin();
   while (it != object_mutators_.end()) {
-    if ((**it)(machine, *this)) {
+    if ((**it)(batch, *this)) {
       it = object_mutators_.erase(it);
     } else {
       ++it;
     }
   }
+
+  if (owns_batch && batch.Apply())
+    graphics.mark_object_state_as_dirty();
 }
 
 template <class Archive>
 void GraphicsObject::serialize(Archive& ar, unsigned int version) {
+  BumpRenderListRevision();
   ar& impl_& object_data_;
 }
 
@@ -33,6 +33,7 @@
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/version.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -58,6 +59,11 @@ class GraphicsObject {
   ~GraphicsObject();
   GraphicsObject& operator=(const GraphicsObject& obj);
 
+  // Changes whenever any object is created or destroyed, gains or loses its
+  // data, or changes visibility or z values, so that the graphics system
+  // knows when its list of objects to draw is out of date.
+  static unsigned render_list_revision() { return s_render_list_revision; }
+
   // Object Position Accessors
 
   // This code, while a boolean, uses an int so that we can get rid
@@ -195,6 +201,13 @@ class GraphicsObject {
   // Render!
   void Render(int objNum, const GraphicsObject* parent, std::ostream* tree);
 
+  // Describes the next Render() for damage tracking; see
+  // GraphicsObjectData::GetDamageInfo(). Returns false if nothing will be
+  // drawn.
+  bool GetDamageInfo(const GraphicsObject* parent,
+                     Rect* rect,
+                     uint64_t* signature) const;
+
   // Frees the object data. Corresponds to objFree, but is also invoked by
   // other commands.
   void FreeObjectData();
@@ -324,6 +337,12 @@ class GraphicsObject {
   // Immediately delete all mutators; doesn't run their SetToEnd() method.
   void DeleteObjectMutators();
 
+  // Gives this object a new revision_. Called on every change that could
+  // affect how it's drawn.
+  void BumpRevision();
+
+  static void BumpRenderListRevision() { s_render_list_revision++; }
+
   // Implementation data structure. GraphicsObject::Impl is the internal data
   // store for GraphicsObjects' copy-on-write semantics.
   struct Impl {
@@ -512,12 +531,18 @@ class GraphicsObject {
   // is cloned on write.
   static const boost::shared_ptr<GraphicsObject::Impl> s_empty_impl;
 
+  static unsigned s_render_list_revision;
+
   // Our actual implementation data
   boost::shared_ptr<GraphicsObject::Impl> impl_;
 
   // The actual data used to render the object
   boost::scoped_ptr<GraphicsObjectData> object_data_;
 
+  // Unique across all objects and never reused, so that damage tracking can
+  // tell whether anything about this object changed since the last frame.
+  uint64_t revision_;
+
   // Tasks that run every tick. Used to mutate object parameters over time (and
   // how we check from a blocking LongOperation if the mutation is ongoing).
   //
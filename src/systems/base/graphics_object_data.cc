@@ -29,6 +29,7 @@
 
 #include <ostream>
 
+#include "systems/base/damage_tracker.h"
 #include "systems/base/graphics_object.h"
 #include "systems/base/graphics_object_of_file.h"
 #include "systems/base/surface.h"
@@ -74,6 +75,8 @@ void GraphicsObjectData::Render(const GraphicsObject& go,
     if (tree) {
       ObjectInfo(*tree);
       *tree << "  Rendering " << src << " to " << dst << std::endl;
+      *tree << "  Texture memory: " << surface->GetTextureMemoryUsage() / 1024
+            << " KB" << std::endl;
       if (parent) {
         *tree << "  Parent Properties: ";
         PrintGraphicsObjectToTree(*parent, tree);
@@ -157,6 +160,47 @@ void GraphicsObjectData::Render(const GraphicsObject& go,
   }
 }
 
+bool GraphicsObjectData::GetDamageInfo(const GraphicsObject& go,
+                                       const GraphicsObject* parent,
+                                       Rect* rect,
+                                       uint64_t* signature) {
+  std::shared_ptr<const Surface> surface = CurrentSurface(go);
+  if (!surface)
+    return false;
+
+  Rect src = SrcRect(go);
+  uint64_t sig = reinterpret_cast<uintptr_t>(surface.get());
+  sig = DamageTracker::Combine(sig, src.x());
+  sig = DamageTracker::Combine(sig, src.y());
+  sig = DamageTracker::Combine(sig, src.width());
+  sig = DamageTracker::Combine(sig, src.height());
+  sig = DamageTracker::Combine(sig, GetRenderingAlpha(go, parent));
+  *signature = sig;
+
+  // Rotated objects and children of parent layers are drawn through
+  // transforms that DstRect() doesn't account for.
+  if (parent || go.rotation() != 0) {
+    *rect = Rect();
+    return true;
+  }
+
+  Rect dst = DstRect(go, parent);
+  if (go.GetButtonUsingOverides()) {
+    dst = Rect(dst.origin() + Size(go.GetButtonXOffsetOverride(),
+                                   go.GetButtonYOffsetOverride()),
+               dst.size());
+  }
+
+  if (go.has_clip_rect()) {
+    dst = dst.Intersection(go.clip_rect());
+    if (dst.width() <= 0 || dst.height() <= 0)
+      return false;
+  }
+
+  *rect = dst;
+  return true;
+}
+
 void GraphicsObjectData::LoopAnimation() {}
 
 void GraphicsObjectData::EndAnimation() {
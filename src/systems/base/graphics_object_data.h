@@ -30,6 +30,7 @@
 
 #include <boost/serialization/access.hpp>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -85,6 +86,18 @@ class GraphicsObjectData {
   // format.
   virtual Rect DstRect(const GraphicsObject& go, const GraphicsObject* parent);
 
+  // Describes what the next Render() will draw, for damage tracking. Sets
+  // |rect| to where on the screen it will draw (or to an empty rect when that
+  // can't be worked out cheaply) and |signature| to a value that changes
+  // whenever what gets drawn does. Returns false if nothing will be drawn.
+  //
+  // The default handles everything drawn from CurrentSurface(); subclasses
+  // that override Render() must override this too.
+  virtual bool GetDamageInfo(const GraphicsObject& go,
+                             const GraphicsObject* parent,
+                             Rect* rect,
+                             uint64_t* signature);
+
  protected:
   // Function called after animation ends when this object has been
   // set up to loop. Default implementation does nothing.
@@ -55,6 +55,7 @@
 #include "systems/base/anm_graphics_object_data.h"
 #include "systems/base/cgm_table.h"
 #include "systems/base/event_system.h"
+#include "systems/base/gan_graphics_object_data.h"
 #include "systems/base/graphics_object.h"
 #include "systems/base/graphics_object_data.h"
 #include "systems/base/graphics_object_of_file.h"
@@ -83,6 +84,19 @@ using std::vector;
 
 namespace fs = boost::filesystem;
 
+namespace {
+
+// DamageTracker keys for things that aren't foreground objects, which are
+// keyed by their object number.
+const uint64_t kBackgroundDamageKey = 1ull << 32;
+const uint64_t kTextSystemDamageKey = 2ull << 32;
+
+// How many frames a second are presented while fast forwarding, unless
+// __SKIP_FPS says otherwise. Enough to see where the skip is.
+const int kDefaultSkipFPS = 15;
+
+}  // namespace
+
 // -----------------------------------------------------------------------
 // GraphicsSystem::GraphicsObjectSettings
 // -----------------------------------------------------------------------
@@ -224,6 +238,12 @@ GraphicsSystem::GraphicsSystem(System& system, Gameexe& gameexe)
       background_type_(BACKGROUND_DC0),
       screen_needs_refresh_(false),
       object_state_dirty_(false),
+      damage_tracking_(!gameexe("__NO_DAMAGE_TRACKING").ToInt(0)),
+      in_refresh_(false),
+      layer_caching_(!gameexe("__NO_LAYER_CACHE").ToInt(0)),
+      skip_frame_interval_(
+          1000 / std::max(gameexe("__SKIP_FPS").ToInt(kDefaultSkipFPS), 1)),
+      background_revision_(0),
       is_responsible_for_update_(true),
       display_subtitle_(gameexe("SUBTITLE").ToInt(0)),
       interface_hidden_(false),
@@ -238,7 +258,10 @@ GraphicsSystem::GraphicsSystem(System& system, Gameexe& gameexe)
       system_(system),
       preloaded_hik_scripts_(32),
       preloaded_g00_(256),
-      image_cache_(10) {}
+      image_cache_(10),
+      to_render_valid_(false),
+      to_render_filters_(0),
+      to_render_revision_(0) {}
 
 // -----------------------------------------------------------------------
 
@@ -246,7 +269,19 @@ GraphicsSystem::~GraphicsSystem() {}
 
 // -----------------------------------------------------------------------
 
-void GraphicsSystem::MarkScreenAsDirty(GraphicsUpdateType type) {
+void GraphicsSystem::MarkScreenAsDirty(GraphicsUpdateType type,
+                                       const Rect& area) {
+  // Damage is recorded even in manual mode, where it's the next refresh()
+  // that has to draw it.
+  if (type == GUT_DRAW_DC0 || type == GUT_DRAW_HIK)
+    background_revision_++;
+  if (type != GUT_DISPLAY_OBJ && type != GUT_MOUSE_MOTION) {
+    if (area.is_empty())
+      damage_.AddFull();
+    else
+      damage_.Add(area);
+  }
+
   switch (screen_update_mode()) {
     case SCREENUPDATEMODE_AUTOMATIC:
     case SCREENUPDATEMODE_SEMIAUTOMATIC: {
@@ -310,6 +345,7 @@ void GraphicsSystem::QueueShakeSpec(int spec) {
       }
     }
 
+    InvalidateScreen();
     ForceRefresh();
     time_at_last_queue_change_ = system().event().GetTicks();
   }
@@ -472,9 +508,34 @@ const ObjectSettings& GraphicsSystem::GetObjectSettings(const int obj_num) {
 // -----------------------------------------------------------------------
 
 void GraphicsSystem::Refresh(std::ostream* tree) {
-  BeginFrame();
-  DrawFrame(tree);
-  EndFrame();
+  DamageTracker::Plan plan = DamageTracker::FULL;
+  if (damage_tracking_ && CanRedrawPartially()) {
+    TrackDamage();
+
+    // The screen origin moves while shaking, which the damage rects don't
+    // account for.
+    if (!tree && screen_shake_queue_.empty())
+      plan = damage_.Decide();
+  }
+
+  in_refresh_ = true;
+  switch (plan) {
+    case DamageTracker::SKIP:
+      break;
+    case DamageTracker::PARTIAL:
+      BeginPartialFrame(damage_.bounds());
+      DrawFrame(tree);
+      EndFrame();
+      break;
+    case DamageTracker::FULL:
+      BeginFrame();
+      DrawFrame(tree);
+      EndFrame();
+      break;
+  }
+  in_refresh_ = false;
+
+  damage_.FrameDrawn(plan);
 }
 
 std::shared_ptr<Surface> GraphicsSystem::RenderToSurface() {
@@ -484,42 +545,48 @@ std::shared_ptr<Surface> GraphicsSystem::RenderToSurface() {
 }
 
 void GraphicsSystem::DrawFrame(std::ostream* tree) {
-  switch (background_type_) {
-    case BACKGROUND_DC0: {
-      // Display DC0
-      GetDC(0)->RenderToScreen(screen_rect(), screen_rect(), 255);
-      if (tree) {
-        // TODO(erg): How do we print the new graphics stack?
-        *tree << "Graphic Stack: UNDER CONSTRUCTION" << endl;
-      }
-      break;
-    }
-    case BACKGROUND_HIK: {
-      if (hik_renderer_) {
-        hik_renderer_->Render(tree);
-      } else {
-        GetHaikei()->RenderToScreen(screen_rect(), screen_rect(), 255);
-        if (tree) {
-          *tree << "[Haikei bitmap: " << default_bgr_name_ << "]" << endl;
-        }
-      }
-    }
+  // The layer holds the scene drawn at the normal screen origin.
+  int first_object = -1;
+  if (layer_caching_ && !tree && screen_shake_queue_.empty() &&
+      CanCacheLayers()) {
+    first_object = DrawCachedLayer();
   }
 
-  RenderObjects(tree);
+  if (first_object == -1) {
+    DrawBackground(tree);
+    RenderObjects(tree);
+  } else {
+    for (size_t i = first_object; i < to_render_.size(); ++i)
+      get<4>(to_render_[i])->Render(get<3>(to_render_[i]), NULL, tree);
+  }
 
   // Render text
   if (!is_interface_hidden())
     system().text().Render(tree);
+
+  if (tree) {
+    *tree << "Shared animation data: " << anm_definitions_.live_count()
+          << " ANM files used by " << anm_definitions_.user_count()
+          << " objects, " << gan_definitions_.live_count()
+          << " GAN files used by " << gan_definitions_.user_count()
+          << " objects; "
+          << anm_definitions_.bytes_saved() + gan_definitions_.bytes_saved()
+          << " bytes saved by sharing." << endl;
+    DescribeTextureMemory(*tree);
+  }
 }
 
 // -----------------------------------------------------------------------
 
 void GraphicsSystem::ExecuteGraphicsSystem(RLMachine& machine) {
   // Check to see if any of the graphics objects are reporting that
-  // they want to force a redraw
+  // they want to force a redraw. All their mutators are evaluated together
+  // afterwards, against one read of the clock.
+  object_mutator_batch_.Begin(system().event().GetTicks());
   for (GraphicsObject& obj : GetForegroundObjects())
     obj.Execute(machine);
+  if (object_mutator_batch_.Apply())
+    mark_object_state_as_dirty();
 
   if (mouse_cursor_)
     mouse_cursor_->Execute(system());
@@ -537,6 +604,7 @@ void GraphicsSystem::ExecuteGraphicsSystem(RLMachine& machine) {
       accumulated_ticks -= frame_ticks;
       time_at_last_queue_change_ += frame_ticks;
       screen_shake_queue_.pop();
+      InvalidateScreen();
       ForceRefresh();
     }
   }
@@ -808,8 +876,148 @@ void GraphicsSystem::ClearAllDCs() {
 
 // -----------------------------------------------------------------------
 
-void GraphicsSystem::RenderObjects(std::ostream* tree) {
+bool GraphicsSystem::CanRedrawPartially() { return false; }
+
+void GraphicsSystem::BeginPartialFrame(const Rect& area) { BeginFrame(); }
+
+bool GraphicsSystem::CanCacheLayers() { return false; }
+
+void GraphicsSystem::BeginLayer() {}
+
+void GraphicsSystem::EndLayer() {}
+
+void GraphicsSystem::DrawLayer() {}
+
+void GraphicsSystem::DescribeTextureMemory(std::ostream& tree) {}
+
+bool GraphicsSystem::DrawTransition(const Surface& from,
+                                    const Surface& to,
+                                    const Transition& transition) {
+  return false;
+}
+
+void GraphicsSystem::OnFrameEnded() {
+  if (!in_refresh_)
+    damage_.AddFull();
+}
+
+void GraphicsSystem::TrackDamage() {
+  // Drawing to DC0 reports its own damage.
+  damage_.Track(kBackgroundDamageKey, screen_rect(), GetBackgroundSignature());
+
+  CollectObjectsToRender();
+  for (ToRenderVec::iterator it = to_render_.begin(); it != to_render_.end();
+       ++it) {
+    Rect rect;
+    uint64_t signature;
+    if (get<4>(*it)->GetDamageInfo(NULL, &rect, &signature))
+      damage_.Track(get<3>(*it), rect, signature);
+  }
+
+  // Text windows draw name boxes and faces outside their window rect, so
+  // only changes to what's shown are tracked here. Text being typed out
+  // reports its own damage.
+  if (!is_interface_hidden())
+    damage_.Track(kTextSystemDamageKey, Rect(),
+                  system().text().GetDamageSignature());
+
+  damage_.FinishTracking();
+}
+
+uint64_t GraphicsSystem::GetBackgroundSignature() {
+  uint64_t background = background_type_;
+  if (background_type_ == BACKGROUND_HIK) {
+    background = DamageTracker::Combine(
+        background, reinterpret_cast<uintptr_t>(hik_renderer_.get()));
+    if (!hik_renderer_) {
+      background = DamageTracker::Combine(
+          background, reinterpret_cast<uintptr_t>(GetHaikei().get()));
+    }
+  } else {
+    background = DamageTracker::Combine(
+        background, reinterpret_cast<uintptr_t>(GetDC(0).get()));
+  }
+  return background;
+}
+
+void GraphicsSystem::DrawBackground(std::ostream* tree) {
+  switch (background_type_) {
+    case BACKGROUND_DC0: {
+      // Display DC0
+      GetDC(0)->RenderToScreen(screen_rect(), screen_rect(), 255);
+      if (tree) {
+        // TODO(erg): How do we print the new graphics stack?
+        *tree << "Graphic Stack: UNDER CONSTRUCTION" << endl;
+      }
+      break;
+    }
+    case BACKGROUND_HIK: {
+      if (hik_renderer_) {
+        hik_renderer_->Render(tree);
+      } else {
+        GetHaikei()->RenderToScreen(screen_rect(), screen_rect(), 255);
+        if (tree) {
+          *tree << "[Haikei bitmap: " << default_bgr_name_ << "]" << endl;
+        }
+      }
+    }
+  }
+}
+
+int GraphicsSystem::DrawCachedLayer() {
+  CollectObjectsToRender();
+
+  layer_cache_.BeginFrame();
+  layer_cache_.Add(kBackgroundDamageKey,
+                   DamageTracker::Combine(GetBackgroundSignature(),
+                                          background_revision_));
+  layer_objects_.clear();
+  for (size_t i = 0; i < to_render_.size(); ++i) {
+    Rect rect;
+    uint64_t signature;
+    if (get<4>(to_render_[i])->GetDamageInfo(NULL, &rect, &signature)) {
+      layer_cache_.Add(get<3>(to_render_[i]), signature);
+      layer_objects_.push_back(i);
+    }
+  }
+  layer_cache_.EndFrame();
+
+  int cached = layer_cache_.cached_count();
+  if (cached == 0)
+    return -1;
+
+  // Objects that don't draw anything are skipped by the cache, so the layer
+  // ends right after the last cached object that does.
+  int first_object = cached > 1 ? layer_objects_[cached - 2] + 1 : 0;
+  if (layer_cache_.needs_rebuild()) {
+    BeginLayer();
+    DrawBackground(NULL);
+    for (int i = 0; i < first_object; ++i)
+      get<4>(to_render_[i])->Render(get<3>(to_render_[i]), NULL, NULL);
+    EndLayer();
+  }
+  DrawLayer();
+
+  return first_object;
+}
+
+void GraphicsSystem::CollectObjectsToRender() {
+  // The list only changes when objects are created, freed, shown, hidden or
+  // restacked, or when a whole class of objects is toggled; on most frames
+  // it's still good.
+  int filters = (should_show_object1() ? 1 : 0) |
+                (should_show_object2() ? 2 : 0) |
+                (should_show_weather() ? 4 : 0) |
+                (is_interface_hidden() ? 8 : 0);
+  if (to_render_valid_ && filters == to_render_filters_ &&
+      GraphicsObject::render_list_revision() == to_render_revision_) {
+    return;
+  }
+
   to_render_.clear();
+  to_render_valid_ = true;
+  to_render_filters_ = filters;
+  to_render_revision_ = GraphicsObject::render_list_revision();
 
   // Collate all objects that we might want to render.
   AllocatedLazyArrayIterator<GraphicsObject> it =
@@ -817,6 +1025,10 @@ void GraphicsSystem::RenderObjects(std::ostream* tree) {
   AllocatedLazyArrayIterator<GraphicsObject> end =
       graphics_object_impl_->foreground_objects.end();
   for (; it != end; ++it) {
+    // Nothing else would draw anything.
+    if (!it->has_object_data() || !it->visible())
+      continue;
+
     const ObjectSettings& settings = GetObjectSettings(it.pos());
     if (settings.obj_on_off == 1 && should_show_object1() == false)
       continue;
@@ -833,6 +1045,10 @@ void GraphicsSystem::RenderObjects(std::ostream* tree) {
 
   // Sort by all the ordering values.
   std::sort(to_render_.begin(), to_render_.end());
+}
+
+void GraphicsSystem::RenderObjects(std::ostream* tree) {
+  CollectObjectsToRender();
 
   for (ToRenderVec::iterator it = to_render_.begin(); it != to_render_.end();
        ++it) {
@@ -878,6 +1094,8 @@ std::shared_ptr<MouseCursor> GraphicsSystem::GetCurrentCursor() {
 void GraphicsSystem::SetScreenSize(const Size& size) {
   screen_size_ = size;
   screen_rect_ = Rect(Point(0, 0), size);
+  damage_.set_screen(screen_rect_);
+  damage_.AddFull();
 }
 
 // -----------------------------------------------------------------------
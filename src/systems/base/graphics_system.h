@@ -43,11 +43,16 @@
 #include <vector>
 
 #include "systems/base/cgm_table.h"
+#include "systems/base/damage_tracker.h"
+#include "systems/base/layer_cache.h"
 #include "systems/base/event_listener.h"
+#include "systems/base/object_mutator_batch.h"
+#include "systems/base/presentation_clock.h"
 #include "systems/base/rect.h"
 #include "systems/base/tone_curve.h"
 
 #include "utilities/lazy_array.h"
+#include "utilities/shared_definition_cache.h"
 #include "lru_cache.hpp"
 
 class ColourFilter;
@@ -64,7 +69,10 @@ class RLMachine;
 class Size;
 class Surface;
 class System;
+struct AnmDefinition;
+struct GanDefinition;
 struct ObjectSettings;
+struct Transition;
 
 template <typename T>
 class LazyArray;
@@ -310,12 +318,30 @@ class GraphicsSystem : public EventListener {
   const ObjectSettings& GetObjectSettings(const int obj_num);
 
   // Should be called by any of the drawing functions the screen is
-  // invalidated.
+  // invalidated. |area| is the part of the screen that changed, if known; an
+  // empty rect means the whole screen unless |type| is GUT_DISPLAY_OBJ or
+  // GUT_MOUSE_MOTION, whose damage is worked out at refresh time.
   //
   // For more information, please see section 5.10.4 of the RLDev
   // manual, which deals with the behaviour of screen updates, and the
   // various modes.
-  virtual void MarkScreenAsDirty(GraphicsUpdateType type);
+  virtual void MarkScreenAsDirty(GraphicsUpdateType type, const Rect& area);
+  void MarkScreenAsDirty(GraphicsUpdateType type) {
+    MarkScreenAsDirty(type, Rect());
+  }
+
+  // Forgets what's on the screen, so that the next refresh redraws all of
+  // it. For when the window contents were lost or drawn over.
+  void InvalidateScreen() { damage_.AddFull(); }
+
+  // Like InvalidateScreen(), but only for |area|. Neither asks for a refresh.
+  void InvalidateScreenArea(const Rect& area) { damage_.Add(area); }
+
+  const DamageTracker& damage() const { return damage_; }
+  bool damage_tracking() const { return damage_tracking_; }
+
+  const LayerCache& layer_cache() const { return layer_cache_; }
+  bool layer_caching() const { return layer_caching_; }
 
   // Forces a refresh of the screen the next time the graphics system
   // executes.
@@ -330,11 +356,31 @@ class GraphicsSystem : public EventListener {
   void mark_object_state_as_dirty() { object_state_dirty_ = true; }
   bool object_state_dirty() const { return object_state_dirty_; }
 
+  // Where ObjectMutators put their values during ExecuteGraphicsSystem().
+  ObjectMutatorBatch& object_mutator_batch() { return object_mutator_batch_; }
+
   virtual void BeginFrame() = 0;
   virtual void EndFrame() = 0;
   virtual std::shared_ptr<Surface> EndFrameToSurface() = 0;
 
-  // Performs a full redraw of the screen.
+  // Draws one whole frame of a \#SEL transition from |from| to |to| between
+  // BeginFrame() and EndFrame(). Returns false if the platform can't draw
+  // |transition| in one pass, in which case the caller has to build the
+  // frame out of RenderToScreen() calls itself.
+  virtual bool DrawTransition(const Surface& from,
+                              const Surface& to,
+                              const Transition& transition);
+
+  // When frames reach the screen. Platforms report each presented frame.
+  PresentationClock& presentation_clock() { return presentation_clock_; }
+
+  // While the game fast forwards, the screen is only presented this often (in
+  // milliseconds) and the VM runs uninterrupted in between.
+  unsigned int skip_frame_interval() const { return skip_frame_interval_; }
+
+  // Redraws the screen. Unless damage tracking is off or |tree| is
+  // requested, only the parts that changed since the last Refresh() are
+  // redrawn, and nothing at all if nothing changed.
   void Refresh(std::ostream* tree);
 
   // Draws the screen (as if refresh() was called), but draw to the returned
@@ -367,6 +413,14 @@ class GraphicsSystem : public EventListener {
   std::shared_ptr<const Surface> GetSurfaceNamed(
       const std::string& short_filename);
 
+  // Parsed ANM and GAN files, shared between every object playing them.
+  SharedDefinitionCache<AnmDefinition>& anm_definitions() {
+    return anm_definitions_;
+  }
+  SharedDefinitionCache<GanDefinition>& gan_definitions() {
+    return gan_definitions_;
+  }
+
   virtual std::shared_ptr<Surface> GetHaikei() = 0;
 
   virtual std::shared_ptr<Surface> GetDC(int dc) = 0;
@@ -470,7 +524,57 @@ class GraphicsSystem : public EventListener {
 
   void DrawFrame(std::ostream* tree);
 
+  // Whether the platform can restore the last frame it presented and redraw
+  // only part of it. When false, every refresh redraws the whole screen.
+  virtual bool CanRedrawPartially();
+
+  // Like BeginFrame(), but starts from the last presented frame and clips
+  // all drawing to |area|.
+  virtual void BeginPartialFrame(const Rect& area);
+
+  // Subclasses call this at the end of every frame. A frame drawn outside
+  // Refresh() (by an effect, for example) leaves the screen in a state the
+  // damage tracker knows nothing about.
+  void OnFrameEnded();
+
+  // Whether the platform has an offscreen layer to cache the static bottom
+  // of the scene in. When false, every frame draws every object.
+  virtual bool CanCacheLayers();
+
+  // Redirects drawing into the (cleared) layer, and back to the frame being
+  // drawn.
+  virtual void BeginLayer();
+  virtual void EndLayer();
+
+  // Draws the contents of the layer over the whole screen.
+  virtual void DrawLayer();
+
+  // Subclasses call this when the layer's contents were lost.
+  void InvalidateLayer() { layer_cache_.Invalidate(); }
+
+  // Appends a summary of the video memory the scene uses to a render tree
+  // dump. Per object figures are printed with each object.
+  virtual void DescribeTextureMemory(std::ostream& tree);
+
  private:
+  // Collates the foreground objects that should be drawn into |to_render_|,
+  // sorted by drawing order, unless it's already up to date.
+  void CollectObjectsToRender();
+
+  // Records what's about to be drawn with |damage_|.
+  void TrackDamage();
+
+  // Identifies the current background, but not what's drawn on it.
+  uint64_t GetBackgroundSignature();
+
+  void DrawBackground(std::ostream* tree);
+
+  // Works out with |layer_cache_| how much of |to_render_| can come from the
+  // layer, rebuilds the layer if needed and draws it. Returns the index of
+  // the first object in |to_render_| to draw normally, or -1 if the layer
+  // wasn't used and the background still has to be drawn.
+  int DrawCachedLayer();
+
   // Gets a platform appropriate surface loaded.
   virtual std::shared_ptr<const Surface> LoadSurfaceFromFile(
       const std::string& short_filename) = 0;
@@ -495,6 +599,36 @@ class GraphicsSystem : public EventListener {
   // Whether object state has been mutated since the last screen refresh.
   bool object_state_dirty_;
 
+  // Which parts of the screen changed since the last refresh.
+  DamageTracker damage_;
+
+  // Whether refreshes are allowed to redraw less than the whole screen.
+  bool damage_tracking_;
+
+  // Set while Refresh() is drawing.
+  bool in_refresh_;
+
+  // Which part of the scene is composited from the layer.
+  LayerCache layer_cache_;
+
+  // Whether the static bottom of the scene may be cached in a layer.
+  bool layer_caching_;
+
+  PresentationClock presentation_clock_;
+
+  // From __SKIP_FPS.
+  unsigned int skip_frame_interval_;
+
+  // Reused every frame, so it holds on to its storage.
+  ObjectMutatorBatch object_mutator_batch_;
+
+  // Bumped whenever the background's contents change.
+  uint64_t background_revision_;
+
+  // Index into |to_render_| of each object added to |layer_cache_| this
+  // frame.
+  std::vector<int> layer_objects_;
+
   // Whether it is the Graphics system's responsibility to redraw the
   // screen. Some LongOperations temporarily take this responsibility
   // to implement pretty fades and wipes
@@ -578,6 +712,9 @@ class GraphicsSystem : public EventListener {
   // This cache's contents are assumed to be immutable.
   LRUCache<std::string, std::shared_ptr<const Surface>> image_cache_;
 
+  SharedDefinitionCache<AnmDefinition> anm_definitions_;
+  SharedDefinitionCache<GanDefinition> gan_definitions_;
+
   // Possible background script which drives graphics to the screen.
   std::unique_ptr<HIKRenderer> hik_renderer_;
 
@@ -590,6 +727,12 @@ class GraphicsSystem : public EventListener {
       ToRenderVec;
   ToRenderVec to_render_;
 
+  // |to_render_| stays valid until GraphicsObject::render_list_revision() or
+  // the object filters it was built with change.
+  bool to_render_valid_;
+  int to_render_filters_;
+  unsigned to_render_revision_;
+
   // boost::serialization support
   friend class boost::serialization::access;
 
@@ -0,0 +1,100 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/layer_cache.h"
+
+#include "systems/base/damage_tracker.h"
+
+LayerCache::LayerCache()
+    : generation_(0),
+      layer_hash_(0),
+      layer_valid_(false),
+      cached_count_(0),
+      needs_rebuild_(false),
+      rebuilds_(0),
+      reuses_(0) {}
+
+LayerCache::~LayerCache() {}
+
+void LayerCache::BeginFrame() {
+  order_.clear();
+  cached_count_ = 0;
+  needs_rebuild_ = false;
+}
+
+void LayerCache::Add(uint64_t key, uint64_t signature) {
+  std::unordered_map<uint64_t, Tracked>::iterator it = tracked_.find(key);
+  if (it == tracked_.end()) {
+    Tracked tracked = {signature, 1, generation_};
+    tracked_.insert(std::make_pair(key, tracked));
+  } else {
+    Tracked& tracked = it->second;
+    if (tracked.generation == generation_ - 1 &&
+        tracked.signature == signature) {
+      tracked.stable_frames++;
+    } else {
+      tracked.signature = signature;
+      tracked.stable_frames = 1;
+    }
+    tracked.generation = generation_;
+  }
+
+  order_.push_back(key);
+}
+
+void LayerCache::EndFrame() {
+  size_t prefix = 0;
+  uint64_t hash = 0;
+  for (; prefix < order_.size(); ++prefix) {
+    const Tracked& tracked = tracked_[order_[prefix]];
+    if (tracked.stable_frames < kMinStableFrames)
+      break;
+    hash = DamageTracker::Combine(hash, order_[prefix]);
+    hash = DamageTracker::Combine(hash, tracked.signature);
+  }
+
+  if (prefix >= static_cast<size_t>(kMinCachedItems)) {
+    cached_count_ = prefix;
+    needs_rebuild_ = !layer_valid_ || hash != layer_hash_;
+    if (needs_rebuild_) {
+      layer_hash_ = hash;
+      layer_valid_ = true;
+      rebuilds_++;
+    } else {
+      reuses_++;
+    }
+  }
+
+  for (std::unordered_map<uint64_t, Tracked>::iterator it = tracked_.begin();
+       it != tracked_.end();) {
+    if (it->second.generation != generation_)
+      it = tracked_.erase(it);
+    else
+      ++it;
+  }
+
+  generation_++;
+}
@@ -0,0 +1,108 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_LAYER_CACHE_H_
+#define SRC_SYSTEMS_BASE_LAYER_CACHE_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Decides how much of the bottom of the scene can be composited from a cached
+// layer instead of being redrawn.
+//
+// Every frame, the background and each object are Add()ed in drawing order
+// with a signature of everything that affects how they look. Items that have
+// looked the same for kMinStableFrames frames are static, and the run of
+// static items at the bottom of the scene is rendered once into an offscreen
+// layer; later frames draw that layer and then only what's above it. Any
+// change to an item in the run, or to which items make up the run, makes the
+// layer stale and it gets rebuilt.
+//
+// Only the bottom of the scene is cached. Objects blend with whatever is
+// beneath them (additively, through colour filters, or just through
+// translucent edges), so a run above an animating object can't be rendered
+// on its own and give the same pixels.
+class LayerCache {
+ public:
+  LayerCache();
+  ~LayerCache();
+
+  // Starts planning a frame.
+  void BeginFrame();
+
+  // Adds the next item in drawing order.
+  void Add(uint64_t key, uint64_t signature);
+
+  // Finishes planning. Afterwards, the first cached_count() items of the
+  // frame come from the layer, which must be rendered again first if
+  // needs_rebuild().
+  void EndFrame();
+
+  // Forgets the layer's contents, for when the platform lost them.
+  void Invalidate() { layer_valid_ = false; }
+
+  int cached_count() const { return cached_count_; }
+  bool needs_rebuild() const { return needs_rebuild_; }
+
+  // How many frames in a row an item has to look the same to be cached.
+  static const int kMinStableFrames = 3;
+
+  // Caching a single item would just draw it through an extra buffer.
+  static const int kMinCachedItems = 2;
+
+  // Statistics since construction.
+  int rebuilds() const { return rebuilds_; }
+  int reuses() const { return reuses_; }
+
+ private:
+  struct Tracked {
+    uint64_t signature;
+    int stable_frames;
+    int generation;
+  };
+
+  std::unordered_map<uint64_t, Tracked> tracked_;
+
+  // This frame's items, in drawing order.
+  std::vector<uint64_t> order_;
+
+  // Bumped by every EndFrame(); entries with an older value weren't in the
+  // last frame.
+  int generation_;
+
+  // Identifies the items the layer was last rendered with.
+  uint64_t layer_hash_;
+  bool layer_valid_;
+
+  int cached_count_;
+  bool needs_rebuild_;
+
+  int rebuilds_;
+  int reuses_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_LAYER_CACHE_H_
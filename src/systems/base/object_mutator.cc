@@ -26,14 +26,7 @@
 
 #include "systems/base/object_mutator.h"
 
-#include "machine/rlmachine.h"
-#include "systems/base/event_system.h"
 #include "systems/base/graphics_object.h"
-#include "systems/base/graphics_object_data.h"
-#include "systems/base/graphics_system.h"
-#include "systems/base/parent_graphics_object_data.h"
-#include "systems/base/system.h"
-#include "utilities/math_util.h"
 
 ObjectMutator::ObjectMutator(int repr,
                              const std::string& name,
@@ -53,12 +46,11 @@ ObjectMutator::ObjectMutator(const ObjectMutator& mutator) = default;
 
 ObjectMutator::~ObjectMutator() {}
 
-bool ObjectMutator::operator()(RLMachine& machine, GraphicsObject& object) {
-  unsigned int ticks = machine.system().event().GetTicks();
-  if (ticks > (creation_time_ + delay_)) {
-    PerformSetting(machine, object);
-    machine.system().graphics().mark_object_state_as_dirty();
-  }
+bool ObjectMutator::operator()(ObjectMutatorBatch& batch,
+                               GraphicsObject& object) {
+  unsigned int ticks = batch.ticks();
+  if (ticks > (creation_time_ + delay_))
+    PerformSetting(batch, object);
   return ticks > (creation_time_ + delay_ + duration_time_);
 }
 
@@ -66,20 +58,23 @@ bool ObjectMutator::OperationMatches(int repr, const std::string& name) const {
   return repr_ == repr && name_ == name;
 }
 
-int ObjectMutator::GetValueForTime(RLMachine& machine, int start, int end) {
-  unsigned int ticks = machine.system().event().GetTicks();
-  if (ticks < (creation_time_ + delay_)) {
-    return start;
-  } else if (ticks < (creation_time_ + delay_ + duration_time_)) {
-    return InterpolateBetween(creation_time_ + delay_,
-                              ticks,
-                              creation_time_ + delay_ + duration_time_,
-                              start,
-                              end,
-                              type_);
-  } else {
-    return end;
-  }
+void ObjectMutator::AddSetting(ObjectMutatorBatch& batch,
+                               GraphicsObject& object,
+                               ObjectMutatorBatch::Setter setter,
+                               int start,
+                               int end) {
+  batch.Add(&object, setter, creation_time_ + delay_, duration_time_, type_,
+            start, end);
+}
+
+void ObjectMutator::AddSetting(ObjectMutatorBatch& batch,
+                               GraphicsObject& object,
+                               ObjectMutatorBatch::RepnoSetter setter,
+                               int repno,
+                               int start,
+                               int end) {
+  batch.Add(&object, setter, repno, creation_time_ + delay_, duration_time_,
+            type_, start, end);
 }
 
 // -----------------------------------------------------------------------
@@ -110,10 +105,9 @@ ObjectMutator* OneIntObjectMutator::Clone() const {
   return new OneIntObjectMutator(*this);
 }
 
-void OneIntObjectMutator::PerformSetting(RLMachine& machine,
+void OneIntObjectMutator::PerformSetting(ObjectMutatorBatch& batch,
                                          GraphicsObject& object) {
-  int value = GetValueForTime(machine, startval_, endval_);
-  (object.*setter_)(value);
+  AddSetting(batch, object, setter_, startval_, endval_);
 }
 
 // -----------------------------------------------------------------------
@@ -147,10 +141,9 @@ ObjectMutator* RepnoIntObjectMutator::Clone() const {
   return new RepnoIntObjectMutator(*this);
 }
 
-void RepnoIntObjectMutator::PerformSetting(RLMachine& machine,
+void RepnoIntObjectMutator::PerformSetting(ObjectMutatorBatch& batch,
                                            GraphicsObject& object) {
-  int value = GetValueForTime(machine, startval_, endval_);
-  (object.*setter_)(repno_, value);
+  AddSetting(batch, object, setter_, repno_, startval_, endval_);
 }
 
 // -----------------------------------------------------------------------
@@ -188,11 +181,8 @@ ObjectMutator* TwoIntObjectMutator::Clone() const {
   return new TwoIntObjectMutator(*this);
 }
 
-void TwoIntObjectMutator::PerformSetting(RLMachine& machine,
+void TwoIntObjectMutator::PerformSetting(ObjectMutatorBatch& batch,
                                          GraphicsObject& object) {
-  int value = GetValueForTime(machine, startval_one_, endval_one_);
-  (object.*setter_one_)(value);
-
-  value = GetValueForTime(machine, startval_two_, endval_two_);
-  (object.*setter_two_)(value);
+  AddSetting(batch, object, setter_one_, startval_one_, endval_one_);
+  AddSetting(batch, object, setter_two_, startval_two_, endval_two_);
 }
@@ -29,6 +29,8 @@
 
 #include <string>
 
+#include "systems/base/object_mutator_batch.h"
+
 class GraphicsObject;
 class RLMachine;
 
@@ -46,9 +48,10 @@ class ObjectMutator {
   int repr() const { return repr_; }
   const std::string& name() const { return name_; }
 
-  // Called every tick. Returns true if the command has completed. Virtual for
-  // testing.
-  virtual bool operator()(RLMachine& machine, GraphicsObject& object);
+  // Called every frame. Adds this frame's values for |object| to |batch|, if
+  // the mutation has started. Returns true if the command has completed.
+  // Virtual for testing.
+  virtual bool operator()(ObjectMutatorBatch& batch, GraphicsObject& object);
 
   // Returns true if this ObjectMutator is operating on |name|/|repr|.
   bool OperationMatches(int repr, const std::string& name) const;
@@ -62,11 +65,23 @@ class ObjectMutator {
  protected:
   ObjectMutator(const ObjectMutator& mutator);
 
-  // Returns what value should be set on the object at the current time.
-  int GetValueForTime(RLMachine& machine, int start, int end);
-
-  // Template method that actually sets the values.
-  virtual void PerformSetting(RLMachine& machine, GraphicsObject& object) = 0;
+  // Adds a track to |batch| which moves the value passed to |setter| from
+  // |start| to |end| over the course of this mutation.
+  void AddSetting(ObjectMutatorBatch& batch,
+                  GraphicsObject& object,
+                  ObjectMutatorBatch::Setter setter,
+                  int start,
+                  int end);
+  void AddSetting(ObjectMutatorBatch& batch,
+                  GraphicsObject& object,
+                  ObjectMutatorBatch::RepnoSetter setter,
+                  int repno,
+                  int start,
+                  int end);
+
+  // Template method that adds the values to set.
+  virtual void PerformSetting(ObjectMutatorBatch& batch,
+                              GraphicsObject& object) = 0;
 
  private:
   // An optional paramater to identify object setters that pass additional
@@ -111,7 +126,7 @@ class OneIntObjectMutator : public ObjectMutator {
 
   virtual void SetToEnd(RLMachine& machine, GraphicsObject& object) override;
   virtual ObjectMutator* Clone() const override;
-  virtual void PerformSetting(RLMachine& machine,
+  virtual void PerformSetting(ObjectMutatorBatch& batch,
                               GraphicsObject& object) override;
 
   int startval_;
@@ -142,7 +157,7 @@ class RepnoIntObjectMutator : public ObjectMutator {
 
   virtual void SetToEnd(RLMachine& machine, GraphicsObject& object) override;
   virtual ObjectMutator* Clone() const override;
-  virtual void PerformSetting(RLMachine& machine,
+  virtual void PerformSetting(ObjectMutatorBatch& batch,
                               GraphicsObject& object) override;
 
   int repno_;
@@ -176,7 +191,7 @@ class TwoIntObjectMutator : public ObjectMutator {
 
   virtual void SetToEnd(RLMachine& machine, GraphicsObject& object) override;
   virtual ObjectMutator* Clone() const override;
-  virtual void PerformSetting(RLMachine& machine,
+  virtual void PerformSetting(ObjectMutatorBatch& batch,
                               GraphicsObject& object) override;
 
   int startval_one_;
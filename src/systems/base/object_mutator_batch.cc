@@ -0,0 +1,249 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/object_mutator_batch.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RLVM_MUTATOR_SSE2 1
+#endif
+
+#include <algorithm>
+
+#include "systems/base/graphics_object.h"
+#include "utilities/math_util.h"
+
+namespace {
+
+// The linear curve, exactly as InterpolateBetween() computes it: the elapsed
+// fraction in double precision, times the distance, truncated towards zero.
+// Time outside [0, |duration|] is clamped, so tracks that haven't started
+// or have finished come out as their start or end values.
+void InterpolateLinearScalar(unsigned int ticks,
+                             const int* begin,
+                             const int* duration,
+                             const int* start,
+                             const int* end,
+                             int* out,
+                             int count) {
+  for (int i = 0; i < count; ++i) {
+    int elapsed = static_cast<int>(ticks - begin[i]);
+    if (elapsed <= 0) {
+      out[i] = start[i];
+    } else if (elapsed >= duration[i]) {
+      out[i] = end[i];
+    } else {
+      double percentage = double(elapsed) / double(duration[i]);
+      out[i] = start[i] + static_cast<int>(percentage * (end[i] - start[i]));
+    }
+  }
+}
+
+#if defined(RLVM_MUTATOR_SSE2)
+
+// Swaps the two halves of |v|, so the high pair of ints can go through
+// _mm_cvtepi32_pd().
+inline __m128i HighHalf(__m128i v) {
+  return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+void InterpolateLinearSSE2(unsigned int ticks,
+                           const int* begin,
+                           const int* duration,
+                           const int* start,
+                           const int* end,
+                           int* out,
+                           int count) {
+  const __m128i now = _mm_set1_epi32(ticks);
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + i));
+    __m128i d =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(duration + i));
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(start + i));
+    __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(end + i));
+
+    // Clamp the elapsed time to [0, duration]; at either end the division
+    // below is exactly 0 or 1.
+    __m128i elapsed = _mm_sub_epi32(now, b);
+    elapsed = _mm_and_si128(elapsed, _mm_cmpgt_epi32(elapsed, zero));
+    elapsed = Select(_mm_cmpgt_epi32(elapsed, d), d, elapsed);
+    __m128i delta = _mm_sub_epi32(e, s);
+
+    __m128d lo = _mm_mul_pd(
+        _mm_div_pd(_mm_cvtepi32_pd(elapsed), _mm_cvtepi32_pd(d)),
+        _mm_cvtepi32_pd(delta));
+    __m128d hi = _mm_mul_pd(
+        _mm_div_pd(_mm_cvtepi32_pd(HighHalf(elapsed)),
+                   _mm_cvtepi32_pd(HighHalf(d))),
+        _mm_cvtepi32_pd(HighHalf(delta)));
+    __m128i offset =
+        _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_add_epi32(s, offset));
+  }
+
+  InterpolateLinearScalar(ticks, begin + i, duration + i, start + i, end + i,
+                          out + i, count - i);
+}
+
+#endif  // RLVM_MUTATOR_SSE2
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// ObjectMutatorBatch
+// -----------------------------------------------------------------------
+
+ObjectMutatorBatch::ObjectMutatorBatch()
+    : is_open_(false), ticks_(0), count_(0) {}
+
+ObjectMutatorBatch::~ObjectMutatorBatch() {}
+
+void ObjectMutatorBatch::Begin(unsigned int ticks) {
+  is_open_ = true;
+  ticks_ = ticks;
+
+  // The arrays keep their size, so a steady number of mutators doesn't
+  // allocate from frame to frame.
+  count_ = 0;
+  eased_.clear();
+  eased_type_.clear();
+}
+
+void ObjectMutatorBatch::Add(GraphicsObject* object,
+                             Setter setter,
+                             int begin,
+                             int duration,
+                             int type,
+                             int start_value,
+                             int end_value) {
+  Target& target = AddTrack(begin, duration, type, start_value, end_value);
+  target.object = object;
+  target.setter = setter;
+  target.repno_setter = NULL;
+  target.repno = 0;
+}
+
+void ObjectMutatorBatch::Add(GraphicsObject* object,
+                             RepnoSetter setter,
+                             int repno,
+                             int begin,
+                             int duration,
+                             int type,
+                             int start_value,
+                             int end_value) {
+  Target& target = AddTrack(begin, duration, type, start_value, end_value);
+  target.object = object;
+  target.setter = NULL;
+  target.repno_setter = setter;
+  target.repno = repno;
+}
+
+bool ObjectMutatorBatch::Apply() {
+  is_open_ = false;
+  if (count_ == 0)
+    return false;
+
+  Evaluate();
+  for (int i = 0; i < count_; ++i) {
+    const Target& target = targets_[i];
+    if (target.repno_setter)
+      (target.object->*target.repno_setter)(target.repno, values_[i]);
+    else
+      (target.object->*target.setter)(values_[i]);
+  }
+
+  return true;
+}
+
+void ObjectMutatorBatch::Evaluate() {
+  if (count_ == 0)
+    return;
+
+#if defined(RLVM_MUTATOR_SSE2)
+  InterpolateLinearSSE2(ticks_, &begin_[0], &duration_[0], &start_[0],
+                        &end_[0], &values_[0], count_);
+#else
+  InterpolateLinearScalar(ticks_, &begin_[0], &duration_[0], &start_[0],
+                          &end_[0], &values_[0], count_);
+#endif
+
+  // There's no vector log(), and an approximation would round differently
+  // from the scalar code these values have always come from.
+  for (size_t j = 0; j < eased_.size(); ++j) {
+    int i = eased_[j];
+    int elapsed = static_cast<int>(ticks_ - begin_[i]);
+    if (elapsed > 0 && elapsed < duration_[i]) {
+      values_[i] = start_[i] + Interpolate(0, elapsed, duration_[i],
+                                           end_[i] - start_[i],
+                                           eased_type_[j]);
+    }
+  }
+}
+
+ObjectMutatorBatch::Target& ObjectMutatorBatch::AddTrack(int begin,
+                                                         int duration,
+                                                         int type,
+                                                         int start_value,
+                                                         int end_value) {
+  // Growing every array at once, rather than push_back()ing onto each, keeps
+  // adding a track down to a bounds check and a handful of stores.
+  if (count_ == static_cast<int>(begin_.size())) {
+    size_t capacity = std::max<size_t>(64, begin_.size() * 2);
+    begin_.resize(capacity);
+    duration_.resize(capacity);
+    start_.resize(capacity);
+    end_.resize(capacity);
+    values_.resize(capacity);
+    targets_.resize(capacity);
+  }
+
+  // A mutation with no duration is at its end from |begin| on. Storing it as
+  // a one tick mutation ending at |begin| gives the same values and keeps the
+  // division in Evaluate() away from zero.
+  if (duration <= 0) {
+    begin -= 1;
+    duration = 1;
+  }
+
+  int index = count_++;
+  begin_[index] = begin;
+  duration_[index] = duration;
+  start_[index] = start_value;
+  end_[index] = end_value;
+  if (type != 0) {
+    eased_.push_back(index);
+    eased_type_.push_back(type);
+  }
+
+  return targets_[index];
+}
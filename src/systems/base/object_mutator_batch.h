@@ -0,0 +1,126 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_OBJECT_MUTATOR_BATCH_H_
+#define SRC_SYSTEMS_BASE_OBJECT_MUTATOR_BATCH_H_
+
+#include <vector>
+
+class GraphicsObject;
+
+// Every object parameter that ObjectMutators are changing this frame, kept as
+// parallel arrays so that they can be interpolated in one pass against one
+// read of the clock.
+//
+// GraphicsSystem::ExecuteGraphicsSystem() calls Begin(), lets every object's
+// mutators Add() their parameters, and then calls Apply(), which interpolates
+// all of them (four linear tracks at a time with SSE2) and calls each setter
+// in the order the tracks were added.
+class ObjectMutatorBatch {
+ public:
+  typedef void (GraphicsObject::*Setter)(const int);
+  typedef void (GraphicsObject::*RepnoSetter)(const int, const int);
+
+  ObjectMutatorBatch();
+  ~ObjectMutatorBatch();
+
+  // Starts collecting tracks for the frame at |ticks|.
+  void Begin(unsigned int ticks);
+
+  // Whether we're between Begin() and Apply().
+  bool is_open() const { return is_open_; }
+
+  // The clock value this frame is evaluated at.
+  unsigned int ticks() const { return ticks_; }
+
+  // The number of tracks added since Begin().
+  int size() const { return count_; }
+
+  // Adds a track that sets |setter| on |object| to the value between
+  // |start_value| and |end_value| at ticks(), where the mutation runs for
+  // |duration| ticks from |begin| along interpolation curve |type| (see
+  // Interpolate() in utilities/math_util.h).
+  void Add(GraphicsObject* object,
+           Setter setter,
+           int begin,
+           int duration,
+           int type,
+           int start_value,
+           int end_value);
+  void Add(GraphicsObject* object,
+           RepnoSetter setter,
+           int repno,
+           int begin,
+           int duration,
+           int type,
+           int start_value,
+           int end_value);
+
+  // Interpolates every track added since Begin() and hands the values to
+  // their objects. Returns true if anything was set.
+  bool Apply();
+
+  // Computes the value of every track at ticks() into values(). Public for
+  // testing; Apply() calls this.
+  void Evaluate();
+  const int* values() const { return &values_[0]; }
+
+ private:
+  // Where each track's value goes.
+  struct Target {
+    GraphicsObject* object;
+    Setter setter;
+    RepnoSetter repno_setter;
+    int repno;
+  };
+
+  // Stores a track and returns the Target for the caller to fill in.
+  Target& AddTrack(int begin,
+                   int duration,
+                   int type,
+                   int start_value,
+                   int end_value);
+
+  bool is_open_;
+  unsigned int ticks_;
+
+  // Tracks in use; the arrays below only ever grow.
+  int count_;
+
+  std::vector<int> begin_;
+  std::vector<int> duration_;
+  std::vector<int> start_;
+  std::vector<int> end_;
+  std::vector<int> values_;
+  std::vector<Target> targets_;
+
+  // Tracks on the logarithmic curves. Everything is evaluated as linear
+  // first; these are then redone one at a time.
+  std::vector<int> eased_;
+  std::vector<int> eased_type_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_OBJECT_MUTATOR_BATCH_H_
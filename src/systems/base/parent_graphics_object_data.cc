@@ -30,6 +30,7 @@
 
 #include "systems/base/parent_graphics_object_data.h"
 
+#include "systems/base/damage_tracker.h"
 #include "systems/base/graphics_object.h"
 #include "utilities/exception.h"
 
@@ -63,6 +64,31 @@ void ParentGraphicsObjectData::Render(const GraphicsObject& go,
   }
 }
 
+bool ParentGraphicsObjectData::GetDamageInfo(const GraphicsObject& go,
+                                             const GraphicsObject* parent,
+                                             Rect* rect,
+                                             uint64_t* signature) {
+  // Children are positioned relative to us, so we can only say whether
+  // anything in the layer changed.
+  uint64_t sig = 0;
+  bool draws = false;
+  AllocatedLazyArrayIterator<GraphicsObject> it = objects_.begin();
+  AllocatedLazyArrayIterator<GraphicsObject> end = objects_.end();
+  for (; it != end; ++it) {
+    Rect child_rect;
+    uint64_t child_signature;
+    if (it->GetDamageInfo(&go, &child_rect, &child_signature)) {
+      sig = DamageTracker::Combine(sig, it.pos());
+      sig = DamageTracker::Combine(sig, child_signature);
+      draws = true;
+    }
+  }
+
+  *rect = Rect();
+  *signature = sig;
+  return draws;
+}
+
 int ParentGraphicsObjectData::PixelWidth(
     const GraphicsObject& rendering_properties) {
   throw rlvm::Exception("There is no sane value for this!");
@@ -57,6 +57,10 @@ class ParentGraphicsObjectData : public GraphicsObjectData {
   virtual void Execute(RLMachine& machine) override;
   virtual bool IsAnimation() const override;
   virtual void PlaySet(int set) override;
+  virtual bool GetDamageInfo(const GraphicsObject& go,
+                             const GraphicsObject* parent,
+                             Rect* rect,
+                             uint64_t* signature) override;
 
   virtual bool IsParentLayer() const override { return true; }
 
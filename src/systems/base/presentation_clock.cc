@@ -0,0 +1,118 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/base/presentation_clock.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Need at least this many intervals before trusting an estimate.
+const int kMinSamples = 4;
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// PresentationClock
+// -----------------------------------------------------------------------
+
+PresentationClock::PresentationClock() { Reset(); }
+
+PresentationClock::~PresentationClock() {}
+
+void PresentationClock::Presented(unsigned int ticks) {
+  if (has_last_) {
+    unsigned int interval = ticks - last_presented_;
+    if (interval >= kMinInterval && interval <= kMaxInterval) {
+      intervals_[next_interval_] = interval;
+      next_interval_ = (next_interval_ + 1) % kHistory;
+      interval_count_ = std::min(interval_count_ + 1, int(kHistory));
+      Estimate();
+    } else if (interval > kMaxInterval) {
+      // A stall; what came before says nothing about what comes next.
+      interval_count_ = 0;
+      next_interval_ = 0;
+      refresh_interval_ = 0;
+    }
+  }
+
+  has_last_ = true;
+  last_presented_ = ticks;
+}
+
+void PresentationClock::Reset() {
+  std::fill(intervals_, intervals_ + kHistory, 0);
+  interval_count_ = 0;
+  next_interval_ = 0;
+  has_last_ = false;
+  last_presented_ = 0;
+  refresh_interval_ = 0;
+}
+
+unsigned int PresentationClock::Predict(unsigned int now) const {
+  if (refresh_interval_ <= 0 || !has_last_)
+    return now;
+
+  // Ticks wrap, so compare differences rather than values.
+  unsigned int elapsed = now - last_presented_;
+  if (elapsed > kMaxIntervalsAhead * refresh_interval_)
+    return now;
+
+  // The frame goes out on the first refresh after |now|; a frame started
+  // right after a presentation still has to wait for the next one.
+  int intervals = std::max(1, int(std::ceil(elapsed / refresh_interval_)));
+  return last_presented_ +
+         static_cast<unsigned int>(std::lround(intervals * refresh_interval_));
+}
+
+void PresentationClock::Estimate() {
+  refresh_interval_ = 0;
+  if (interval_count_ < kMinSamples)
+    return;
+
+  // Millisecond ticks make a 60Hz display alternate between 16 and 17, and a
+  // frame that missed its refresh shows up as a multiple. Average the
+  // intervals that are close to the median to get the fractional period.
+  unsigned int sorted[kHistory];
+  std::copy(intervals_, intervals_ + interval_count_, sorted);
+  std::sort(sorted, sorted + interval_count_);
+  float median = sorted[interval_count_ / 2];
+
+  float total = 0;
+  int count = 0;
+  for (int i = 0; i < interval_count_; ++i) {
+    if (std::fabs(intervals_[i] - median) <= 1.5f) {
+      total += intervals_[i];
+      ++count;
+    }
+  }
+
+  // Presentation that isn't paced by anything doesn't settle.
+  if (count * 4 >= interval_count_ * 3)
+    refresh_interval_ = total / count;
+}
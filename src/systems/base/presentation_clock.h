@@ -0,0 +1,88 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_BASE_PRESENTATION_CLOCK_H_
+#define SRC_SYSTEMS_BASE_PRESENTATION_CLOCK_H_
+
+// Predicts when the frame being drawn will actually reach the screen.
+//
+// Graphics systems report every frame they present with Presented(). When
+// presentation is paced by the display, frames land a whole number of
+// refresh intervals apart; the clock estimates that interval from recent
+// frames and predicts the next presentation as the first refresh after the
+// current time. Animations that are timed against the prediction instead of
+// against when they happen to be drawn move by even steps on screen, however
+// the main loop's cadence lines up with the display's.
+//
+// Until it has a stable estimate (and when nothing presents at all, as in
+// the tests) the prediction is simply the current time.
+class PresentationClock {
+ public:
+  PresentationClock();
+  ~PresentationClock();
+
+  // Records that a frame was presented at |ticks|.
+  void Presented(unsigned int ticks);
+
+  // Forgets all history; for when presentation timing changes, such as
+  // switching between windowed and fullscreen.
+  void Reset();
+
+  // Returns when a frame started at |now| will be presented.
+  unsigned int Predict(unsigned int now) const;
+
+  // The estimated time between refreshes in milliseconds, or 0 when there
+  // isn't a stable estimate.
+  float refresh_interval() const { return refresh_interval_; }
+
+  // How many recent frame intervals the estimate is drawn from.
+  static const int kHistory = 16;
+
+  // Intervals outside this range (in milliseconds) don't look like display
+  // refreshes and are ignored.
+  static const unsigned int kMinInterval = 4;
+  static const unsigned int kMaxInterval = 50;
+
+  // Predictions further than this many intervals from the last presented
+  // frame are too uncertain to be worth making.
+  static const int kMaxIntervalsAhead = 8;
+
+ private:
+  // Recomputes |refresh_interval_| from |intervals_|.
+  void Estimate();
+
+  unsigned int intervals_[kHistory];
+  int interval_count_;
+  int next_interval_;
+
+  bool has_last_;
+  unsigned int last_presented_;
+
+  float refresh_interval_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_PRESENTATION_CLOCK_H_
@@ -0,0 +1,128 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/rendered_text_cache.h"
+
+#include <tuple>
+
+#include "systems/base/colour.h"
+#include "systems/base/surface.h"
+
+namespace {
+
+int PackColour(const RGBColour& colour) {
+  return (colour.r() << 16) | (colour.g() << 8) | colour.b();
+}
+
+size_t SurfaceBytes(const Surface& surface) {
+  Size size = surface.GetSize();
+  return size_t(size.width()) * size.height() * 4;
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// RenderedTextCache::Key
+// -----------------------------------------------------------------------
+
+RenderedTextCache::Key::Key(const std::string& utf8str,
+                            int size,
+                            int xspace,
+                            int yspace,
+                            const RGBColour& colour,
+                            const RGBColour* shadow_colour,
+                            int max_chars_in_line,
+                            bool font_shadow)
+    : utf8str(utf8str),
+      size(size),
+      xspace(xspace),
+      yspace(yspace),
+      colour(PackColour(colour)),
+      shadow_colour(shadow_colour ? PackColour(*shadow_colour) : -1),
+      max_chars_in_line(max_chars_in_line),
+      font_shadow(font_shadow) {}
+
+bool RenderedTextCache::Key::operator<(const Key& rhs) const {
+  return std::tie(size, xspace, yspace, colour, shadow_colour,
+                  max_chars_in_line, font_shadow, utf8str) <
+         std::tie(rhs.size, rhs.xspace, rhs.yspace, rhs.colour,
+                  rhs.shadow_colour, rhs.max_chars_in_line, rhs.font_shadow,
+                  rhs.utf8str);
+}
+
+// -----------------------------------------------------------------------
+// RenderedTextCache
+// -----------------------------------------------------------------------
+
+RenderedTextCache::RenderedTextCache(size_t max_bytes)
+    : max_bytes_(max_bytes), used_bytes_(0), hits_(0), misses_(0) {}
+
+RenderedTextCache::~RenderedTextCache() {}
+
+std::shared_ptr<Surface> RenderedTextCache::Find(const Key& key) {
+  std::map<Key, Entry>::iterator it = entries_.find(key);
+  if (it == entries_.end()) {
+    misses_++;
+    return std::shared_ptr<Surface>();
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  hits_++;
+  return it->second.surface;
+}
+
+void RenderedTextCache::Store(const Key& key,
+                              const std::shared_ptr<Surface>& surface) {
+  std::map<Key, Entry>::iterator existing = entries_.find(key);
+  if (existing != entries_.end())
+    Evict(existing);
+
+  size_t bytes = SurfaceBytes(*surface);
+  if (bytes > max_bytes_)
+    return;
+
+  while (used_bytes_ + bytes > max_bytes_)
+    Evict(entries_.find(lru_.back()));
+
+  lru_.push_front(key);
+  Entry& entry = entries_[key];
+  entry.surface = surface;
+  entry.bytes = bytes;
+  entry.lru_position = lru_.begin();
+  used_bytes_ += bytes;
+}
+
+void RenderedTextCache::Clear() {
+  entries_.clear();
+  lru_.clear();
+  used_bytes_ = 0;
+}
+
+void RenderedTextCache::Evict(std::map<Key, Entry>::iterator it) {
+  used_bytes_ -= it->second.bytes;
+  lru_.erase(it->second.lru_position);
+  entries_.erase(it);
+}
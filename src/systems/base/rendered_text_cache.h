@@ -0,0 +1,113 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_RENDERED_TEXT_CACHE_H_
+#define SRC_SYSTEMS_BASE_RENDERED_TEXT_CACHE_H_
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+class RGBColour;
+class Surface;
+
+// Surfaces made by TextSystem::RenderText(), so that text objects, name boxes
+// and selection buttons showing the same string with the same properties
+// share one rendering instead of each going through the text renderer.
+//
+// Entries are evicted least recently used first once the surfaces in the
+// cache add up to more than |max_bytes|. Cached surfaces are shared and must
+// not be drawn onto.
+class RenderedTextCache {
+ public:
+  struct Key {
+    Key(const std::string& utf8str,
+        int size,
+        int xspace,
+        int yspace,
+        const RGBColour& colour,
+        const RGBColour* shadow_colour,
+        int max_chars_in_line,
+        bool font_shadow);
+
+    bool operator<(const Key& rhs) const;
+
+    std::string utf8str;
+    int size;
+    int xspace;
+    int yspace;
+    int colour;
+
+    // -1 when there is no shadow.
+    int shadow_colour;
+    int max_chars_in_line;
+    bool font_shadow;
+  };
+
+  explicit RenderedTextCache(size_t max_bytes);
+  ~RenderedTextCache();
+
+  // Returns the surface stored for |key|, or NULL.
+  std::shared_ptr<Surface> Find(const Key& key);
+
+  // Stores |surface| for |key|, evicting old entries to make room. Surfaces
+  // larger than the whole cache aren't stored.
+  void Store(const Key& key, const std::shared_ptr<Surface>& surface);
+
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+  size_t max_bytes() const { return max_bytes_; }
+  size_t used_bytes() const { return used_bytes_; }
+
+  // Statistics since construction.
+  int hits() const { return hits_; }
+  int misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    std::shared_ptr<Surface> surface;
+    size_t bytes;
+    std::list<Key>::iterator lru_position;
+  };
+
+  void Evict(std::map<Key, Entry>::iterator it);
+
+  size_t max_bytes_;
+  size_t used_bytes_;
+
+  std::map<Key, Entry> entries_;
+
+  // Most recently used at the front.
+  std::list<Key> lru_;
+
+  int hits_;
+  int misses_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_RENDERED_TEXT_CACHE_H_
@@ -573,26 +573,33 @@ int RlBabelDLL::TestGlosses(int x,
 
 int RlBabelDLL::GetCharWidth(uint16_t cp932_char, bool as_xmod) {
   Codepage& cp = Cp::instance(machine_.GetTextEncoding());
+  std::shared_ptr<TextWindow> window = GetWindow(-1);
+  int width = GetCharWidth(cp, window->font_size_in_pixels(), cp932_char);
+  return as_xmod ? window->insertion_point_x() + width : width;
+}
+
+int RlBabelDLL::GetCharWidth(const Codepage& cp,
+                             int font_size,
+                             uint16_t cp932_char) {
   uint16_t native_char = cp.JisDecode(cp932_char);
   uint16_t unicode_codepoint = cp.Convert(native_char);
-  std::shared_ptr<TextWindow> window = GetWindow(-1);
-  int font_size = window->font_size_in_pixels();
   // TODO(erg): Can I somehow modify this to try to do proper kerning?
-  int width = machine_.system().text().GetCharWidth(font_size, unicode_codepoint);
-  return as_xmod ? window->insertion_point_x() + width : width;
+  return machine_.system().text().GetCharWidth(font_size, unicode_codepoint);
 }
 
 bool RlBabelDLL::LineBreakRequired() {
   std::shared_ptr<TextWindow> window = GetWindow(-1);
+  const Codepage& cp = Cp::instance(machine_.GetTextEncoding());
+  int font_size = window->font_size_in_pixels();
 
   int width = 0;
   std::string::size_type ptr = text_index;
   while (ptr < end_token_index) {
     uint16_t cp932_char = ConsumeNextCharacter(ptr);
     if (text_index < end_token_index) {
-      width += GetCharWidth(cp932_char, false);
+      width += GetCharWidth(cp, font_size, cp932_char);
     } else {
-      width += window->font_size_in_pixels();
+      width += font_size;
     }
   }
 
@@ -609,14 +616,14 @@ bool RlBabelDLL::LineBreakRequired() {
   if (width >= max_space) {
     ptr = text_index;
     uint16_t cp932_char = ConsumeNextCharacter(ptr);
-    width = GetCharWidth(cp932_char, false);
+    width = GetCharWidth(cp, font_size, cp932_char);
 
     // If the first character will fit on the current line, a line break is not
     // required.
     if (width < remaining_space) {
       while (ptr < end_token_index) {
         cp932_char = ConsumeNextCharacter(ptr);
-        int cw = GetCharWidth(cp932_char, false);
+        int cw = GetCharWidth(cp, font_size, cp932_char);
         if (width + cw >= remaining_space)
           break;
         ptr += 1 + (cp932_char > 0xff);
@@ -636,7 +643,7 @@ bool RlBabelDLL::LineBreakRequired() {
     // next line, and a break is required.
     while (ptr < end_token_index) {
       cp932_char = ConsumeNextCharacter(ptr);
-      int cw = GetCharWidth(cp932_char, false);
+      int cw = GetCharWidth(cp, font_size, cp932_char);
       if (width + cw >= remaining_space)
         break;
       ptr += 1 + (cp932_char > 0xff);
@@ -37,6 +37,7 @@
 #include "machine/reference.h"
 #include "systems/base/rect.h"
 
+struct Codepage;
 class TextWindow;
 
 // Possible commands sent to the rlBabel DLL from the code. These will be
@@ -190,6 +191,10 @@ class RlBabelDLL : public RealLiveDLL {
 
   int GetCharWidth(uint16_t full_char, bool as_xmod);
 
+  // Width of |cp932_char| in a |font_size| font, without looking up the
+  // window and codepage; used by the per-character loops below.
+  int GetCharWidth(const Codepage& cp, int font_size, uint16_t cp932_char);
+
   bool LineBreakRequired();
 
   uint16_t ConsumeNextCharacter(std::string::size_type& index);
@@ -0,0 +1,164 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/base/shelf_packer.h"
+
+#include <algorithm>
+#include <vector>
+
+ShelfPacker::ShelfPacker(int width, int height, int padding)
+    : width_(width),
+      height_(height),
+      padding_(padding),
+      top_(0),
+      allocation_count_(0),
+      used_area_(0) {}
+
+ShelfPacker::~ShelfPacker() {}
+
+bool ShelfPacker::Allocate(int width, int height, Rect* out) {
+  if (width <= 0 || height <= 0 || width > width_ || height > height_)
+    return false;
+
+  // Prefer the shortest shelf that fits, as long as it isn't much taller
+  // than the image; a tall shelf full of short images wastes the rest of the
+  // page.
+  Shelf* best = NULL;
+  Shelf* fallback = NULL;
+  for (Shelf& shelf : shelves_) {
+    int room = shelf.height - (shelf.y + shelf.height < height_ ? padding_ : 0);
+    if (room < height)
+      continue;
+
+    bool has_span = std::any_of(
+        shelf.free.begin(), shelf.free.end(),
+        [&](const Span& span) { return Fits(span, width); });
+    if (!has_span)
+      continue;
+
+    if (room <= height * 2) {
+      if (!best || shelf.height < best->height)
+        best = &shelf;
+    } else if (!fallback || shelf.height < fallback->height) {
+      fallback = &shelf;
+    }
+  }
+
+  if (best)
+    return AllocateOnShelf(*best, width, height, out);
+
+  if (top_ + height <= height_) {
+    int shelf_height = PaddedSize(top_, height, height_);
+    Shelf shelf;
+    shelf.y = top_;
+    shelf.height = shelf_height;
+    shelf.allocation_count = 0;
+    shelf.free.push_back(Span{0, width_});
+    shelves_.push_back(shelf);
+    top_ += shelf_height;
+    return AllocateOnShelf(shelves_.back(), width, height, out);
+  }
+
+  if (fallback)
+    return AllocateOnShelf(*fallback, width, height, out);
+
+  return false;
+}
+
+void ShelfPacker::Free(const Rect& rect) {
+  std::vector<Shelf>::iterator shelf = std::find_if(
+      shelves_.begin(), shelves_.end(),
+      [&](const Shelf& s) { return s.y == rect.y(); });
+  if (shelf == shelves_.end())
+    return;
+
+  Span span = {rect.x(), PaddedSize(rect.x(), rect.width(), width_)};
+  std::vector<Span>::iterator next = std::find_if(
+      shelf->free.begin(), shelf->free.end(),
+      [&](const Span& s) { return s.x > span.x; });
+  next = shelf->free.insert(next, span);
+
+  // Merge with the following span, then with the preceding one.
+  std::vector<Span>::iterator after = next + 1;
+  if (after != shelf->free.end() && next->x + next->width == after->x) {
+    next->width += after->width;
+    shelf->free.erase(after);
+  }
+  if (next != shelf->free.begin()) {
+    std::vector<Span>::iterator before = next - 1;
+    if (before->x + before->width == next->x) {
+      before->width += next->width;
+      shelf->free.erase(next);
+    }
+  }
+
+  shelf->allocation_count--;
+  allocation_count_--;
+  used_area_ -= rect.width() * rect.height();
+
+  // Give back empty shelves at the bottom so a differently sized image can
+  // use the space.
+  while (!shelves_.empty() && shelves_.back().allocation_count == 0) {
+    top_ = shelves_.back().y;
+    shelves_.pop_back();
+  }
+}
+
+int ShelfPacker::PaddedSize(int position, int size, int limit) const {
+  return std::min(size + padding_, limit - position);
+}
+
+bool ShelfPacker::Fits(const Span& span, int width) const {
+  return width <= span.width &&
+         PaddedSize(span.x, width, width_) <= span.width;
+}
+
+bool ShelfPacker::AllocateOnShelf(Shelf& shelf,
+                                  int width,
+                                  int height,
+                                  Rect* out) {
+  for (std::vector<Span>::iterator it = shelf.free.begin();
+       it != shelf.free.end();
+       ++it) {
+    if (!Fits(*it, width))
+      continue;
+
+    int padded = PaddedSize(it->x, width, width_);
+    *out = Rect::REC(it->x, shelf.y, width, height);
+    it->x += padded;
+    it->width -= padded;
+    if (it->width == 0)
+      shelf.free.erase(it);
+
+    shelf.allocation_count++;
+    allocation_count_++;
+    used_area_ += width * height;
+    return true;
+  }
+
+  return false;
+}
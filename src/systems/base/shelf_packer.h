@@ -0,0 +1,103 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_BASE_SHELF_PACKER_H_
+#define SRC_SYSTEMS_BASE_SHELF_PACKER_H_
+
+#include <vector>
+
+#include "systems/base/rect.h"
+
+// Hands out rectangles of a fixed size page, so that several small images can
+// share one texture.
+//
+// The page is cut into horizontal shelves as images arrive. Each image goes
+// on the shortest shelf it fits on, or a new shelf is opened at the bottom of
+// the used area. Freed rectangles go back to their shelf's free list and are
+// merged with their neighbours; empty shelves at the bottom of the page are
+// given back entirely.
+//
+// Every rectangle is followed by |padding| unused pixels to the right and
+// below it (except at the edges of the page), so that linear filtering
+// doesn't bleed one image into its neighbour.
+class ShelfPacker {
+ public:
+  ShelfPacker(int width, int height, int padding);
+  ~ShelfPacker();
+
+  // Finds room for a |width| x |height| rectangle and writes it to |out|.
+  // Returns false if the page doesn't have any.
+  bool Allocate(int width, int height, Rect* out);
+
+  // Returns a rectangle previously handed out by Allocate().
+  void Free(const Rect& rect);
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  bool empty() const { return allocation_count_ == 0; }
+  int allocation_count() const { return allocation_count_; }
+
+  // Pixels covered by live rectangles, not counting padding.
+  int used_area() const { return used_area_; }
+
+ private:
+  struct Span {
+    int x;
+    int width;
+  };
+
+  struct Shelf {
+    int y;
+    int height;
+    int allocation_count;
+
+    // Unused parts of the shelf, sorted by x.
+    std::vector<Span> free;
+  };
+
+  // Space a rectangle of |size| at |position| takes up, including padding.
+  int PaddedSize(int position, int size, int limit) const;
+
+  // Whether a rectangle |width| wide can go at the start of |span|.
+  bool Fits(const Span& span, int width) const;
+
+  // Tries to place a |width| x |height| rectangle on |shelf|.
+  bool AllocateOnShelf(Shelf& shelf, int width, int height, Rect* out);
+
+  int width_;
+  int height_;
+  int padding_;
+
+  // Sorted by y. Shelves cover [0, top_).
+  std::vector<Shelf> shelves_;
+  int top_;
+
+  int allocation_count_;
+  int used_area_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_SHELF_PACKER_H_
@@ -0,0 +1,145 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/base/sprite_batch.h"
+
+#include <cmath>
+
+#include "systems/base/colour.h"
+#include "systems/base/graphics_object.h"
+
+// -----------------------------------------------------------------------
+// SpriteEffects
+// -----------------------------------------------------------------------
+
+SpriteEffects::SpriteEffects() : light(0), mono(0), invert(0) {
+  colour[0] = colour[1] = colour[2] = colour[3] = 0;
+  tint[0] = tint[1] = tint[2] = 0;
+}
+
+// static
+SpriteEffects SpriteEffects::FromGraphicsObject(const GraphicsObject& go) {
+  SpriteEffects effects;
+  RGBAColour colour = go.colour();
+  effects.colour[0] = colour.r_float();
+  effects.colour[1] = colour.g_float();
+  effects.colour[2] = colour.b_float();
+  effects.colour[3] = colour.a_float();
+
+  RGBColour tint = go.tint();
+  effects.tint[0] = tint.r_float();
+  effects.tint[1] = tint.g_float();
+  effects.tint[2] = tint.b_float();
+
+  effects.light = go.light() / 255.0f;
+  effects.mono = go.mono() / 255.0f;
+  effects.invert = go.invert() / 255.0f;
+  return effects;
+}
+
+bool SpriteEffects::Any() const {
+  return colour[3] != 0 || tint[0] != 0 || tint[1] != 0 || tint[2] != 0 ||
+         light != 0 || mono != 0 || invert != 0;
+}
+
+// -----------------------------------------------------------------------
+// SpriteQuad
+// -----------------------------------------------------------------------
+
+SpriteQuad::SpriteQuad()
+    : x1(0), y1(0), x2(0), y2(0),
+      u1(0), v1(0), u2(1), v2(1),
+      rotation(0), pivot_x(0), pivot_y(0),
+      red(255), green(255), blue(255) {
+  alpha[0] = alpha[1] = alpha[2] = alpha[3] = 255;
+}
+
+// -----------------------------------------------------------------------
+// SpriteBatch
+// -----------------------------------------------------------------------
+
+SpriteBatch::SpriteBatch() {}
+
+SpriteBatch::~SpriteBatch() {}
+
+void SpriteBatch::Add(unsigned int texture,
+                      unsigned int program,
+                      SpriteBlendMode blend,
+                      const SpriteQuad& quad) {
+  if (draws_.empty() || draws_.back().texture != texture ||
+      draws_.back().program != program || draws_.back().blend != blend) {
+    Draw draw = {texture, program, blend, static_cast<int>(vertices_.size()),
+                 0};
+    draws_.push_back(draw);
+  }
+  draws_.back().vertex_count += 4;
+
+  const float xs[4] = {quad.x1, quad.x2, quad.x2, quad.x1};
+  const float ys[4] = {quad.y1, quad.y1, quad.y2, quad.y2};
+  const float us[4] = {quad.u1, quad.u2, quad.u2, quad.u1};
+  const float vs[4] = {quad.v1, quad.v1, quad.v2, quad.v2};
+
+  // This is the glTranslate/glRotate/glTranslate sequence objects used to be
+  // drawn with, done here so every sprite can share one modelview matrix.
+  float c = 1.0f, s = 0.0f;
+  if (quad.rotation != 0) {
+    const float radians = quad.rotation * 3.14159265358979f / 180.0f;
+    c = std::cos(radians);
+    s = std::sin(radians);
+  }
+  const float cx = quad.x1 + quad.pivot_x;
+  const float cy = quad.y1 + quad.pivot_y;
+
+  const SpriteEffects& e = quad.effects;
+  for (int i = 0; i < 4; ++i) {
+    SpriteVertex v;
+    float dx = xs[i] - cx;
+    float dy = ys[i] - cy;
+    v.x = cx + dx * c - dy * s;
+    v.y = cy + dx * s + dy * c;
+    v.u = us[i];
+    v.v = vs[i];
+    v.rgba[0] = quad.red;
+    v.rgba[1] = quad.green;
+    v.rgba[2] = quad.blue;
+    v.rgba[3] = quad.alpha[i];
+    for (int j = 0; j < 4; ++j)
+      v.colour[j] = e.colour[j];
+    v.tint_light[0] = e.tint[0];
+    v.tint_light[1] = e.tint[1];
+    v.tint_light[2] = e.tint[2];
+    v.tint_light[3] = e.light;
+    v.mono_invert[0] = e.mono;
+    v.mono_invert[1] = e.invert;
+    vertices_.push_back(v);
+  }
+}
+
+void SpriteBatch::Clear() {
+  vertices_.clear();
+  draws_.clear();
+}
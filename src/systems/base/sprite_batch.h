@@ -0,0 +1,134 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_BASE_SPRITE_BATCH_H_
+#define SRC_SYSTEMS_BASE_SPRITE_BATCH_H_
+
+#include <cstdint>
+#include <vector>
+
+class GraphicsObject;
+
+// How a sprite is combined with what's already on screen. The first three
+// match the values of GraphicsObject::composite_mode().
+enum SpriteBlendMode {
+  SPRITE_BLEND_ALPHA = 0,     // src * a + dst * (1 - a)
+  SPRITE_BLEND_ADD = 1,       // dst + src * a
+  SPRITE_BLEND_SUBTRACT = 2,  // dst - src * a
+  SPRITE_BLEND_REPLACE = 3    // src, ignoring alpha
+};
+
+// RealLive's per object colour effects, in the [0, 1] (or for tint and
+// light, [-1, 1]) ranges the object shader works in. The defaults leave the
+// image untouched.
+struct SpriteEffects {
+  SpriteEffects();
+
+  // Returns the colour/tint/light/mono/invert properties of |go|.
+  static SpriteEffects FromGraphicsObject(const GraphicsObject& go);
+
+  // Returns true if any effect would change the image.
+  bool Any() const;
+
+  float colour[4];  // #colour: blended towards rgb by colour[3]
+  float tint[3];
+  float light;
+  float mono;
+  float invert;
+};
+
+// One textured quad to draw. Positions are in screen pixels, texture
+// coordinates are normalized.
+struct SpriteQuad {
+  SpriteQuad();
+
+  float x1, y1, x2, y2;
+  float u1, v1, u2, v2;
+
+  // Clockwise rotation in degrees around (x1 + pivot_x, y1 + pivot_y).
+  float rotation;
+  float pivot_x, pivot_y;
+
+  // Vertex colour, which the texture is multiplied by. The alpha is given
+  // per corner, in the order top left, top right, bottom right, bottom left.
+  uint8_t red, green, blue;
+  uint8_t alpha[4];
+
+  SpriteEffects effects;
+};
+
+// The vertex format the renderer uploads. Everything that used to be a
+// uniform of the object shader travels with the vertex instead, so sprites
+// with different effects can share a draw call.
+struct SpriteVertex {
+  float x, y;
+  float u, v;
+  uint8_t rgba[4];
+  float colour[4];
+  float tint_light[4];
+  float mono_invert[2];
+};
+
+// Collects quads into a vertex array and a list of draws, starting a new
+// draw only when the texture, shader program or blend mode changes. Knows
+// nothing about OpenGL; the SDL renderer owns one of these and submits its
+// contents.
+class SpriteBatch {
+ public:
+  struct Draw {
+    unsigned int texture;
+    unsigned int program;
+    SpriteBlendMode blend;
+
+    // Range of vertices(), four per quad.
+    int first_vertex;
+    int vertex_count;
+  };
+
+  SpriteBatch();
+  ~SpriteBatch();
+
+  // Appends |quad|, transforming its corners on the CPU.
+  void Add(unsigned int texture,
+           unsigned int program,
+           SpriteBlendMode blend,
+           const SpriteQuad& quad);
+
+  // Forgets all queued quads. The storage is kept for the next frame.
+  void Clear();
+
+  bool empty() const { return draws_.empty(); }
+  int quad_count() const { return vertices_.size() / 4; }
+  const std::vector<SpriteVertex>& vertices() const { return vertices_; }
+  const std::vector<Draw>& draws() const { return draws_; }
+
+ private:
+  std::vector<SpriteVertex> vertices_;
+  std::vector<Draw> draws_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_SPRITE_BATCH_H_
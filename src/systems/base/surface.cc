@@ -49,6 +49,15 @@ void Surface::Dump() {
 
 // -----------------------------------------------------------------------
 
+void Surface::RenderManyToScreen(const std::vector<Rect>& srcs,
+                                 const std::vector<Rect>& dsts,
+                                 int alpha) const {
+  for (size_t i = 0; i < srcs.size(); ++i)
+    RenderToScreen(srcs[i], dsts[i], alpha);
+}
+
+// -----------------------------------------------------------------------
+
 int Surface::GetNumPatterns() const { return 1; }
 
 // -----------------------------------------------------------------------
@@ -28,7 +28,9 @@
 #ifndef SRC_SYSTEMS_BASE_SURFACE_H_
 #define SRC_SYSTEMS_BASE_SURFACE_H_
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "systems/base/rect.h"
 #include "systems/base/tone_curve.h"
@@ -58,6 +60,10 @@ class Surface : public std::enable_shared_from_this<Surface> {
   // uploading.
   virtual void EnsureUploaded() const {}
 
+  // Optional method which returns roughly how many bytes of video memory the
+  // surface's textures take up. Used in render tree dumps.
+  virtual uint64_t GetTextureMemoryUsage() const { return 0; }
+
   // ------------------------------------------------- [ Drawing functions ]
 
   // Fills the surface with |colour|.
@@ -97,6 +103,12 @@ class Surface : public std::enable_shared_from_this<Surface> {
                               const Rect& dst,
                               int alpha = 255) const = 0;
 
+  // Renders |srcs[i]| to |dsts[i]| for every i, as one batch where the
+  // backend can. The default just calls RenderToScreen() for each.
+  virtual void RenderManyToScreen(const std::vector<Rect>& srcs,
+                                  const std::vector<Rect>& dsts,
+                                  int alpha) const;
+
   virtual void RenderToScreenAsColorMask(const Rect& src,
                                          const Rect& dst,
                                          const RGBAColour& colour,
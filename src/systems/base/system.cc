@@ -124,7 +124,15 @@ System::System()
     : in_menu_(false),
       force_fast_forward_(false),
       force_wait_(false),
-      use_western_font_(false) {
+      use_western_font_(false),
+      file_index_(ALL_FILETYPES) {
+  for (const std::vector<std::string>* list :
+       {&OBJ_FILETYPES, &IMAGE_FILETYPES, &PDT_IMAGE_FILETYPES, &GAN_FILETYPES,
+        &ANM_FILETYPES, &HIK_FILETYPES, &SOUND_FILETYPES,
+        &KOE_ARCHIVE_FILETYPES, &KOE_LOOSE_FILETYPES}) {
+    file_index_.RegisterExtensionList(list);
+  }
+
   std::fill(syscom_status_,
             syscom_status_ + NUM_SYSCOM_ENTRIES,
             SYSCOM_VISIBLE);
@@ -330,8 +338,8 @@ void System::ShowSystemInfo(RLMachine& machine) {
 boost::filesystem::path System::FindFile(
     const std::string& file_name,
     const std::vector<std::string>& extensions) {
-  if (filesystem_cache_.empty())
-    BuildFileSystemCache();
+  if (!file_index_.build_started())
+    StartFileIndexBuild(fs::path());
 
   // Hack to get around fileNames like "REALNAME?010", where we only
   // want REALNAME.
@@ -339,19 +347,18 @@ boost::filesystem::path System::FindFile(
       string(file_name.begin(), find(file_name.begin(), file_name.end(), '?'));
   to_lower(lower_name);
 
-  std::pair<FileSystemCache::const_iterator, FileSystemCache::const_iterator>
-      ret = filesystem_cache_.equal_range(lower_name);
-  for (const std::string& extension : extensions) {
-    for (FileSystemCache::const_iterator it = ret.first; it != ret.second;
-         ++it) {
-      if (extension == it->second.first) {
-        return it->second.second;
-      }
-    }
+  return file_index_.Find(lower_name, extensions);
+}
+
+void System::StartBuildingFileIndex() {
+  fs::path saved_index;
+  try {
+    saved_index = GameSaveDirectory() / "file_index";
+  } catch (std::exception& e) {
+    // No usable save directory; build the index without saving it.
   }
 
-  // Error.
-  return fs::path();
+  StartFileIndexBuild(saved_index);
 }
 
 void System::Reset() {
@@ -445,7 +452,7 @@ void System::CheckSyscomIndex(int index, const char* function) {
   }
 }
 
-void System::BuildFileSystemCache() {
+void System::StartFileIndexBuild(const fs::path& saved_index) {
   // First retrieve all the directories defined in the #FOLDNAME section.
   std::vector<std::string> valid_directories;
   Gameexe& gexe = gameexe();
@@ -460,39 +467,7 @@ void System::BuildFileSystemCache() {
   }
 
   fs::path gamepath(gexe("__GAMEPATH").ToString());
-  fs::directory_iterator dir_end;
-  for (fs::directory_iterator dir(gamepath); dir != dir_end; ++dir) {
-    if (fs::is_directory(dir->status())) {
-      std::string lowername = dir->path().filename().string();
-      to_lower(lowername);
-      if (find(valid_directories.begin(), valid_directories.end(), lowername) !=
-          valid_directories.end()) {
-        AddDirectoryToCache(dir->path());
-      }
-    }
-  }
-}
-
-void System::AddDirectoryToCache(const fs::path& directory) {
-  fs::directory_iterator dir_end;
-  for (fs::directory_iterator dir(directory); dir != dir_end; ++dir) {
-    if (fs::is_directory(dir->status())) {
-      AddDirectoryToCache(dir->path());
-    } else {
-      std::string extension = dir->path().extension().string();
-      if (extension.size() > 1 && extension[0] == '.')
-        extension = extension.substr(1);
-      to_lower(extension);
-
-      if (find(ALL_FILETYPES.begin(), ALL_FILETYPES.end(), extension) !=
-          ALL_FILETYPES.end()) {
-        std::string stem = dir->path().stem().string();
-        to_lower(stem);
-
-        filesystem_cache_.emplace(stem, make_pair(extension, dir->path()));
-      }
-    }
-  }
+  file_index_.StartBuild(gamepath, valid_directories, saved_index);
 }
 
 std::string GetRlvmVersionString() { return "Version 0.14"; }
@@ -38,6 +38,8 @@
 #include <utility>
 #include <vector>
 
+#include "systems/base/game_file_index.h"
+
 class GraphicsSystem;
 class EventSystem;
 class TextSystem;
@@ -229,6 +231,12 @@ class System {
   boost::filesystem::path FindFile(const std::string& fileName,
                                    const std::vector<std::string>& extensions);
 
+  // Starts indexing the game's #FOLDNAME directories in the background, so
+  // that the first FindFile() doesn't have to wait for the whole walk. The
+  // index is saved in GameSaveDirectory() and reused while the directories
+  // are unchanged. Called once the Gameexe is fully set up.
+  void StartBuildingFileIndex();
+
   // Resets the present values of the system; this doesn't clear user settings,
   // but clears things like the current graphics state and the status of all
   // the text windows. This method is called when the user loads a game or
@@ -279,10 +287,6 @@ class System {
   std::shared_ptr<Platform> platform_;
 
  private:
-  typedef std::multimap<std::string,
-                        std::pair<std::string, boost::filesystem::path>>
-      FileSystemCache;
-
   boost::filesystem::path GetHomeDirectory();
 
   // Invokes a custom dialog or the standard one if none present.
@@ -294,13 +298,9 @@ class System {
   // Verify that |index| is valid and throw if it isn't.
   void CheckSyscomIndex(int index, const char* function);
 
-  // Builds a list of all files that are in a directory specified in the
+  // Starts building |file_index_| from the directories specified in the
   // #FOLDNAME part of the Gameexe.ini file.
-  void BuildFileSystemCache();
-
-  // Recurses on |directory| and adds all filetypes that we can read to our
-  // FileSystemCache.
-  void AddDirectoryToCache(const boost::filesystem::path& directory);
+  void StartFileIndexBuild(const boost::filesystem::path& saved_index);
 
   // The visibility status for all syscom entries
   int syscom_status_[NUM_SYSCOM_ENTRIES];
@@ -319,9 +319,9 @@ class System {
   // Whether we should be trying to find a western font.
   bool use_western_font_;
 
-  // Cached view of the filesystem, mapping a lowercase filename to an
-  // extension and the local file path for that file.
-  FileSystemCache filesystem_cache_;
+  // Cached view of the filesystem, mapping a lowercase filename and
+  // extension to the local file path for that file.
+  GameFileIndex file_index_;
 
   SystemGlobals globals_;
 
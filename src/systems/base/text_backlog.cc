@@ -0,0 +1,108 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/text_backlog.h"
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <cstring>
+#include <string>
+
+#include "libreallive/filemap.h"
+
+namespace fs = boost::filesystem;
+
+TextBacklog::TextBacklog(size_t max_bytes, const fs::path& spill_file)
+    : max_bytes_(max_bytes),
+      data_(NULL),
+      head_(0),
+      first_page_(0),
+      used_bytes_(0) {
+  if (!spill_file.empty() && max_bytes_ > 0) {
+    // Mapping won't create or grow the file itself.
+    try {
+      { fs::ofstream create(spill_file, std::ios::binary | std::ios::trunc); }
+      fs::resize_file(spill_file, max_bytes_);
+      mapping_.reset(new libreallive::Mapping(
+          spill_file.string(), libreallive::Write, max_bytes_));
+      data_ = mapping_->get();
+    } catch (std::exception& e) {
+      mapping_.reset();
+    }
+  }
+
+  if (!mapping_) {
+    heap_.resize(max_bytes_);
+    data_ = heap_.data();
+  }
+}
+
+TextBacklog::~TextBacklog() {}
+
+void TextBacklog::Append(const std::string& page) {
+  size_t size = page.size();
+  if (size == 0 || size > max_bytes_)
+    return;
+
+  size_t offset = head_;
+  if (offset + size > max_bytes_) {
+    // Pages are never split, so wrap around. Everything past |head_| is from
+    // the previous lap, so it's the oldest and goes first.
+    while (!index_.empty() && index_.front().offset >= head_)
+      PopFront();
+    offset = 0;
+  }
+
+  while (!index_.empty() && index_.front().offset >= offset &&
+         index_.front().offset < offset + size) {
+    PopFront();
+  }
+
+  memcpy(data_ + offset, page.data(), size);
+  Entry entry = {offset, size};
+  index_.push_back(entry);
+  used_bytes_ += size;
+  head_ = offset + size;
+}
+
+std::string TextBacklog::Page(int page) const {
+  const Entry& entry = index_[page - first_page_];
+  return std::string(data_ + entry.offset, entry.size);
+}
+
+void TextBacklog::PopFront() {
+  used_bytes_ -= index_.front().size;
+  index_.pop_front();
+  first_page_++;
+}
+
+void TextBacklog::Clear() {
+  first_page_ += index_.size();
+  index_.clear();
+  used_bytes_ = 0;
+  head_ = 0;
+}
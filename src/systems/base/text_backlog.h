@@ -0,0 +1,105 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_TEXT_BACKLOG_H_
+#define SRC_SYSTEMS_BASE_TEXT_BACKLOG_H_
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace libreallive {
+class Mapping;
+}  // namespace libreallive
+
+// The message backlog, as an append only log of encoded pages in a fixed
+// size ring buffer.
+//
+// Pages are numbered from the first page ever appended, so a page keeps its
+// number while older pages are evicted around it, and any retained page is
+// found through the index in constant time. Appending a page evicts the
+// oldest pages whose bytes it overwrites; nothing is ever allocated per page.
+//
+// The ring buffer lives on the heap, or, when given a spill file, in a
+// mapping of that file so the backlog doesn't count against resident memory.
+// If the file can't be mapped, the backlog quietly falls back to the heap.
+class TextBacklog {
+ public:
+  TextBacklog(size_t max_bytes, const boost::filesystem::path& spill_file);
+  ~TextBacklog();
+
+  // Retained pages are numbered [begin_page(), end_page()).
+  int begin_page() const { return first_page_; }
+  int end_page() const { return first_page_ + index_.size(); }
+  int size() const { return index_.size(); }
+  bool empty() const { return index_.empty(); }
+
+  // Appends |page|, evicting as many of the oldest pages as it takes to make
+  // room. Pages larger than the whole buffer aren't kept.
+  void Append(const std::string& page);
+
+  // Returns the bytes of |page|, which must be retained.
+  std::string Page(int page) const;
+
+  // Evicts the oldest page.
+  void PopFront();
+
+  // Evicts everything. Page numbers keep counting up.
+  void Clear();
+
+  size_t max_bytes() const { return max_bytes_; }
+  bool spilled() const { return mapping_ != nullptr; }
+
+  // Bytes taken by retained pages.
+  size_t used_bytes() const { return used_bytes_; }
+
+ private:
+  struct Entry {
+    size_t offset;
+    size_t size;
+  };
+
+  size_t max_bytes_;
+
+  // Either |heap_| or the contents of |mapping_|, |max_bytes_| long.
+  char* data_;
+  std::vector<char> heap_;
+  std::unique_ptr<libreallive::Mapping> mapping_;
+
+  // Where the next page is written.
+  size_t head_;
+
+  // Retained pages, oldest first.
+  std::deque<Entry> index_;
+  int first_page_;
+  size_t used_bytes_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_TEXT_BACKLOG_H_
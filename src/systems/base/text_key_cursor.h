@@ -92,6 +92,10 @@ class TextKeyCursor {
   // The last time current_frame_ was incremented in ticks
   unsigned int last_time_frame_incremented_;
 
+  // Where we were last drawn, which is what a frame change damages. Empty
+  // until the first Render().
+  Rect last_rendered_rect_;
+
   System& system_;
 };
 
@@ -0,0 +1,76 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "systems/base/text_layout.h"
+
+#include <string>
+
+#include "utf8cpp/utf8.h"
+#include "utilities/string_utilities.h"
+
+TextLayout::TextLayout(const std::string& utf8) {
+  text_.reserve(utf8.size());
+  std::string::const_iterator it = utf8.begin();
+  while (it != utf8.end()) {
+    std::string::const_iterator start = it;
+    int point = utf8::next(it, utf8.end());
+    if (point == 0)
+      continue;
+
+    offsets_.push_back(text_.size());
+    text_.append(start, it);
+    codepoints_.push_back(point);
+
+    uint8_t flags = 0;
+    if (IsKinsoku(point))
+      flags |= KINSOKU;
+    if (IsWrappingRomanCharacter(point))
+      flags |= WRAPPING_ROMAN;
+    flags_.push_back(flags);
+  }
+  offsets_.push_back(text_.size());
+
+  // Walk backwards so each run is found once.
+  lookahead_end_.resize(size());
+  int run_end = size();
+  for (int i = size() - 1; i >= 0; --i) {
+    lookahead_end_[i] = run_end;
+    if (flags_[i] == 0)
+      run_end = i;
+  }
+}
+
+TextLayout::~TextLayout() {}
+
+std::string TextLayout::Character(int index) const {
+  if (index >= size())
+    return std::string();
+  return Characters(index, index + 1);
+}
+
+std::string TextLayout::Characters(int begin, int end) const {
+  return text_.substr(offsets_[begin], offsets_[end] - offsets_[begin]);
+}
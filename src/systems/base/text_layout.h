@@ -0,0 +1,83 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_BASE_TEXT_LAYOUT_H_
+#define SRC_SYSTEMS_BASE_TEXT_LAYOUT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A message split into characters once, when it arrives, along with what the
+// line breaker needs to know about each one.
+//
+// TextWindow decides whether to break before a character by looking ahead
+// through the run of kinsoku and wrapping roman characters that follow it.
+// That run is found here, a single time for the whole message, so displaying
+// a character is a matter of indexing into the layout instead of copying and
+// rescanning the rest of the message against the kinsoku table.
+//
+// Embedded NUL characters are dropped.
+class TextLayout {
+ public:
+  explicit TextLayout(const std::string& utf8);
+  ~TextLayout();
+
+  int size() const { return codepoints_.size(); }
+
+  // The codepoint of character |index|, or 0 past the end.
+  int codepoint(int index) const {
+    return index < size() ? codepoints_[index] : 0;
+  }
+
+  // The UTF-8 of character |index|, or the empty string past the end.
+  std::string Character(int index) const;
+
+  // The UTF-8 of characters [|begin|, |end|).
+  std::string Characters(int begin, int end) const;
+
+  bool is_kinsoku(int index) const { return flags_[index] & KINSOKU; }
+
+  // One past the end of the run of kinsoku and wrapping roman characters
+  // directly after |index|.
+  int lookahead_end(int index) const { return lookahead_end_[index]; }
+
+ private:
+  enum Flags {
+    KINSOKU = 1,
+    WRAPPING_ROMAN = 2
+  };
+
+  // |text_| without NULs, with character i at [offsets_[i], offsets_[i+1]).
+  std::string text_;
+  std::vector<int> offsets_;
+
+  std::vector<int> codepoints_;
+  std::vector<uint8_t> flags_;
+  std::vector<int> lookahead_end_;
+};
+
+#endif  // SRC_SYSTEMS_BASE_TEXT_LAYOUT_H_
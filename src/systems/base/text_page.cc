@@ -28,22 +28,20 @@
 #include "systems/base/text_page.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "libreallive/gameexe.h"
 #include "machine/rlmachine.h"
 #include "systems/base/system.h"
+#include "systems/base/text_layout.h"
 #include "systems/base/text_system.h"
 #include "systems/base/text_window.h"
 #include "utf8cpp/utf8.h"
 #include "utilities/exception.h"
 #include "utilities/string_utilities.h"
 
-using std::bind;
-using std::ref;
-using std::placeholders::_1;
-using std::placeholders::_2;
-
 // Represents the various commands.
 enum CommandType {
   TYPE_CHARACTERS,
@@ -66,6 +64,56 @@ enum CommandType {
   TYPE_NEXT_CHAR_IS_ITALIC,
 };
 
+namespace {
+
+void AppendInt(std::string* out, int32_t value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(std::string* out, const std::string& value) {
+  AppendInt(out, value.size());
+  out->append(value);
+}
+
+// Reads back what AppendInt() and AppendString() wrote.
+class EncodedReader {
+ public:
+  EncodedReader(const char* data, size_t size)
+      : cur_(data), end_(data + size) {}
+
+  bool done() const { return cur_ == end_; }
+
+  uint8_t ReadByte() {
+    Take(1);
+    return cur_[-1];
+  }
+
+  int32_t ReadInt() {
+    int32_t value;
+    Take(sizeof(value));
+    memcpy(&value, cur_ - sizeof(value), sizeof(value));
+    return value;
+  }
+
+  std::string ReadString() {
+    uint32_t size = ReadInt();
+    Take(size);
+    return std::string(cur_ - size, size);
+  }
+
+ private:
+  void Take(size_t size) {
+    if (size_t(end_ - cur_) < size)
+      throw rlvm::Exception("Truncated backlog page");
+    cur_ += size;
+  }
+
+  const char* cur_;
+  const char* end_;
+};
+
+}  // namespace
+
 // Storage for each command.
 struct TextPage::Command {
   explicit Command(CommandType type);
@@ -330,8 +378,9 @@ void TextPage::Replay(bool is_active_page) {
 
 // ------------------------------------------------- [ Public operations ]
 
-bool TextPage::Character(const string& current, const string& rest) {
-  bool rendered = CharacterImpl(current, rest);
+bool TextPage::Character(const TextLayout& layout, int index) {
+  bool rendered = system_->text().GetTextWindow(window_num_)->
+      DisplayCharacterAt(layout, index);
 
   if (rendered) {
     if (elements_to_replay_.size() == 0 ||
@@ -339,7 +388,7 @@ bool TextPage::Character(const string& current, const string& rest) {
       elements_to_replay_.emplace_back(TYPE_CHARACTERS);
     }
 
-    elements_to_replay_.back().characters.append(current);
+    elements_to_replay_.back().characters.append(layout.Character(index));
 
     number_of_chars_on_page_++;
   }
@@ -347,6 +396,25 @@ bool TextPage::Character(const string& current, const string& rest) {
   return rendered;
 }
 
+int TextPage::Characters(const TextLayout& layout, int begin, int end) {
+  int rendered = system_->text().GetTextWindow(window_num_)->
+      DisplayCharacters(layout, begin, end);
+
+  if (rendered) {
+    if (elements_to_replay_.size() == 0 ||
+        elements_to_replay_.back().command != TYPE_CHARACTERS) {
+      elements_to_replay_.emplace_back(TYPE_CHARACTERS);
+    }
+
+    elements_to_replay_.back().characters.append(
+        layout.Characters(begin, begin + rendered));
+
+    number_of_chars_on_page_ += rendered;
+  }
+
+  return rendered;
+}
+
 void TextPage::Name(const string& name, const string& next_char) {
   AddAction(Command(TYPE_NAME, name, next_char));
   number_of_chars_on_page_++;
@@ -420,15 +488,116 @@ bool TextPage::IsFull() const {
   return system_->text().GetTextWindow(window_num_)->IsFull();
 }
 
+void TextPage::Encode(std::string* out) const {
+  for (const Command& command : elements_to_replay_) {
+    out->push_back(command.command);
+    switch (command.command) {
+      case TYPE_HARD_BREAK:
+      case TYPE_SET_INDENTATION:
+      case TYPE_RESET_INDENTATION:
+      case TYPE_DEFAULT_FONT_SIZE:
+      case TYPE_RUBY_BEGIN:
+      case TYPE_NEXT_CHAR_IS_ITALIC:
+        break;
+      case TYPE_KOE_MARKER:
+        AppendInt(out, command.koe_id);
+        break;
+      case TYPE_FONT_COLOUR:
+        AppendInt(out, command.font_colour);
+        break;
+      case TYPE_FONT_SIZE:
+        AppendInt(out, command.font_size);
+        break;
+      case TYPE_SET_INSERTION_X:
+        AppendInt(out, command.set_insertion_x);
+        break;
+      case TYPE_SET_INSERTION_Y:
+        AppendInt(out, command.set_insertion_y);
+        break;
+      case TYPE_OFFSET_INSERTION_X:
+        AppendInt(out, command.offset_insertion_x);
+        break;
+      case TYPE_OFFSET_INSERTION_Y:
+        AppendInt(out, command.offset_insertion_y);
+        break;
+      case TYPE_FACE_CLOSE:
+        AppendInt(out, command.face_close);
+        break;
+      case TYPE_CHARACTERS:
+        AppendString(out, command.characters);
+        break;
+      case TYPE_RUBY_END:
+        AppendString(out, command.ruby_text);
+        break;
+      case TYPE_NAME:
+        AppendString(out, command.name.name);
+        AppendString(out, command.name.next_char);
+        break;
+      case TYPE_FACE_OPEN:
+        AppendString(out, command.face_open.filename);
+        AppendInt(out, command.face_open.index);
+        break;
+    }
+  }
+}
+
+// static
+TextPage TextPage::Decode(System& system,
+                          int window_num,
+                          const char* data,
+                          size_t size) {
+  TextPage page(system, window_num);
+  EncodedReader reader(data, size);
+  while (!reader.done()) {
+    CommandType type = static_cast<CommandType>(reader.ReadByte());
+    switch (type) {
+      case TYPE_HARD_BREAK:
+      case TYPE_SET_INDENTATION:
+      case TYPE_RESET_INDENTATION:
+      case TYPE_DEFAULT_FONT_SIZE:
+      case TYPE_RUBY_BEGIN:
+      case TYPE_NEXT_CHAR_IS_ITALIC:
+        page.elements_to_replay_.emplace_back(type);
+        break;
+      case TYPE_CHARACTERS:
+        page.elements_to_replay_.emplace_back(type);
+        page.elements_to_replay_.back().characters = reader.ReadString();
+        break;
+      case TYPE_KOE_MARKER:
+      case TYPE_FONT_COLOUR:
+      case TYPE_FONT_SIZE:
+      case TYPE_SET_INSERTION_X:
+      case TYPE_SET_INSERTION_Y:
+      case TYPE_OFFSET_INSERTION_X:
+      case TYPE_OFFSET_INSERTION_Y:
+      case TYPE_FACE_CLOSE:
+        page.elements_to_replay_.emplace_back(type, reader.ReadInt());
+        break;
+      case TYPE_RUBY_END:
+        page.elements_to_replay_.emplace_back(type, reader.ReadString());
+        break;
+      case TYPE_NAME: {
+        std::string name = reader.ReadString();
+        page.elements_to_replay_.emplace_back(type, name, reader.ReadString());
+        break;
+      }
+      case TYPE_FACE_OPEN: {
+        std::string filename = reader.ReadString();
+        page.elements_to_replay_.emplace_back(type, filename, reader.ReadInt());
+        break;
+      }
+      default:
+        throw rlvm::Exception("Unknown command in backlog page");
+    }
+  }
+  return page;
+}
+
 void TextPage::AddAction(const Command& command) {
   RunTextPageCommand(command, true);
   elements_to_replay_.push_back(command);
 }
 
-bool TextPage::CharacterImpl(const string& c, const string& rest) {
-  return system_->text().GetTextWindow(window_num_)->DisplayCharacter(c, rest);
-}
-
 void TextPage::RunTextPageCommand(const Command& command,
                                   bool is_active_page) {
   std::shared_ptr<TextWindow> window =
@@ -437,10 +606,8 @@ void TextPage::RunTextPageCommand(const Command& command,
   switch (command.command) {
     case TYPE_CHARACTERS:
       if (command.characters.size()) {
-        PrintTextToFunction(
-            bind(&TextPage::CharacterImpl, ref(*this), _1, _2),
-            command.characters,
-            "");
+        TextLayout layout(command.characters);
+        window->DisplayCharacters(layout, 0, layout.size());
       }
       break;
     case TYPE_NAME:
@@ -36,6 +36,7 @@
 class TextPageElement;
 class SetWindowTextPageElement;
 class System;
+class TextLayout;
 class TextTextPageElement;
 
 // A sequence of replayable commands that write to or modify a window, such as
@@ -63,10 +64,14 @@ class TextPage {
   // Replays every recordable action called on this TextPage.
   void Replay(bool is_active_page);
 
-  // Add this character to the most recent text render operation on
-  // this page's backlog, and then render it, minding the kinsoku
-  // spacing rules.
-  bool Character(const std::string& current, const std::string& rest);
+  // Add character |index| of |layout| to the most recent text render
+  // operation on this page's backlog, and then render it, minding the
+  // kinsoku spacing rules.
+  bool Character(const TextLayout& layout, int index);
+
+  // Like Character(), for characters [|begin|, |end|) of |layout|. Stops at
+  // the first character that doesn't fit and returns how many were rendered.
+  int Characters(const TextLayout& layout, int begin, int end);
 
   // Displays a name. This function will be called by the
   // TextoutLongOperation.
@@ -120,6 +125,17 @@ class TextPage {
   // to implement implicit pauses when a page is full.
   bool IsFull() const;
 
+  // Appends a compact encoding of the commands to replay to |out|, for
+  // storing the page in the backlog.
+  void Encode(std::string* out) const;
+
+  // Rebuilds a page from |size| bytes written by Encode(). Throws
+  // rlvm::Exception if the encoding is cut short.
+  static TextPage Decode(System& system,
+                         int window_num,
+                         const char* data,
+                         size_t size);
+
  private:
   // Storage for an individual command.
   struct Command;
@@ -127,9 +143,6 @@ class TextPage {
   // Executes |command| and then adds it to |elements_to_replay_|.
   void AddAction(const Command& command);
 
-  // Performs textout.
-  bool CharacterImpl(const std::string& c, const std::string& rest);
-
   // Actually performs the command in most cases.
   void RunTextPageCommand(const Command& command,
                           bool is_active_page);
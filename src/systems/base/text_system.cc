@@ -30,7 +30,11 @@
 
 #include "systems/base/text_system.h"
 
+#include <boost/filesystem/path.hpp>
+
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <map>
 #include <sstream>
 #include <string>
@@ -43,6 +47,7 @@
 #include "machine/memory.h"
 #include "machine/rlmachine.h"
 #include "machine/serialization.h"
+#include "systems/base/damage_tracker.h"
 #include "systems/base/graphics_system.h"
 #include "systems/base/surface.h"
 #include "systems/base/system.h"
@@ -59,7 +64,17 @@ using std::ostringstream;
 using std::string;
 using std::vector;
 
-const unsigned int MAX_PAGE_HISTORY = 100;
+namespace fs = boost::filesystem;
+
+const int MAX_PAGE_HISTORY = 100;
+
+// Memory budget for the backlog, unless __BACKLOG_KB says otherwise. Way more
+// than MAX_PAGE_HISTORY pages of ordinary dialogue need.
+const int DEFAULT_BACKLOG_KB = 256;
+
+// Memory budget for RenderText() surfaces shared between callers. Enough for
+// a few hundred name boxes and text objects.
+const size_t RENDERED_TEXT_CACHE_BYTES = 8 * 1024 * 1024;
 
 const int FULLWIDTH_NUMBER_SIGN = 0xFF03;
 const int FULLWIDTH_A = 0xFF21;
@@ -93,6 +108,23 @@ TextSystemGlobals::TextSystemGlobals(Gameexe& gexe)
 // -----------------------------------------------------------------------
 // TextSystem
 // -----------------------------------------------------------------------
+namespace {
+
+size_t BacklogBytes(Gameexe& gexe) {
+  return size_t(std::max(gexe("__BACKLOG_KB").ToInt(DEFAULT_BACKLOG_KB), 1)) *
+         1024;
+}
+
+// With __BACKLOG_SPILL, the backlog is kept in a mapped file in the save
+// directory.
+fs::path BacklogSpillFile(System& system, Gameexe& gexe) {
+  if (!gexe("__BACKLOG_SPILL").ToInt(0))
+    return fs::path();
+  return system.GameSaveDirectory() / "backlog.dat";
+}
+
+}  // namespace
+
 TextSystem::TextSystem(System& system, Gameexe& gexe)
     : auto_mode_(false),
       ctrl_key_skip_(true),
@@ -102,6 +134,9 @@ TextSystem::TextSystem(System& system, Gameexe& gexe)
       active_window_(0),
       is_reading_backlog_(false),
       current_pageset_(),
+      backlog_(BacklogBytes(gexe), BacklogSpillFile(system, gexe)),
+      backlog_position_(0),
+      rendered_text_cache_(RENDERED_TEXT_CACHE_BYTES),
       in_pause_state_(false),
       // #WINDOW_*_USE
       move_use_(false),
@@ -147,7 +182,6 @@ TextSystem::TextSystem(System& system, Gameexe& gexe)
       // Gameexe.ini file is malformed.
     }
   }
-  previous_page_it_ = previous_page_sets_.end();
 }
 
 TextSystem::~TextSystem() {}
@@ -202,6 +236,28 @@ void TextSystem::Render(std::ostream* tree) {
   }
 }
 
+uint64_t TextSystem::GetDamageSignature() {
+  if (!system_visible())
+    return 0;
+
+  uint64_t signature = 1;
+  for (WindowMap::iterator it = text_window_.begin(); it != text_window_.end();
+       ++it) {
+    if (ShowWindow(it->first)) {
+      signature = DamageTracker::Combine(signature, it->first);
+      signature =
+          DamageTracker::Combine(signature, it->second->GetDamageSignature());
+    }
+  }
+
+  bool key_cursor_shown = in_pause_state_ && !IsReadingBacklog();
+  signature = DamageTracker::Combine(signature, key_cursor_shown);
+  signature = DamageTracker::Combine(signature, active_window_);
+  signature = DamageTracker::Combine(
+      signature, reinterpret_cast<uintptr_t>(text_key_cursor_.get()));
+  return signature;
+}
+
 void TextSystem::HideTextWindow(int win_number) {
   WindowMap::iterator it = text_window_.find(win_number);
   if (it != text_window_.end()) {
@@ -271,8 +327,30 @@ void TextSystem::CheckAndSetBool(Gameexe& gexe,
 }
 
 void TextSystem::ExpireOldPages() {
-  while (previous_page_sets_.size() > MAX_PAGE_HISTORY)
-    previous_page_sets_.pop_front();
+  while (backlog_.size() > MAX_PAGE_HISTORY)
+    backlog_.PopFront();
+  backlog_position_ = std::max(backlog_position_, backlog_.begin_page());
+}
+
+void TextSystem::ReplayBacklogPage(int page) {
+  // Only the page being looked at is ever decoded. Each record is a list of
+  // (window, size, encoded TextPage).
+  backlog_pageset_.clear();
+  std::string record = backlog_.Page(page);
+  const char* cur = record.data();
+  const char* end = cur + record.size();
+  while (end - cur >= int(2 * sizeof(int32_t))) {
+    int32_t window, size;
+    memcpy(&window, cur, sizeof(window));
+    memcpy(&size, cur + sizeof(window), sizeof(size));
+    cur += sizeof(window) + sizeof(size);
+    size = std::min<int32_t>(size, end - cur);
+    backlog_pageset_.emplace(
+        window, TextPage::Decode(system(), window, cur, size));
+    cur += size;
+  }
+
+  ReplayPageSet(backlog_pageset_, false);
 }
 
 bool TextSystem::MouseButtonStateChanged(MouseButton mouse_button,
@@ -311,7 +389,22 @@ void TextSystem::Snapshot() {
       [&](std::pair<const int, TextPage>& rhs) { return rhs.second.empty(); });
 
   if (!all_empty) {
-    previous_page_sets_.push_back(current_pageset_);
+    std::string record;
+    for (const std::pair<const int, TextPage>& page : current_pageset_) {
+      std::string encoded;
+      page.second.Encode(&encoded);
+
+      int32_t window = page.first;
+      int32_t size = encoded.size();
+      record.append(reinterpret_cast<const char*>(&window), sizeof(window));
+      record.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      record.append(encoded);
+    }
+
+    bool viewing_current = backlog_position_ == backlog_.end_page();
+    backlog_.Append(record);
+    if (viewing_current)
+      backlog_position_ = backlog_.end_page();
     ExpireOldPages();
   }
 }
@@ -323,7 +416,7 @@ void TextSystem::NewPageOnWindow(int window) {
     current_pageset_.erase(it);
   }
 
-  previous_page_it_ = previous_page_sets_.end();
+  backlog_position_ = backlog_.end_page();
   current_pageset_.emplace(window, TextPage(system(), window));
   ExpireOldPages();
 }
@@ -341,29 +434,29 @@ TextPage& TextSystem::GetCurrentPage() {
 void TextSystem::BackPage() {
   is_reading_backlog_ = true;
 
-  if (previous_page_it_ != previous_page_sets_.begin()) {
-    previous_page_it_ = std::prev(previous_page_it_);
+  if (backlog_position_ > backlog_.begin_page()) {
+    backlog_position_--;
 
     // Clear all windows
     ClearAllTextWindows();
     HideAllTextWindows();
 
-    ReplayPageSet(*previous_page_it_, false);
+    ReplayBacklogPage(backlog_position_);
   }
 }
 
 void TextSystem::ForwardPage() {
   is_reading_backlog_ = true;
 
-  if (previous_page_it_ != previous_page_sets_.end()) {
-    previous_page_it_ = std::next(previous_page_it_);
+  if (backlog_position_ < backlog_.end_page()) {
+    backlog_position_++;
 
     // Clear all windows
     ClearAllTextWindows();
     HideAllTextWindows();
 
-    if (previous_page_it_ != previous_page_sets_.end())
-      ReplayPageSet(*previous_page_it_, false);
+    if (backlog_position_ < backlog_.end_page())
+      ReplayBacklogPage(backlog_position_);
     else
       ReplayPageSet(current_pageset_, false);
   }
@@ -535,6 +628,38 @@ std::shared_ptr<Surface> TextSystem::RenderText(const std::string& utf8str,
                                                   const RGBColour& colour,
                                                   RGBColour* shadow_colour,
                                                   int max_chars_in_line) {
+  RenderedTextCache::Key key(utf8str, size, xspace, yspace, colour,
+                             shadow_colour, max_chars_in_line, font_shadow());
+  std::shared_ptr<Surface> surface = rendered_text_cache_.Find(key);
+  if (!surface) {
+    surface = RenderTextSurface(utf8str, size, xspace, yspace, colour,
+                                shadow_colour, max_chars_in_line);
+    rendered_text_cache_.Store(key, surface);
+  }
+  return surface;
+}
+
+int TextSystem::GetCharWidth(int size, uint16_t codepoint) {
+  int width = font_metrics_.Advance(size, 0, codepoint);
+  if (width == FontMetrics::kUnknown) {
+    width = MeasureCharWidth(size, codepoint);
+    font_metrics_.SetAdvance(size, 0, codepoint, width);
+  }
+  return width;
+}
+
+void TextSystem::StoreCharWidth(int size, uint16_t codepoint, int width) {
+  font_metrics_.SetAdvance(size, 0, codepoint, width);
+}
+
+std::shared_ptr<Surface> TextSystem::RenderTextSurface(
+    const std::string& utf8str,
+    int size,
+    int xspace,
+    int yspace,
+    const RGBColour& colour,
+    RGBColour* shadow_colour,
+    int max_chars_in_line) {
   const int line_max_width =
       (max_chars_in_line > 0) ? (size + xspace) * max_chars_in_line : INT_MAX;
 
@@ -792,8 +917,10 @@ void TextSystem::Reset() {
   script_message_no_wait_ = false;
 
   current_pageset_.clear();
-  previous_page_sets_.clear();
-  previous_page_it_ = previous_page_sets_.end();
+  backlog_.Clear();
+  backlog_position_ = backlog_.end_page();
+  backlog_pageset_.clear();
+  rendered_text_cache_.Clear();
 
   window_visual_override_.clear();
   text_window_.clear();
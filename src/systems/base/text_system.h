@@ -32,7 +32,6 @@
 #include <boost/serialization/version.hpp>
 
 #include <cstdint>
-#include <list>
 #include <memory>
 #include <string>
 #include <vector>
@@ -40,6 +39,9 @@
 
 #include "machine/long_operation.h"
 #include "systems/base/event_listener.h"
+#include "systems/base/font_metrics.h"
+#include "systems/base/rendered_text_cache.h"
+#include "systems/base/text_backlog.h"
 
 class Gameexe;
 class Memory;
@@ -103,6 +105,12 @@ class TextSystem : public EventListener {
   void ExecuteTextSystem();
 
   void Render(std::ostream* tree);
+
+  // Returns a value that changes whenever the set of things Render() draws
+  // does, for damage tracking. Doesn't cover text being added to a window,
+  // which reports its own damage.
+  uint64_t GetDamageSignature();
+
   void HideTextWindow(int win_number);
   void HideAllTextWindows();
   void HideAllTextWindowsExcept(int i);
@@ -221,6 +229,9 @@ class TextSystem : public EventListener {
   // Returns a surface with |utf8str| rendered with the other specified
   // properties. Will search |utf8str| for object text syntax and will change
   // various properties based on that syntax.
+  //
+  // The surface comes from |rendered_text_cache_| and may be shared with
+  // other callers asking for the same text, so it must not be drawn onto.
   std::shared_ptr<Surface> RenderText(const std::string& utf8str,
                                         int size,
                                         int xspace,
@@ -240,7 +251,9 @@ class TextSystem : public EventListener {
       int insertion_point_y,
       const std::shared_ptr<Surface>& destination) = 0;
 
-  virtual int GetCharWidth(int size, uint16_t codepoint) = 0;
+  // Advance width of |codepoint| in a |size| font. Each character is only
+  // measured once per size; after that it's answered from |font_metrics_|.
+  int GetCharWidth(int size, uint16_t codepoint);
 
   // Whether the current font has monospaced Roman letters.
   virtual bool FontIsMonospaced() = 0;
@@ -267,6 +280,12 @@ class TextSystem : public EventListener {
 
   System& system() { return system_; }
 
+  const RenderedTextCache& rendered_text_cache() const {
+    return rendered_text_cache_;
+  }
+
+  const FontMetrics& font_metrics() const { return font_metrics_; }
+
  protected:
   void UpdateWindowsForChangeToWindowAttr();
 
@@ -274,10 +293,29 @@ class TextSystem : public EventListener {
 
   void CheckAndSetBool(Gameexe& gexe, const std::string& key, bool& out);
 
-  // Reduces the number of page snapshots in previous_page_sets_ down to a
-  // manageable constant number.
+  // Reduces the number of page snapshots in |backlog_| down to a manageable
+  // constant number.
   void ExpireOldPages();
 
+  // Decodes backlog page |page| into |backlog_pageset_| and replays it.
+  void ReplayBacklogPage(int page);
+
+  // Does the actual work of RenderText() on a fresh surface.
+  std::shared_ptr<Surface> RenderTextSurface(const std::string& utf8str,
+                                             int size,
+                                             int xspace,
+                                             int yspace,
+                                             const RGBColour& colour,
+                                             RGBColour* shadow_colour,
+                                             int max_chars_in_line);
+
+  // Asks the font renderer for the advance width of |codepoint|.
+  virtual int MeasureCharWidth(int size, uint16_t codepoint) = 0;
+
+  // Records a width the font renderer reported some other way, so that
+  // GetCharWidth() doesn't have to ask for it again.
+  void StoreCharWidth(int size, uint16_t codepoint, int width);
+
   // TextPage will call our internals since it actually does most of
   // the work while we hold state.
   friend class TextPage;
@@ -316,15 +354,22 @@ class TextSystem : public EventListener {
   // value.
   std::map<std::string, std::string> namae_mapping_;
 
-  // Previous Text Pages. The TextSystem owns the list of previous
-  // pages because multiple windows can be displayed in one text page.
-  std::list<PageSet> previous_page_sets_;
+  // Previous Text Pages, encoded. The TextSystem owns the backlog because
+  // multiple windows can be displayed in one text page.
+  TextBacklog backlog_;
+
+  // When backlog_position_ == backlog_.end_page(), active_page_ is currently
+  // being rendered to the screen. Otherwise it is the number of the backlog
+  // page being rendered, which is decoded into |backlog_pageset_|.
+  int backlog_position_;
+  PageSet backlog_pageset_;
+
+  // Surfaces returned by RenderText().
+  RenderedTextCache rendered_text_cache_;
 
-  // When previous_page_it_ == previous_pages_.end(), active_page_ is
-  // currently being rendered to the screen. When it is any valid
-  // iterator pointing into previous_pages_, that is the current page
-  // being rendered.
-  std::list<PageSet>::iterator previous_page_it_;
+  // Widths returned by GetCharWidth(). Unlike rendered text, these only
+  // depend on the font, so they are kept across Reset().
+  FontMetrics font_metrics_;
 
   // Whether we are in a state where the interpreter is pause()d.
   bool in_pause_state_;
@@ -37,12 +37,14 @@
 #include "libreallive/defs.h"
 #include "libreallive/gameexe.h"
 #include "machine/rlmachine.h"
+#include "systems/base/damage_tracker.h"
 #include "systems/base/graphics_system.h"
 #include "systems/base/selection_element.h"
 #include "systems/base/sound_system.h"
 #include "systems/base/surface.h"
 #include "systems/base/system.h"
 #include "systems/base/system_error.h"
+#include "systems/base/text_layout.h"
 #include "systems/base/text_system.h"
 #include "systems/base/text_waku.h"
 #include "utf8cpp/utf8.h"
@@ -50,16 +52,12 @@
 #include "utilities/graphics.h"
 #include "utilities/string_utilities.h"
 
-using std::bind;
 using std::endl;
 using std::ostringstream;
-using std::ref;
 using std::setfill;
 using std::setw;
 using std::unique_ptr;
 using std::vector;
-using std::placeholders::_1;
-using std::placeholders::_2;
 
 struct TextWindow::FaceSlot {
   explicit FaceSlot(const std::vector<int>& vec)
@@ -105,6 +103,7 @@ TextWindow::TextWindow(System& system, int window_num)
       is_visible_(0),
       in_selection_mode_(0),
       next_char_italic_(false),
+      chrome_layout_valid_(false),
       system_(system),
       text_system_(system.text()) {
   Gameexe& gexe = system.gameexe();
@@ -162,6 +161,9 @@ TextWindow::TextWindow(System& system, int window_num)
     name_size_ = window("NAME_MOJI_SIZE");
   }
 
+  // The wakus may have asked where they are before everything above was set.
+  InvalidateChromeLayout();
+
   // Load #FACE information.
   GameexeFilteringIterator it = gexe.filtering_begin(window.key() + ".FACE");
   GameexeFilteringIterator end = gexe.filtering_end();
@@ -194,6 +196,7 @@ void TextWindow::SetTextboxPadding(const vector<int>& pos_data) {
   lower_box_padding_ = pos_data.at(1);
   left_box_padding_ = pos_data.at(2);
   right_box_padding_ = pos_data.at(3);
+  InvalidateChromeLayout();
 }
 
 void TextWindow::SetName(const std::string& utf8name,
@@ -201,10 +204,12 @@ void TextWindow::SetName(const std::string& utf8name,
   if (name_mod_ == 0) {
     std::string interpreted_name = text_system_.InterpretName(utf8name);
 
-    // Display the name in one pass
-    PrintTextToFunction(
-        bind(&TextWindow::DisplayCharacter, ref(*this), _1, _2),
-        interpreted_name, next_char);
+    // Display the name in one pass. Only the final character looks past the
+    // name, at |next_char|.
+    TextLayout name(interpreted_name);
+    int last = std::max(name.size() - 1, 0);
+    DisplayCharacters(name, 0, last);
+    DisplayCharacter(name.Character(last), next_char);
     SetIndentation();
   }
 
@@ -226,6 +231,7 @@ void TextWindow::SetNameWithoutDisplay(const std::string& utf8name) {
     }
 
     namebox_characters_ = std::max(namebox_characters_, minimum_namebox_size_);
+    InvalidateChromeLayout();
 
     RenderNameInBox(interpreted_name);
   }
@@ -244,17 +250,20 @@ void TextWindow::SetFontColor(const vector<int>& colour) {
 void TextWindow::SetWindowSizeInCharacters(const vector<int>& pos_data) {
   x_window_size_in_chars_ = pos_data.at(0);
   y_window_size_in_chars_ = pos_data.at(1);
+  InvalidateChromeLayout();
 }
 
 void TextWindow::SetSpacingBetweenCharacters(const vector<int>& pos_data) {
   x_spacing_ = pos_data.at(0);
   y_spacing_ = pos_data.at(1);
+  InvalidateChromeLayout();
 }
 
 void TextWindow::SetWindowPosition(const vector<int>& pos_data) {
   origin_ = pos_data.at(0);
   x_distance_from_origin_ = pos_data.at(1);
   y_distance_from_origin_ = pos_data.at(2);
+  InvalidateChromeLayout();
 }
 
 Size TextWindow::GetTextWindowSize() const {
@@ -271,6 +280,46 @@ Size TextWindow::GetTextSurfaceSize() const {
 }
 
 Rect TextWindow::GetWindowRect() const {
+  return GetChromeLayout().window;
+}
+
+Rect TextWindow::GetTextSurfaceRect() const {
+  return GetChromeLayout().text_surface;
+}
+
+Rect TextWindow::GetNameboxWakuRect() const {
+  return GetChromeLayout().namebox_waku;
+}
+
+const TextWindow::ChromeLayout& TextWindow::GetChromeLayout() const {
+  if (chrome_layout_valid_)
+    return chrome_layout_;
+
+  Rect window = ComputeWindowRect();
+  chrome_layout_.window = window;
+
+  Point text_origin =
+      window.origin() + Size(left_box_padding_, upper_box_padding_);
+  Size text_size = GetTextSurfaceSize();
+  text_size += Size(right_box_padding_, lower_box_padding_);
+  chrome_layout_.text_surface = Rect(text_origin, text_size);
+
+  // Like the main window rect, we need to ask the waku what size it wants to
+  // be. The waku is offset from the top left corner of the text window.
+  chrome_layout_.namebox_waku = Rect();
+  if (namebox_waku_) {
+    Size box_size = namebox_waku_->GetSize(GetNameboxTextArea());
+    chrome_layout_.namebox_waku =
+        Rect(Point(window.x() + namebox_x_offset_,
+                   window.y() + namebox_y_offset_ - box_size.height()),
+             box_size);
+  }
+
+  chrome_layout_valid_ = true;
+  return chrome_layout_;
+}
+
+Rect TextWindow::ComputeWindowRect() const {
   // This absolutely needs to know the size of the on main backing waku if we
   // want to draw things correctly! If we are going to offset this text box
   // from the top or the bottom, we MUST know what the size of the image
@@ -327,30 +376,6 @@ Rect TextWindow::GetWindowRect() const {
   return Rect(x, y, boxSize);
 }
 
-Rect TextWindow::GetTextSurfaceRect() const {
-  Rect window = GetWindowRect();
-
-  Point textOrigin =
-      window.origin() + Size(left_box_padding_, upper_box_padding_);
-
-  Size rectSize = GetTextSurfaceSize();
-  rectSize += Size(right_box_padding_, lower_box_padding_);
-
-  return Rect(textOrigin, rectSize);
-}
-
-Rect TextWindow::GetNameboxWakuRect() const {
-  // Like the main GetWindowRect(), we need to ask the waku what size it wants to
-  // be.
-  Size boxSize = namebox_waku_->GetSize(GetNameboxTextArea());
-
-  // The waku is offset from the top left corner of the text window.
-  Rect r = GetWindowRect();
-  return Rect(Point(r.x() + namebox_x_offset_,
-                    r.y() + namebox_y_offset_ - boxSize.height()),
-              boxSize);
-}
-
 Size TextWindow::GetNameboxTextArea() const {
   // TODO(erg): This seems excessively wide.
   return Size(
@@ -368,11 +393,13 @@ void TextWindow::SetNameboxPadding(const std::vector<int>& pos_data) {
     horizontal_namebox_padding_ = pos_data.at(0);
   if (pos_data.size() >= 2)
     vertical_namebox_padding_ = pos_data.at(1);
+  InvalidateChromeLayout();
 }
 
 void TextWindow::SetNameboxPosition(const vector<int>& pos_data) {
   namebox_x_offset_ = pos_data.at(0);
   namebox_y_offset_ = pos_data.at(1);
+  InvalidateChromeLayout();
 }
 
 void TextWindow::SetKeycursorMod(const vector<int>& keycur) {
@@ -425,6 +452,8 @@ void TextWindow::Render(std::ostream* tree) {
   std::shared_ptr<Surface> text_surface = GetTextSurface();
 
   if (text_surface && is_visible()) {
+    FlushPendingGlyphs();
+
     Size surface_size = text_surface->GetSize();
 
     // POINT
@@ -481,6 +510,35 @@ void TextWindow::Render(std::ostream* tree) {
   }
 }
 
+uint64_t TextWindow::GetDamageSignature() {
+  if (!is_visible())
+    return 0;
+
+  Rect window = GetWindowRect();
+  uint64_t signature = 1;
+  signature = DamageTracker::Combine(signature, window.x());
+  signature = DamageTracker::Combine(signature, window.y());
+  signature = DamageTracker::Combine(signature, window.width());
+  signature = DamageTracker::Combine(signature, window.height());
+  signature = DamageTracker::Combine(
+      signature, reinterpret_cast<uintptr_t>(GetTextSurface().get()));
+  signature = DamageTracker::Combine(
+      signature, reinterpret_cast<uintptr_t>(GetNameSurface().get()));
+  signature = DamageTracker::Combine(signature, in_selection_mode_);
+  signature = DamageTracker::Combine(signature, selections_.size());
+  signature = DamageTracker::Combine(signature, koe_replay_button_.size());
+  for (int i = 0; i < kNumFaceSlots; ++i) {
+    if (face_slot_[i]) {
+      signature = DamageTracker::Combine(
+          signature,
+          reinterpret_cast<uintptr_t>(face_slot_[i]->face_surface.get()));
+      signature = DamageTracker::Combine(signature, face_slot_[i]->x);
+      signature = DamageTracker::Combine(signature, face_slot_[i]->y);
+    }
+  }
+  return signature;
+}
+
 void TextWindow::RenderFaces(std::ostream* tree, int behind) {
   for (int i = 0; i < kNumFaceSlots; ++i) {
     if (face_slot_[i] && face_slot_[i]->face_surface &&
@@ -488,8 +546,9 @@ void TextWindow::RenderFaces(std::ostream* tree, int behind) {
       const std::shared_ptr<const Surface>& surface =
           face_slot_[i]->face_surface;
 
-      Rect dest(GetWindowRect().x() + face_slot_[i]->x,
-                GetWindowRect().y() + face_slot_[i]->y,
+      const Rect& window = GetChromeLayout().window;
+      Rect dest(window.x() + face_slot_[i]->x,
+                window.y() + face_slot_[i]->y,
                 surface->GetSize());
       surface->RenderToScreen(surface->GetRect(), dest, 255);
 
@@ -513,7 +572,27 @@ void TextWindow::RenderKoeReplayButtons(std::ostream* tree) {
   }
 }
 
+void TextWindow::FlushPendingGlyphs() {
+  if (pending_glyphs_.empty())
+    return;
+
+  RGBColour shadow = RGBAColour::Black().rgb();
+  std::shared_ptr<Surface> text_surface = GetTextSurface();
+  for (const PendingGlyph& pending : pending_glyphs_) {
+    text_system_.RenderGlyphOnto(pending.glyph,
+                                 pending.font_size,
+                                 pending.italic,
+                                 pending.colour,
+                                 &shadow,
+                                 pending.x,
+                                 pending.y,
+                                 text_surface);
+  }
+  pending_glyphs_.clear();
+}
+
 void TextWindow::ClearWin() {
+  pending_glyphs_.clear();
   text_insertion_point_x_ = 0;
   text_insertion_point_y_ = ruby_text_size();
   text_wrapping_point_x_ = 0;
@@ -523,10 +602,11 @@ void TextWindow::ClearWin() {
   ruby_begin_point_ = -1;
   font_colour_ = default_colour_;
   koe_replay_button_.clear();
+
+  system_.graphics().InvalidateScreenArea(GetTextSurfaceRect());
 }
 
-bool TextWindow::DisplayCharacter(const std::string& current,
-                                  const std::string& rest) {
+bool TextWindow::DisplayCharacterAt(const TextLayout& layout, int index) {
   // If this text page is already full, save some time and reject
   // early.
   if (IsFull())
@@ -534,8 +614,9 @@ bool TextWindow::DisplayCharacter(const std::string& current,
 
   set_is_visible(true);
 
-  if (current != "") {
-    int cur_codepoint = Codepoint(current);
+  if (index < layout.size()) {
+    std::string current = layout.Character(index);
+    int cur_codepoint = layout.codepoint(index);
     bool indent_after_spacing = false;
 
     // But if the last character was a lenticular bracket, we need to indent
@@ -553,22 +634,30 @@ bool TextWindow::DisplayCharacter(const std::string& current,
 
     // If the width of this glyph plus the spacing will put us over the
     // edge of the window, then line increment.
-    if (MustLineBreak(cur_codepoint, rest)) {
+    if (MustLineBreak(layout, index)) {
       HardBrake();
 
       if (IsFull())
         return false;
     }
 
-    RGBColour shadow = RGBAColour::Black().rgb();
-    text_system_.RenderGlyphOnto(current,
-                                 font_size_in_pixels(),
-                                 next_char_italic_,
-                                 font_colour_,
-                                 &shadow,
-                                 text_insertion_point_x_,
-                                 text_insertion_point_y_,
-                                 GetTextSurface());
+    if (system_.ShouldFastForward()) {
+      PendingGlyph pending = {current, font_size_in_pixels(), next_char_italic_,
+                              font_colour_, text_insertion_point_x_,
+                              text_insertion_point_y_};
+      pending_glyphs_.push_back(pending);
+    } else {
+      FlushPendingGlyphs();
+      RGBColour shadow = RGBAColour::Black().rgb();
+      text_system_.RenderGlyphOnto(current,
+                                   font_size_in_pixels(),
+                                   next_char_italic_,
+                                   font_colour_,
+                                   &shadow,
+                                   text_insertion_point_x_,
+                                   text_insertion_point_y_,
+                                   GetTextSurface());
+    }
     next_char_italic_ = false;
     text_wrapping_point_x_ += GetWrappingWidthFor(cur_codepoint);
 
@@ -602,7 +691,7 @@ bool TextWindow::DisplayCharacter(const std::string& current,
   // When we aren't rendering a piece of text with a ruby gloss, mark
   // the screen as dirty so that this character renders.
   if (ruby_begin_point_ == -1) {
-    system_.graphics().MarkScreenAsDirty(GUT_TEXTSYS);
+    system_.graphics().MarkScreenAsDirty(GUT_TEXTSYS, GetTextSurfaceRect());
   }
 
   last_token_was_name_ = false;
@@ -610,6 +699,22 @@ bool TextWindow::DisplayCharacter(const std::string& current,
   return true;
 }
 
+int TextWindow::DisplayCharacters(const TextLayout& layout,
+                                  int begin,
+                                  int end) {
+  int index = begin;
+  while (index < end && DisplayCharacterAt(layout, index))
+    ++index;
+  return index - begin;
+}
+
+bool TextWindow::DisplayCharacter(const std::string& current,
+                                  const std::string& rest) {
+  if (current == "")
+    return DisplayCharacterAt(TextLayout(""), 0);
+  return DisplayCharacterAt(TextLayout(current + rest), 0);
+}
+
 // Lines we still get wrong in CLANNAD Prologue:
 //
 // <rlmax> = Official RealLive's breaking
@@ -618,9 +723,10 @@ bool TextWindow::DisplayCharacter(const std::string& current,
 // - "Whose ides was it to put a school at the top of a giant <rlmax> slope,<rlvm> anyway?"
 //
 
-bool TextWindow::MustLineBreak(int cur_codepoint, const std::string& rest) {
+bool TextWindow::MustLineBreak(const TextLayout& layout, int index) {
+  int cur_codepoint = layout.codepoint(index);
   int char_width = GetWrappingWidthFor(cur_codepoint);
-  bool cur_codepoint_is_kinsoku = IsKinsoku(cur_codepoint) ||
+  bool cur_codepoint_is_kinsoku = layout.is_kinsoku(index) ||
                                   cur_codepoint == 0x20;
   int normal_width =
       x_window_size_in_chars_ * (default_font_size_in_pixels_ + x_spacing_);
@@ -640,29 +746,19 @@ bool TextWindow::MustLineBreak(int cur_codepoint, const std::string& rest) {
 
   // If this character will fit on the line, but the next n characters are
   // kinsoku characters OR wrapping roman characters and one of them won't,
-  // then break.
-  if (!cur_codepoint_is_kinsoku && rest != "") {
+  // then break. The layout already knows where that run of characters ends.
+  if (!cur_codepoint_is_kinsoku) {
     int final_insertion_x = text_wrapping_point_x_ + char_width;
 
-    string::const_iterator cur = rest.begin();
-    string::const_iterator end = rest.end();
-    while (cur != end) {
-      int point = utf8::next(cur, end);
-      if (IsKinsoku(point)) {
-        final_insertion_x += GetWrappingWidthFor(point);
+    int run_end = layout.lookahead_end(index);
+    for (int i = index + 1; i < run_end; ++i) {
+      final_insertion_x += GetWrappingWidthFor(layout.codepoint(i));
 
-        if (final_insertion_x > extended_width) {
-          return true;
-        }
-      // OK, is this correct? I'm now having places where we prematurely break.
-      } else if (IsWrappingRomanCharacter(point)) {
-        final_insertion_x += GetWrappingWidthFor(point);
-
-        if (final_insertion_x > normal_width) {
-          return true;
-        }
-      } else {
-        break;
+      // OK, is this correct? I'm now having places where we prematurely break
+      // on wrapping roman characters.
+      int limit = layout.is_kinsoku(i) ? extended_width : normal_width;
+      if (final_insertion_x > limit) {
+        return true;
       }
     }
   }
@@ -28,6 +28,7 @@
 #ifndef SRC_SYSTEMS_BASE_TEXT_WINDOW_H_
 #define SRC_SYSTEMS_BASE_TEXT_WINDOW_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -45,6 +46,7 @@ class RLMachine;
 class SelectionElement;
 class Surface;
 class System;
+class TextLayout;
 class TextSystem;
 class TextWaku;
 class TextWindowButton;
@@ -85,7 +87,10 @@ class TextWindow {
   // Sets the size of the ruby (furigana; pronunciation guide) text in
   // pixels. If zero, ruby text is disabled in this window. Represented by
   // #WINDOW.xxx.LUBY_SIZE.
-  void set_ruby_text_size(const int i) { ruby_size_ = i; }
+  void set_ruby_text_size(const int i) {
+    ruby_size_ = i;
+    InvalidateChromeLayout();
+  }
   int ruby_text_size() const { return ruby_size_; }
 
   // Sets the size of the font. Represented by #WINDOW.xxx.MOJI.SIZE.
@@ -196,6 +201,11 @@ class TextWindow {
   // ------------------------------------------------ [ Abstract interface ]
   void Render(std::ostream* tree);
 
+  // Returns a value that changes whenever what Render() draws does, except
+  // for text being added to the text surface. See
+  // TextSystem::GetDamageSignature().
+  uint64_t GetDamageSignature();
+
   // Returns a surface that is the text.
   virtual std::shared_ptr<Surface> GetTextSurface() = 0;
   virtual std::shared_ptr<Surface> GetNameSurface() = 0;
@@ -204,15 +214,22 @@ class TextWindow {
   // point.
   virtual void ClearWin();
 
-  // Displays one character, and performs line breaking logic based on the next
-  // character. Returns true if the character fits on the screen. False if it
-  // does not and was not displayed.
-  virtual bool DisplayCharacter(const std::string& current,
-                                const std::string& rest);
+  // Displays character |index| of |layout|, and performs line breaking logic
+  // based on the characters after it. Past the end of |layout|, just marks the
+  // window as shown. Returns true if the character fits on the screen. False
+  // if it does not and was not displayed.
+  virtual bool DisplayCharacterAt(const TextLayout& layout, int index);
+
+  // Displays characters [|begin|, |end|) of |layout| until one doesn't fit.
+  // Returns how many were displayed.
+  int DisplayCharacters(const TextLayout& layout, int begin, int end);
 
-  // Checks to make sure that not only will |cur_codepoint| fit on the line,
+  // Displays |current|, breaking lines as if |rest| followed it.
+  bool DisplayCharacter(const std::string& current, const std::string& rest);
+
+  // Checks to make sure that not only will character |index| fit on the line,
   // but also that we'll perform kinsoku rules correctly.
-  bool MustLineBreak(int cur_codepoint, const std::string& rest);
+  bool MustLineBreak(const TextLayout& layout, int index);
 
   // Returns whether another character can be placed on the screen.
   bool IsFull() const;
@@ -259,8 +276,27 @@ class TextWindow {
 
   void RenderKoeReplayButtons(std::ostream* tree);
 
+  // Rasterizes the glyphs held back while fast forwarding.
+  void FlushPendingGlyphs();
+
   int GetWrappingWidthFor(int cur_codepoint);
 
+  // Where the window and its name box sit on screen. Render(), the keycursor
+  // and the koe and face placement ask for these several times a frame, but
+  // they only change when the window is moved, resized or given a new name,
+  // so they're computed once and kept until InvalidateChromeLayout().
+  struct ChromeLayout {
+    Rect window;
+    Rect text_surface;
+
+    // Empty when there is no namebox waku.
+    Rect namebox_waku;
+  };
+  const ChromeLayout& GetChromeLayout() const;
+  void InvalidateChromeLayout() { chrome_layout_valid_ = false; }
+
+  Rect ComputeWindowRect() const;
+
  protected:
   // We cache the size of the screen so we don't need the machine in
   // some accessors.
@@ -419,6 +455,21 @@ class TextWindow {
   };
   std::unique_ptr<KoeReplayInfo> koe_replay_info_;
 
+  // Characters displayed while fast forwarding are laid out as usual but only
+  // rasterized once the page is about to be presented, so pages that are
+  // skipped past between two presents never rasterize their text at all.
+  struct PendingGlyph {
+    std::string glyph;
+    int font_size;
+    bool italic;
+    RGBColour colour;
+    int x, y;
+  };
+  std::vector<PendingGlyph> pending_glyphs_;
+
+  mutable ChromeLayout chrome_layout_;
+  mutable bool chrome_layout_valid_;
+
   System& system_;
   TextSystem& text_system_;
 };
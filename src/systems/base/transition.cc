@@ -0,0 +1,128 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/base/transition.h"
+
+#include <algorithm>
+#include <cmath>
+
+// -----------------------------------------------------------------------
+// Transition::Pane
+// -----------------------------------------------------------------------
+
+Transition::Pane::Pane() : image(NO_IMAGE) {}
+
+Transition::Pane::Pane(Image image, const Rect& src, const Rect& dst)
+    : image(image), src(src), dst(dst) {}
+
+// -----------------------------------------------------------------------
+// Transition
+// -----------------------------------------------------------------------
+
+Transition::Transition()
+    : style(FADE),
+      opacity(0),
+      axis_x(0),
+      axis_y(0),
+      axis_origin(0),
+      edge(0),
+      band(0),
+      blind_size(1),
+      rows(0),
+      pane_count(0) {}
+
+// static
+Transition Transition::Fade(int opacity) {
+  Transition transition;
+  transition.style = FADE;
+  transition.opacity = opacity;
+  return transition;
+}
+
+// static
+Transition Transition::Wipe(float axis_x,
+                            float axis_y,
+                            float axis_origin,
+                            int edge,
+                            int band) {
+  Transition transition;
+  transition.style = WIPE;
+  transition.axis_x = axis_x;
+  transition.axis_y = axis_y;
+  transition.axis_origin = axis_origin;
+  transition.edge = edge;
+  transition.band = band;
+  return transition;
+}
+
+// static
+Transition Transition::Blind(float axis_x,
+                             float axis_y,
+                             float axis_origin,
+                             int blind_size,
+                             int rows) {
+  Transition transition;
+  transition.style = BLIND;
+  transition.axis_x = axis_x;
+  transition.axis_y = axis_y;
+  transition.axis_origin = axis_origin;
+  transition.blind_size = blind_size;
+  transition.rows = rows;
+  return transition;
+}
+
+void Transition::AddPane(Image image, const Rect& src, const Rect& dst) {
+  style = PANES;
+  if (pane_count < kMaxPanes)
+    panes[pane_count++] = Pane(image, src, dst);
+}
+
+float Transition::Coverage(int x, int y) const {
+  switch (style) {
+    case FADE:
+      return opacity / 255.0f;
+    case WIPE: {
+      float position = Position(x, y);
+      if (band <= 0)
+        return position < edge ? 1.0f : 0.0f;
+
+      // The soft edge fades linearly from the end of the solid part.
+      float coverage = (edge + band - position) / band;
+      return std::max(0.0f, std::min(1.0f, coverage));
+    }
+    case BLIND: {
+      float position = Position(x, y);
+      float blind = std::floor(position / blind_size);
+      float shown = std::max(0.0f, std::min<float>(blind_size, rows - blind));
+      return position - blind * blind_size < shown ? 1.0f : 0.0f;
+    }
+    case PANES:
+      break;
+  }
+
+  return 0.0f;
+}
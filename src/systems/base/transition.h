@@ -0,0 +1,114 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_BASE_TRANSITION_H_
+#define SRC_SYSTEMS_BASE_TRANSITION_H_
+
+#include "systems/base/rect.h"
+
+// One frame of a \#SEL transition from the old contents of the screen to a
+// new image, described per pixel so that a graphics system can draw the
+// whole frame in a single pass (see GraphicsSystem::DrawTransition()).
+//
+// FADE, WIPE and BLIND draw the old image and then the new image over it,
+// letting Coverage() of it through at each pixel. PANES draws pieces of
+// either image, stretched onto rectangles of an otherwise black screen.
+struct Transition {
+  enum Style { FADE, WIPE, BLIND, PANES };
+
+  enum Image { NO_IMAGE, FROM_IMAGE, TO_IMAGE };
+
+  // A piece of one of the images: |src| of |image| drawn onto |dst|.
+  struct Pane {
+    Pane();
+    Pane(Image image, const Rect& src, const Rect& dst);
+
+    Image image;
+    Rect src;
+    Rect dst;
+  };
+
+  static const int kMaxPanes = 2;
+
+  Transition();
+
+  // The new image at |opacity| (0-255) over the whole screen.
+  static Transition Fade(int opacity);
+
+  // The new image up to |edge| along the axis, fading out over the |band|
+  // pixels after it.
+  static Transition Wipe(float axis_x,
+                         float axis_y,
+                         float axis_origin,
+                         int edge,
+                         int band);
+
+  // The new image in blinds |blind_size| pixels deep along the axis. Blind
+  // n shows its first clamp(|rows| - n, 0, |blind_size|) pixels.
+  static Transition Blind(float axis_x,
+                          float axis_y,
+                          float axis_origin,
+                          int blind_size,
+                          int rows);
+
+  // Adds a pane for PANES; later panes are drawn over earlier ones.
+  void AddPane(Image image, const Rect& src, const Rect& dst);
+
+  // How far along the axis the centre of pixel (x, y) is.
+  float Position(int x, int y) const {
+    return axis_x * (x + 0.5f) + axis_y * (y + 0.5f) + axis_origin;
+  }
+
+  // How much of the new image shows at pixel (x, y), from 0 to 1. Not
+  // meaningful for PANES.
+  float Coverage(int x, int y) const;
+
+  Style style;
+
+  // FADE: opacity of the new image.
+  int opacity;
+
+  // WIPE and BLIND: a pixel's position along the transition is
+  // axis_x * x + axis_y * y + axis_origin for its centre (x, y).
+  float axis_x;
+  float axis_y;
+  float axis_origin;
+
+  // WIPE: where the new image ends and how wide its soft edge is.
+  int edge;
+  int band;
+
+  // BLIND: depth of each blind and how far they've opened.
+  int blind_size;
+  int rows;
+
+  // PANES: what to draw, bottom first.
+  Pane panes[kMaxPanes];
+  int pane_count;
+};
+
+#endif  // SRC_SYSTEMS_BASE_TRANSITION_H_
@@ -0,0 +1,163 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "GL/glew.h"
+
+#include "systems/sdl/gl_state.h"
+
+#include <utility>
+#include <vector>
+
+GLState::Cached<GLenum> GLState::active_texture_;
+GLState::Cached<GLuint> GLState::bound_texture_[kTextureUnits];
+GLState::Cached<bool> GLState::texture_2d_[kTextureUnits];
+GLState::Cached<GLuint> GLState::program_;
+GLState::Cached<std::pair<GLenum, GLenum> > GLState::blend_func_;
+GLState::Cached<GLenum> GLState::blend_equation_;
+std::vector<std::pair<GLenum, GLState::Cached<bool> > >
+    GLState::capabilities_;
+
+int GLState::calls_ = 0;
+int GLState::skipped_ = 0;
+int GLState::last_frame_calls_ = 0;
+int GLState::last_frame_skipped_ = 0;
+
+// static
+void GLState::ActiveTexture(GLenum unit) {
+  if (active_texture_.Set(unit))
+    glActiveTextureARB(unit);
+}
+
+// static
+void GLState::BindTexture(GLuint texture) {
+  int unit = ActiveUnit();
+  if (unit >= kTextureUnits) {
+    calls_++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+  } else if (bound_texture_[unit].Set(texture)) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+  }
+}
+
+// static
+void GLState::DeleteTexture(GLuint texture) {
+  glDeleteTextures(1, &texture);
+
+  // Deleting a bound texture rebinds zero in its place.
+  for (Cached<GLuint>& bound : bound_texture_) {
+    if (bound.known && bound.value == texture)
+      bound.value = 0;
+  }
+}
+
+// static
+void GLState::UseProgram(GLuint program) {
+  // Cards without shaders are only ever asked for the fixed pipeline.
+  if (!GLEW_ARB_shader_objects)
+    return;
+
+  if (program_.Set(program))
+    glUseProgramObjectARB(program);
+}
+
+// static
+void GLState::BlendFunc(GLenum source, GLenum destination) {
+  if (blend_func_.Set(std::make_pair(source, destination)))
+    glBlendFunc(source, destination);
+}
+
+// static
+void GLState::BlendEquation(GLenum mode) {
+  if (blend_equation_.Set(mode))
+    glBlendEquation(mode);
+}
+
+// static
+void GLState::Enable(GLenum capability) {
+  SetCapability(capability, true);
+}
+
+// static
+void GLState::Disable(GLenum capability) {
+  SetCapability(capability, false);
+}
+
+// static
+void GLState::Invalidate() {
+  active_texture_ = Cached<GLenum>();
+  for (int i = 0; i < kTextureUnits; ++i) {
+    bound_texture_[i] = Cached<GLuint>();
+    texture_2d_[i] = Cached<bool>();
+  }
+  program_ = Cached<GLuint>();
+  blend_func_ = Cached<std::pair<GLenum, GLenum> >();
+  blend_equation_ = Cached<GLenum>();
+  capabilities_.clear();
+}
+
+// static
+void GLState::EndFrame() {
+  last_frame_calls_ = calls_;
+  last_frame_skipped_ = skipped_;
+  calls_ = 0;
+  skipped_ = 0;
+}
+
+// static
+int GLState::ActiveUnit() {
+  // Until someone picks a unit, assume the default one.
+  return active_texture_.known ? active_texture_.value - GL_TEXTURE0_ARB : 0;
+}
+
+// static
+void GLState::SetCapability(GLenum capability, bool enabled) {
+  Cached<bool>* cached = NULL;
+  if (capability == GL_TEXTURE_2D) {
+    int unit = ActiveUnit();
+    if (unit < kTextureUnits)
+      cached = &texture_2d_[unit];
+  } else {
+    for (auto& entry : capabilities_) {
+      if (entry.first == capability)
+        cached = &entry.second;
+    }
+    if (!cached) {
+      capabilities_.push_back(std::make_pair(capability, Cached<bool>()));
+      cached = &capabilities_.back().second;
+    }
+  }
+
+  if (cached && !cached->Set(enabled))
+    return;
+  if (!cached)
+    calls_++;
+
+  if (enabled)
+    glEnable(capability);
+  else
+    glDisable(capability);
+}
@@ -0,0 +1,121 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_SDL_GL_STATE_H_
+#define SRC_SYSTEMS_SDL_GL_STATE_H_
+
+#include <SDL/SDL_opengl.h>
+
+#include <utility>
+#include <vector>
+
+// A shadow copy of the bits of OpenGL state that systems/sdl changes all the
+// time: the bound texture of each texture unit, the active unit, the shader
+// program, the blend function and equation, and enabled capabilities. Calls
+// that wouldn't change anything never reach the driver.
+//
+// Everything in systems/sdl must go through here instead of calling the gl*
+// functions directly, or the cache goes stale. Code that doesn't (guichan,
+// a freshly created context) must be followed by Invalidate().
+//
+// Static state, like Shaders; there is only one GL context.
+class GLState {
+ public:
+  // glActiveTextureARB(). |unit| is GL_TEXTURE0_ARB and up.
+  static void ActiveTexture(GLenum unit);
+
+  // glBindTexture(GL_TEXTURE_2D, |texture|) on the active unit.
+  static void BindTexture(GLuint texture);
+
+  // glDeleteTextures() for one texture, forgetting it wherever it's bound.
+  static void DeleteTexture(GLuint texture);
+
+  // glUseProgramObjectARB().
+  static void UseProgram(GLuint program);
+
+  static void BlendFunc(GLenum source, GLenum destination);
+  static void BlendEquation(GLenum mode);
+
+  // glEnable()/glDisable(). GL_TEXTURE_2D is tracked per texture unit.
+  static void Enable(GLenum capability);
+  static void Disable(GLenum capability);
+
+  // Forgets everything, so the next call of each kind goes to the driver.
+  static void Invalidate();
+
+  // Moves this frame's counters into the last_frame_* values.
+  static void EndFrame();
+
+  // Statistics for the last completed frame: calls passed on to the driver
+  // and calls dropped because they wouldn't have changed anything.
+  static int last_frame_calls() { return last_frame_calls_; }
+  static int last_frame_skipped() { return last_frame_skipped_; }
+
+ private:
+  // One cached value. Unknown until the first Set().
+  template <typename T>
+  struct Cached {
+    Cached() : known(false), value() {}
+
+    // Returns true (and counts a call) if |v| differs from the cached value.
+    bool Set(const T& v) {
+      if (known && value == v) {
+        skipped_++;
+        return false;
+      }
+      known = true;
+      value = v;
+      calls_++;
+      return true;
+    }
+
+    bool known;
+    T value;
+  };
+
+  static const int kTextureUnits = 4;
+
+  // Returns the index of the active texture unit.
+  static int ActiveUnit();
+
+  static void SetCapability(GLenum capability, bool enabled);
+
+  static Cached<GLenum> active_texture_;
+  static Cached<GLuint> bound_texture_[kTextureUnits];
+  static Cached<bool> texture_2d_[kTextureUnits];
+  static Cached<GLuint> program_;
+  static Cached<std::pair<GLenum, GLenum> > blend_func_;
+  static Cached<GLenum> blend_equation_;
+  static std::vector<std::pair<GLenum, Cached<bool> > > capabilities_;
+
+  static int calls_;
+  static int skipped_;
+  static int last_frame_calls_;
+  static int last_frame_skipped_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_GL_STATE_H_
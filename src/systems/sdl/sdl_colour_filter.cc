@@ -28,18 +28,23 @@
 
 #include "systems/sdl/sdl_colour_filter.h"
 
+#include <algorithm>
+
 #include "systems/base/colour.h"
 #include "systems/base/graphics_object.h"
+#include "systems/sdl/gl_state.h"
 #include "systems/sdl/sdl_utils.h"
-#include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_renderer.h"
 #include "systems/sdl/texture.h"
 
 SDLColourFilter::SDLColourFilter()
     : texture_width_(0), texture_height_(0), back_texture_id_(0) {}
 
 SDLColourFilter::~SDLColourFilter() {
-  if (back_texture_id_)
-    glDeleteTextures(1, &back_texture_id_);
+  if (back_texture_id_) {
+    SpriteRenderer::Flush();
+    GLState::DeleteTexture(back_texture_id_);
+  }
 }
 
 void SDLColourFilter::Fill(const GraphicsObject& go,
@@ -48,7 +53,7 @@ void SDLColourFilter::Fill(const GraphicsObject& go,
   if (GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
     if (back_texture_id_ == 0) {
       glGenTextures(1, &back_texture_id_);
-      glBindTexture(GL_TEXTURE_2D, back_texture_id_);
+      GLState::BindTexture(back_texture_id_);
       DebugShowGLErrors();
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -69,7 +74,8 @@ void SDLColourFilter::Fill(const GraphicsObject& go,
 
     // Copy the current value of the region where we're going to render
     // to a texture for input to the shader
-    glBindTexture(GL_TEXTURE_2D, back_texture_id_);
+    SpriteRenderer::Flush();
+    GLState::BindTexture(back_texture_id_);
     int ystart =
         int(Texture::ScreenHeight() - screen_rect.y() - screen_rect.height());
     int idx1 = screen_rect.x();
@@ -77,34 +83,18 @@ void SDLColourFilter::Fill(const GraphicsObject& go,
         GL_TEXTURE_2D, 0, 0, 0, idx1, ystart, texture_width_, texture_height_);
     DebugShowGLErrors();
 
-    // Set up shader
-    glUseProgramObjectARB(Shaders::GetObjectProgram());
-    glUniform1iARB(Shaders::GetObjectUniformImage(), 0);
-    glUniform1fARB(Shaders::GetObjectUniformAlpha(),
-                   (go.GetComputedAlpha() / 255.0f));
-    Shaders::loadObjectUniformFromGraphicsObject(go);
-
-    float thisx1 = 0;
-    float thisy1 = 0;
-    float thisx2 = float(screen_rect.width()) / texture_width_;
-    float thisy2 = float(screen_rect.height()) / texture_height_;
-
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glBegin(GL_QUADS);
-    {
-      glTexCoord2f(thisx1, thisy2);
-      glVertex2f(screen_rect.x(), screen_rect.y());
-      glTexCoord2f(thisx1, thisy1);
-      glVertex2f(screen_rect.x(), screen_rect.y() + screen_rect.height());
-      glTexCoord2f(thisx2, thisy1);
-      glVertex2f(screen_rect.x() + screen_rect.width(),
-                 screen_rect.y() + screen_rect.height());
-      glTexCoord2f(thisx2, thisy2);
-      glVertex2f(screen_rect.x() + screen_rect.width(), screen_rect.y());
-    }
-    glEnd();
-    glBlendFunc(GL_ONE, GL_ZERO);
-
-    glUseProgramObjectARB(0);
+    // The copy is upside down.
+    SpriteQuad quad;
+    quad.x1 = screen_rect.x();
+    quad.y1 = screen_rect.y();
+    quad.x2 = screen_rect.x() + screen_rect.width();
+    quad.y2 = screen_rect.y() + screen_rect.height();
+    quad.u1 = 0;
+    quad.v1 = float(screen_rect.height()) / texture_height_;
+    quad.u2 = float(screen_rect.width()) / texture_width_;
+    quad.v2 = 0;
+    std::fill(quad.alpha, quad.alpha + 4, go.GetComputedAlpha());
+    quad.effects = SpriteEffects::FromGraphicsObject(go);
+    SpriteRenderer::Draw(back_texture_id_, SPRITE_BLEND_ALPHA, quad);
   }
 }
@@ -93,6 +93,7 @@ void SDLEventSystem::ExecuteEventSystem(RLMachine& machine) {
         HandleActiveEvent(machine, event);
         break;
       case SDL_VIDEOEXPOSE: {
+        machine.system().graphics().InvalidateScreen();
         machine.system().graphics().ForceRefresh();
         break;
       }
@@ -51,6 +51,7 @@
 #include "machine/rlmachine.h"
 #include "systems/base/cgm_table.h"
 #include "systems/base/colour.h"
+#include "systems/base/decoded_image_cache.h"
 #include "systems/base/event_system.h"
 #include "systems/base/graphics_object.h"
 #include "systems/base/mouse_cursor.h"
@@ -59,19 +60,44 @@
 #include "systems/base/system_error.h"
 #include "systems/base/text_system.h"
 #include "systems/base/tone_curve.h"
+#include "systems/base/transition.h"
+#include "systems/sdl/gl_state.h"
 #include "systems/sdl/sdl_colour_filter.h"
 #include "systems/sdl/sdl_event_system.h"
 #include "systems/sdl/sdl_render_to_texture_surface.h"
 #include "systems/sdl/sdl_surface.h"
+#include "systems/sdl/sdl_text_system.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_renderer.h"
 #include "systems/sdl/texture.h"
+#include "systems/sdl/texture_page.h"
+#include "systems/sdl/texture_uploader.h"
 #include "utilities/exception.h"
 #include "utilities/graphics.h"
 #include "utilities/lazy_array.h"
+#include "utilities/pixel_conversion.h"
 #include "utilities/string_utilities.h"
 #include "xclannad/file.h"
 
+namespace {
+
+// The one texture backing |surface|, or NULL if it doesn't have exactly one.
+Texture* TransitionTexture(const Surface& surface) {
+  const SDLSurface* sdl_surface = dynamic_cast<const SDLSurface*>(&surface);
+  if (sdl_surface)
+    return sdl_surface->GetSingleTexture();
+
+  const SDLRenderToTextureSurface* rendered =
+      dynamic_cast<const SDLRenderToTextureSurface*>(&surface);
+  if (rendered)
+    return rendered->texture();
+
+  return NULL;
+}
+
+}  // namespace
+
 // -----------------------------------------------------------------------
 // Private Interface
 // -----------------------------------------------------------------------
@@ -83,13 +109,93 @@ void SDLGraphicsSystem::SetCursor(int cursor) {
 }
 
 void SDLGraphicsSystem::BeginFrame() {
+  StartBackgroundUploads();
+
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   DebugShowGLErrors();
 
-  glDisable(GL_DEPTH_TEST);
-  glDisable(GL_CULL_FACE);
-  glDisable(GL_LIGHTING);
+  partial_area_ = Rect();
+  SetupFrameState();
+}
+
+bool SDLGraphicsSystem::CanRedrawPartially() {
+  // Final renderers draw on top of everything and don't report damage.
+  return screen_contents_texture_valid_ && renderer_begin() == renderer_end();
+}
+
+void SDLGraphicsSystem::BeginPartialFrame(const Rect& area) {
+  StartBackgroundUploads();
+  SetupFrameState();
+
+  // The back buffer is undefined after a swap, so everything outside |area|
+  // comes from the snapshot of the last frame.
+  DrawScreenContents();
+
+  partial_area_ = area;
+  GLState::Enable(GL_SCISSOR_TEST);
+  glScissor(area.x(),
+            screen_size().height() - area.y2(),
+            area.width(),
+            area.height());
+}
+
+bool SDLGraphicsSystem::CanCacheLayers() { return layer_framebuffer_ != 0; }
+
+void SDLGraphicsSystem::BeginLayer() {
+  SpriteRenderer::Flush();
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, layer_framebuffer_);
+
+  // The layer is reused by later frames, so it's always drawn in full.
+  GLState::Disable(GL_SCISSOR_TEST);
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  DebugShowGLErrors();
+}
+
+void SDLGraphicsSystem::EndLayer() {
+  SpriteRenderer::Flush();
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+  if (!partial_area_.is_empty())
+    GLState::Enable(GL_SCISSOR_TEST);
+  DebugShowGLErrors();
+}
+
+void SDLGraphicsSystem::DrawLayer() {
+  SpriteRenderer::Flush();
+  DrawScreenTexture(layer_texture_);
+}
+
+void SDLGraphicsSystem::DescribeTextureMemory(std::ostream& tree) {
+  tree << "Texture memory:" << std::endl;
+  for (int i = 0; i < 16; ++i) {
+    if (display_contexts_[i]->rawSurface()) {
+      tree << "  DC" << i << ": "
+           << display_contexts_[i]->GetTextureMemoryUsage() / 1024 << " KB"
+           << std::endl;
+    }
+  }
+  if (haikei_->rawSurface()) {
+    tree << "  Haikei: " << haikei_->GetTextureMemoryUsage() / 1024 << " KB"
+         << std::endl;
+  }
+
+  uint64_t screen_bytes = uint64_t(screen_tex_width_) * screen_tex_height_ * 4;
+  uint64_t screen_total = screen_bytes * (layer_texture_ ? 2 : 1);
+  tree << "  Screen and layer textures: " << screen_total / 1024 << " KB"
+       << std::endl;
+  tree << "  Shared pages: " << TexturePage::page_count() << " pages, "
+       << TexturePage::allocated_bytes() / 1024 << " KB" << std::endl;
+  tree << "  Total: "
+       << (Texture::allocated_bytes() + TexturePage::allocated_bytes() +
+           screen_total) / 1024
+       << " KB" << std::endl;
+}
+
+void SDLGraphicsSystem::SetupFrameState() {
+  GLState::Disable(GL_DEPTH_TEST);
+  GLState::Disable(GL_CULL_FACE);
+  GLState::Disable(GL_LIGHTING);
   DebugShowGLErrors();
 
   glMatrixMode(GL_PROJECTION);
@@ -111,27 +217,49 @@ void SDLGraphicsSystem::BeginFrame() {
   glTranslatef(origin.x(), origin.y(), 0);
 }
 
-void SDLGraphicsSystem::MarkScreenAsDirty(GraphicsUpdateType type) {
-  if (is_responsible_for_update() &&
-      screen_update_mode() == SCREENUPDATEMODE_MANUAL && type == GUT_MOUSE_MOTION)
+void SDLGraphicsSystem::StartBackgroundUploads() {
+  display_contexts_[0]->UploadPendingChanges();
+  haikei_->UploadPendingChanges();
+}
+
+void SDLGraphicsSystem::MarkScreenAsDirty(GraphicsUpdateType type,
+                                          const Rect& area) {
+  // The cursor is drawn on top of the snapshot of the last frame, so moving
+  // it doesn't need the scene redrawn once we have a snapshot.
+  bool can_redraw_last_frame =
+      screen_update_mode() == SCREENUPDATEMODE_MANUAL ||
+      (damage_tracking() && screen_contents_texture_valid_);
+  if (is_responsible_for_update() && can_redraw_last_frame &&
+      type == GUT_MOUSE_MOTION)
     redraw_last_frame_ = true;
   else
-    GraphicsSystem::MarkScreenAsDirty(type);
+    GraphicsSystem::MarkScreenAsDirty(type, area);
 }
 
 void SDLGraphicsSystem::EndFrame() {
+  // Final renderers (the guichan platform) draw with OpenGL directly, so they
+  // get the fixed function pipeline and we can't trust our cached state
+  // afterwards.
+  SpriteRenderer::Flush();
+  GLState::UseProgram(0);
+
   FinalRenderers::iterator it = renderer_begin();
   FinalRenderers::iterator end = renderer_end();
   for (; it != end; ++it) {
     (*it)->Render(NULL);
   }
+  if (renderer_begin() != renderer_end())
+    GLState::Invalidate();
+  SpriteRenderer::Flush();
+  GLState::Disable(GL_SCISSOR_TEST);
 
-  if (screen_update_mode() == SCREENUPDATEMODE_MANUAL) {
+  if (screen_update_mode() == SCREENUPDATEMODE_MANUAL || damage_tracking()) {
     // Copy the area behind the cursor to the temporary buffer (drivers differ:
     // the contents of the back buffer is undefined after SDL_GL_SwapBuffers()
     // and I've just been lucky that the Intel i810 and whatever my Mac machine
-    // has have been doing things that way.)
-    glBindTexture(GL_TEXTURE_2D, screen_contents_texture_);
+    // has have been doing things that way.) Partial redraws start from this
+    // copy too.
+    GLState::BindTexture(screen_contents_texture_);
     glCopyTexSubImage2D(GL_TEXTURE_2D,
                         0,
                         0,
@@ -146,53 +274,69 @@ void SDLGraphicsSystem::EndFrame() {
   }
 
   DrawCursor();
+  SpriteRenderer::EndFrame();
+  GLState::EndFrame();
+  TextureUploader::EndFrame();
 
   // Swap the buffers
   glFlush();
   SDL_GL_SwapBuffers();
   ShowGLErrors();
+  presentation_clock().Presented(system().event().GetTicks());
+
+  OnFrameEnded();
 }
 
 void SDLGraphicsSystem::RedrawLastFrame() {
   // We won't redraw the screen between when the DrawManual() command is issued
   // by the bytecode and the first refresh() is called since we need a valid
   // copy of the screen to work with and we only snapshot the screen during
-  // DrawManual() mode.
+  // DrawManual() mode (or with damage tracking on).
   if (screen_contents_texture_valid_) {
-    // Redraw the screen
-    glBindTexture(GL_TEXTURE_2D, screen_contents_texture_);
-    glBegin(GL_QUADS);
-    {
-      int dx1 = 0;
-      int dx2 = screen_size().width();
-      int dy1 = 0;
-      int dy2 = screen_size().height();
-
-      float x_cord = dx2 / float(screen_tex_width_);
-      float y_cord = dy2 / float(screen_tex_height_);
-
-      glColor4ub(255, 255, 255, 255);
-      glTexCoord2f(0, y_cord);
-      glVertex2i(dx1, dy1);
-      glTexCoord2f(x_cord, y_cord);
-      glVertex2i(dx2, dy1);
-      glTexCoord2f(x_cord, 0);
-      glVertex2i(dx2, dy2);
-      glTexCoord2f(0, 0);
-      glVertex2i(dx1, dy2);
-    }
-    glEnd();
-
+    DrawScreenContents();
     DrawCursor();
+    SpriteRenderer::Flush();
 
     glFlush();
 
     // Swap the buffers
     SDL_GL_SwapBuffers();
     ShowGLErrors();
+    presentation_clock().Presented(system().event().GetTicks());
   }
 }
 
+void SDLGraphicsSystem::DrawScreenContents() {
+  DrawScreenTexture(screen_contents_texture_);
+}
+
+void SDLGraphicsSystem::DrawScreenTexture(GLuint texture) {
+  GLState::UseProgram(0);
+  GLState::BlendFunc(GL_ONE, GL_ZERO);
+  GLState::BindTexture(texture);
+  glBegin(GL_QUADS);
+  {
+    int dx1 = 0;
+    int dx2 = screen_size().width();
+    int dy1 = 0;
+    int dy2 = screen_size().height();
+
+    float x_cord = dx2 / float(screen_tex_width_);
+    float y_cord = dy2 / float(screen_tex_height_);
+
+    glColor4ub(255, 255, 255, 255);
+    glTexCoord2f(0, y_cord);
+    glVertex2i(dx1, dy1);
+    glTexCoord2f(x_cord, y_cord);
+    glVertex2i(dx2, dy1);
+    glTexCoord2f(x_cord, 0);
+    glVertex2i(dx2, dy2);
+    glTexCoord2f(0, 0);
+    glVertex2i(dx1, dy2);
+  }
+  glEnd();
+}
+
 void SDLGraphicsSystem::DrawCursor() {
   if (ShouldUseCustomCursor()) {
     std::shared_ptr<MouseCursor> cursor;
@@ -210,6 +354,102 @@ std::shared_ptr<Surface> SDLGraphicsSystem::EndFrameToSurface() {
       new SDLRenderToTextureSurface(this, screen_size()));
 }
 
+bool SDLGraphicsSystem::DrawTransition(const Surface& from,
+                                       const Surface& to,
+                                       const Transition& transition) {
+  if (!GLEW_ARB_fragment_shader || !GLEW_ARB_multitexture)
+    return false;
+
+  Texture* textures[2] = {TransitionTexture(from), TransitionTexture(to)};
+  if (!textures[0] || !textures[1])
+    return false;
+
+  SpriteRenderer::Flush();
+  GLState::UseProgram(Shaders::GetTransitionProgram());
+
+  static const char* const kSamplers[2] = {"from_image", "to_image"};
+  static const char* const kCoords[2] = {"from_coords", "to_coords"};
+  for (int i = 0; i < 2; ++i) {
+    GLState::ActiveTexture(i == 0 ? GL_TEXTURE0_ARB : GL_TEXTURE1_ARB);
+    GLState::Enable(GL_TEXTURE_2D);
+    GLState::BindTexture(textures[i]->textureId());
+    glUniform1iARB(Shaders::GetTransitionUniform(kSamplers[i]), i);
+
+    float transform[4];
+    textures[i]->GetTexCoordTransform(transform);
+    glUniform4fARB(Shaders::GetTransitionUniform(kCoords[i]),
+                   transform[0], transform[1], transform[2], transform[3]);
+  }
+  glUniform4fARB(Shaders::GetTransitionUniform("image_sizes"),
+                 textures[0]->width(), textures[0]->height(),
+                 textures[1]->width(), textures[1]->height());
+
+  glUniform1fARB(Shaders::GetTransitionUniform("style"), transition.style);
+  glUniform3fARB(Shaders::GetTransitionUniform("axis"),
+                 transition.axis_x,
+                 transition.axis_y,
+                 transition.axis_origin);
+  float params[2] = {0.0f, 0.0f};
+  switch (transition.style) {
+    case Transition::FADE:
+      params[0] = transition.opacity;
+      break;
+    case Transition::WIPE:
+      params[0] = transition.edge;
+      params[1] = transition.band;
+      break;
+    case Transition::BLIND:
+      params[0] = transition.blind_size;
+      params[1] = transition.rows;
+      break;
+    case Transition::PANES:
+      break;
+  }
+  glUniform2fARB(Shaders::GetTransitionUniform("params"), params[0], params[1]);
+
+  static const char* const kPaneDst[Transition::kMaxPanes] = {"pane0_dst",
+                                                              "pane1_dst"};
+  static const char* const kPaneSrc[Transition::kMaxPanes] = {"pane0_src",
+                                                              "pane1_src"};
+  float pane_images[Transition::kMaxPanes] = {0.0f, 0.0f};
+  for (int i = 0; i < transition.pane_count; ++i) {
+    const Transition::Pane& pane = transition.panes[i];
+    pane_images[i] = pane.image;
+    glUniform4fARB(Shaders::GetTransitionUniform(kPaneDst[i]),
+                   pane.dst.x(), pane.dst.y(), pane.dst.x2(), pane.dst.y2());
+    glUniform4fARB(Shaders::GetTransitionUniform(kPaneSrc[i]),
+                   pane.src.x(), pane.src.y(), pane.src.x2(), pane.src.y2());
+  }
+  glUniform2fARB(Shaders::GetTransitionUniform("pane_images"),
+                 pane_images[0], pane_images[1]);
+
+  // The shader composites everything itself, so whatever was on screen
+  // before doesn't matter. Texture coordinates are screen pixels.
+  GLState::Disable(GL_BLEND);
+  int width = screen_size().width();
+  int height = screen_size().height();
+  glBegin(GL_QUADS);
+  {
+    glTexCoord2f(0, 0);
+    glVertex2i(0, 0);
+    glTexCoord2f(width, 0);
+    glVertex2i(width, 0);
+    glTexCoord2f(width, height);
+    glVertex2i(width, height);
+    glTexCoord2f(0, height);
+    glVertex2i(0, height);
+  }
+  glEnd();
+  DebugShowGLErrors();
+
+  GLState::ActiveTexture(GL_TEXTURE1_ARB);
+  GLState::Disable(GL_TEXTURE_2D);
+  GLState::ActiveTexture(GL_TEXTURE0_ARB);
+  GLState::UseProgram(0);
+  GLState::Enable(GL_BLEND);
+  return true;
+}
+
 // -----------------------------------------------------------------------
 // Public Interface
 // -----------------------------------------------------------------------
@@ -219,17 +459,22 @@ SDLGraphicsSystem::SDLGraphicsSystem(System& system, Gameexe& gameexe)
       redraw_last_frame_(false),
       display_data_in_titlebar_(false),
       time_of_last_titlebar_update_(0),
+      time_of_last_refresh_(0),
       last_seen_number_(0),
       last_line_number_(0),
       screen_contents_texture_valid_(false),
       screen_tex_width_(0),
-      screen_tex_height_(0) {
+      screen_tex_height_(0),
+      layer_framebuffer_(0),
+      layer_texture_(0),
+      decoded_image_cache_checked_(false) {
   haikei_.reset(new SDLSurface(this));
   for (int i = 0; i < 16; ++i)
     display_contexts_[i].reset(new SDLSurface(this));
 
   SetScreenSize(GetScreenSize(gameexe));
   Texture::SetScreenSize(screen_size());
+  TexturePage::set_atlas_enabled(!gameexe("__NO_TEXTURE_ATLAS").ToInt(0));
 
   // Grab the caption
   std::string cp932caption = gameexe("CAPTION").ToString();
@@ -318,11 +563,14 @@ void SDLGraphicsSystem::SetupVideo() {
     throw SystemError(oss.str());
   }
 
-  glEnable(GL_TEXTURE_2D);
+  // This is a new context; nothing we remember about the old one holds.
+  GLState::Invalidate();
+
+  GLState::Enable(GL_TEXTURE_2D);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
   // Enable Texture Mapping ( NEW )
-  glEnable(GL_TEXTURE_2D);
+  GLState::Enable(GL_TEXTURE_2D);
 
   // Enable smooth shading
   glShadeModel(GL_SMOOTH);
@@ -334,9 +582,9 @@ void SDLGraphicsSystem::SetupVideo() {
   glClearDepth(1.0f);
 
   // Enables Depth Testing
-  glEnable(GL_DEPTH_TEST);
+  GLState::Enable(GL_DEPTH_TEST);
 
-  glEnable(GL_BLEND);
+  GLState::Enable(GL_BLEND);
 
   // The Type Of Depth Test To Do
   glDepthFunc(GL_LEQUAL);
@@ -350,7 +598,7 @@ void SDLGraphicsSystem::SetupVideo() {
   // Create a small 32x32 texture for storing what's behind the mouse
   // cursor.
   glGenTextures(1, &screen_contents_texture_);
-  glBindTexture(GL_TEXTURE_2D, screen_contents_texture_);
+  GLState::BindTexture(screen_contents_texture_);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   screen_tex_width_ = SafeSize(screen_size().width());
@@ -364,31 +612,87 @@ void SDLGraphicsSystem::SetupVideo() {
                GL_RGB,
                GL_UNSIGNED_BYTE,
                NULL);
+  screen_contents_texture_valid_ = false;
+  InvalidateScreen();
+
+  SetupLayer();
 
   ShowGLErrors();
 }
 
+void SDLGraphicsSystem::SetupLayer() {
+  // Anything from a previous context is gone along with it.
+  layer_framebuffer_ = 0;
+  layer_texture_ = 0;
+  InvalidateLayer();
+  if (!GLEW_EXT_framebuffer_object)
+    return;
+
+  glGenTextures(1, &layer_texture_);
+  GLState::BindTexture(layer_texture_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               GL_RGBA,
+               screen_tex_width_,
+               screen_tex_height_,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               NULL);
+
+  glGenFramebuffersEXT(1, &layer_framebuffer_);
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, layer_framebuffer_);
+  glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT,
+                            GL_COLOR_ATTACHMENT0_EXT,
+                            GL_TEXTURE_2D,
+                            layer_texture_,
+                            0);
+  GLenum status = glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT);
+  glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
+
+  if (status != GL_FRAMEBUFFER_COMPLETE_EXT) {
+    // Some drivers can't render to this format; draw every frame in full.
+    glDeleteFramebuffersEXT(1, &layer_framebuffer_);
+    GLState::DeleteTexture(layer_texture_);
+    layer_framebuffer_ = 0;
+    layer_texture_ = 0;
+  }
+}
+
 SDLGraphicsSystem::~SDLGraphicsSystem() {}
 
 void SDLGraphicsSystem::ExecuteGraphicsSystem(RLMachine& machine) {
-  // For now, nothing, but later, we need to put all code each cycle
-  // here.
-  if (is_responsible_for_update() && screen_needs_refresh()) {
+  // While fast forwarding, only present every skip_frame_interval(); the
+  // screen stays marked as needing a refresh until then.
+  unsigned int current_time = machine.system().event().GetTicks();
+  bool present_due =
+      !machine.system().ShouldFastForward() ||
+      current_time - time_of_last_refresh_ >= skip_frame_interval();
+
+  if (is_responsible_for_update() && screen_needs_refresh() && present_due) {
+    time_of_last_refresh_ = current_time;
+    // A skipped frame leaves a moved cursor to RedrawLastFrame() below.
+    int skipped_frames = damage().skipped_frames();
     Refresh(NULL);
     OnScreenRefreshed();
-    redraw_last_frame_ = false;
-  } else if (is_responsible_for_update() && redraw_last_frame_) {
+    if (damage().skipped_frames() == skipped_frames)
+      redraw_last_frame_ = false;
+  }
+
+  if (is_responsible_for_update() && redraw_last_frame_) {
     RedrawLastFrame();
     redraw_last_frame_ = false;
   }
 
   // Update the seen.
-  int current_time = machine.system().event().GetTicks();
   if ((current_time - time_of_last_titlebar_update_) > 60) {
     time_of_last_titlebar_update_ = current_time;
 
     if (machine.SceneNumber() != last_seen_number_ ||
-        machine.line_number() != last_line_number_) {
+        machine.line_number() != last_line_number_ ||
+        display_data_in_titlebar_) {
       last_seen_number_ = machine.SceneNumber();
       last_line_number_ = machine.line_number();
       SetWindowTitle();
@@ -407,8 +711,28 @@ void SDLGraphicsSystem::SetWindowTitle() {
   }
 
   if (display_data_in_titlebar_) {
+    const SDLTextSystem& text = static_cast<SDLTextSystem&>(system().text());
+    int glyph_lookups =
+        text.glyph_cache().hits() + text.glyph_cache().misses();
+    int glyph_hit_percent =
+        glyph_lookups ? int64_t(text.glyph_cache().hits()) * 100 / glyph_lookups
+                      : 0;
     oss << " - (SEEN" << last_seen_number_ << ")(Line " << last_line_number_
-        << ")";
+        << ")(" << SpriteRenderer::last_frame_sprites() << " sprites in "
+        << SpriteRenderer::last_frame_draw_calls() << " draws, "
+        << GLState::last_frame_skipped() << " of "
+        << GLState::last_frame_calls() + GLState::last_frame_skipped()
+        << " GL state changes skipped)(Frames: "
+        << damage().skipped_frames() << " skipped, "
+        << damage().partial_frames() << " partial, "
+        << damage().full_frames() << " full)(Layer: "
+        << layer_cache().cached_count() << " cached, "
+        << layer_cache().rebuilds() << " rebuilds)(Uploads: "
+        << TextureUploader::last_frame_bytes() / 1024 << " KB, "
+        << TextureUploader::last_frame_stall_us() << " us stalled)(Atlas: "
+        << TexturePage::page_count() << " pages)(Glyphs: "
+        << glyph_hit_percent << "% cached, " << text.glyphs_per_second()
+        << "/s)";
   }
 
   // PulseAudio allocates a string each time we set the title. Make sure we
@@ -420,10 +744,31 @@ void SDLGraphicsSystem::SetWindowTitle() {
   }
 }
 
+DecodedImageCache* SDLGraphicsSystem::GetDecodedImageCache() {
+  if (!decoded_image_cache_checked_) {
+    decoded_image_cache_checked_ = true;
+
+    int megabytes = system().gameexe()("__IMAGE_CACHE_MB").ToInt(0);
+    if (megabytes > 0) {
+      decoded_image_cache_.reset(new DecodedImageCache(
+          system().GameSaveDirectory() / "image_cache",
+          uintmax_t(megabytes) * 1024 * 1024));
+    }
+  }
+
+  return decoded_image_cache_.get();
+}
+
 void SDLGraphicsSystem::Observe(NotificationType type,
                                 const NotificationSource& source,
                                 const NotificationDetails& details) {
+  SpriteRenderer::Reset();
+  TextureUploader::Reset();
   Shaders::Reset();
+  GLState::Invalidate();
+
+  // A new video mode may well run at a different refresh rate.
+  presentation_clock().Reset();
 }
 
 void SDLGraphicsSystem::SetWindowSubtitle(const std::string& cp932str,
@@ -569,16 +914,20 @@ static SDLSurface::GrpRect xclannadRegionToGrpRect(
   return rect;
 }
 
-std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
-    const std::string& short_filename) {
-  boost::filesystem::path filename =
-      system().FindFile(short_filename, IMAGE_FILETYPES);
-  if (filename.empty()) {
-    std::ostringstream oss;
-    oss << "Could not find image file \"" << short_filename << "\".";
-    throw rlvm::Exception(oss.str());
-  }
-
+// Sprite sheets with at least this many patterns are decoded one pattern at a
+// time as they're used, instead of all up front.
+static const int kMinDeferredRegions = 8;
+
+// Decodes the image at |filename| with Jagarl's loader, writing the result to
+// |disk_cache| if there is one. If |deferred| is non-NULL, a large sprite
+// sheet may instead be returned as a blank surface, with the decompressed
+// regions to fill it with placed in |deferred|.
+static SDL_Surface* DecodeImageFile(
+    const boost::filesystem::path& filename,
+    DecodedImageCache* disk_cache,
+    std::shared_ptr<G00RegionDecoder>* deferred,
+    Size* size,
+    std::vector<SDLSurface::GrpRect>* region_table) {
   // Glue code to allow my stuff to work with Jagarl's loader
   FILE* file = fopen(filename.string().c_str(), "rb");
   if (!file) {
@@ -588,60 +937,125 @@ std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
   }
 
   fseek(file, 0, SEEK_END);
-  size_t size = ftell(file);
-  std::unique_ptr<char[]> d(new char[size + 1]);
+  size_t file_size = ftell(file);
+  std::unique_ptr<char[]> d(new char[file_size + 1]);
   fseek(file, 0, SEEK_SET);
-  fread(d.get(), size, 1, file);
+  fread(d.get(), file_size, 1, file);
   fclose(file);
 
   std::unique_ptr<GRPCONV> conv(
-      GRPCONV::AssignConverter(d.get(), size, "???"));
+      GRPCONV::AssignConverter(d.get(), file_size, "???"));
   if (conv == 0) {
     throw SystemError("Failure in GRPCONV.");
   }
+  *size = Size(conv->Width(), conv->Height());
+
+  // Grab the Type-2 information out of the converter or create one
+  // default region if none exist
+  if (conv->region_table.size()) {
+    std::transform(conv->region_table.begin(),
+                   conv->region_table.end(),
+                   std::back_inserter(*region_table),
+                   xclannadRegionToGrpRect);
+  } else {
+    SDLSurface::GrpRect rect;
+    rect.rect = Rect(Point(0, 0), Size(conv->Width(), conv->Height()));
+    rect.originX = 0;
+    rect.originY = 0;
+    region_table->push_back(rect);
+  }
+
+  if (deferred && conv->region_table.size() >= kMinDeferredRegions) {
+    // The regions have to be disjoint, otherwise the order they're copied in
+    // matters. (In that rare case the image is decompressed a second time
+    // below.)
+    std::shared_ptr<G00RegionDecoder> regions(conv->DecompressRegions());
+    if (regions && !regions->RegionsOverlap()) {
+      *deferred = regions;
+      return buildNewSurface(*size);
+    }
+  }
+
   // do not free until SDL_FreeSurface() is called on the surface using it
   char* mem = (char*)malloc(conv->Width() * conv->Height() * 4 + 1024);
   SDL_Surface* s = 0;
   if (conv->Read(mem)) {
     MaskType is_mask = conv->IsMask() ? ALPHA_MASK : NO_MASK;
     if (is_mask == ALPHA_MASK) {
-      int len = conv->Width() * conv->Height();
-      unsigned int* d = (unsigned int*)mem;
-      int i;
-      for (i = 0; i < len; i++) {
-        if ((*d & 0xff000000) != 0xff000000)
-          break;
-        d++;
+      // Most converters already know whether the image is opaque from the
+      // copy pass; only scan the pixels when they couldn't tell.
+      bool opaque = conv->opacity == GRPCONV::OPACITY_OPAQUE;
+      if (conv->opacity == GRPCONV::OPACITY_UNKNOWN) {
+        opaque = IsFullyOpaque(reinterpret_cast<uint32_t*>(mem),
+                               conv->Width() * conv->Height());
       }
-      if (i == len) {
+      if (opaque) {
         is_mask = NO_MASK;
       }
     }
 
     s = newSurfaceFromRGBAData(conv->Width(), conv->Height(), mem, is_mask);
+
+    if (disk_cache) {
+      disk_cache->Store(filename,
+                        conv->Width(),
+                        conv->Height(),
+                        is_mask == ALPHA_MASK,
+                        mem,
+                        *region_table);
+    }
   }
   free(mem);
 
-  // Grab the Type-2 information out of the converter or create one
-  // default region if none exist
+  return s;
+}
+
+std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
+    const std::string& short_filename) {
+  boost::filesystem::path filename =
+      system().FindFile(short_filename, IMAGE_FILETYPES);
+  if (filename.empty()) {
+    std::ostringstream oss;
+    oss << "Could not find image file \"" << short_filename << "\".";
+    throw rlvm::Exception(oss.str());
+  }
+
+  SDL_Surface* s = 0;
+  Size size;
   std::vector<SDLSurface::GrpRect> region_table;
-  if (conv->region_table.size()) {
-    std::transform(conv->region_table.begin(),
-                   conv->region_table.end(),
-                   std::back_inserter(region_table),
-                   xclannadRegionToGrpRect);
+  std::shared_ptr<G00RegionDecoder> pending_regions;
+  bool has_tone_curve = short_filename.find("?") != short_filename.npos;
+
+  // A hit in the on disk cache skips decoding entirely; the pixels are
+  // already in the format we hand to SDL.
+  DecodedImageCache* disk_cache = GetDecodedImageCache();
+  std::unique_ptr<DecodedImageCache::Entry> cached;
+  if (disk_cache)
+    cached = disk_cache->Lookup(filename);
+
+  if (cached) {
+    size = Size(cached->width(), cached->height());
+    s = newSurfaceFromRGBAData(cached->width(),
+                               cached->height(),
+                               cached->pixels(),
+                               cached->has_alpha() ? ALPHA_MASK : NO_MASK);
+    region_table = cached->region_table();
   } else {
-    SDLSurface::GrpRect rect;
-    rect.rect = Rect(Point(0, 0), Size(conv->Width(), conv->Height()));
-    rect.originX = 0;
-    rect.originY = 0;
-    region_table.push_back(rect);
+    // Deferred regions would be decoded straight away by a tone curve, and
+    // the disk cache wants the whole image.
+    s = DecodeImageFile(filename,
+                        disk_cache,
+                        disk_cache || has_tone_curve ? NULL : &pending_regions,
+                        &size,
+                        &region_table);
   }
 
-  std::shared_ptr<Surface> surface_to_ret(
-      new SDLSurface(this, s, region_table));
+  SDLSurface* sdl_surface = new SDLSurface(this, s, region_table);
+  if (pending_regions)
+    sdl_surface->setPendingRegions(pending_regions);
+  std::shared_ptr<Surface> surface_to_ret(sdl_surface);
   // handle tone curve effect loading
-  if (short_filename.find("?") != short_filename.npos) {
+  if (has_tone_curve) {
     std::string effect_no_str =
         short_filename.substr(short_filename.find("?") + 1);
     int effect_no = std::stoi(effect_no_str);
@@ -655,7 +1069,7 @@ std::shared_ptr<const Surface> SDLGraphicsSystem::LoadSurfaceFromFile(
     }
     surface_to_ret.get()->ToneCurve(
         globals().tone_curves.GetEffect(effect_no / 10 - 1),
-        Rect(Point(0, 0), Size(conv->Width(), conv->Height())));
+        Rect(Point(0, 0), size));
   }
 
   return surface_to_ret;
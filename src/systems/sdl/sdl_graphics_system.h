@@ -40,6 +40,7 @@
 
 struct SDL_Surface;
 
+class DecodedImageCache;
 class Gameexe;
 class GraphicsObject;
 class SDLGraphicsSystem;
@@ -64,7 +65,9 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
 
   virtual void BeginFrame() override;
 
-  virtual void MarkScreenAsDirty(GraphicsUpdateType type) override;
+  using GraphicsSystem::MarkScreenAsDirty;
+  virtual void MarkScreenAsDirty(GraphicsUpdateType type,
+                                 const Rect& area) override;
 
   virtual void EndFrame() override;
 
@@ -73,6 +76,12 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
 
   virtual std::shared_ptr<Surface> EndFrameToSurface() override;
 
+  // Draws the frame with Shaders::GetTransitionProgram(). Only takes images
+  // that fit in a single texture, since the shader samples both at once.
+  virtual bool DrawTransition(const Surface& from,
+                              const Surface& to,
+                              const Transition& transition) override;
+
   virtual void ExecuteGraphicsSystem(RLMachine& machine) override;
 
   virtual void AllocateDC(int dc, Size screen_size) override;
@@ -99,9 +108,37 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
   // game.
   virtual void Reset() override;
 
+ protected:
+  // GraphicsSystem:
+  virtual bool CanRedrawPartially() override;
+  virtual void BeginPartialFrame(const Rect& area) override;
+  virtual bool CanCacheLayers() override;
+  virtual void BeginLayer() override;
+  virtual void EndLayer() override;
+  virtual void DrawLayer() override;
+  virtual void DescribeTextureMemory(std::ostream& tree) override;
+
  private:
   void SetupVideo();
 
+  // Sets up the projection and fixed function state every frame starts with.
+  void SetupFrameState();
+
+  // Starts uploading changes to the background surfaces, which are the ones
+  // grp operations modify, before the frame draws anything.
+  void StartBackgroundUploads();
+
+  // Draws the snapshot of the last frame taken in EndFrame().
+  void DrawScreenContents();
+
+  // Draws |texture|, which is laid out like |screen_contents_texture_|, over
+  // the whole screen.
+  void DrawScreenTexture(GLuint texture);
+
+  // Creates the framebuffer object for the cached layer, if the driver has
+  // them.
+  void SetupLayer();
+
   // Makes sure that a passed in dc number is valid.
   //
   // @exception Error Throws when dc is greater then the maximum.
@@ -110,6 +147,10 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
 
   void SetWindowTitle();
 
+  // Returns the on disk cache of decoded images, creating it the first time
+  // it's needed, or NULL if the user didn't ask for one with --image-cache.
+  DecodedImageCache* GetDecodedImageCache();
+
   // NotificationObserver:
   virtual void Observe(NotificationType type,
                        const NotificationSource& source,
@@ -130,6 +171,9 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
   // The last time the titlebar was updated (in GetTicks())
   unsigned int time_of_last_titlebar_update_;
 
+  // The last time the screen was refreshed (in GetTicks())
+  unsigned int time_of_last_refresh_;
+
   // The last seen number;
   int last_seen_number_;
 
@@ -160,6 +204,21 @@ class SDLGraphicsSystem : public GraphicsSystem, public NotificationObserver {
   int screen_tex_width_;
   int screen_tex_height_;
 
+  // Offscreen framebuffer the static bottom of the scene is cached in, and
+  // the texture (the same size as |screen_contents_texture_|) it renders to.
+  // Zero without GL_EXT_framebuffer_object.
+  GLuint layer_framebuffer_;
+  GLuint layer_texture_;
+
+  // The area the current frame is clipped to, or empty when it's drawn in
+  // full.
+  Rect partial_area_;
+
+  // Optional persistent cache of decoded G00/PDT data. Built lazily because
+  // it lives in the game's save directory.
+  std::unique_ptr<DecodedImageCache> decoded_image_cache_;
+  bool decoded_image_cache_checked_;
+
   NotificationRegistrar registrar_;
 };
 
@@ -87,6 +87,9 @@ class SDLRenderToTextureSurface : public Surface, public NotificationObserver {
 
   virtual Surface* Clone() const override;
 
+  // The screenshot, or NULL once it's been dropped.
+  Texture* texture() const { return texture_.get(); }
+
   // NotificationObserver:
   virtual void Observe(NotificationType type,
                        const NotificationSource& source,
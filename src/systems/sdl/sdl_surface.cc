@@ -42,119 +42,48 @@
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/texture.h"
 #include "utilities/graphics.h"
+#include "utilities/pixel_conversion.h"
+#include "xclannad/file.h"
 
 namespace {
 
-// An interface to TransformSurface that maps one color to another.
-class ColourTransformer {
- public:
-  virtual ~ColourTransformer() {}
-  virtual SDL_Color operator()(const SDL_Color& colour) const = 0;
-};
-
-class ToneCurveColourTransformer : public ColourTransformer {
- public:
-  explicit ToneCurveColourTransformer(const ToneCurveRGBMap m) : colormap(m) {}
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    SDL_Color out = {colormap[0][colour.r], colormap[1][colour.g],
-                     colormap[2][colour.b], 0};
-    return out;
-  }
-
- private:
-  ToneCurveRGBMap colormap;
-};
-
-class InvertColourTransformer : public ColourTransformer {
- public:
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    SDL_Color out = {255 - colour.r, 255 - colour.g, 255 - colour.b, 0};
-    return out;
-  }
-};
-
-class MonoColourTransformer : public ColourTransformer {
- public:
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    float grayscale = 0.3 * colour.r + 0.59 * colour.g + 0.11 * colour.b;
-    Clamp(grayscale, 0, 255);
-    SDL_Color out = {grayscale, grayscale, grayscale, 0};
-    return out;
-  }
-};
-
-class ApplyColourTransformer : public ColourTransformer {
- public:
-  explicit ApplyColourTransformer(const RGBColour& colour) : colour_(colour) {}
-
-  int compose(int in_colour, int surface_colour) const {
-    if (in_colour > 0) {
-      return 255 -
-             ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
-               (255 * 255)) *
-              255);
-    } else if (in_colour < 0) {
-      return (static_cast<float>(abs(in_colour) * surface_colour) /
-              (255 * 255)) *
-             255;
-    } else {
-      return surface_colour;
-    }
-  }
-
-  virtual SDL_Color operator()(const SDL_Color& colour) const {
-    SDL_Color out = {
-        compose(colour_.r(), colour.r), compose(colour_.g(), colour.g),
-        compose(colour_.b(), colour.b), 0};
-    return out;
+// The #colour operation on a single channel value.
+int ComposeColour(int in_colour, int surface_colour) {
+  if (in_colour > 0) {
+    return 255 -
+           ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
+             (255 * 255)) *
+            255);
+  } else if (in_colour < 0) {
+    return (static_cast<float>(abs(in_colour) * surface_colour) /
+            (255 * 255)) *
+           255;
+  } else {
+    return surface_colour;
   }
+}
 
- private:
-  RGBColour colour_;
-};
-
-// Applies a |transformer| to every pixel in |area| in the surface |surface|.
+// Runs |kernel| over each row of |area| in |our_surface|. The colour
+// operations work on the pixels in place with the kernels from
+// pixel_conversion.h, which need 32-bit pixels with 8-bit channels; every
+// surface we build has that layout (see buildNewSurface()).
+template <typename RowKernel>
 void TransformSurface(SDLSurface* our_surface,
                       const Rect& area,
-                      const ColourTransformer& transformer) {
+                      const RowKernel& kernel) {
   SDL_Surface* surface = our_surface->rawSurface();
-  SDL_Color colour;
-  Uint32 col = 0;
-
-  // determine position
-  char* p_position = (char*)surface->pixels;
-
-  // offset by y
-  p_position += (surface->pitch * area.y());
+  const SDL_PixelFormat* format = surface->format;
+  if (format->BytesPerPixel != 4 || format->Rloss || format->Gloss ||
+      format->Bloss) {
+    throw SystemError("Colour operation on a surface that isn't 32-bit");
+  }
 
   SDL_LockSurface(surface);
-  {
-    for (int y = 0; y < area.height(); ++y) {
-      // advance forward x
-      p_position += (surface->format->BytesPerPixel * area.x());
-
-      for (int x = 0; x < area.width(); ++x) {
-        // copy pixel data
-        memcpy(&col, p_position, surface->format->BytesPerPixel);
-
-        // Before someone tries to simplify the following four lines,
-        // remember that sizeof(int) != sizeof(Uint8).
-        Uint8 alpha;
-        SDL_GetRGBA(
-            col, surface->format, &colour.r, &colour.g, &colour.b, &alpha);
-        SDL_Color out = transformer(colour);
-        Uint32 out_colour =
-            SDL_MapRGBA(surface->format, out.r, out.g, out.b, alpha);
-
-        memcpy(p_position, &out_colour, surface->format->BytesPerPixel);
-
-        p_position += surface->format->BytesPerPixel;
-      }
-
-      // advance forward image_width - area.width() - x
-      int advance = surface->w - area.x() - area.width();
-      p_position += (surface->format->BytesPerPixel * advance);
-    }
+  char* row = static_cast<char*>(surface->pixels) +
+              surface->pitch * area.y() + 4 * area.x();
+  for (int y = 0; y < area.height(); ++y) {
+    kernel(reinterpret_cast<uint32_t*>(row), area.width(), *format);
+    row += surface->pitch;
   }
   SDL_UnlockSurface(surface);
 
@@ -162,6 +91,19 @@ void TransformSurface(SDLSurface* our_surface,
   our_surface->markWrittenTo(our_surface->GetRect());
 }
 
+// Maps each colour channel through the matching one of |tables|.
+void TransformSurfaceChannels(SDLSurface* our_surface,
+                              const Rect& area,
+                              const ToneCurveRGBMap& tables) {
+  TransformSurface(
+      our_surface, area,
+      [&](uint32_t* row, int count, const SDL_PixelFormat& format) {
+        MapColourChannels(row, count, tables[0].data(), tables[1].data(),
+                          tables[2].data(), format.Rshift, format.Gshift,
+                          format.Bshift);
+      });
+}
+
 }  // namespace
 
 // -----------------------------------------------------------------------
@@ -256,6 +198,7 @@ void SDLSurface::TextureRecord::forceUnload() { texture.reset(); }
 
 SDLSurface::SDLSurface(SDLGraphicsSystem* system)
     : surface_(NULL),
+      regions_left_to_decode_(0),
       texture_is_valid_(false),
       is_dc0_(false),
       graphics_system_(system),
@@ -267,6 +210,7 @@ SDLSurface::SDLSurface(SDLGraphicsSystem* system)
 
 SDLSurface::SDLSurface(SDLGraphicsSystem* system, SDL_Surface* surf)
     : surface_(surf),
+      regions_left_to_decode_(0),
       texture_is_valid_(false),
       is_dc0_(false),
       graphics_system_(system),
@@ -283,6 +227,7 @@ SDLSurface::SDLSurface(SDLGraphicsSystem* system,
                        const std::vector<SDLSurface::GrpRect>& region_table)
     : surface_(surf),
       region_table_(region_table),
+      regions_left_to_decode_(0),
       texture_is_valid_(false),
       is_dc0_(false),
       graphics_system_(system),
@@ -294,6 +239,7 @@ SDLSurface::SDLSurface(SDLGraphicsSystem* system,
 
 SDLSurface::SDLSurface(SDLGraphicsSystem* system, const Size& size)
     : surface_(NULL),
+      regions_left_to_decode_(0),
       texture_is_valid_(false),
       is_dc0_(false),
       graphics_system_(system),
@@ -312,6 +258,32 @@ void SDLSurface::EnsureUploaded() const {
 
 // -----------------------------------------------------------------------
 
+Texture* SDLSurface::GetSingleTexture() const {
+  decodePendingRegions(Rect(Point(0, 0), GetSize()));
+  uploadTextureIfNeeded();
+  return textures_.size() == 1 ? textures_[0].texture.get() : NULL;
+}
+
+// -----------------------------------------------------------------------
+
+uint64_t SDLSurface::GetTextureMemoryUsage() const {
+  uint64_t bytes = 0;
+  for (const TextureRecord& record : textures_) {
+    if (record.texture)
+      bytes += record.texture->memory_usage();
+  }
+  return bytes;
+}
+
+// -----------------------------------------------------------------------
+
+void SDLSurface::UploadPendingChanges() const {
+  if (!texture_is_valid_ && !textures_.empty() && !pending_regions_)
+    uploadTextureIfNeeded();
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::registerForNotification(GraphicsSystem* system) {
   registrar_.Add(this,
                  NotificationType::FULLSCREEN_STATE_CHANGED,
@@ -346,7 +318,69 @@ Size SDLSurface::GetSize() const {
 
 // -----------------------------------------------------------------------
 
+void SDLSurface::setPendingRegions(std::shared_ptr<G00RegionDecoder> decoder) {
+  pending_regions_ = decoder;
+  region_is_decoded_.assign(decoder->RegionCount(), false);
+  regions_left_to_decode_ = decoder->RegionCount();
+  if (regions_left_to_decode_ == 0)
+    pending_regions_.reset();
+}
+
+// -----------------------------------------------------------------------
+
+void SDLSurface::decodePendingRegions(const Rect& area) const {
+  if (!pending_regions_)
+    return;
+
+  for (int i = 0; i < pending_regions_->RegionCount(); ++i) {
+    const G00RegionDecoder::Area& region_area = pending_regions_->RegionArea(i);
+    if (!region_is_decoded_[i] &&
+        Rect::GRP(region_area.x1, region_area.y1, region_area.x2,
+                  region_area.y2).Intersects(area)) {
+      decodePendingRegion(i);
+      if (!pending_regions_)
+        return;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------
+
+void SDLSurface::decodeAllPendingRegions() const {
+  for (int i = 0; pending_regions_; ++i)
+    decodePendingRegion(i);
+}
+
+// -----------------------------------------------------------------------
+
+void SDLSurface::decodePendingRegion(int region) const {
+  if (!pending_regions_ || region < 0 || region >= region_is_decoded_.size() ||
+      region_is_decoded_[region])
+    return;
+
+  SDL_LockSurface(surface_);
+  pending_regions_->CopyRegion(region, static_cast<char*>(surface_->pixels));
+  SDL_UnlockSurface(surface_);
+  region_is_decoded_[region] = true;
+
+  // The same as markWrittenTo(), which we can't call from const methods.
+  // Image surfaces are never DC0.
+  const G00RegionDecoder::Area& area = pending_regions_->RegionArea(region);
+  dirty_rectangle_ = dirty_rectangle_.RectUnion(
+      Rect::GRP(area.x1, area.y1, area.x2, area.y2));
+  texture_is_valid_ = false;
+
+  if (--regions_left_to_decode_ == 0) {
+    pending_regions_.reset();
+    region_is_decoded_.clear();
+  }
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::Dump() {
+  decodeAllPendingRegions();
+
   static int count = 0;
   std::ostringstream ss;
   ss << "dump_" << count << ".bmp";
@@ -374,6 +408,9 @@ void SDLSurface::allocate(const Size& size, bool is_dc0) {
 // -----------------------------------------------------------------------
 
 void SDLSurface::deallocate() {
+  pending_regions_.reset();
+  region_is_decoded_.clear();
+  regions_left_to_decode_ = 0;
   textures_.clear();
   if (surface_) {
     SDL_FreeSurface(surface_);
@@ -389,6 +426,8 @@ void SDLSurface::BlitToSurface(Surface& dest_surface,
                                int alpha,
                                bool use_src_alpha) const {
   SDLSurface& sdl_dest_surface = dynamic_cast<SDLSurface&>(dest_surface);
+  decodePendingRegions(src);
+  sdl_dest_surface.decodePendingRegions(dst);
 
   SDL_Rect src_rect, dest_rect;
   RectToSDLRect(src, &src_rect);
@@ -441,6 +480,8 @@ void SDLSurface::blitFROMSurface(SDL_Surface* src_surface,
                                  const Rect& dst,
                                  int alpha,
                                  bool use_src_alpha) {
+  decodePendingRegions(dst);
+
   SDL_Rect src_rect, dest_rect;
   RectToSDLRect(src, &src_rect);
   RectToSDLRect(dst, &dest_rect);
@@ -573,6 +614,7 @@ void SDLSurface::uploadTextureIfNeeded() const {
 void SDLSurface::RenderToScreen(const Rect& src,
                                 const Rect& dst,
                                 int alpha) const {
+  decodePendingRegions(src);
   uploadTextureIfNeeded();
 
   for (std::vector<TextureRecord>::iterator it = textures_.begin();
@@ -584,10 +626,30 @@ void SDLSurface::RenderToScreen(const Rect& src,
 
 // -----------------------------------------------------------------------
 
+void SDLSurface::RenderManyToScreen(const std::vector<Rect>& srcs,
+                                    const std::vector<Rect>& dsts,
+                                    int alpha) const {
+  for (const Rect& src : srcs)
+    decodePendingRegions(src);
+  uploadTextureIfNeeded();
+
+  // Consecutive quads from the same texture are merged by SpriteRenderer, so
+  // this goes out as one draw call per texture.
+  for (std::vector<TextureRecord>::iterator it = textures_.begin();
+       it != textures_.end();
+       ++it) {
+    for (size_t i = 0; i < srcs.size(); ++i)
+      it->texture->RenderToScreen(srcs[i], dsts[i], alpha);
+  }
+}
+
+// -----------------------------------------------------------------------
+
 void SDLSurface::RenderToScreenAsColorMask(const Rect& src,
                                            const Rect& dst,
                                            const RGBAColour& rgba,
                                            int filter) const {
+  decodePendingRegions(src);
   uploadTextureIfNeeded();
 
   for (std::vector<TextureRecord>::iterator it = textures_.begin();
@@ -602,6 +664,7 @@ void SDLSurface::RenderToScreenAsColorMask(const Rect& src,
 void SDLSurface::RenderToScreen(const Rect& src,
                                 const Rect& dst,
                                 const int opacity[4]) const {
+  decodePendingRegions(src);
   uploadTextureIfNeeded();
 
   for (std::vector<TextureRecord>::iterator it = textures_.begin();
@@ -617,6 +680,7 @@ void SDLSurface::RenderToScreenAsObject(const GraphicsObject& rp,
                                         const Rect& src,
                                         const Rect& dst,
                                         int alpha) const {
+  decodePendingRegions(src);
   uploadTextureIfNeeded();
 
   for (std::vector<TextureRecord>::iterator it = textures_.begin();
@@ -629,6 +693,11 @@ void SDLSurface::RenderToScreenAsObject(const GraphicsObject& rp,
 // -----------------------------------------------------------------------
 
 void SDLSurface::Fill(const RGBAColour& colour) {
+  // Nothing pending would survive this.
+  pending_regions_.reset();
+  region_is_decoded_.clear();
+  regions_left_to_decode_ = 0;
+
   // Fill the entire surface with the incoming colour
   Uint32 sdl_colour = MapRGBA(surface_->format, colour);
 
@@ -642,6 +711,8 @@ void SDLSurface::Fill(const RGBAColour& colour) {
 // -----------------------------------------------------------------------
 
 void SDLSurface::Fill(const RGBAColour& colour, const Rect& area) {
+  decodePendingRegions(area);
+
   // Fill the entire surface with the incoming colour
   Uint32 sdl_colour = MapRGBA(surface_->format, colour);
 
@@ -658,29 +729,43 @@ void SDLSurface::Fill(const RGBAColour& colour, const Rect& area) {
 // -----------------------------------------------------------------------
 
 void SDLSurface::Invert(const Rect& rect) {
-  InvertColourTransformer inverter;
-  TransformSurface(this, rect, inverter);
+  decodePendingRegions(rect);
+  TransformSurface(
+      this, rect, [](uint32_t* row, int count, const SDL_PixelFormat& format) {
+        InvertColourChannels(row, count,
+                             format.Rmask | format.Gmask | format.Bmask);
+      });
 }
 
 // -----------------------------------------------------------------------
 
 void SDLSurface::Mono(const Rect& rect) {
-  MonoColourTransformer mono;
-  TransformSurface(this, rect, mono);
+  decodePendingRegions(rect);
+  TransformSurface(
+      this, rect, [](uint32_t* row, int count, const SDL_PixelFormat& format) {
+        MonoColourChannels(row, count, format.Rshift, format.Gshift,
+                           format.Bshift);
+      });
 }
 
 // -----------------------------------------------------------------------
 
 void SDLSurface::ToneCurve(const ToneCurveRGBMap effect, const Rect& area) {
-  ToneCurveColourTransformer tc(effect);
-  TransformSurface(this, area, tc);
+  decodePendingRegions(area);
+  TransformSurfaceChannels(this, area, effect);
 }
 
 // -----------------------------------------------------------------------
 
 void SDLSurface::ApplyColour(const RGBColour& colour, const Rect& area) {
-  ApplyColourTransformer apply(colour);
-  TransformSurface(this, area, apply);
+  decodePendingRegions(area);
+  ToneCurveRGBMap tables;
+  for (int i = 0; i < 256; ++i) {
+    tables[0][i] = ComposeColour(colour.r(), i);
+    tables[1][i] = ComposeColour(colour.g(), i);
+    tables[2][i] = ComposeColour(colour.b(), i);
+  }
+  TransformSurfaceChannels(this, area, tables);
 }
 
 // -----------------------------------------------------------------------
@@ -690,6 +775,9 @@ int SDLSurface::GetNumPatterns() const { return region_table_.size(); }
 // -----------------------------------------------------------------------
 
 const SDLSurface::GrpRect& SDLSurface::GetPattern(int patt_no) const {
+  // Asking for a pattern is a good sign it's about to be drawn.
+  decodePendingRegion(patt_no);
+
   if (patt_no < region_table_.size())
     return region_table_[patt_no];
   else
@@ -699,6 +787,8 @@ const SDLSurface::GrpRect& SDLSurface::GetPattern(int patt_no) const {
 // -----------------------------------------------------------------------
 
 Surface* SDLSurface::Clone() const {
+  decodeAllPendingRegions();
+
   SDL_Surface* tmp_surface =
       SDL_CreateRGBSurface(surface_->flags,
                            surface_->w,
@@ -752,6 +842,8 @@ std::vector<int> SDLSurface::segmentPicture(int size_remainging) {
 // -----------------------------------------------------------------------
 
 void SDLSurface::GetDCPixel(const Point& pos, int& r, int& g, int& b) const {
+  decodePendingRegions(Rect(pos, Size(1, 1)));
+
   SDL_Color colour;
   Uint32 col = 0;
 
@@ -782,6 +874,7 @@ std::shared_ptr<Surface> SDLSurface::ClipAsColorMask(const Rect& clip_rect,
                                                        int g,
                                                        int b) const {
   const char* function_name = "SDLGraphicsSystem::ClipAsColorMask()";
+  decodePendingRegions(clip_rect);
 
   // TODO(erg): This needs to be made exception safe and so does the rest
   // of this file.
@@ -817,7 +910,7 @@ std::shared_ptr<Surface> SDLSurface::ClipAsColorMask(const Rect& clip_rect,
 void SDLSurface::markWrittenTo(const Rect& written_rect) {
   // If we are marked as dc0, alert the SDLGraphicsSystem.
   if (is_dc0_ && graphics_system_) {
-    graphics_system_->MarkScreenAsDirty(GUT_DRAW_DC0);
+    graphics_system_->MarkScreenAsDirty(GUT_DRAW_DC0, written_rect);
   }
 
   // Mark that the texture needs reuploading
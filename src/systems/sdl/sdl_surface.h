@@ -28,6 +28,7 @@
 #ifndef SRC_SYSTEMS_SDL_SDL_SURFACE_H_
 #define SRC_SYSTEMS_SDL_SDL_SURFACE_H_
 
+#include <memory>
 #include <vector>
 
 #include "base/notification_observer.h"
@@ -36,6 +37,7 @@
 #include "systems/base/tone_curve.h"
 
 struct SDL_Surface;
+class G00RegionDecoder;
 class Texture;
 class GraphicsSystem;
 class SDLGraphicsSystem;
@@ -68,6 +70,15 @@ class SDLSurface : public Surface, public NotificationObserver {
   ~SDLSurface();
 
   virtual void EnsureUploaded() const override;
+  virtual uint64_t GetTextureMemoryUsage() const override;
+
+  // Uploads changes to textures that already exist, so that the transfer can
+  // get going before anything is drawn with them. Doesn't create textures.
+  void UploadPendingChanges() const;
+
+  // Uploads the whole surface and returns its texture, or NULL if it's too
+  // big to fit in just one.
+  Texture* GetSingleTexture() const;
 
   void registerForNotification(GraphicsSystem* system);
 
@@ -78,6 +89,12 @@ class SDLSurface : public Surface, public NotificationObserver {
 
   void buildRegionTable(const Size& size);
 
+  // Defers filling in this (blank) surface from |decoder|: each region is
+  // copied in the first time something reads or writes its part of the
+  // surface, so a sprite sheet where only a few patterns are ever shown never
+  // pays for converting the rest. |decoder|'s regions must not overlap.
+  void setPendingRegions(std::shared_ptr<G00RegionDecoder> decoder);
+
   virtual void Dump() override;
 
   void allocate(const Size& size);
@@ -104,6 +121,10 @@ class SDLSurface : public Surface, public NotificationObserver {
                               const Rect& dst,
                               int alpha = 255) const override;
 
+  virtual void RenderManyToScreen(const std::vector<Rect>& srcs,
+                                  const std::vector<Rect>& dsts,
+                                  int alpha) const override;
+
   virtual void RenderToScreenAsColorMask(const Rect& src,
                                          const Rect& dst,
                                          const RGBAColour& rgba,
@@ -195,12 +216,25 @@ class SDLSurface : public Surface, public NotificationObserver {
 
   static std::vector<int> segmentPicture(int size_remainging);
 
+  // Copies in any pending regions which intersect |area|, or all of them.
+  // Must be called before touching the pixels in surface_.
+  void decodePendingRegions(const Rect& area) const;
+  void decodeAllPendingRegions() const;
+  void decodePendingRegion(int region) const;
+
   // The SDL_Surface that contains the software version of the bitmap.
   SDL_Surface* surface_;
 
   // The region table
   std::vector<GrpRect> region_table_;
 
+  // Decompressed regions which haven't been copied into surface_ yet (see
+  // setPendingRegions()), and which of them have been. Released once every
+  // region has been copied.
+  mutable std::shared_ptr<G00RegionDecoder> pending_regions_;
+  mutable std::vector<bool> region_is_decoded_;
+  mutable int regions_left_to_decode_;
+
   // The SDLTexture which wraps one or more OpenGL textures
   mutable std::vector<TextureRecord> textures_;
 
@@ -45,6 +45,9 @@
 // -----------------------------------------------------------------------
 
 SDLSystem::SDLSystem(Gameexe& gameexe) : System(), gameexe_(gameexe) {
+  // Index the game files while SDL and the subsystems start up.
+  StartBuildingFileIndex();
+
   // First, initialize SDL's video subsystem.
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     std::ostringstream ss;
@@ -29,6 +29,7 @@
 
 #include <SDL/SDL_ttf.h>
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
@@ -46,9 +47,14 @@
 #include "utilities/exception.h"
 #include "utilities/find_font_file.h"
 #include "libreallive/gameexe.h"
+#include "utf8cpp/utf8.h"
 
 SDLTextSystem::SDLTextSystem(SDLSystem& system, Gameexe& gameexe)
-    : TextSystem(system, gameexe), sdl_system_(system) {
+    : TextSystem(system, gameexe),
+      sdl_system_(system),
+      glyph_cache_(1024, 4),
+      glyphs_rendered_(0),
+      glyph_render_us_(0) {
   if (TTF_Init() == -1) {
     std::ostringstream oss;
     oss << "Error initializing SDL_ttf: " << TTF_GetError();
@@ -81,8 +87,133 @@ Size SDLTextSystem::RenderGlyphOnto(
     int insertion_point_x,
     int insertion_point_y,
     const std::shared_ptr<Surface>& destination) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
   SDLSurface* sdl_surface = static_cast<SDLSurface*>(destination.get());
+  SDL_Surface* surface = sdl_surface->rawSurface();
+  Point insertion(insertion_point_x, insertion_point_y);
+  if (!sdl_system_.text().font_shadow())
+    shadow_colour = NULL;
+
+  Size size;
+  const GlyphCache::Glyph* glyph = GetGlyph(current, font_size, italic);
+  if (glyph && surface->format->BytesPerPixel == 4) {
+    const SDL_PixelFormat* format = surface->format;
+    GlyphCache::Target target;
+    target.pitch = surface->pitch;
+    target.size = Size(surface->w, surface->h);
+    target.red_shift = format->Rshift;
+    target.green_shift = format->Gshift;
+    target.blue_shift = format->Bshift;
+    target.alpha_shift = format->Ashift;
+    target.has_alpha = format->Amask != 0;
+
+    SDL_LockSurface(surface);
+    target.pixels = static_cast<uint8_t*>(surface->pixels);
+    if (shadow_colour) {
+      glyph_cache_.Composite(
+          *glyph, *shadow_colour, insertion + Point(2, 2), target);
+    }
+    glyph_cache_.Composite(*glyph, font_colour, insertion, target);
+    SDL_UnlockSurface(surface);
+
+    size = glyph->cell;
+    if (shadow_colour)
+      sdl_surface->markWrittenTo(Rect(insertion + Point(2, 2), size));
+    sdl_surface->markWrittenTo(Rect(insertion, size));
+  } else {
+    size = RenderUncachedGlyphOnto(current, font_size, italic, font_colour,
+                                   shadow_colour, insertion, sdl_surface);
+  }
+
+  glyphs_rendered_++;
+  glyph_render_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start).count();
+  return size;
+}
+
+int SDLTextSystem::MeasureCharWidth(int size, uint16_t codepoint) {
+  return MeasureAdvance(GetFontOfSize(size).get(), codepoint);
+}
+
+int SDLTextSystem::MeasureAdvance(TTF_Font* font, uint16_t codepoint) {
+  int minx, maxx, miny, maxy;
+  int advance = 0;
+  TTF_GlyphMetrics(font, codepoint, &minx, &maxx, &miny, &maxy, &advance);
+  return advance;
+}
+
+int SDLTextSystem::glyphs_per_second() const {
+  if (glyph_render_us_ == 0)
+    return 0;
+  return glyphs_rendered_ * 1000000 / glyph_render_us_;
+}
+
+const GlyphCache::Glyph* SDLTextSystem::GetGlyph(const std::string& current,
+                                                 int font_size,
+                                                 bool italic) {
+  // The cache holds single characters; anything else goes straight to
+  // SDL_ttf.
+  if (current.empty() || !utf8::is_valid(current.begin(), current.end()))
+    return NULL;
+  std::string::const_iterator it = current.begin();
+  uint32_t codepoint = utf8::next(it, current.end());
+  if (it != current.end())
+    return NULL;
+
+  int style = italic ? TTF_STYLE_ITALIC : TTF_STYLE_NORMAL;
+  GlyphCache::Key key(font_size, style, codepoint);
+  const GlyphCache::Glyph* glyph = glyph_cache_.Find(key);
+  if (glyph)
+    return glyph;
+
+  std::shared_ptr<TTF_Font> font = GetFontOfSize(font_size);
+
+  // Text windows ask for the advance of each character right after drawing
+  // it, so measure it now while we have the font.
+  if (!italic && codepoint <= 0xffff &&
+      font_metrics().Advance(font_size, TTF_STYLE_NORMAL, codepoint) ==
+          FontMetrics::kUnknown) {
+    StoreCharWidth(font_size, codepoint, MeasureAdvance(font.get(), codepoint));
+  }
+
+  // Rasterize in white; only the coverage in the alpha channel is kept.
+  if (italic) {
+    TTF_SetFontStyle(font.get(), TTF_STYLE_ITALIC);
+  }
+  SDL_Color white = {255, 255, 255, 0};
+  std::shared_ptr<SDL_Surface> character(
+      TTF_RenderUTF8_Blended(font.get(), current.c_str(), white),
+      SDL_FreeSurface);
+  if (italic) {
+    TTF_SetFontStyle(font.get(), TTF_STYLE_NORMAL);
+  }
+  if (character == NULL || character->format->BytesPerPixel != 4)
+    return NULL;
+
+  std::vector<uint8_t> coverage(character->w * character->h);
+  SDL_LockSurface(character.get());
+  for (int y = 0; y < character->h; ++y) {
+    const uint32_t* row = reinterpret_cast<const uint32_t*>(
+        static_cast<const char*>(character->pixels) + y * character->pitch);
+    for (int x = 0; x < character->w; ++x) {
+      coverage[y * character->w + x] =
+          (row[x] & character->format->Amask) >> character->format->Ashift;
+    }
+  }
+  SDL_UnlockSurface(character.get());
+
+  return glyph_cache_.Store(key, character->w, character->h, coverage.data(),
+                            character->w);
+}
 
+Size SDLTextSystem::RenderUncachedGlyphOnto(const std::string& current,
+                                            int font_size,
+                                            bool italic,
+                                            const RGBColour& font_colour,
+                                            const RGBColour* shadow_colour,
+                                            const Point& insertion,
+                                            SDLSurface* sdl_surface) {
   std::shared_ptr<TTF_Font> font = GetFontOfSize(font_size);
 
   if (italic) {
@@ -96,6 +227,10 @@ Size SDLTextSystem::RenderGlyphOnto(
       SDL_FreeSurface);
 
   if (character == NULL) {
+    if (italic) {
+      TTF_SetFontStyle(font.get(), TTF_STYLE_NORMAL);
+    }
+
     // Bug during Kyou's path. The string is printed "". Regression in parser?
     std::cerr << "WARNING. TTF_RenderUTF8_Blended didn't render the "
               << "character \"" << current << "\". Hopefully continuing..."
@@ -104,7 +239,7 @@ Size SDLTextSystem::RenderGlyphOnto(
   }
 
   std::shared_ptr<SDL_Surface> shadow;
-  if (shadow_colour && sdl_system_.text().font_shadow()) {
+  if (shadow_colour) {
     SDL_Color sdl_shadow_colour;
     RGBColourToSDLColor(*shadow_colour, &sdl_shadow_colour);
 
@@ -117,8 +252,6 @@ Size SDLTextSystem::RenderGlyphOnto(
     TTF_SetFontStyle(font.get(), TTF_STYLE_NORMAL);
   }
 
-  Point insertion(insertion_point_x, insertion_point_y);
-
   if (shadow) {
     Size offset(shadow->w, shadow->h);
     sdl_surface->blitFROMSurface(shadow.get(),
@@ -133,13 +266,6 @@ Size SDLTextSystem::RenderGlyphOnto(
   return size;
 }
 
-int SDLTextSystem::GetCharWidth(int size, uint16_t codepoint) {
-  std::shared_ptr<TTF_Font> font = GetFontOfSize(size);
-  int minx, maxx, miny, maxy, advance;
-  TTF_GlyphMetrics(font.get(), codepoint, &minx, &maxx, &miny, &maxy, &advance);
-  return advance;
-}
-
 std::shared_ptr<TTF_Font> SDLTextSystem::GetFontOfSize(int size) {
   FontSizeMap::iterator it = map_.find(size);
   if (it == map_.end()) {
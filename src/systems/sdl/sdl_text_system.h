@@ -30,13 +30,16 @@
 
 #include <SDL/SDL_ttf.h>
 
+#include <cstdint>
 #include <map>
 #include <string>
 
+#include "systems/base/glyph_cache.h"
 #include "systems/base/text_system.h"
 
 class Point;
 class RLMachine;
+class SDLSurface;
 class SDLSystem;
 class SDLTextWindow;
 class TextWindow;
@@ -56,19 +59,51 @@ class SDLTextSystem : public TextSystem {
                                int insertion_point_x,
                                int insertion_point_y,
                                const std::shared_ptr<Surface>& destination) override;
-  virtual int GetCharWidth(int size, uint16_t codepoint) override;
   bool FontIsMonospaced() override;
 
   // Returns (and caches) a SDL_ttf font object for a font of |size|.
   std::shared_ptr<TTF_Font> GetFontOfSize(int size);
 
+  const GlyphCache& glyph_cache() const { return glyph_cache_; }
+
+  // How many glyphs RenderGlyphOnto() draws per second of its own time.
+  int glyphs_per_second() const;
+
  private:
+  // Returns the cached glyph for |current|, rasterizing it if needed, or
+  // NULL if |current| isn't a single character the cache can hold.
+  const GlyphCache::Glyph* GetGlyph(const std::string& current,
+                                    int font_size,
+                                    bool italic);
+
+  // Overridden from TextSystem:
+  virtual int MeasureCharWidth(int size, uint16_t codepoint) override;
+
+  // Asks SDL_ttf for the advance of |codepoint| in |font|.
+  int MeasureAdvance(TTF_Font* font, uint16_t codepoint);
+
+  // Draws |current| with SDL_ttf and blits it, without the cache.
+  Size RenderUncachedGlyphOnto(const std::string& current,
+                               int font_size,
+                               bool italic,
+                               const RGBColour& font_colour,
+                               const RGBColour* shadow_colour,
+                               const Point& insertion,
+                               SDLSurface* destination);
+
   // Font storage.
   typedef std::map<int, std::shared_ptr<TTF_Font>> FontSizeMap;
   FontSizeMap map_;
 
   SDLSystem& sdl_system_;
 
+  // Rasterized glyphs of the one font we use.
+  GlyphCache glyph_cache_;
+
+  // Glyphs drawn, and the time spent drawing them.
+  int64_t glyphs_rendered_;
+  int64_t glyph_render_us_;
+
   std::unique_ptr<bool> is_monospace_;
 };
 
@@ -30,7 +30,6 @@
 #include <iostream>
 #endif
 
-#include "systems/base/graphics_object.h"
 #include "systems/base/system_error.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/shaders.h"
@@ -49,14 +48,14 @@ const char kColorMaskShader[] =
     "                     0.0, 1.0);"
     "}";
 
+// Everything but the image comes in per vertex (see SpriteVertex), so one
+// draw call can cover objects with different effects:
+//   gl_Color: vertex colour and alpha, multiplied in first
+//   gl_TexCoord[1]: #colour, blended in by its alpha
+//   gl_TexCoord[2]: tint in rgb, light in a
+//   gl_TexCoord[3]: mono in s, invert in t
 const char kObjectShader[] =
     "uniform sampler2D image;\n"
-    "uniform vec4 colour;\n"
-    "uniform float mono;\n"
-    "uniform float invert;\n"
-    "uniform float light;\n"
-    "uniform vec3 tint;\n"
-    "uniform float alpha;\n"
     "\n"
     "void tinter(in float pixel_val, in float tint_val, out float mixed) {\n"
     "  if (tint_val > 0.0) {\n"
@@ -69,7 +68,12 @@ const char kObjectShader[] =
     "}\n"
     "\n"
     "void main() {\n"
-    "  vec4 pixel = texture2D(image, gl_TexCoord[0].st);\n"
+    "  vec4 pixel = texture2D(image, gl_TexCoord[0].st) * gl_Color;\n"
+    "  vec4 colour = gl_TexCoord[1];\n"
+    "  vec3 tint = gl_TexCoord[2].rgb;\n"
+    "  float light = gl_TexCoord[2].a;\n"
+    "  float mono = gl_TexCoord[3].s;\n"
+    "  float invert = gl_TexCoord[3].t;\n"
     "\n"
     "  // The colour is blended directly with the incoming pixel value.\n"
     "  vec3 coloured = mix(pixel.rgb, colour.rgb, colour.a);\n"
@@ -99,11 +103,90 @@ const char kObjectShader[] =
     "  tinter(pixel.b, tint.b, out_b);\n"
     "  pixel = vec4(out_r, out_g, out_b, pixel.a);\n"
     "\n"
-    "  // We're responsible for doing the main alpha blending, too.\n"
-    "  pixel.a = pixel.a * alpha;\n"
     "  gl_FragColor = pixel;\n"
     "}\n";
 
+// Draws every pixel of a Transition frame. gl_TexCoord[0] is the screen
+// position; everything else is a uniform (see
+// SDLGraphicsSystem::DrawTransition()):
+//   from_image, to_image: the old and new images
+//   from_coords, to_coords: texture coordinates of image pixel p are
+//     xy + p * zw
+//   image_sizes: from width and height, then to width and height
+//   style: Transition::Style
+//   axis: axis_x, axis_y, axis_origin
+//   params: FADE: opacity; WIPE: edge, band; BLIND: blind_size, rows
+//   pane_images: the Transition::Image of each pane
+//   pane0_dst, pane0_src, pane1_dst, pane1_src: pane rectangles as
+//     (x1, y1, x2, y2)
+const char kTransitionShader[] =
+    "uniform sampler2D from_image, to_image;\n"
+    "uniform vec4 from_coords, to_coords, image_sizes;\n"
+    "uniform float style;\n"
+    "uniform vec3 axis;\n"
+    "uniform vec2 params, pane_images;\n"
+    "uniform vec4 pane0_dst, pane0_src, pane1_dst, pane1_src;\n"
+    "\n"
+    "// Pixel p of the old (1) or new (2) image; black outside it.\n"
+    "vec4 image_pixel(float image, vec2 p) {\n"
+    "  vec2 size = image == 1.0 ? image_sizes.xy : image_sizes.zw;\n"
+    "  if (image == 0.0 || p.x < 0.0 || p.y < 0.0 || p.x >= size.x ||\n"
+    "      p.y >= size.y)\n"
+    "    return vec4(0.0, 0.0, 0.0, 0.0);\n"
+    "  if (image == 1.0)\n"
+    "    return texture2D(from_image, from_coords.xy + p * from_coords.zw);\n"
+    "  return texture2D(to_image, to_coords.xy + p * to_coords.zw);\n"
+    "}\n"
+    "\n"
+    "// What glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) makes of top\n"
+    "// drawn over bottom.\n"
+    "vec4 over(vec4 top, vec4 bottom) {\n"
+    "  return top * top.a + bottom * (1.0 - top.a);\n"
+    "}\n"
+    "\n"
+    "vec4 pane(float image, vec4 dst, vec4 src, vec2 p, vec4 bottom) {\n"
+    "  if (image == 0.0 || p.x < dst.x || p.y < dst.y || p.x >= dst.z ||\n"
+    "      p.y >= dst.w)\n"
+    "    return bottom;\n"
+    "  vec2 scale = (src.zw - src.xy) / (dst.zw - dst.xy);\n"
+    "  vec2 q = src.xy + (p - dst.xy) * scale;\n"
+    "  return over(image_pixel(image, q), bottom);\n"
+    "}\n"
+    "\n"
+    "void main() {\n"
+    "  vec2 p = gl_TexCoord[0].st;\n"
+    "  vec4 colour = vec4(0.0, 0.0, 0.0, 1.0);\n"
+    "\n"
+    "  if (style == 3.0) {\n"
+    "    colour = pane(pane_images.x, pane0_dst, pane0_src, p, colour);\n"
+    "    colour = pane(pane_images.y, pane1_dst, pane1_src, p, colour);\n"
+    "  } else {\n"
+    "    colour = over(image_pixel(1.0, p), colour);\n"
+    "\n"
+    "    float position = dot(axis.xy, p) + axis.z;\n"
+    "    float coverage;\n"
+    "    if (style == 0.0) {\n"
+    "      coverage = params.x / 255.0;\n"
+    "    } else if (style == 1.0) {\n"
+    "      if (params.y <= 0.0)\n"
+    "        coverage = position < params.x ? 1.0 : 0.0;\n"
+    "      else\n"
+    "        coverage = clamp((params.x + params.y - position) / params.y,\n"
+    "                         0.0, 1.0);\n"
+    "    } else {\n"
+    "      float blind = floor(position / params.x);\n"
+    "      float shown = clamp(params.y - blind, 0.0, params.x);\n"
+    "      coverage = position - blind * params.x < shown ? 1.0 : 0.0;\n"
+    "    }\n"
+    "\n"
+    "    vec4 to = image_pixel(2.0, p);\n"
+    "    to.a *= coverage;\n"
+    "    colour = over(to, colour);\n"
+    "  }\n"
+    "\n"
+    "  gl_FragColor = colour;\n"
+    "}\n";
+
 }  // namespace
 
 GLuint Shaders::color_mask_program_object_id_ = 0;
@@ -112,12 +195,9 @@ GLint Shaders::color_mask_mask_ = 0;
 
 GLuint Shaders::object_program_object_id_ = 0;
 GLint Shaders::object_image_ = 0;
-GLint Shaders::object_colour_ = 0;
-GLint Shaders::object_tint_ = 0;
-GLint Shaders::object_light_ = 0;
-GLint Shaders::object_alpha_ = 0;
-GLint Shaders::object_mono_ = 0;
-GLint Shaders::object_invert_ = 0;
+
+GLuint Shaders::transition_program_object_id_ = 0;
+std::map<std::string, GLint> Shaders::transition_uniforms_;
 
 // static
 void Shaders::Reset() {
@@ -136,12 +216,14 @@ void Shaders::Reset() {
 
     object_program_object_id_ = 0;
     object_image_ = 0;
-    object_colour_ = 0;
-    object_tint_ = 0;
-    object_light_ = 0;
-    object_alpha_ = 0;
-    object_mono_ = 0;
-    object_invert_ = 0;
+  }
+
+  if (transition_program_object_id_) {
+    glDeleteObjectARB(transition_program_object_id_);
+    DebugShowGLErrors();
+
+    transition_program_object_id_ = 0;
+    transition_uniforms_.clear();
   }
 }
 
@@ -193,85 +275,26 @@ GLint Shaders::GetObjectUniformImage() {
   return object_image_;
 }
 
-void Shaders::loadObjectUniformFromGraphicsObject(const GraphicsObject& go) {
-  RGBAColour colour = go.colour();
-  glUniform4fARB(Shaders::GetObjectUniformColour(),
-                 colour.r_float(),
-                 colour.g_float(),
-                 colour.b_float(),
-                 colour.a_float());
-
-  RGBColour tint = go.tint();
-  glUniform3fARB(Shaders::GetObjectUniformTint(),
-                 tint.r_float(),
-                 tint.g_float(),
-                 tint.b_float());
-
-  glUniform1fARB(Shaders::GetObjectUniformLight(), go.light() / 255.0f);
-
-  glUniform1fARB(Shaders::GetObjectUniformMono(), go.mono() / 255.0f);
-
-  glUniform1fARB(Shaders::GetObjectUniformInvert(), go.invert() / 255.0f);
-}
-
-GLint Shaders::GetObjectUniformColour() {
-  if (object_colour_ == 0) {
-    object_colour_ = glGetUniformLocationARB(GetObjectProgram(), "colour");
-    if (object_colour_ == -1)
-      throw SystemError("Bad uniform value: colour");
+GLuint Shaders::GetTransitionProgram() {
+  if (transition_program_object_id_ == 0) {
+    buildShader(kTransitionShader, &transition_program_object_id_);
   }
 
-  return object_colour_;
+  return transition_program_object_id_;
 }
 
-GLint Shaders::GetObjectUniformTint() {
-  if (object_tint_ == 0) {
-    object_tint_ = glGetUniformLocationARB(GetObjectProgram(), "tint");
-    if (object_tint_ == -1)
-      throw SystemError("Bad uniform value: tint");
-  }
+GLint Shaders::GetTransitionUniform(const std::string& name) {
+  std::map<std::string, GLint>::iterator it = transition_uniforms_.find(name);
+  if (it != transition_uniforms_.end())
+    return it->second;
 
-  return object_tint_;
-}
-
-GLint Shaders::GetObjectUniformLight() {
-  if (object_light_ == 0) {
-    object_light_ = glGetUniformLocationARB(GetObjectProgram(), "light");
-    if (object_light_ == -1)
-      throw SystemError("Bad uniform value: light");
-  }
-
-  return object_light_;
-}
-
-GLint Shaders::GetObjectUniformAlpha() {
-  if (object_alpha_ == 0) {
-    object_alpha_ = glGetUniformLocationARB(GetObjectProgram(), "alpha");
-    if (object_alpha_ == -1)
-      throw SystemError("Bad uniform value: alpha");
-  }
-
-  return object_alpha_;
-}
-
-GLint Shaders::GetObjectUniformMono() {
-  if (object_mono_ == 0) {
-    object_mono_ = glGetUniformLocationARB(GetObjectProgram(), "mono");
-    if (object_mono_ == -1)
-      throw SystemError("Bad uniform value: mono");
-  }
-
-  return object_mono_;
-}
-
-GLint Shaders::GetObjectUniformInvert() {
-  if (object_invert_ == 0) {
-    object_invert_ = glGetUniformLocationARB(GetObjectProgram(), "invert");
-    if (object_invert_ == -1)
-      throw SystemError("Bad uniform value: invert");
-  }
+  GLint location =
+      glGetUniformLocationARB(GetTransitionProgram(), name.c_str());
+  if (location == -1)
+    throw SystemError("Bad uniform value: " + name);
 
-  return object_invert_;
+  transition_uniforms_[name] = location;
+  return location;
 }
 
 // static
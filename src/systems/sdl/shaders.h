@@ -29,7 +29,8 @@
 
 #include <SDL/SDL_opengl.h>
 
-class GraphicsObject;
+#include <map>
+#include <string>
 
 // Static state about shaders. We just leak them.
 class Shaders {
@@ -44,21 +45,19 @@ class Shaders {
   static GLint getColorMaskUniformCurrentValues();
   static GLint getColorMaskUniformMask();
 
-  // Returns the shader that implements tint/light/colour on objects.
+  // Returns the shader that implements tint/light/colour on objects. It takes
+  // its parameters per vertex; see SpriteRenderer.
   static GLuint GetObjectProgram();
 
-  // Returns the parameters to the object program.
+  // Returns the image sampler of the object program.
   static GLint GetObjectUniformImage();
-  static GLint GetObjectUniformAlpha();
 
-  // Set the colour/tint/light/mono/invert properties from |go|. (Individual
-  // setters also exposed.)
-  static void loadObjectUniformFromGraphicsObject(const GraphicsObject& go);
-  static GLint GetObjectUniformColour();
-  static GLint GetObjectUniformTint();
-  static GLint GetObjectUniformLight();
-  static GLint GetObjectUniformMono();
-  static GLint GetObjectUniformInvert();
+  // Returns the shader that draws a whole frame of a \#SEL transition from
+  // two images; see Transition and SDLGraphicsSystem::DrawTransition().
+  static GLuint GetTransitionProgram();
+
+  // Returns the named parameter of the transition program.
+  static GLint GetTransitionUniform(const std::string& name);
 
  private:
   // Compiles and links the text program in |shader| into a shader and program
@@ -73,12 +72,9 @@ class Shaders {
   static GLuint object_program_object_id_;
   static GLuint object_shader_object_id_;
   static GLint object_image_;
-  static GLint object_colour_;
-  static GLint object_tint_;
-  static GLint object_light_;
-  static GLint object_alpha_;
-  static GLint object_mono_;
-  static GLint object_invert_;
+
+  static GLuint transition_program_object_id_;
+  static std::map<std::string, GLint> transition_uniforms_;
 };
 
 #endif  // SRC_SYSTEMS_SDL_SHADERS_H_
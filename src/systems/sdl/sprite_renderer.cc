@@ -0,0 +1,190 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "GL/glew.h"
+
+#include "systems/sdl/sprite_renderer.h"
+
+#include <cstddef>
+#include <vector>
+
+#include "systems/sdl/gl_state.h"
+#include "systems/sdl/sdl_utils.h"
+#include "systems/sdl/shaders.h"
+
+namespace {
+
+bool UseObjectShader() {
+  return GLEW_ARB_fragment_shader && GLEW_ARB_multitexture;
+}
+
+// Points texture coordinate set |unit| at a member of the vertex array.
+void TexCoordArray(GLenum unit, int size, const char* pointer) {
+  if (GLEW_ARB_multitexture)
+    glClientActiveTextureARB(unit);
+  glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer(size, GL_FLOAT, sizeof(SpriteVertex), pointer);
+}
+
+void DisableTexCoordArray(GLenum unit) {
+  if (GLEW_ARB_multitexture)
+    glClientActiveTextureARB(unit);
+  glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+}
+
+}  // namespace
+
+SpriteBatch SpriteRenderer::batch_;
+GLuint SpriteRenderer::vertex_buffer_ = 0;
+size_t SpriteRenderer::vertex_buffer_bytes_ = 0;
+int SpriteRenderer::draw_calls_ = 0;
+int SpriteRenderer::sprites_ = 0;
+int SpriteRenderer::last_frame_draw_calls_ = 0;
+int SpriteRenderer::last_frame_sprites_ = 0;
+
+// static
+void SpriteRenderer::Draw(GLuint texture,
+                          SpriteBlendMode blend,
+                          const SpriteQuad& quad) {
+  GLuint program = UseObjectShader() ? Shaders::GetObjectProgram() : 0;
+  batch_.Add(texture, program, blend, quad);
+}
+
+// static
+void SpriteRenderer::Flush() {
+  if (batch_.empty())
+    return;
+
+  SetupArrays();
+
+  // The object program's image sampler is left at its default of unit 0.
+  GLState::ActiveTexture(GL_TEXTURE0_ARB);
+  GLState::Enable(GL_BLEND);
+  for (const SpriteBatch::Draw& draw : batch_.draws()) {
+    GLState::UseProgram(draw.program);
+    GLState::BindTexture(draw.texture);
+    SetBlendMode(draw.blend);
+    glDrawArrays(GL_QUADS, draw.first_vertex, draw.vertex_count);
+    draw_calls_++;
+  }
+  sprites_ += batch_.quad_count();
+
+  if (UseObjectShader()) {
+    DisableTexCoordArray(GL_TEXTURE3_ARB);
+    DisableTexCoordArray(GL_TEXTURE2_ARB);
+    DisableTexCoordArray(GL_TEXTURE1_ARB);
+  }
+  DisableTexCoordArray(GL_TEXTURE0_ARB);
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  if (vertex_buffer_)
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+  DebugShowGLErrors();
+
+  batch_.Clear();
+}
+
+// static
+void SpriteRenderer::EndFrame() {
+  Flush();
+  last_frame_draw_calls_ = draw_calls_;
+  last_frame_sprites_ = sprites_;
+  draw_calls_ = 0;
+  sprites_ = 0;
+}
+
+// static
+void SpriteRenderer::Reset() {
+  batch_.Clear();
+  if (vertex_buffer_) {
+    glDeleteBuffersARB(1, &vertex_buffer_);
+    DebugShowGLErrors();
+    vertex_buffer_ = 0;
+    vertex_buffer_bytes_ = 0;
+  }
+}
+
+// static
+void SpriteRenderer::SetupArrays() {
+  const std::vector<SpriteVertex>& vertices = batch_.vertices();
+  size_t bytes = vertices.size() * sizeof(SpriteVertex);
+
+  const char* base = reinterpret_cast<const char*>(vertices.data());
+  if (GLEW_ARB_vertex_buffer_object) {
+    if (!vertex_buffer_)
+      glGenBuffersARB(1, &vertex_buffer_);
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, vertex_buffer_);
+
+    // Respecify the whole buffer each time so the driver can hand us fresh
+    // storage instead of waiting for last frame's draws to finish.
+    if (bytes > vertex_buffer_bytes_)
+      vertex_buffer_bytes_ = bytes + bytes / 2;
+    glBufferDataARB(GL_ARRAY_BUFFER_ARB, vertex_buffer_bytes_, NULL,
+                    GL_STREAM_DRAW_ARB);
+    glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, bytes, vertices.data());
+    base = NULL;
+  }
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(2, GL_FLOAT, sizeof(SpriteVertex),
+                  base + offsetof(SpriteVertex, x));
+  glEnableClientState(GL_COLOR_ARRAY);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(SpriteVertex),
+                 base + offsetof(SpriteVertex, rgba));
+
+  TexCoordArray(GL_TEXTURE0_ARB, 2, base + offsetof(SpriteVertex, u));
+  if (UseObjectShader()) {
+    // The object shader reads its effects out of the spare texture
+    // coordinate sets.
+    TexCoordArray(GL_TEXTURE1_ARB, 4, base + offsetof(SpriteVertex, colour));
+    TexCoordArray(GL_TEXTURE2_ARB, 4,
+                  base + offsetof(SpriteVertex, tint_light));
+    TexCoordArray(GL_TEXTURE3_ARB, 2,
+                  base + offsetof(SpriteVertex, mono_invert));
+    glClientActiveTextureARB(GL_TEXTURE0_ARB);
+  }
+  DebugShowGLErrors();
+}
+
+// static
+void SpriteRenderer::SetBlendMode(SpriteBlendMode blend) {
+  GLState::BlendEquation(
+      blend == SPRITE_BLEND_SUBTRACT ? GL_FUNC_REVERSE_SUBTRACT : GL_FUNC_ADD);
+
+  switch (blend) {
+    case SPRITE_BLEND_ALPHA:
+      GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+      break;
+    case SPRITE_BLEND_ADD:
+    case SPRITE_BLEND_SUBTRACT:
+      GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE);
+      break;
+    case SPRITE_BLEND_REPLACE:
+      GLState::BlendFunc(GL_ONE, GL_ZERO);
+      break;
+  }
+}
@@ -0,0 +1,91 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_SDL_SPRITE_RENDERER_H_
+#define SRC_SYSTEMS_SDL_SPRITE_RENDERER_H_
+
+#include <SDL/SDL_opengl.h>
+
+#include <cstddef>
+
+#include "systems/base/sprite_batch.h"
+
+// Retained mode drawing of textured quads. Instead of each Texture issuing
+// its own glBegin()/glEnd() with its own blend and shader state, quads are
+// queued here with their transform and colour effects baked into the
+// vertices, and submitted from a vertex buffer in as few draw calls as the
+// order of textures and blend modes allows.
+//
+// Anything else that touches the framebuffer or a texture which might still
+// be queued (reading the screen back, reuploading or deleting a texture,
+// immediate mode drawing) must call Flush() first.
+//
+// Static state, like Shaders; there is only one GL context.
+class SpriteRenderer {
+ public:
+  // Queues |quad| to be drawn with |texture|. Uses the object shader when
+  // the card supports it, so that sprites with and without colour effects
+  // can be drawn together.
+  static void Draw(GLuint texture,
+                   SpriteBlendMode blend,
+                   const SpriteQuad& quad);
+
+  // Submits everything queued so far. The program, texture and blend state
+  // of the last draw are left in place; anything drawing afterwards sets
+  // what it needs through GLState.
+  static void Flush();
+
+  // Flushes and moves this frame's counters into the last_frame_* values.
+  static void EndFrame();
+
+  // Drops queued sprites and frees the vertex buffer; called when the GL
+  // context is recreated.
+  static void Reset();
+
+  // Statistics for the last completed frame.
+  static int last_frame_draw_calls() { return last_frame_draw_calls_; }
+  static int last_frame_sprites() { return last_frame_sprites_; }
+
+ private:
+  // Binds the vertex buffer (if there is one), uploads |batch_| and points
+  // the vertex arrays at it.
+  static void SetupArrays();
+
+  static void SetBlendMode(SpriteBlendMode blend);
+
+  static SpriteBatch batch_;
+
+  static GLuint vertex_buffer_;
+  static size_t vertex_buffer_bytes_;
+
+  static int draw_calls_;
+  static int sprites_;
+  static int last_frame_draw_calls_;
+  static int last_frame_sprites_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_SPRITE_RENDERER_H_
@@ -44,17 +44,19 @@
 #include "systems/base/graphics_object.h"
 #include "systems/base/graphics_object_data.h"
 #include "systems/base/system_error.h"
+#include "systems/sdl/gl_state.h"
 #include "systems/sdl/sdl_graphics_system.h"
 #include "systems/sdl/sdl_surface.h"
 #include "systems/sdl/sdl_utils.h"
 #include "systems/sdl/shaders.h"
+#include "systems/sdl/sprite_renderer.h"
 #include "systems/sdl/texture.h"
+#include "systems/sdl/texture_page.h"
+#include "systems/sdl/texture_uploader.h"
 
 unsigned int Texture::s_screen_width = 0;
 unsigned int Texture::s_screen_height = 0;
-
-unsigned int Texture::s_upload_buffer_size = 0;
-std::unique_ptr<char[]> Texture::s_upload_buffer;
+uint64_t Texture::s_allocated_bytes = 0;
 
 // -----------------------------------------------------------------------
 
@@ -84,60 +86,30 @@ Texture::Texture(SDL_Surface* surface,
       total_height_(surface->h),
       texture_width_(SafeSize(logical_width_)),
       texture_height_(SafeSize(logical_height_)),
+      page_x_(0),
+      page_y_(0),
       back_texture_id_(0),
+      back_width_(0),
+      back_height_(0),
       is_upside_down_(false) {
-  glGenTextures(1, &texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  DebugShowGLErrors();
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  if (w == total_width_ && h == total_height_) {
-    SDL_LockSurface(surface);
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 bytes_per_pixel,
-                 texture_width_,
-                 texture_height_,
-                 0,
-                 byte_order,
-                 byte_type,
-                 NULL);
-    DebugShowGLErrors();
-
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0,
-                    0,
-                    0,
-                    surface->w,
-                    surface->h,
-                    byte_order,
-                    byte_type,
-                    surface->pixels);
-    DebugShowGLErrors();
-
-    SDL_UnlockSurface(surface);
+  if (TexturePage::ShouldPack(w, h))
+    page_ = TexturePage::Allocate(bytes_per_pixel, w, h, &page_slot_);
+
+  if (page_) {
+    texture_id_ = page_->texture_id();
+    texture_width_ = page_->width();
+    texture_height_ = page_->height();
+    page_x_ = page_slot_.x();
+    page_y_ = page_slot_.y();
+    GLState::BindTexture(texture_id_);
   } else {
-    // Cut out the current piece
-    char* pixel_data = uploadBuffer(surface->format->BytesPerPixel * w * h);
-    char* cur_dst_ptr = pixel_data;
-
-    SDL_LockSurface(surface);
-    {
-      char* cur_src_ptr = (char*)surface->pixels;
-      cur_src_ptr += surface->pitch * y;
-
-      int row_start = surface->format->BytesPerPixel * x;
-      int subrow_size = surface->format->BytesPerPixel * w;
-      for (int current_row = 0; current_row < h; ++current_row) {
-        memcpy(cur_dst_ptr, cur_src_ptr + row_start, subrow_size);
-        cur_dst_ptr += subrow_size;
-        cur_src_ptr += surface->pitch;
-      }
-    }
-    SDL_UnlockSurface(surface);
+    glGenTextures(1, &texture_id_);
+    GLState::BindTexture(texture_id_);
+    DebugShowGLErrors();
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     glTexImage2D(GL_TEXTURE_2D,
                  0,
@@ -149,11 +121,16 @@ Texture::Texture(SDL_Surface* surface,
                  byte_type,
                  NULL);
     DebugShowGLErrors();
-
-    glTexSubImage2D(
-        GL_TEXTURE_2D, 0, 0, 0, w, h, byte_order, byte_type, pixel_data);
-    DebugShowGLErrors();
+    s_allocated_bytes += uint64_t(texture_width_) * texture_height_ * 4;
   }
+
+  SDL_LockSurface(surface);
+  int bpp = surface->format->BytesPerPixel;
+  TextureUploader::SubImage(
+      page_x_, page_y_, w, h, bpp, byte_order, byte_type,
+      static_cast<const char*>(surface->pixels) + surface->pitch * y + bpp * x,
+      surface->pitch);
+  SDL_UnlockSurface(surface);
 }
 
 // -----------------------------------------------------------------------
@@ -168,10 +145,14 @@ Texture::Texture(render_to_texture, int width, int height)
       texture_width_(0),
       texture_height_(0),
       texture_id_(0),
+      page_x_(0),
+      page_y_(0),
       back_texture_id_(0),
+      back_width_(0),
+      back_height_(0),
       is_upside_down_(true) {
   glGenTextures(1, &texture_id_);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  GLState::BindTexture(texture_id_);
   DebugShowGLErrors();
   //  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   //  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
@@ -181,6 +162,9 @@ Texture::Texture(render_to_texture, int width, int height)
   texture_width_ = SafeSize(logical_width_);
   texture_height_ = SafeSize(logical_height_);
 
+  // Everything queued so far has to be on screen before we copy it.
+  SpriteRenderer::Flush();
+
   // This may fail.
   glTexImage2D(GL_TEXTURE_2D,
                0,
@@ -196,28 +180,37 @@ Texture::Texture(render_to_texture, int width, int height)
   glCopyTexSubImage2D(
       GL_TEXTURE_2D, 0, 0, 0, 0, 0, logical_width_, logical_height_);
   DebugShowGLErrors();
+  s_allocated_bytes += uint64_t(texture_width_) * texture_height_ * 4;
 }
 
 // -----------------------------------------------------------------------
 
 Texture::~Texture() {
-  glDeleteTextures(1, &texture_id_);
+  SpriteRenderer::Flush();
+  if (page_) {
+    page_->Free(page_slot_);
+  } else {
+    GLState::DeleteTexture(texture_id_);
+    s_allocated_bytes -= uint64_t(texture_width_) * texture_height_ * 4;
+  }
 
-  if (back_texture_id_)
-    glDeleteTextures(1, &back_texture_id_);
+  if (back_texture_id_) {
+    GLState::DeleteTexture(back_texture_id_);
+    s_allocated_bytes -= uint64_t(back_width_) * back_height_ * 4;
+  }
 
   DebugShowGLErrors();
 }
 
 // -----------------------------------------------------------------------
 
-char* Texture::uploadBuffer(unsigned int size) {
-  if (!s_upload_buffer || size > s_upload_buffer_size) {
-    s_upload_buffer.reset(new char[size]);
-    s_upload_buffer_size = size;
-  }
-
-  return s_upload_buffer.get();
+uint64_t Texture::memory_usage() const {
+  uint64_t bytes = uint64_t(back_width_) * back_height_ * 4;
+  if (page_)
+    bytes += uint64_t(logical_width_) * logical_height_ * 4;
+  else
+    bytes += uint64_t(texture_width_) * texture_height_ * 4;
+  return bytes;
 }
 
 // -----------------------------------------------------------------------
@@ -232,54 +225,17 @@ void Texture::reupload(SDL_Surface* surface,
                        unsigned int bytes_per_pixel,
                        int byte_order,
                        int byte_type) {
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  if (w == total_width_ && h == total_height_) {
-    SDL_LockSurface(surface);
-
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0,
-                    0,
-                    0,
-                    surface->w,
-                    surface->h,
-                    byte_order,
-                    byte_type,
-                    surface->pixels);
-    DebugShowGLErrors();
-
-    SDL_UnlockSurface(surface);
-  } else {
-    // Cut out the current piece
-    char* pixel_data = uploadBuffer(surface->format->BytesPerPixel * w * h);
-    char* cur_dst_ptr = pixel_data;
-
-    SDL_LockSurface(surface);
-    {
-      char* cur_src_ptr = (char*)surface->pixels;
-      cur_src_ptr += surface->pitch * y;
-
-      int row_start = surface->format->BytesPerPixel * x;
-      int subrow_size = surface->format->BytesPerPixel * w;
-      for (int current_row = 0; current_row < h; ++current_row) {
-        memcpy(cur_dst_ptr, cur_src_ptr + row_start, subrow_size);
-        cur_dst_ptr += subrow_size;
-        cur_src_ptr += surface->pitch;
-      }
-    }
-    SDL_UnlockSurface(surface);
-
-    glTexSubImage2D(GL_TEXTURE_2D,
-                    0,
-                    offset_x,
-                    offset_y,
-                    w,
-                    h,
-                    byte_order,
-                    byte_type,
-                    pixel_data);
-    DebugShowGLErrors();
-  }
+  // Queued draws of this texture must see the old contents.
+  SpriteRenderer::Flush();
+  GLState::BindTexture(texture_id_);
+
+  SDL_LockSurface(surface);
+  int bpp = surface->format->BytesPerPixel;
+  TextureUploader::SubImage(
+      page_x_ + offset_x, page_y_ + offset_y, w, h, bpp, byte_order, byte_type,
+      static_cast<const char*>(surface->pixels) + surface->pitch * y + bpp * x,
+      surface->pitch);
+  SDL_UnlockSurface(surface);
 }
 
 // -----------------------------------------------------------------------
@@ -303,6 +259,37 @@ std::string readTextFile(const std::string& file) {
 
 // -----------------------------------------------------------------------
 
+// static
+SpriteQuad Texture::MakeQuad(int dx1, int dy1, int dx2, int dy2,
+                             float u1, float v1, float u2, float v2) {
+  SpriteQuad quad;
+  quad.x1 = dx1;
+  quad.y1 = dy1;
+  quad.x2 = dx2;
+  quad.y2 = dy2;
+  quad.u1 = u1;
+  quad.v1 = v1;
+  quad.u2 = u2;
+  quad.v2 = v2;
+  return quad;
+}
+
+// -----------------------------------------------------------------------
+
+void Texture::GetTexCoordTransform(float transform[4]) const {
+  transform[0] = TexCoordX(0);
+  transform[1] = TexCoordY(0);
+  transform[2] = 1.0f / texture_width_;
+  transform[3] = 1.0f / texture_height_;
+
+  if (is_upside_down_) {
+    transform[1] = TexCoordY(logical_height_);
+    transform[3] = -transform[3];
+  }
+}
+
+// -----------------------------------------------------------------------
+
 // This is really broken and brain dead.
 void Texture::RenderToScreen(const Rect& src, const Rect& dst, int opacity) {
   int x1 = src.x(), y1 = src.y(), x2 = src.x2(), y2 = src.y2();
@@ -312,33 +299,20 @@ void Texture::RenderToScreen(const Rect& src, const Rect& dst, int opacity) {
 
   // For the time being, we are dumb and assume that it's one texture
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexCoordX(x1);
+  float thisy1 = TexCoordY(y1);
+  float thisx2 = TexCoordX(x2);
+  float thisy2 = TexCoordY(y2);
 
   if (is_upside_down_) {
-    thisy1 = float(logical_height_ - y1) / texture_height_;
-    thisy2 = float(logical_height_ - y2) / texture_height_;
+    thisy1 = TexCoordY(logical_height_ - y1);
+    thisy2 = TexCoordY(logical_height_ - y2);
   }
 
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  glBegin(GL_QUADS);
-  {
-    glColor4ub(255, 255, 255, opacity);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
-  }
-  glEnd();
-  glBlendFunc(GL_ONE, GL_ZERO);
+  SpriteQuad quad = MakeQuad(fdx1, fdy1, fdx2, fdy2,
+                             thisx1, thisy1, thisx2, thisy2);
+  std::fill(quad.alpha, quad.alpha + 4, opacity);
+  SpriteRenderer::Draw(texture_id_, SPRITE_BLEND_ALPHA, quad);
 }
 
 // -----------------------------------------------------------------------
@@ -371,24 +345,28 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexCoordX(x1);
+  float thisy1 = TexCoordY(y1);
+  float thisx2 = TexCoordX(x2);
+  float thisy2 = TexCoordY(y2);
 
   if (is_upside_down_) {
-    thisy1 = float(logical_height_ - y1) / texture_height_;
-    thisy2 = float(logical_height_ - y2) / texture_height_;
+    thisy1 = TexCoordY(logical_height_ - y1);
+    thisy2 = TexCoordY(logical_height_ - y2);
   }
 
   // If we haven't already, allocate video memory for the back
-  // texture.
+  // texture. It's sized for this image alone, even if the image itself
+  // lives on a shared page.
   //
   // NOTE: Does this code deal with changing the dimensions of the
   // text box? Does it matter?
   if (back_texture_id_ == 0) {
+    back_width_ = SafeSize(logical_width_);
+    back_height_ = SafeSize(logical_height_);
+
     glGenTextures(1, &back_texture_id_);
-    glBindTexture(GL_TEXTURE_2D, back_texture_id_);
+    GLState::BindTexture(back_texture_id_);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
@@ -396,67 +374,78 @@ void Texture::render_to_screen_as_colour_mask_subtractive_glsl(
     glTexImage2D(GL_TEXTURE_2D,
                  0,
                  GL_RGBA,
-                 texture_width_,
-                 texture_height_,
+                 back_width_,
+                 back_height_,
                  0,
                  GL_RGB,
                  GL_UNSIGNED_BYTE,
                  NULL);
     DebugShowGLErrors();
+    s_allocated_bytes += uint64_t(back_width_) * back_height_ * 4;
+  }
+
+  float backx1 = float(x1) / back_width_;
+  float backy1 = float(y1) / back_height_;
+  float backx2 = float(x2) / back_width_;
+  float backy2 = float(y2) / back_height_;
+  if (is_upside_down_) {
+    backy1 = float(logical_height_ - y1) / back_height_;
+    backy2 = float(logical_height_ - y2) / back_height_;
   }
 
   // Copy the current value of the region where we're going to render
   // to a texture for input to the shader
-  glBindTexture(GL_TEXTURE_2D, back_texture_id_);
+  SpriteRenderer::Flush();
+  GLState::BindTexture(back_texture_id_);
   int ystart = int(s_screen_height - fdy1 - (fdy2 - fdy1));
   int idx1 = int(fdx1);
   glCopyTexSubImage2D(
-      GL_TEXTURE_2D, 0, 0, 0, idx1, ystart, texture_width_, texture_height_);
+      GL_TEXTURE_2D, 0, 0, 0, idx1, ystart, back_width_, back_height_);
   DebugShowGLErrors();
 
-  glUseProgramObjectARB(Shaders::getColorMaskProgram());
+  GLState::UseProgram(Shaders::getColorMaskProgram());
 
   // Put the back_texture in texture slot zero and set this to be the
   // texture "current_values" in the above shader program.
-  glActiveTextureARB(GL_TEXTURE0_ARB);
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, back_texture_id_);
+  GLState::ActiveTexture(GL_TEXTURE0_ARB);
+  GLState::Enable(GL_TEXTURE_2D);
+  GLState::BindTexture(back_texture_id_);
   glUniform1iARB(Shaders::getColorMaskUniformCurrentValues(), 0);
 
   // Put the mask in texture slot one and set this to be the
   // texture "mask" in the above shader program.
-  glActiveTextureARB(GL_TEXTURE1_ARB);
-  glEnable(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  GLState::ActiveTexture(GL_TEXTURE1_ARB);
+  GLState::Enable(GL_TEXTURE_2D);
+  GLState::BindTexture(texture_id_);
   glUniform1iARB(Shaders::getColorMaskUniformMask(), 1);
 
-  glDisable(GL_BLEND);
+  GLState::Disable(GL_BLEND);
 
   glBegin(GL_QUADS);
   {
     glColorRGBA(rgba);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx1, thisy2);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx1, backy2);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx1, thisy1);
     glVertex2i(fdx1, fdy1);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx2, thisy2);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx2, backy2);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx2, thisy1);
     glVertex2i(fdx2, fdy1);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx2, thisy1);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx2, backy1);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx2, thisy2);
     glVertex2i(fdx2, fdy2);
-    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, thisx1, thisy1);
+    glMultiTexCoord2fARB(GL_TEXTURE0_ARB, backx1, backy1);
     glMultiTexCoord2fARB(GL_TEXTURE1_ARB, thisx1, thisy2);
     glVertex2i(fdx1, fdy2);
   }
   glEnd();
 
-  glActiveTextureARB(GL_TEXTURE1_ARB);
-  glDisable(GL_TEXTURE_2D);
-  glActiveTextureARB(GL_TEXTURE0_ARB);
+  GLState::ActiveTexture(GL_TEXTURE1_ARB);
+  GLState::Disable(GL_TEXTURE_2D);
+  GLState::ActiveTexture(GL_TEXTURE0_ARB);
 
-  glUseProgramObjectARB(0);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_ONE, GL_ZERO);
+  GLState::UseProgram(0);
+  GLState::Enable(GL_BLEND);
+  GLState::BlendFunc(GL_ONE, GL_ZERO);
 }
 
 // -----------------------------------------------------------------------
@@ -476,24 +465,26 @@ void Texture::render_to_screen_as_colour_mask_subtractive_fallback(
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexCoordX(x1);
+  float thisy1 = TexCoordY(y1);
+  float thisx2 = TexCoordX(x2);
+  float thisy2 = TexCoordY(y2);
 
   if (is_upside_down_) {
-    thisy1 = float(logical_height_ - y1) / texture_height_;
-    thisy2 = float(logical_height_ - y2) / texture_height_;
+    thisy1 = TexCoordY(logical_height_ - y1);
+    thisy2 = TexCoordY(logical_height_ - y2);
   }
 
   // First draw the mask
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  SpriteRenderer::Flush();
+  GLState::BindTexture(texture_id_);
 
   /// SERIOUS WTF: gl_blend_func_separate causes a segmentation fault
   /// under the current i810 driver for linux.
   //  glBlendFuncSeparate(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA,
   //                      GL_SRC_COLOR, GL_ONE_MINUS_SRC_ALPHA);
-  glBlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA);
+  GLState::UseProgram(0);
+  GLState::BlendFunc(GL_SRC_ALPHA_SATURATE, GL_ONE_MINUS_SRC_ALPHA);
 
   glBegin(GL_QUADS);
   {
@@ -509,7 +500,7 @@ void Texture::render_to_screen_as_colour_mask_subtractive_fallback(
   }
   glEnd();
 
-  glBlendFunc(GL_ONE, GL_ZERO);
+  GLState::BlendFunc(GL_ONE, GL_ZERO);
 }
 
 // -----------------------------------------------------------------------
@@ -522,35 +513,26 @@ void Texture::render_to_screen_as_colour_mask_additive(const Rect& src,
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexCoordX(x1);
+  float thisy1 = TexCoordY(y1);
+  float thisx2 = TexCoordX(x2);
+  float thisy2 = TexCoordY(y2);
 
   if (is_upside_down_) {
-    thisy1 = float(logical_height_ - y1) / texture_height_;
-    thisy2 = float(logical_height_ - y2) / texture_height_;
-  }
-
-  // First draw the mask
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  glBegin(GL_QUADS);
-  {
-    glColorRGBA(rgba);
-    glTexCoord2i(thisx1, thisy1);
-    glVertex2f(fdx1, fdy1);
-    glTexCoord2i(thisx2, thisy1);
-    glVertex2f(fdx2, fdy1);
-    glTexCoord2i(thisx2, thisy2);
-    glVertex2f(fdx2, fdy2);
-    glTexCoord2i(thisx1, thisy2);
-    glVertex2f(fdx1, fdy2);
+    thisy1 = TexCoordY(logical_height_ - y1);
+    thisy2 = TexCoordY(logical_height_ - y2);
   }
-  glEnd();
 
-  glBlendFunc(GL_ONE, GL_ZERO);
+  // This has always been drawn with integer texture coordinates (it used
+  // glTexCoord2i()), so keep truncating them.
+  SpriteQuad quad = MakeQuad(fdx1, fdy1, fdx2, fdy2,
+                             int(thisx1), int(thisy1), int(thisx2),
+                             int(thisy2));
+  quad.red = rgba.r();
+  quad.green = rgba.g();
+  quad.blue = rgba.b();
+  std::fill(quad.alpha, quad.alpha + 4, rgba.a());
+  SpriteRenderer::Draw(texture_id_, SPRITE_BLEND_ALPHA, quad);
 }
 
 // -----------------------------------------------------------------------
@@ -564,36 +546,23 @@ void Texture::RenderToScreen(const Rect& src,
   if (!filterCoords(x1, y1, x2, y2, fdx1, fdy1, fdx2, fdy2))
     return;
 
-  float thisx1 = float(x1) / texture_width_;
-  float thisy1 = float(y1) / texture_height_;
-  float thisx2 = float(x2) / texture_width_;
-  float thisy2 = float(y2) / texture_height_;
+  float thisx1 = TexCoordX(x1);
+  float thisy1 = TexCoordY(y1);
+  float thisx2 = TexCoordX(x2);
+  float thisy2 = TexCoordY(y2);
 
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
+  SpriteQuad quad = MakeQuad(fdx1, fdy1, fdx2, fdy2,
+                             thisx1, thisy1, thisx2, thisy2);
+  std::copy(opacity, opacity + 4, quad.alpha);
 
   // Blend when we have less opacity
-  if (std::find_if(opacity, opacity + 4, [](int o) { return o < 255; }) !=
-      opacity + 4) {
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-  }
-
-  glBegin(GL_QUADS);
-  {
-    glColor4ub(255, 255, 255, opacity[0]);
-    glTexCoord2f(thisx1, thisy1);
-    glVertex2i(fdx1, fdy1);
-    glColor4ub(255, 255, 255, opacity[1]);
-    glTexCoord2f(thisx2, thisy1);
-    glVertex2i(fdx2, fdy1);
-    glColor4ub(255, 255, 255, opacity[2]);
-    glTexCoord2f(thisx2, thisy2);
-    glVertex2i(fdx2, fdy2);
-    glColor4ub(255, 255, 255, opacity[3]);
-    glTexCoord2f(thisx1, thisy2);
-    glVertex2i(fdx1, fdy2);
-  }
-  glEnd();
-  glBlendFunc(GL_ONE, GL_ZERO);
+  bool translucent =
+      std::find_if(opacity, opacity + 4, [](int o) { return o < 255; }) !=
+      opacity + 4;
+  SpriteRenderer::Draw(
+      texture_id_,
+      translucent ? SPRITE_BLEND_ALPHA : SPRITE_BLEND_REPLACE,
+      quad);
 }
 
 // -----------------------------------------------------------------------
@@ -620,101 +589,45 @@ void Texture::RenderToScreenAsObject(const GraphicsObject& go,
   }
 
   // Convert the pixel coordinates into [0,1) texture coordinates
-  float thisx1 = float(xSrc1) / texture_width_;
-  float thisy1 = float(ySrc1) / texture_height_;
-  float thisx2 = float(xSrc2) / texture_width_;
-  float thisy2 = float(ySrc2) / texture_height_;
-
-  glBindTexture(GL_TEXTURE_2D, texture_id_);
-
-  glPushMatrix();
-  {
-    // Translate to where the object starts.
-    glTranslatef(fdx1, fdy1, 0);
-
-    int width = fdx2 - fdx1;
-    int height = fdy2 - fdy1;
-
-    // Rotate the texture around the point (origin + position + reporigin)
-    float x_rep = (width / 2.0f) + go.rep_origin_x();
-    float y_rep = (height / 2.0f) + go.rep_origin_y();
-
-    glTranslatef(x_rep, y_rep, 0);
-    glRotatef(float(go.rotation()) / 10, 0, 0, 1);
-    glTranslatef(-x_rep, -y_rep, 0);
-
-    // RealLive has its own complex shading/tinting system which we implement
-    // in a shader if available. It's costly enough that we make sure we need
-    // to use it.
-    bool using_shader = false;
-    if ((go.light() || go.tint() != RGBColour::Black() ||
-         go.colour() != RGBAColour::Clear() || go.mono() || go.invert()) &&
-        GLEW_ARB_fragment_shader && GLEW_ARB_multitexture) {
-      // Image
-      glActiveTexture(GL_TEXTURE0_ARB);
-      glEnable(GL_TEXTURE_2D);
-      glBindTexture(GL_TEXTURE_2D, texture_id_);
-      glUseProgramObjectARB(Shaders::GetObjectProgram());
-      glUniform1iARB(Shaders::GetObjectUniformImage(), 0);
-
-      // Colour/Tint/Etc.
-      Shaders::loadObjectUniformFromGraphicsObject(go);
-
-      // Alpha.
-      glUniform1fARB(Shaders::GetObjectUniformAlpha(), alpha / 255.0f);
-
-      // Our final blending color has to be all white here.
-      using_shader = true;
-    } else {
-      // The shader takes care of the alpha for us, so we need to specify when
-      // not using it.
-      glColor4ub(255, 255, 255, alpha);
-    }
-
-    // Make this so that when we have composite 1, we're doing a pure
-    // additive blend, (ignoring the alpha channel?)
-    switch (go.composite_mode()) {
-      case 0:
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        break;
-      case 1:
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-        break;
-      case 2: {
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-        glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
-        break;
-      }
-      default: {
-        std::ostringstream oss;
-        oss << "Invalid composite_mode in render: " << go.composite_mode();
-        throw SystemError(oss.str());
-      }
+  float thisx1 = TexCoordX(xSrc1);
+  float thisy1 = TexCoordY(ySrc1);
+  float thisx2 = TexCoordX(xSrc2);
+  float thisy2 = TexCoordY(ySrc2);
+
+  // Make this so that when we have composite 1, we're doing a pure
+  // additive blend, (ignoring the alpha channel?)
+  SpriteBlendMode blend;
+  switch (go.composite_mode()) {
+    case 0:
+      blend = SPRITE_BLEND_ALPHA;
+      break;
+    case 1:
+      blend = SPRITE_BLEND_ADD;
+      break;
+    case 2:
+      blend = SPRITE_BLEND_SUBTRACT;
+      break;
+    default: {
+      std::ostringstream oss;
+      oss << "Invalid composite_mode in render: " << go.composite_mode();
+      throw SystemError(oss.str());
     }
+  }
 
-    glBegin(GL_QUADS);
-    {
-      glTexCoord2f(thisx1, thisy1);
-      glVertex2i(0, 0);
-      glTexCoord2f(thisx2, thisy1);
-      glVertex2i(width, 0);
-      glTexCoord2f(thisx2, thisy2);
-      glVertex2i(width, height);
-      glTexCoord2f(thisx1, thisy2);
-      glVertex2i(0, height);
-    }
-    glEnd();
+  SpriteQuad quad = MakeQuad(fdx1, fdy1, fdx2, fdy2,
+                             thisx1, thisy1, thisx2, thisy2);
+  std::fill(quad.alpha, quad.alpha + 4, alpha);
 
-    if (using_shader) {
-      glUseProgramObjectARB(0);
-    }
+  // Rotate the texture around the point (origin + position + reporigin)
+  quad.rotation = float(go.rotation()) / 10;
+  quad.pivot_x = ((fdx2 - fdx1) / 2.0f) + go.rep_origin_x();
+  quad.pivot_y = ((fdy2 - fdy1) / 2.0f) + go.rep_origin_y();
 
-    glBlendEquation(GL_FUNC_ADD);
-    glBlendFunc(GL_ONE, GL_ZERO);
-  }
-  glPopMatrix();
+  // RealLive has its own complex shading/tinting system which the object
+  // shader implements from per vertex data when the card can run it.
+  quad.effects = SpriteEffects::FromGraphicsObject(go);
 
-  DebugShowGLErrors();
+  SpriteRenderer::Draw(texture_id_, blend, quad);
 }
 
 // -----------------------------------------------------------------------
@@ -30,11 +30,16 @@
 
 #include <SDL/SDL_opengl.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
+#include "systems/base/rect.h"
+
 struct SDL_Surface;
+struct SpriteQuad;
 class SDLSurface;
+class TexturePage;
 class GraphicsObject;
 
 struct render_to_texture {};
@@ -50,6 +55,10 @@ class Texture {
 
   static int ScreenHeight();
 
+  // Approximate video memory held by textures that aren't on a shared
+  // TexturePage.
+  static uint64_t allocated_bytes() { return s_allocated_bytes; }
+
  public:
   Texture(SDL_Surface* surface,
           int x,
@@ -80,6 +89,10 @@ class Texture {
   int height() { return logical_height_; }
   GLuint textureId() { return texture_id_; }
 
+  // Approximate video memory this texture accounts for: its own textures, or
+  // its slot on a shared page.
+  uint64_t memory_usage() const;
+
   void RenderToScreenAsObject(const GraphicsObject& go,
                               const SDLSurface& surface,
                               const Rect& srcRect,
@@ -95,13 +108,24 @@ class Texture {
 
   void RenderToScreen(const Rect& src, const Rect& dst, const int opacity[4]);
 
+  // How a shader finds pixel (x, y) of this image: its texture coordinates
+  // are (transform[0], transform[1]) + (x, y) * (transform[2], transform[3]).
+  // Covers shared pages and upside down screenshots.
+  void GetTexCoordTransform(float transform[4]) const;
+
  private:
-  // Returns a shared buffer of at least size. This is not thread safe
-  // or reenterant in the least; it is merely meant to prevent
-  // allocations. This is the proper way to access s_upload_buffer,
-  // since it will automatically reallocate it for you if it isn't
-  // large enough.
-  static char* uploadBuffer(unsigned int size);
+  // Returns a quad covering the screen rectangle (dx1, dy1)-(dx2, dy2) with
+  // the given texture coordinates.
+  static SpriteQuad MakeQuad(int dx1, int dy1, int dx2, int dy2,
+                             float u1, float v1, float u2, float v2);
+
+  // Normalized texture coordinates of pixel (x, y) of this image.
+  float TexCoordX(int x) const {
+    return float(page_x_ + x) / texture_width_;
+  }
+  float TexCoordY(int y) const {
+    return float(page_y_ + y) / texture_height_;
+  }
 
   void render_to_screen_as_colour_mask_subtractive_glsl(const Rect& src,
                                                         const Rect& dst,
@@ -132,12 +156,22 @@ class Texture {
   int total_width_;
   int total_height_;
 
+  // Size of the GL texture, which is the whole page for packed images.
   unsigned int texture_width_;
   unsigned int texture_height_;
 
   GLuint texture_id_;
 
+  // Set when this image lives in |page_slot_| of a shared page instead of
+  // owning |texture_id_|.
+  std::shared_ptr<TexturePage> page_;
+  Rect page_slot_;
+  int page_x_;
+  int page_y_;
+
   GLuint back_texture_id_;
+  unsigned int back_width_;
+  unsigned int back_height_;
 
   // Is this texture upside down? (Because it's a screenshot, etc.)
   bool is_upside_down_;
@@ -146,12 +180,7 @@ class Texture {
   static unsigned int s_screen_width;
   static unsigned int s_screen_height;
 
-  // The size of s_upload_buffer. Initialized to 0.
-  static unsigned int s_upload_buffer_size;
-
-  // To prevent new-ing in a loop, save the dynamically allocated
-  // buffer used to upload data into.
-  static std::unique_ptr<char[]> s_upload_buffer;
+  static uint64_t s_allocated_bytes;
 };
 
 #endif  // SRC_SYSTEMS_SDL_TEXTURE_H_
@@ -0,0 +1,142 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "GL/glew.h"
+
+#include "systems/sdl/texture_page.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "systems/sdl/gl_state.h"
+#include "systems/sdl/sdl_utils.h"
+#include "systems/sdl/texture_uploader.h"
+
+std::vector<std::weak_ptr<TexturePage>> TexturePage::s_pages;
+uint64_t TexturePage::s_allocated_bytes = 0;
+bool TexturePage::s_atlas_enabled = true;
+
+TexturePage::~TexturePage() {
+  GLState::DeleteTexture(texture_id_);
+  s_allocated_bytes -= uint64_t(width()) * height() * 4;
+}
+
+// static
+bool TexturePage::ShouldPack(int width, int height) {
+  if (!IsPackable(width, height))
+    return false;
+
+  if (s_atlas_enabled)
+    return true;
+
+  // Images that are already a power of two in both directions don't waste
+  // anything in a texture of their own.
+  return !IsNPOTSafe() &&
+         (SafeSize(width) != width || SafeSize(height) != height);
+}
+
+// static
+std::shared_ptr<TexturePage> TexturePage::Allocate(GLenum internal_format,
+                                                   int width,
+                                                   int height,
+                                                   Rect* slot) {
+  s_pages.erase(std::remove_if(s_pages.begin(),
+                               s_pages.end(),
+                               [](const std::weak_ptr<TexturePage>& page) {
+                                 return page.expired();
+                               }),
+                s_pages.end());
+
+  for (const std::weak_ptr<TexturePage>& weak_page : s_pages) {
+    std::shared_ptr<TexturePage> page = weak_page.lock();
+    if (page->internal_format_ == internal_format &&
+        page->AllocateSlot(width, height, slot)) {
+      page->ClearPadding(*slot);
+      return page;
+    }
+  }
+
+  std::shared_ptr<TexturePage> page(new TexturePage(
+      internal_format, std::min(kPageSize, GetMaxTextureSize())));
+  if (!page->AllocateSlot(width, height, slot))
+    return std::shared_ptr<TexturePage>();
+
+  page->ClearPadding(*slot);
+  s_pages.push_back(page);
+  return page;
+}
+
+// static
+int TexturePage::page_count() {
+  return std::count_if(
+      s_pages.begin(), s_pages.end(),
+      [](const std::weak_ptr<TexturePage>& page) { return !page.expired(); });
+}
+
+TexturePage::TexturePage(GLenum internal_format, int size)
+    : AtlasPage(size), internal_format_(internal_format), texture_id_(0) {
+  glGenTextures(1, &texture_id_);
+  GLState::BindTexture(texture_id_);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexImage2D(GL_TEXTURE_2D,
+               0,
+               internal_format,
+               size,
+               size,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               NULL);
+  DebugShowGLErrors();
+
+  s_allocated_bytes += uint64_t(size) * size * 4;
+}
+
+void TexturePage::ClearPadding(const Rect& slot) {
+  int right = std::min(kPadding, width() - slot.x2());
+  int below = std::min(kPadding, height() - slot.y2());
+  if (right <= 0 && below <= 0)
+    return;
+
+  std::vector<char> zeros((std::max(slot.width(), slot.height()) + kPadding) *
+                          kPadding * 4);
+  GLState::BindTexture(texture_id_);
+  if (right > 0) {
+    TextureUploader::SubImage(slot.x2(), slot.y(), right,
+                              slot.height() + std::max(below, 0), 4, GL_RGBA,
+                              GL_UNSIGNED_BYTE, zeros.data(), right * 4);
+  }
+  if (below > 0) {
+    TextureUploader::SubImage(slot.x(), slot.y2(), slot.width(), below, 4,
+                              GL_RGBA, GL_UNSIGNED_BYTE, zeros.data(),
+                              slot.width() * 4);
+  }
+}
@@ -0,0 +1,94 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_SDL_TEXTURE_PAGE_H_
+#define SRC_SYSTEMS_SDL_TEXTURE_PAGE_H_
+
+#include <SDL/SDL_opengl.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "systems/base/atlas_page.h"
+
+// A power of two texture shared by several small images: an atlas.
+//
+// Buttons, digits, cursors and pattern sheets are small and are usually
+// drawn together, so they are packed onto shared pages and the sprite
+// renderer can draw a whole menu from one or two textures instead of binding
+// a texture per piece. On drivers without non power of two textures,
+// packing also keeps each image from being rounded up to the next power of
+// two in each direction; a 300x40 button would otherwise take a 512x64
+// texture.
+//
+// Each Texture holding a slot keeps its page alive and frees its slot when
+// it dies, and the page's GL texture is deleted along with the last of them.
+// The Texture maps its own coordinates into the slot, so pattern rects and
+// everything else above it keep working in image coordinates.
+class TexturePage : public AtlasPage {
+ public:
+  virtual ~TexturePage();
+
+  // Whether a |width| x |height| image should go on a page instead of into a
+  // texture of its own.
+  static bool ShouldPack(int width, int height);
+
+  // Turns packing images for batching off; only the padding saving on
+  // drivers without non power of two textures remains.
+  static void set_atlas_enabled(bool enabled) { s_atlas_enabled = enabled; }
+
+  // Finds a slot for a |width| x |height| image on a page with
+  // |internal_format|, creating a new page if none of the existing ones have
+  // room. Writes the slot's position on the page to |slot|.
+  static std::shared_ptr<TexturePage> Allocate(GLenum internal_format,
+                                               int width,
+                                               int height,
+                                               Rect* slot);
+
+  GLuint texture_id() const { return texture_id_; }
+
+  // Video memory held by all live pages, and how many of them there are.
+  static uint64_t allocated_bytes() { return s_allocated_bytes; }
+  static int page_count();
+
+ private:
+  TexturePage(GLenum internal_format, int size);
+
+  // Fills the padding to the right of and below |slot| with transparent
+  // black, so filtering at the slot's edges doesn't pick up stale texels.
+  void ClearPadding(const Rect& slot);
+
+  GLenum internal_format_;
+  GLuint texture_id_;
+
+  static std::vector<std::weak_ptr<TexturePage>> s_pages;
+  static uint64_t s_allocated_bytes;
+  static bool s_atlas_enabled;
+};
+
+#endif  // SRC_SYSTEMS_SDL_TEXTURE_PAGE_H_
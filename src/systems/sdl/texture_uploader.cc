@@ -0,0 +1,156 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "GL/glew.h"
+
+#include "systems/sdl/texture_uploader.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "systems/sdl/sdl_utils.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+int64_t MicrosecondsSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               start).count();
+}
+
+// Copies |height| rows of |row_bytes| bytes, |pitch| bytes apart in |src|,
+// into the packed |dest|.
+void PackRows(char* dest,
+              const char* src,
+              int row_bytes,
+              int height,
+              int pitch) {
+  for (int row = 0; row < height; ++row) {
+    memcpy(dest, src, row_bytes);
+    dest += row_bytes;
+    src += pitch;
+  }
+}
+
+}  // namespace
+
+GLuint TextureUploader::buffers_[kRingSize] = {0};
+int TextureUploader::next_buffer_ = 0;
+std::unique_ptr<char[]> TextureUploader::scratch_;
+size_t TextureUploader::scratch_size_ = 0;
+uint64_t TextureUploader::bytes_ = 0;
+int64_t TextureUploader::stall_us_ = 0;
+uint64_t TextureUploader::last_frame_bytes_ = 0;
+int TextureUploader::last_frame_stall_us_ = 0;
+
+// static
+void TextureUploader::SubImage(int x,
+                               int y,
+                               int width,
+                               int height,
+                               int bytes_per_pixel,
+                               GLenum format,
+                               GLenum type,
+                               const char* pixels,
+                               int pitch) {
+  if (width <= 0 || height <= 0)
+    return;
+
+  int row_bytes = width * bytes_per_pixel;
+  size_t size = size_t(row_bytes) * height;
+  bytes_ += size;
+
+  if (GLEW_ARB_pixel_buffer_object) {
+    GLuint& buffer = buffers_[next_buffer_];
+    next_buffer_ = (next_buffer_ + 1) % kRingSize;
+    if (!buffer)
+      glGenBuffersARB(1, &buffer);
+
+    glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, buffer);
+    Clock::time_point start = Clock::now();
+    glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, size, NULL,
+                    GL_STREAM_DRAW_ARB);
+    char* mapped = static_cast<char*>(
+        glMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB));
+    stall_us_ += MicrosecondsSince(start);
+
+    if (mapped) {
+      PackRows(mapped, pixels, row_bytes, height, pitch);
+      glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type,
+                      NULL);
+      glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+      DebugShowGLErrors();
+      return;
+    }
+
+    // Mapping can fail when memory is tight; fall back to a plain upload.
+    glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+  }
+
+  const char* data = pixels;
+  if (pitch != row_bytes) {
+    char* packed = ScratchBuffer(size);
+    PackRows(packed, pixels, row_bytes, height, pitch);
+    data = packed;
+  }
+
+  Clock::time_point start = Clock::now();
+  glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, format, type, data);
+  stall_us_ += MicrosecondsSince(start);
+  DebugShowGLErrors();
+}
+
+// static
+void TextureUploader::EndFrame() {
+  last_frame_bytes_ = bytes_;
+  last_frame_stall_us_ = stall_us_;
+  bytes_ = 0;
+  stall_us_ = 0;
+}
+
+// static
+void TextureUploader::Reset() {
+  for (int i = 0; i < kRingSize; ++i) {
+    if (buffers_[i]) {
+      glDeleteBuffersARB(1, &buffers_[i]);
+      buffers_[i] = 0;
+    }
+  }
+  next_buffer_ = 0;
+  DebugShowGLErrors();
+}
+
+// static
+char* TextureUploader::ScratchBuffer(size_t size) {
+  if (!scratch_ || size > scratch_size_) {
+    scratch_.reset(new char[size]);
+    scratch_size_ = size;
+  }
+
+  return scratch_.get();
+}
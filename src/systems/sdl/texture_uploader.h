@@ -0,0 +1,90 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_SYSTEMS_SDL_TEXTURE_UPLOADER_H_
+#define SRC_SYSTEMS_SDL_TEXTURE_UPLOADER_H_
+
+#include <SDL/SDL_opengl.h>
+
+#include <cstdint>
+#include <memory>
+
+// Moves pixels from system memory into textures.
+//
+// When the driver has pixel buffer objects, each upload is copied into the
+// next buffer of a small ring, which is orphaned first so the driver never
+// has to wait for the GPU to finish with what was in it, and
+// glTexSubImage2D() then returns without waiting for the transfer. Without
+// them, the pixels are handed to glTexSubImage2D() directly (packed into a
+// scratch buffer when the rows aren't contiguous), which blocks until the
+// driver has its own copy.
+//
+// Static state, like SpriteRenderer; there is only one GL context.
+class TextureUploader {
+ public:
+  // Uploads the |width| x |height| block of pixels starting at |pixels|,
+  // whose rows are |pitch| bytes apart, to (x, y) of the texture bound to
+  // the active unit.
+  static void SubImage(int x,
+                       int y,
+                       int width,
+                       int height,
+                       int bytes_per_pixel,
+                       GLenum format,
+                       GLenum type,
+                       const char* pixels,
+                       int pitch);
+
+  // Moves this frame's counters into the last_frame_* values.
+  static void EndFrame();
+
+  // Frees the pixel buffers; called when the GL context is recreated.
+  static void Reset();
+
+  // Statistics for the last completed frame: bytes uploaded and the time
+  // spent waiting for the driver to accept them.
+  static uint64_t last_frame_bytes() { return last_frame_bytes_; }
+  static int last_frame_stall_us() { return last_frame_stall_us_; }
+
+ private:
+  static const int kRingSize = 4;
+
+  // Returns a scratch buffer of at least |size| bytes for packing rows.
+  static char* ScratchBuffer(size_t size);
+
+  static GLuint buffers_[kRingSize];
+  static int next_buffer_;
+
+  static std::unique_ptr<char[]> scratch_;
+  static size_t scratch_size_;
+
+  static uint64_t bytes_;
+  static int64_t stall_us_;
+  static uint64_t last_frame_bytes_;
+  static int last_frame_stall_us_;
+};
+
+#endif  // SRC_SYSTEMS_SDL_TEXTURE_UPLOADER_H_
@@ -0,0 +1,47 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/software/software_colour_filter.h"
+
+#include <algorithm>
+
+#include "systems/base/graphics_object.h"
+#include "systems/software/software_graphics_system.h"
+
+SoftwareColourFilter::SoftwareColourFilter(SoftwareGraphicsSystem* system)
+    : system_(system) {}
+
+SoftwareColourFilter::~SoftwareColourFilter() {}
+
+void SoftwareColourFilter::Fill(const GraphicsObject& go,
+                                const Rect& screen_rect,
+                                const RGBAColour& colour) {
+  SpriteQuad quad;
+  std::fill(quad.alpha, quad.alpha + 4, go.GetComputedAlpha());
+  quad.effects = SpriteEffects::FromGraphicsObject(go);
+  system_->FilterScreen(screen_rect, quad);
+}
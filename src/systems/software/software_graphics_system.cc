@@ -0,0 +1,437 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/software/software_graphics_system.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "libreallive/gameexe.h"
+#include "systems/base/colour.h"
+#include "systems/base/event_system.h"
+#include "systems/base/renderable.h"
+#include "systems/base/system.h"
+#include "systems/base/system_error.h"
+#include "systems/base/tone_curve.h"
+#include "systems/base/transition.h"
+#include "systems/software/software_colour_filter.h"
+#include "systems/software/software_rasterizer.h"
+#include "systems/software/software_surface.h"
+#include "utilities/exception.h"
+#include "utilities/graphics.h"
+#include "xclannad/file.h"
+
+namespace {
+
+// Helper function for LoadSurfaceFromFile; invoked in a stl loop.
+Surface::GrpRect xclannadRegionToGrpRect(const GRPCONV::REGION& region) {
+  Surface::GrpRect rect;
+  rect.rect =
+      Rect(Point(region.x1, region.y1), Point(region.x2 + 1, region.y2 + 1));
+  rect.originX = region.origin_x;
+  rect.originY = region.origin_y;
+  return rect;
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// SoftwareGraphicsSystem
+// -----------------------------------------------------------------------
+
+SoftwareGraphicsSystem::SoftwareGraphicsSystem(System& system,
+                                               Gameexe& gameexe)
+    : GraphicsSystem(system, gameexe),
+      target_(NULL),
+      screen_valid_(false),
+      refresh_interval_(0),
+      last_presented_(0) {
+  haikei_.reset(new SoftwareSurface(this));
+  for (int i = 0; i < 16; ++i)
+    display_contexts_[i].reset(new SoftwareSurface(this));
+
+  SetScreenSize(GetScreenSize(gameexe));
+  screen_.reset(new SoftwareSurface(this, screen_size()));
+  SetupFrameState(screen_rect());
+
+  // Now we allocate the first two display contexts with equal size to
+  // the display
+  display_contexts_[0]->allocate(screen_size(), true);
+  display_contexts_[1]->allocate(screen_size());
+}
+
+SoftwareGraphicsSystem::~SoftwareGraphicsSystem() {}
+
+void SoftwareGraphicsSystem::Draw(const SoftwareSurface& texture,
+                                  SpriteBlendMode blend,
+                                  const SpriteQuad& quad) {
+  SpriteQuad moved = quad;
+  moved.x1 += origin_.x();
+  moved.x2 += origin_.x();
+  moved.y1 += origin_.y();
+  moved.y2 += origin_.y();
+  RasterizeQuad(texture.image(), blend, moved, clip_, target_->image());
+}
+
+void SoftwareGraphicsSystem::DrawColourMask(const SoftwareSurface& mask,
+                                            const Rect& src,
+                                            const Rect& dst,
+                                            const RGBAColour& colour) {
+  Rect moved(dst.origin() + origin_, dst.size());
+  RasterizeColourMask(mask.image(), src, moved, colour, clip_,
+                      target_->image());
+}
+
+void SoftwareGraphicsSystem::FilterScreen(const Rect& area,
+                                          const SpriteQuad& quad) {
+  Rect copy_area = area.Intersection(target_->GetRect());
+  if (copy_area.width() <= 0 || copy_area.height() <= 0)
+    return;
+
+  // Like SDLColourFilter, copy what's there and draw it back over itself.
+  RasterImage from = target_->image();
+  std::vector<uint32_t> pixels;
+  pixels.reserve(copy_area.width() * copy_area.height());
+  for (int y = copy_area.y(); y < copy_area.y2(); ++y) {
+    const uint32_t* row = from.Row(y) + copy_area.x();
+    pixels.insert(pixels.end(), row, row + copy_area.width());
+  }
+  SoftwareSurface copy(this, copy_area.size(), &pixels,
+                       std::vector<Surface::GrpRect>());
+
+  SpriteQuad filter = quad;
+  filter.x1 = copy_area.x();
+  filter.y1 = copy_area.y();
+  filter.x2 = copy_area.x2();
+  filter.y2 = copy_area.y2();
+  Draw(copy, SPRITE_BLEND_ALPHA, filter);
+}
+
+void SoftwareGraphicsSystem::BeginFrame() {
+  SetupFrameState(screen_rect());
+  screen_->Fill(RGBAColour::Black());
+}
+
+void SoftwareGraphicsSystem::EndFrame() {
+  FinalRenderers::iterator it = renderer_begin();
+  FinalRenderers::iterator end = renderer_end();
+  for (; it != end; ++it) {
+    (*it)->Render(NULL);
+  }
+
+  screen_valid_ = true;
+  OnFrameEnded();
+
+  if (refresh_interval_ > 0) {
+    unsigned int now = system().event().GetTicks();
+    last_presented_ = static_cast<unsigned int>(
+        std::ceil(now / refresh_interval_) * refresh_interval_);
+    presentation_clock().Presented(last_presented_);
+  }
+}
+
+std::shared_ptr<Surface> SoftwareGraphicsSystem::EndFrameToSurface() {
+  // There's no alpha channel on a real screen.
+  SoftwareSurface* frame = static_cast<SoftwareSurface*>(screen_->Clone());
+  frame->MakeOpaque();
+
+  // SDLGraphicsSystem draws these offscreen, so the frame on screen stays
+  // put; ours was just drawn over.
+  screen_valid_ = false;
+  return std::shared_ptr<Surface>(frame);
+}
+
+bool SoftwareGraphicsSystem::DrawTransition(const Surface& from,
+                                            const Surface& to,
+                                            const Transition& transition) {
+  const SoftwareSurface* from_surface =
+      dynamic_cast<const SoftwareSurface*>(&from);
+  const SoftwareSurface* to_surface = dynamic_cast<const SoftwareSurface*>(&to);
+  if (!from_surface || !to_surface)
+    return false;
+
+  if (transition.style == Transition::PANES) {
+    for (int i = 0; i < transition.pane_count; ++i) {
+      const Transition::Pane& pane = transition.panes[i];
+      const Surface& image = pane.image == Transition::TO_IMAGE ? to : from;
+      image.RenderToScreen(pane.src, pane.dst, 255);
+    }
+    return true;
+  }
+
+  // A single pass down the frame: each row gets the old image, then the new
+  // one with every pixel's alpha scaled by how much of it shows there.
+  Rect area = clip_.Intersection(target_->GetRect());
+  RasterImage from_image = from_surface->image();
+  RasterImage to_image = to_surface->image();
+  RasterImage target = target_->image();
+  std::vector<uint32_t> row(std::max(0, area.width()));
+  for (int y = area.y(); y < area.y2(); ++y) {
+    uint32_t* out = target.Row(y) + area.x();
+
+    int count = std::min(area.x2(), from_image.width) - area.x();
+    if (y < from_image.height && count > 0) {
+      BlendRow(SPRITE_BLEND_ALPHA, from_image.Row(y) + area.x(), out, count,
+               255);
+    }
+
+    count = std::min(area.x2(), to_image.width) - area.x();
+    if (y >= to_image.height || count <= 0)
+      continue;
+    const uint32_t* in = to_image.Row(y) + area.x();
+    for (int i = 0; i < count; ++i) {
+      float coverage = transition.Coverage(area.x() + i, y);
+      uint32_t alpha = static_cast<uint32_t>((in[i] >> 24) * coverage + 0.5f);
+      row[i] = (in[i] & 0x00ffffff) | (alpha << 24);
+    }
+    BlendRow(SPRITE_BLEND_ALPHA, row.data(), out, count, 255);
+  }
+
+  return true;
+}
+
+bool SoftwareGraphicsSystem::CanRedrawPartially() {
+  // Final renderers draw on top of everything and don't report damage.
+  return screen_valid_ && renderer_begin() == renderer_end();
+}
+
+void SoftwareGraphicsSystem::BeginPartialFrame(const Rect& area) {
+  // Everything outside |area| is still there from the last frame.
+  SetupFrameState(area);
+}
+
+bool SoftwareGraphicsSystem::CanCacheLayers() { return true; }
+
+void SoftwareGraphicsSystem::BeginLayer() {
+  // The layer is reused by later frames, so it's always drawn in full.
+  if (!layer_ || layer_->GetSize() != screen_size())
+    layer_.reset(new SoftwareSurface(this, screen_size()));
+  else
+    layer_->Fill(RGBAColour::Black());
+
+  target_ = layer_.get();
+  clip_ = screen_rect();
+}
+
+void SoftwareGraphicsSystem::EndLayer() {
+  target_ = screen_.get();
+  clip_ = frame_area_;
+}
+
+void SoftwareGraphicsSystem::DrawLayer() {
+  SpriteQuad quad;
+  quad.x2 = screen_size().width();
+  quad.y2 = screen_size().height();
+  Draw(*layer_, SPRITE_BLEND_REPLACE, quad);
+}
+
+void SoftwareGraphicsSystem::AllocateDC(int dc, Size size) {
+  if (dc >= 16) {
+    std::ostringstream ss;
+    ss << "Invalid DC number \"" << dc
+       << "\" in SoftwareGraphicsSystem::allocate_dc";
+    throw rlvm::Exception(ss.str());
+  }
+
+  // We can't reallocate the screen!
+  if (dc == 0)
+    throw rlvm::Exception("Attempting to reallocate DC 0!");
+
+  // DC 1 is a special case and must always be at least the size of
+  // the screen.
+  if (dc == 1) {
+    Size dc0 = display_contexts_[0]->GetSize();
+    if (size.width() < dc0.width())
+      size.set_width(dc0.width());
+    if (size.height() < dc0.height())
+      size.set_height(dc0.height());
+  }
+
+  // Allocate a new obj.
+  display_contexts_[dc]->allocate(size);
+}
+
+void SoftwareGraphicsSystem::SetMinimumSizeForDC(int dc, Size size) {
+  if (display_contexts_[dc] == NULL || !display_contexts_[dc]->allocated()) {
+    AllocateDC(dc, size);
+  } else {
+    Size current = display_contexts_[dc]->GetSize();
+    if (current.width() < size.width() || current.height() < size.height()) {
+      // Make a new surface of the maximum size.
+      Size maxSize = current.SizeUnion(size);
+
+      std::shared_ptr<SoftwareSurface> newdc(new SoftwareSurface(this));
+      newdc->allocate(maxSize);
+
+      display_contexts_[dc]->BlitToSurface(
+          *newdc, display_contexts_[dc]->GetRect(),
+          display_contexts_[dc]->GetRect());
+
+      display_contexts_[dc] = newdc;
+    }
+  }
+}
+
+void SoftwareGraphicsSystem::FreeDC(int dc) {
+  if (dc == 0) {
+    throw rlvm::Exception("Attempt to deallocate DC[0]");
+  } else if (dc == 1) {
+    // DC[1] never gets freed; it only gets blanked
+    GetDC(1)->Fill(RGBAColour::Black());
+  } else {
+    display_contexts_[dc]->deallocate();
+  }
+}
+
+std::shared_ptr<Surface> SoftwareGraphicsSystem::GetHaikei() {
+  if (!haikei_->allocated())
+    haikei_->allocate(screen_size(), true);
+
+  return haikei_;
+}
+
+std::shared_ptr<Surface> SoftwareGraphicsSystem::GetDC(int dc) {
+  VerifySurfaceExists(dc, "SoftwareGraphicsSystem::get_dc");
+
+  // If requesting a DC that doesn't exist, allocate it first.
+  if (!display_contexts_[dc]->allocated())
+    AllocateDC(dc, display_contexts_[0]->GetSize());
+
+  return display_contexts_[dc];
+}
+
+std::shared_ptr<Surface> SoftwareGraphicsSystem::BuildSurface(
+    const Size& size) {
+  return std::shared_ptr<Surface>(new SoftwareSurface(this, size));
+}
+
+ColourFilter* SoftwareGraphicsSystem::BuildColourFiller() {
+  return new SoftwareColourFilter(this);
+}
+
+void SoftwareGraphicsSystem::SetupFrameState(const Rect& area) {
+  target_ = screen_.get();
+  frame_area_ = area;
+  clip_ = area;
+
+  // Full screen shaking moves where the origin is.
+  origin_ = GetScreenOrigin();
+}
+
+void SoftwareGraphicsSystem::VerifySurfaceExists(int dc,
+                                                 const std::string& caller) {
+  if (dc >= 16) {
+    std::ostringstream ss;
+    ss << "Invalid DC number (" << dc << ") in " << caller;
+    throw rlvm::Exception(ss.str());
+  }
+
+  if (display_contexts_[dc] == NULL) {
+    std::ostringstream ss;
+    ss << "Parameter DC[" << dc << "] not allocated in " << caller;
+    throw rlvm::Exception(ss.str());
+  }
+}
+
+std::shared_ptr<const Surface> SoftwareGraphicsSystem::LoadSurfaceFromFile(
+    const std::string& short_filename) {
+  boost::filesystem::path filename =
+      system().FindFile(short_filename, IMAGE_FILETYPES);
+  if (filename.empty()) {
+    std::ostringstream oss;
+    oss << "Could not find image file \"" << short_filename << "\".";
+    throw rlvm::Exception(oss.str());
+  }
+
+  // Glue code to allow my stuff to work with Jagarl's loader
+  FILE* file = fopen(filename.string().c_str(), "rb");
+  if (!file) {
+    std::ostringstream oss;
+    oss << "Could not open file: " << filename;
+    throw rlvm::Exception(oss.str());
+  }
+
+  fseek(file, 0, SEEK_END);
+  size_t file_size = ftell(file);
+  std::unique_ptr<char[]> d(new char[file_size + 1]);
+  fseek(file, 0, SEEK_SET);
+  fread(d.get(), file_size, 1, file);
+  fclose(file);
+
+  std::unique_ptr<GRPCONV> conv(
+      GRPCONV::AssignConverter(d.get(), file_size, "???"));
+  if (conv == 0) {
+    throw SystemError("Failure in GRPCONV.");
+  }
+  Size size(conv->Width(), conv->Height());
+
+  // Grab the Type-2 information out of the converter or create one
+  // default region if none exist
+  std::vector<Surface::GrpRect> region_table;
+  std::transform(conv->region_table.begin(),
+                 conv->region_table.end(),
+                 std::back_inserter(region_table),
+                 xclannadRegionToGrpRect);
+
+  // The converters may write a little past the end of the image, the same
+  // slack SDLGraphicsSystem gives them.
+  int pixel_count = size.width() * size.height();
+  std::vector<uint32_t> pixels(pixel_count + 256);
+  if (!conv->Read(reinterpret_cast<char*>(pixels.data())))
+    throw SystemError("Failure in GRPCONV.");
+  pixels.resize(pixel_count);
+
+  std::shared_ptr<SoftwareSurface> surface(
+      new SoftwareSurface(this, size, &pixels, region_table));
+  if (!conv->IsMask())
+    surface->MakeOpaque();
+
+  // handle tone curve effect loading
+  if (short_filename.find("?") != short_filename.npos) {
+    std::string effect_no_str =
+        short_filename.substr(short_filename.find("?") + 1);
+    int effect_no = std::stoi(effect_no_str);
+    // the effect number is an index that goes from 10 to GetEffectCount() * 10,
+    // so keep that in mind here
+    if ((effect_no / 10) > globals().tone_curves.GetEffectCount() ||
+        effect_no < 10) {
+      std::ostringstream oss;
+      oss << "Tone curve index " << effect_no << " is invalid.";
+      throw rlvm::Exception(oss.str());
+    }
+    surface->ToneCurve(globals().tone_curves.GetEffect(effect_no / 10 - 1),
+                       Rect(Point(0, 0), size));
+  }
+
+  return surface;
+}
@@ -0,0 +1,146 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_SOFTWARE_SOFTWARE_GRAPHICS_SYSTEM_H_
+#define SRC_SYSTEMS_SOFTWARE_SOFTWARE_GRAPHICS_SYSTEM_H_
+
+#include <memory>
+#include <string>
+
+#include "systems/base/graphics_system.h"
+#include "systems/base/sprite_batch.h"
+
+class Gameexe;
+class RGBAColour;
+class SoftwareSurface;
+class System;
+
+// A GraphicsSystem which draws every frame on the CPU into an in memory
+// framebuffer, for running the engine without a display or OpenGL (on test
+// and batch machines, say). Its output is meant to match SDLGraphicsSystem's
+// pixel for pixel; see software_rasterizer.h for how it draws.
+//
+// Nothing is ever shown. EndFrame() leaves the frame in screen(), and
+// EndFrameToSurface() hands back a copy. To exercise presentation timing, it
+// can pretend that frames go to a display refreshing at a fixed interval.
+class SoftwareGraphicsSystem : public GraphicsSystem {
+ public:
+  SoftwareGraphicsSystem(System& system, Gameexe& gameexe);
+  ~SoftwareGraphicsSystem();
+
+  // The last frame drawn.
+  const SoftwareSurface& screen() const { return *screen_; }
+
+  // Draws |quad| with |texture| into the frame (or layer) being drawn,
+  // offset by screen shaking and clipped to the area being redrawn.
+  void Draw(const SoftwareSurface& texture,
+            SpriteBlendMode blend,
+            const SpriteQuad& quad);
+
+  // Draws |src| of |mask| at |dst| as a subtractive colour mask.
+  void DrawColourMask(const SoftwareSurface& mask,
+                      const Rect& src,
+                      const Rect& dst,
+                      const RGBAColour& colour);
+
+  // Redraws |area| of the frame onto itself through |quad|'s alpha and
+  // effects.
+  void FilterScreen(const Rect& area, const SpriteQuad& quad);
+
+  // Makes EndFrame() treat each frame as shown at the next multiple of
+  // |interval| milliseconds, and report that to presentation_clock(). Zero,
+  // the default, reports nothing.
+  void set_refresh_interval(double interval) { refresh_interval_ = interval; }
+
+  // When the last frame was shown, while there's a refresh interval.
+  unsigned int last_presented() const { return last_presented_; }
+
+  // GraphicsSystem:
+  virtual void BeginFrame() override;
+  virtual void EndFrame() override;
+  virtual std::shared_ptr<Surface> EndFrameToSurface() override;
+  virtual bool DrawTransition(const Surface& from,
+                              const Surface& to,
+                              const Transition& transition) override;
+  virtual void AllocateDC(int dc, Size size) override;
+  virtual void SetMinimumSizeForDC(int dc, Size size) override;
+  virtual void FreeDC(int dc) override;
+  virtual std::shared_ptr<Surface> GetHaikei() override;
+  virtual std::shared_ptr<Surface> GetDC(int dc) override;
+  virtual std::shared_ptr<Surface> BuildSurface(const Size& size) override;
+  virtual ColourFilter* BuildColourFiller() override;
+
+ protected:
+  virtual bool CanRedrawPartially() override;
+  virtual void BeginPartialFrame(const Rect& area) override;
+  virtual bool CanCacheLayers() override;
+  virtual void BeginLayer() override;
+  virtual void EndLayer() override;
+  virtual void DrawLayer() override;
+
+ private:
+  // Sets up the drawing state shared by full and partial frames.
+  void SetupFrameState(const Rect& area);
+
+  void VerifySurfaceExists(int dc, const std::string& caller);
+
+  virtual std::shared_ptr<const Surface> LoadSurfaceFromFile(
+      const std::string& short_filename) override;
+
+  std::shared_ptr<SoftwareSurface> haikei_;
+
+  // Map between device contexts number and their surface.
+  std::shared_ptr<SoftwareSurface> display_contexts_[16];
+
+  // The frame being drawn, and after EndFrame(), the last frame drawn.
+  std::unique_ptr<SoftwareSurface> screen_;
+
+  // The cached bottom of the scene (see LayerCache). Allocated on first use.
+  std::unique_ptr<SoftwareSurface> layer_;
+
+  // Where drawing currently goes: |screen_| or |layer_|.
+  SoftwareSurface* target_;
+
+  // The part of |target_| that drawing may touch.
+  Rect clip_;
+
+  // The part of |screen_| being redrawn this frame.
+  Rect frame_area_;
+
+  // Screen shaking offset for this frame.
+  Point origin_;
+
+  // Whether |screen_| holds a complete frame to redraw part of.
+  bool screen_valid_;
+
+  // The simulated display's refresh interval in milliseconds, or 0.
+  double refresh_interval_;
+
+  unsigned int last_presented_;
+};
+
+#endif  // SRC_SYSTEMS_SOFTWARE_SOFTWARE_GRAPHICS_SYSTEM_H_
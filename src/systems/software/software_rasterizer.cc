@@ -0,0 +1,591 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/software/software_rasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "systems/base/colour.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RLVM_RASTER_SSE2 1
+#elif defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define RLVM_RASTER_NEON 1
+#endif
+
+namespace {
+
+const uint32_t kAlphaMask = 0xff000000;
+
+// Texel footprints up to this size count as magnification, which OpenGL
+// samples with GL_LINEAR; anything bigger is shrunk with GL_NEAREST. The slack
+// keeps rotated sprites drawn at their natural size on the bilinear side.
+const float kMaxMagnification = 1.001f;
+
+// How far from a texel centre a sample can fall and still be read as that
+// texel on the unfiltered fast path.
+const float kTexelTolerance = 0.001f;
+
+// |x| / 255, rounded to nearest, for |x| in [0, 255 * 255].
+inline int Div255(int x) {
+  x += 128;
+  return (x + (x >> 8)) >> 8;
+}
+
+inline int Channel(uint32_t pixel, int shift) {
+  return (pixel >> shift) & 0xff;
+}
+
+inline uint32_t Pack(int a, int r, int g, int b) {
+  return (uint32_t(a) << 24) | (r << 16) | (g << 8) | b;
+}
+
+// -----------------------------------------------------------------------
+// Blending
+// -----------------------------------------------------------------------
+
+uint32_t BlendPixel(SpriteBlendMode blend, uint32_t s, uint32_t d, int alpha) {
+  if (blend == SPRITE_BLEND_REPLACE)
+    return s;
+
+  // The alpha channel is blended with the scaled alpha as its source value,
+  // as the vertex alpha has already been multiplied in when GL blends.
+  int a = Div255(Channel(s, 24) * alpha);
+  uint32_t out = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    int sc = shift == 24 ? a : Channel(s, shift);
+    int dc = Channel(d, shift);
+    int value;
+    if (blend == SPRITE_BLEND_ALPHA)
+      value = Div255(sc * a + dc * (255 - a));
+    else if (blend == SPRITE_BLEND_ADD)
+      value = std::min(255, dc + Div255(sc * a));
+    else
+      value = std::max(0, dc - Div255(sc * a));
+    out |= uint32_t(value) << shift;
+  }
+  return out;
+}
+
+void BlendRowScalar(SpriteBlendMode blend,
+                    const uint32_t* src,
+                    uint32_t* dst,
+                    int count,
+                    int alpha,
+                    bool keep_dst_alpha) {
+  for (int i = 0; i < count; ++i) {
+    uint32_t out = BlendPixel(blend, src[i], dst[i], alpha);
+    if (keep_dst_alpha)
+      out = (out & ~kAlphaMask) | (dst[i] & kAlphaMask);
+    dst[i] = out;
+  }
+}
+
+#if defined(RLVM_RASTER_SSE2)
+
+// |x| / 255, rounded, in each 16-bit lane.
+inline __m128i Div255SSE2(__m128i x) {
+  x = _mm_add_epi16(x, _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Copies the alpha of each of the two pixels unpacked into |v| to all four of
+// its lanes.
+inline __m128i SplatAlpha(__m128i v) {
+  v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+  return _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// Blends two unpacked pixels; |alpha| holds the global alpha in every lane.
+template <SpriteBlendMode kBlend>
+inline __m128i BlendHalfSSE2(__m128i s, __m128i d, __m128i alpha) {
+  const __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  __m128i a = Div255SSE2(_mm_mullo_epi16(SplatAlpha(s), alpha));
+  s = _mm_or_si128(_mm_andnot_si128(alpha_lanes, s),
+                   _mm_and_si128(alpha_lanes, a));
+  if (kBlend == SPRITE_BLEND_ALPHA) {
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return Div255SSE2(
+        _mm_add_epi16(_mm_mullo_epi16(s, a), _mm_mullo_epi16(d, inverse)));
+  }
+  return Div255SSE2(_mm_mullo_epi16(s, a));
+}
+
+template <SpriteBlendMode kBlend>
+inline __m128i BlendPixelsSSE2(__m128i s, __m128i d, __m128i alpha) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i lo = BlendHalfSSE2<kBlend>(_mm_unpacklo_epi8(s, zero),
+                                     _mm_unpacklo_epi8(d, zero), alpha);
+  __m128i hi = BlendHalfSSE2<kBlend>(_mm_unpackhi_epi8(s, zero),
+                                     _mm_unpackhi_epi8(d, zero), alpha);
+  __m128i blended = _mm_packus_epi16(lo, hi);
+  if (kBlend == SPRITE_BLEND_ADD)
+    return _mm_adds_epu8(d, blended);
+  if (kBlend == SPRITE_BLEND_SUBTRACT)
+    return _mm_subs_epu8(d, blended);
+  return blended;
+}
+
+template <SpriteBlendMode kBlend>
+int BlendRowSSE2(const uint32_t* src,
+                 uint32_t* dst,
+                 int count,
+                 int alpha,
+                 bool keep_dst_alpha) {
+  const __m128i global_alpha = _mm_set1_epi16(alpha);
+  const __m128i alpha_mask = _mm_set1_epi32(kAlphaMask);
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i* q = reinterpret_cast<__m128i*>(dst + i);
+
+    // Most sprites are mostly fully transparent or fully opaque, which don't
+    // need any arithmetic.
+    __m128i s_alpha = _mm_and_si128(s, alpha_mask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, zero)) == 0xffff)
+      continue;
+    __m128i d = _mm_loadu_si128(q);
+    __m128i out;
+    if (kBlend == SPRITE_BLEND_ALPHA && alpha == 255 &&
+        _mm_movemask_epi8(_mm_cmpeq_epi32(s_alpha, alpha_mask)) == 0xffff) {
+      out = s;
+    } else {
+      out = BlendPixelsSSE2<kBlend>(s, d, global_alpha);
+    }
+    if (keep_dst_alpha) {
+      out = _mm_or_si128(_mm_andnot_si128(alpha_mask, out),
+                         _mm_and_si128(alpha_mask, d));
+    }
+    _mm_storeu_si128(q, out);
+  }
+  return i;
+}
+
+#endif  // RLVM_RASTER_SSE2
+
+#if defined(RLVM_RASTER_NEON)
+
+// |x| / 255, rounded and narrowed to 8 bits.
+inline uint8x8_t Div255NEON(uint16x8_t x) {
+  x = vaddq_u16(x, vdupq_n_u16(128));
+  return vaddhn_u16(x, vshrq_n_u16(x, 8));
+}
+
+template <SpriteBlendMode kBlend>
+int BlendRowNEON(const uint32_t* src,
+                 uint32_t* dst,
+                 int count,
+                 int alpha,
+                 bool keep_dst_alpha) {
+  const uint8x8_t global_alpha = vdup_n_u8(alpha);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    // Deinterleaved into blue, green, red and alpha planes.
+    uint8x8x4_t s = vld4_u8(reinterpret_cast<const uint8_t*>(src + i));
+    uint8x8x4_t d = vld4_u8(reinterpret_cast<const uint8_t*>(dst + i));
+    uint8x8_t a = Div255NEON(vmull_u8(s.val[3], global_alpha));
+    uint8x8_t inverse = vmvn_u8(a);
+    s.val[3] = a;
+
+    uint8x8x4_t out;
+    for (int c = 0; c < 4; ++c) {
+      if (kBlend == SPRITE_BLEND_ALPHA) {
+        out.val[c] = Div255NEON(
+            vmlal_u8(vmull_u8(s.val[c], a), d.val[c], inverse));
+      } else if (kBlend == SPRITE_BLEND_ADD) {
+        out.val[c] = vqadd_u8(d.val[c], Div255NEON(vmull_u8(s.val[c], a)));
+      } else {
+        out.val[c] = vqsub_u8(d.val[c], Div255NEON(vmull_u8(s.val[c], a)));
+      }
+    }
+    if (keep_dst_alpha)
+      out.val[3] = d.val[3];
+    vst4_u8(reinterpret_cast<uint8_t*>(dst + i), out);
+  }
+  return i;
+}
+
+#endif  // RLVM_RASTER_NEON
+
+template <SpriteBlendMode kBlend>
+void BlendRowImpl(const uint32_t* src,
+                  uint32_t* dst,
+                  int count,
+                  int alpha,
+                  bool keep_dst_alpha) {
+  int done = 0;
+#if defined(RLVM_RASTER_SSE2)
+  done = BlendRowSSE2<kBlend>(src, dst, count, alpha, keep_dst_alpha);
+#elif defined(RLVM_RASTER_NEON)
+  done = BlendRowNEON<kBlend>(src, dst, count, alpha, keep_dst_alpha);
+#endif
+  BlendRowScalar(kBlend, src + done, dst + done, count - done, alpha,
+                 keep_dst_alpha);
+}
+
+// -----------------------------------------------------------------------
+// Sampling
+// -----------------------------------------------------------------------
+
+inline int Clamp(int value, int low, int high) {
+  return std::max(low, std::min(value, high));
+}
+
+// Texels outside |texture| repeat its edge. (The SDL backend's textures
+// repeat instead, but nothing samples outside the source rectangle except
+// bilinear filtering right at its border.)
+uint32_t SampleNearest(const RasterImage& texture, float u, float v) {
+  int x = Clamp(static_cast<int>(std::floor(u)), 0, texture.width - 1);
+  int y = Clamp(static_cast<int>(std::floor(v)), 0, texture.height - 1);
+  return texture.Row(y)[x];
+}
+
+// GL_LINEAR, with the 8 bits of weight precision common hardware uses.
+uint32_t SampleBilinear(const RasterImage& texture, float u, float v) {
+  float fx = u - 0.5f;
+  float fy = v - 0.5f;
+  int x = static_cast<int>(std::floor(fx));
+  int y = static_cast<int>(std::floor(fy));
+  int wx = static_cast<int>((fx - x) * 256 + 0.5f);
+  int wy = static_cast<int>((fy - y) * 256 + 0.5f);
+  if (wx == 256) {
+    x++;
+    wx = 0;
+  }
+  if (wy == 256) {
+    y++;
+    wy = 0;
+  }
+
+  int x0 = Clamp(x, 0, texture.width - 1);
+  int y0 = Clamp(y, 0, texture.height - 1);
+  if (wx == 0 && wy == 0)
+    return texture.Row(y0)[x0];
+
+  int x1 = Clamp(x + 1, 0, texture.width - 1);
+  int y1 = Clamp(y + 1, 0, texture.height - 1);
+  uint32_t p00 = texture.Row(y0)[x0], p10 = texture.Row(y0)[x1];
+  uint32_t p01 = texture.Row(y1)[x0], p11 = texture.Row(y1)[x1];
+  uint32_t out = 0;
+  for (int shift = 0; shift < 32; shift += 8) {
+    int top = Channel(p00, shift) * (256 - wx) + Channel(p10, shift) * wx;
+    int bottom = Channel(p01, shift) * (256 - wx) + Channel(p11, shift) * wx;
+    int value = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+    out |= uint32_t(value) << shift;
+  }
+  return out;
+}
+
+// -----------------------------------------------------------------------
+// Colour effects
+// -----------------------------------------------------------------------
+
+inline float Mix(float x, float y, float a) { return x * (1.0f - a) + y * a; }
+
+// tinter() from the object shader.
+inline float Tint(float value, float tint) {
+  if (tint > 0.0f)
+    return value + tint - value * tint;
+  if (tint < 0.0f)
+    return value * -tint;
+  return value;
+}
+
+inline int ToByte(float value) {
+  return static_cast<int>(std::max(0.0f, std::min(value, 1.0f)) * 255.0f +
+                          0.5f);
+}
+
+// The body of kObjectShader, applied to a pixel already multiplied by the
+// vertex colour.
+uint32_t ApplyEffects(const SpriteEffects& e, uint32_t pixel) {
+  float rgb[3] = {Channel(pixel, 16) / 255.0f, Channel(pixel, 8) / 255.0f,
+                  Channel(pixel, 0) / 255.0f};
+
+  for (int i = 0; i < 3; ++i)
+    rgb[i] = Mix(rgb[i], e.colour[i], e.colour[3]);
+
+  if (e.mono > 0.0f) {
+    float grey = rgb[0] * 0.299f + rgb[1] * 0.587f + rgb[2] * 0.114f;
+    for (int i = 0; i < 3; ++i)
+      rgb[i] = Mix(rgb[i], grey, e.mono);
+  }
+
+  if (e.invert > 0.0f) {
+    for (int i = 0; i < 3; ++i)
+      rgb[i] = Mix(rgb[i], 1.0f - rgb[i], e.invert);
+  }
+
+  for (int i = 0; i < 3; ++i)
+    rgb[i] = Tint(Tint(rgb[i], e.light), e.tint[i]);
+
+  return Pack(Channel(pixel, 24), ToByte(rgb[0]), ToByte(rgb[1]),
+              ToByte(rgb[2]));
+}
+
+// Multiplies |pixel| by the vertex colour (|red|, |green|, |blue|, |alpha|).
+inline uint32_t Modulate(uint32_t pixel, int red, int green, int blue,
+                         int alpha) {
+  return Pack(Div255(Channel(pixel, 24) * alpha),
+              Div255(Channel(pixel, 16) * red),
+              Div255(Channel(pixel, 8) * green),
+              Div255(Channel(pixel, 0) * blue));
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+
+void BlendRow(SpriteBlendMode blend,
+              const uint32_t* src,
+              uint32_t* dst,
+              int count,
+              int alpha) {
+  switch (blend) {
+    case SPRITE_BLEND_ALPHA:
+      BlendRowImpl<SPRITE_BLEND_ALPHA>(src, dst, count, alpha, false);
+      break;
+    case SPRITE_BLEND_ADD:
+      BlendRowImpl<SPRITE_BLEND_ADD>(src, dst, count, alpha, false);
+      break;
+    case SPRITE_BLEND_SUBTRACT:
+      BlendRowImpl<SPRITE_BLEND_SUBTRACT>(src, dst, count, alpha, false);
+      break;
+    case SPRITE_BLEND_REPLACE:
+      std::copy(src, src + count, dst);
+      break;
+  }
+}
+
+void BlitRow(const uint32_t* src, uint32_t* dst, int count, int alpha) {
+  BlendRowImpl<SPRITE_BLEND_ALPHA>(src, dst, count, alpha, true);
+}
+
+void RasterizeQuad(const RasterImage& texture,
+                   SpriteBlendMode blend,
+                   const SpriteQuad& quad,
+                   const Rect& clip,
+                   const RasterImage& target) {
+  const float width = quad.x2 - quad.x1;
+  const float height = quad.y2 - quad.y1;
+  if (width == 0 || height == 0 || texture.width <= 0 || texture.height <= 0)
+    return;
+
+  // Place the corners the way SpriteBatch::Add() does.
+  float c = 1.0f, s = 0.0f;
+  if (quad.rotation != 0) {
+    const float radians = quad.rotation * 3.14159265358979f / 180.0f;
+    c = std::cos(radians);
+    s = std::sin(radians);
+  }
+  const float cx = quad.x1 + quad.pivot_x;
+  const float cy = quad.y1 + quad.pivot_y;
+  const float xs[4] = {quad.x1, quad.x2, quad.x2, quad.x1};
+  const float ys[4] = {quad.y1, quad.y1, quad.y2, quad.y2};
+  float min_x = 1e30f, max_x = -1e30f, min_y = 1e30f, max_y = -1e30f;
+  for (int i = 0; i < 4; ++i) {
+    float x = cx + (xs[i] - cx) * c - (ys[i] - cy) * s;
+    float y = cy + (xs[i] - cx) * s + (ys[i] - cy) * c;
+    min_x = std::min(min_x, x);
+    max_x = std::max(max_x, x);
+    min_y = std::min(min_y, y);
+    max_y = std::max(max_y, y);
+  }
+
+  Rect area = clip.Intersection(Rect(Point(0, 0),
+                                     Size(target.width, target.height)));
+  area = area.Intersection(
+      Rect::GRP(static_cast<int>(std::floor(min_x)),
+                static_cast<int>(std::floor(min_y)),
+                static_cast<int>(std::ceil(max_x)),
+                static_cast<int>(std::ceil(max_y))));
+  if (area.width() <= 0 || area.height() <= 0)
+    return;
+
+  // A pixel is covered when its centre maps back inside the unrotated quad,
+  // at (s, t) in [0, 1) x [0, 1). Both are affine in the pixel position.
+  const float ds_dx = c / width, ds_dy = s / width;
+  const float dt_dx = -s / height, dt_dy = c / height;
+  const float tex_du = (quad.u2 - quad.u1) * texture.width;
+  const float tex_dv = (quad.v2 - quad.v1) * texture.height;
+  const float tex_u1 = quad.u1 * texture.width;
+  const float tex_v1 = quad.v1 * texture.height;
+
+  // Texels per pixel decides between GL_LINEAR and GL_NEAREST.
+  float footprint = std::max(std::hypot(tex_du * ds_dx, tex_dv * dt_dx),
+                             std::hypot(tex_du * ds_dy, tex_dv * dt_dy));
+  bool bilinear = footprint <= kMaxMagnification;
+
+  const bool uniform_alpha = quad.alpha[0] == quad.alpha[1] &&
+                             quad.alpha[0] == quad.alpha[2] &&
+                             quad.alpha[0] == quad.alpha[3];
+  const bool white = quad.red == 255 && quad.green == 255 && quad.blue == 255;
+  const bool effects = quad.effects.Any();
+
+  // Unrotated, unscaled quads which land on whole texels read straight out
+  // of the texture and go to the blend kernels a row at a time. (Normalized
+  // texture coordinates don't survive the round trip through floats exactly,
+  // hence the tolerances.)
+  float first_u = tex_u1 + tex_du * ((area.x() + 0.5f - quad.x1) / width);
+  float first_v = tex_v1 + tex_dv * ((area.y() + 0.5f - quad.y1) / height);
+  int texel_x = static_cast<int>(std::floor(first_u));
+  int texel_y = static_cast<int>(std::floor(first_v));
+  if (quad.rotation == 0 && std::abs(tex_du - width) < kTexelTolerance &&
+      std::abs(tex_dv - height) < kTexelTolerance &&
+      std::abs(first_u - texel_x - 0.5f) < kTexelTolerance &&
+      std::abs(first_v - texel_y - 0.5f) < kTexelTolerance &&
+      uniform_alpha && white && !effects && texel_x >= 0 && texel_y >= 0 &&
+      texel_x + area.width() <= texture.width &&
+      texel_y + area.height() <= texture.height) {
+    for (int y = 0; y < area.height(); ++y) {
+      BlendRow(blend, texture.Row(texel_y + y) + texel_x,
+               target.Row(area.y() + y) + area.x(), area.width(),
+               quad.alpha[0]);
+    }
+    return;
+  }
+
+  std::vector<uint32_t> row(area.width());
+  for (int y = area.y(); y < area.y2(); ++y) {
+    // (s, t) at the centre of the first pixel of the row.
+    float dx = area.x() + 0.5f - cx;
+    float dy = y + 0.5f - cy;
+    float s0 = (cx + dx * c + dy * s - quad.x1) / width;
+    float t0 = (cy - dx * s + dy * c - quad.y1) / height;
+    auto inside = [&](int i) {
+      float ps = s0 + i * ds_dx;
+      float pt = t0 + i * dt_dx;
+      return ps >= 0.0f && ps < 1.0f && pt >= 0.0f && pt < 1.0f;
+    };
+
+    // The covered pixels of a row are contiguous, so find where they start
+    // and end analytically and settle rounding at the two ends.
+    float low = 0, high = area.width();
+    const float starts[2] = {s0, t0};
+    const float steps[2] = {ds_dx, dt_dx};
+    for (int k = 0; k < 2; ++k) {
+      if (steps[k] > 0) {
+        low = std::max(low, -starts[k] / steps[k]);
+        high = std::min(high, (1.0f - starts[k]) / steps[k]);
+      } else if (steps[k] < 0) {
+        low = std::max(low, (1.0f - starts[k]) / steps[k]);
+        high = std::min(high, -starts[k] / steps[k]);
+      }
+    }
+    if (low > high)
+      continue;
+    int first = Clamp(static_cast<int>(std::ceil(low)), 0, area.width());
+    int last = Clamp(static_cast<int>(std::ceil(high)), 0, area.width());
+    while (first > 0 && inside(first - 1))
+      first--;
+    while (first < last && !inside(first))
+      first++;
+    while (last < area.width() && inside(last))
+      last++;
+    while (last > first && !inside(last - 1))
+      last--;
+    if (first == last)
+      continue;
+
+    for (int i = first; i < last; ++i) {
+      float ps = s0 + i * ds_dx;
+      float pt = t0 + i * dt_dx;
+      float u = tex_u1 + ps * tex_du;
+      float v = tex_v1 + pt * tex_dv;
+      uint32_t pixel = bilinear ? SampleBilinear(texture, u, v)
+                                : SampleNearest(texture, u, v);
+
+      // OpenGL interpolates per vertex alpha over two triangles; bilinear
+      // interpolation agrees with that whenever the alpha only changes
+      // along one side, which is how every fade and wipe uses it.
+      int alpha = quad.alpha[0];
+      if (!uniform_alpha) {
+        float top = Mix(quad.alpha[0], quad.alpha[1], ps);
+        float bottom = Mix(quad.alpha[3], quad.alpha[2], ps);
+        alpha = static_cast<int>(Mix(top, bottom, pt) + 0.5f);
+      }
+      if (!white || alpha != 255)
+        pixel = Modulate(pixel, quad.red, quad.green, quad.blue, alpha);
+      if (effects)
+        pixel = ApplyEffects(quad.effects, pixel);
+      row[i] = pixel;
+    }
+
+    BlendRow(blend, row.data() + first, target.Row(y) + area.x() + first,
+             last - first, 255);
+  }
+}
+
+void RasterizeColourMask(const RasterImage& mask,
+                         const Rect& src,
+                         const Rect& dst,
+                         const RGBAColour& colour,
+                         const Rect& clip,
+                         const RasterImage& target) {
+  if (src.width() <= 0 || src.height() <= 0 || dst.width() <= 0 ||
+      dst.height() <= 0 || mask.width <= 0 || mask.height <= 0)
+    return;
+
+  Rect area = clip.Intersection(Rect(Point(0, 0),
+                                     Size(target.width, target.height)));
+  area = area.Intersection(dst);
+  if (area.width() <= 0 || area.height() <= 0)
+    return;
+
+  // How much each destination channel is pulled down by a fully opaque mask
+  // texel: bg - m + colour * m.
+  const int darken[4] = {255 - colour.b(), 255 - colour.g(), 255 - colour.r(),
+                         255 - colour.a()};
+  for (int y = area.y(); y < area.y2(); ++y) {
+    int mask_y = src.y() + (2 * (y - dst.y()) + 1) * src.height() /
+                               (2 * dst.height());
+    const uint32_t* mask_row =
+        mask.Row(Clamp(mask_y, 0, mask.height - 1));
+    uint32_t* out = target.Row(y);
+    for (int x = area.x(); x < area.x2(); ++x) {
+      int mask_x = src.x() + (2 * (x - dst.x()) + 1) * src.width() /
+                                 (2 * dst.width());
+      int m = Div255(Channel(mask_row[Clamp(mask_x, 0, mask.width - 1)], 24) *
+                     colour.a());
+      if (m == 0)
+        continue;
+
+      uint32_t pixel = out[x];
+      uint32_t result = 0;
+      for (int k = 0; k < 4; ++k) {
+        int value = Channel(pixel, k * 8) - Div255(m * darken[k]);
+        result |= uint32_t(std::max(0, value)) << (k * 8);
+      }
+      out[x] = result;
+    }
+  }
+}
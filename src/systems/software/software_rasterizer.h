@@ -0,0 +1,99 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_SOFTWARE_SOFTWARE_RASTERIZER_H_
+#define SRC_SYSTEMS_SOFTWARE_SOFTWARE_RASTERIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "systems/base/rect.h"
+#include "systems/base/sprite_batch.h"
+
+class RGBAColour;
+
+// The drawing primitives behind SoftwareGraphicsSystem: the same quads the
+// OpenGL SpriteRenderer is handed, filled on the CPU with the sampling and
+// blending rules of the SDL backend (nearest texels when shrinking, bilinear
+// when enlarging, the object shader's colour effects, and GL's blend
+// equations with exact rounding).
+//
+// Blending runs four pixels at a time with SSE2 on x86 and eight at a time
+// with NEON on little endian ARM; texel fetches and colour effects are
+// scalar.
+
+// A block of 32-bit 0xAARRGGBB pixels, |stride| pixels from one row to the
+// next. Doesn't own the pixels.
+struct RasterImage {
+  RasterImage() : pixels(NULL), width(0), height(0), stride(0) {}
+  RasterImage(uint32_t* pixels, int width, int height, int stride)
+      : pixels(pixels), width(width), height(height), stride(stride) {}
+
+  uint32_t* Row(int y) const {
+    return pixels + static_cast<ptrdiff_t>(y) * stride;
+  }
+
+  uint32_t* pixels;
+  int width;
+  int height;
+  int stride;
+};
+
+// Blends |count| pixels of |src| onto |dst| the way glBlendFunc() does for
+// |blend|, after scaling the source alpha by |alpha|. The alpha channel is
+// blended like the colour channels.
+void BlendRow(SpriteBlendMode blend,
+              const uint32_t* src,
+              uint32_t* dst,
+              int count,
+              int alpha);
+
+// Alpha blends |count| pixels of |src| onto |dst| like an SDL blit with
+// SDL_SRCALPHA: the source alpha (scaled by |alpha|) mixes the colours, and
+// the destination keeps its own alpha.
+void BlitRow(const uint32_t* src, uint32_t* dst, int count, int alpha);
+
+// Draws |quad| onto |target|, reading texture coordinates in |texture|, and
+// touches only the pixels inside |clip|.
+void RasterizeQuad(const RasterImage& texture,
+                   SpriteBlendMode blend,
+                   const SpriteQuad& quad,
+                   const Rect& clip,
+                   const RasterImage& target);
+
+// The subtractive colour mask text windows use for their backgrounds (see
+// kColorMaskShader): every pixel of |dst| is darkened by the alpha of the
+// matching |src| pixel of |mask| and |colour|'s alpha, then tinted by
+// |colour| by the same amount.
+void RasterizeColourMask(const RasterImage& mask,
+                         const Rect& src,
+                         const Rect& dst,
+                         const RGBAColour& colour,
+                         const Rect& clip,
+                         const RasterImage& target);
+
+#endif  // SRC_SYSTEMS_SOFTWARE_SOFTWARE_RASTERIZER_H_
@@ -0,0 +1,474 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "systems/software/software_surface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include "systems/base/colour.h"
+#include "systems/base/graphics_object.h"
+#include "systems/base/system_error.h"
+#include "systems/software/software_graphics_system.h"
+#include "utilities/pixel_conversion.h"
+
+namespace {
+
+const uint32_t kAlphaMask = 0xff000000;
+const uint32_t kColourMask = 0x00ffffff;
+
+// Where the channels of our pixels are, for the pixel_conversion.h kernels.
+const int kRedShift = 16;
+const int kGreenShift = 8;
+const int kBlueShift = 0;
+
+inline uint32_t PackColour(const RGBAColour& colour) {
+  return (uint32_t(colour.a()) << 24) | (colour.r() << 16) |
+         (colour.g() << 8) | colour.b();
+}
+
+// The #colour operation on a single channel value. (The same as SDLSurface's.)
+int ComposeColour(int in_colour, int surface_colour) {
+  if (in_colour > 0) {
+    return 255 -
+           ((static_cast<float>((255 - in_colour) * (255 - surface_colour)) /
+             (255 * 255)) *
+            255);
+  } else if (in_colour < 0) {
+    return (static_cast<float>(abs(in_colour) * surface_colour) /
+            (255 * 255)) *
+           255;
+  } else {
+    return surface_colour;
+  }
+}
+
+float our_round(float r) {
+  return (r > 0.0f) ? floor(r + 0.5f) : ceil(r - 0.5f);
+}
+
+}  // namespace
+
+// -----------------------------------------------------------------------
+// SoftwareSurface
+// -----------------------------------------------------------------------
+
+SoftwareSurface::SoftwareSurface(SoftwareGraphicsSystem* system)
+    : system_(system), is_dc0_(false), is_mask_(false) {}
+
+SoftwareSurface::SoftwareSurface(SoftwareGraphicsSystem* system,
+                                 const Size& size)
+    : system_(system), is_dc0_(false), is_mask_(false) {
+  allocate(size);
+}
+
+SoftwareSurface::SoftwareSurface(SoftwareGraphicsSystem* system,
+                                 const Size& size,
+                                 std::vector<uint32_t>* pixels,
+                                 const std::vector<GrpRect>& region_table)
+    : system_(system),
+      size_(size),
+      region_table_(region_table),
+      is_dc0_(false),
+      is_mask_(false) {
+  pixels_.swap(*pixels);
+  if (region_table_.empty())
+    BuildRegionTable(size);
+}
+
+SoftwareSurface::~SoftwareSurface() {}
+
+void SoftwareSurface::allocate(const Size& size) {
+  size_ = size;
+  pixels_.assign(size.width() * size.height(), 0);
+  BuildRegionTable(size);
+  Fill(RGBAColour::Black());
+}
+
+void SoftwareSurface::allocate(const Size& size, bool is_dc0) {
+  is_dc0_ = is_dc0;
+  allocate(size);
+}
+
+void SoftwareSurface::deallocate() {
+  std::vector<uint32_t>().swap(pixels_);
+  size_ = Size();
+}
+
+RasterImage SoftwareSurface::image() const {
+  return RasterImage(const_cast<uint32_t*>(pixels_.data()), size_.width(),
+                     size_.height(), size_.width());
+}
+
+void SoftwareSurface::MakeOpaque() {
+  for (uint32_t& pixel : pixels_)
+    pixel |= kAlphaMask;
+}
+
+void SoftwareSurface::Fill(const RGBAColour& colour) {
+  std::fill(pixels_.begin(), pixels_.end(), PackColour(colour));
+  MarkWrittenTo(GetRect());
+}
+
+void SoftwareSurface::Fill(const RGBAColour& colour, const Rect& area) {
+  uint32_t pixel = PackColour(colour);
+  TransformRows(area, [pixel](uint32_t* row, int count) {
+    std::fill(row, row + count, pixel);
+  });
+}
+
+void SoftwareSurface::ToneCurve(const ToneCurveRGBMap effect,
+                                const Rect& area) {
+  TransformRows(area, [&effect](uint32_t* row, int count) {
+    MapColourChannels(row, count, effect[0].data(), effect[1].data(),
+                      effect[2].data(), kRedShift, kGreenShift, kBlueShift);
+  });
+}
+
+void SoftwareSurface::Invert(const Rect& area) {
+  TransformRows(area, [](uint32_t* row, int count) {
+    InvertColourChannels(row, count, kColourMask);
+  });
+}
+
+void SoftwareSurface::Mono(const Rect& area) {
+  TransformRows(area, [](uint32_t* row, int count) {
+    MonoColourChannels(row, count, kRedShift, kGreenShift, kBlueShift);
+  });
+}
+
+void SoftwareSurface::ApplyColour(const RGBColour& colour, const Rect& area) {
+  ToneCurveRGBMap tables;
+  for (int i = 0; i < 256; ++i) {
+    tables[0][i] = ComposeColour(colour.r(), i);
+    tables[1][i] = ComposeColour(colour.g(), i);
+    tables[2][i] = ComposeColour(colour.b(), i);
+  }
+  ToneCurve(tables, area);
+}
+
+Size SoftwareSurface::GetSize() const { return size_; }
+
+void SoftwareSurface::BlitToSurface(Surface& dest_surface,
+                                    const Rect& src,
+                                    const Rect& dst,
+                                    int alpha,
+                                    bool use_src_alpha) const {
+  SoftwareSurface& dest = dynamic_cast<SoftwareSurface&>(dest_surface);
+  if (src.width() <= 0 || src.height() <= 0 || dst.width() <= 0 ||
+      dst.height() <= 0)
+    return;
+
+  // Stretched blits (and blits within one surface) go through a copy of
+  // |src| scaled to |dst|'s size, with nearest neighbour sampling like
+  // pygame_stretch(). Pixels from outside this surface come out transparent.
+  RasterImage from = image();
+  Rect from_rect = src;
+  std::vector<uint32_t> scratch;
+  if (src.size() != dst.size() || &dest == this) {
+    scratch.assign(dst.width() * dst.height(), 0);
+    for (int y = 0; y < dst.height(); ++y) {
+      int sy = src.y() + y * src.height() / dst.height();
+      if (sy < 0 || sy >= size_.height())
+        continue;
+      const uint32_t* in = from.Row(sy);
+      uint32_t* out = scratch.data() + y * dst.width();
+      for (int x = 0; x < dst.width(); ++x) {
+        int sx = src.x() + x * src.width() / dst.width();
+        if (sx >= 0 && sx < size_.width())
+          out[x] = in[sx];
+      }
+    }
+    from = RasterImage(scratch.data(), dst.width(), dst.height(), dst.width());
+    from_rect = Rect(Point(0, 0), dst.size());
+  }
+
+  // Clip the way SDL_BlitSurface() does: the source rectangle to its
+  // surface, then the destination to its.
+  int sx = from_rect.x(), sy = from_rect.y();
+  int dx = dst.x(), dy = dst.y();
+  int w = from_rect.width(), h = from_rect.height();
+  if (sx < 0) {
+    dx -= sx;
+    w += sx;
+    sx = 0;
+  }
+  if (sy < 0) {
+    dy -= sy;
+    h += sy;
+    sy = 0;
+  }
+  w = std::min(w, from.width - sx);
+  h = std::min(h, from.height - sy);
+  if (dx < 0) {
+    sx -= dx;
+    w += dx;
+    dx = 0;
+  }
+  if (dy < 0) {
+    sy -= dy;
+    h += dy;
+    dy = 0;
+  }
+  w = std::min(w, dest.size_.width() - dx);
+  h = std::min(h, dest.size_.height() - dy);
+  if (w <= 0 || h <= 0)
+    return;
+
+  RasterImage to = dest.image();
+  for (int y = 0; y < h; ++y) {
+    const uint32_t* in = from.Row(sy + y) + sx;
+    uint32_t* out = to.Row(dy + y) + dx;
+    if (use_src_alpha)
+      BlitRow(in, out, w, alpha);
+    else
+      std::copy(in, in + w, out);
+  }
+
+  dest.MarkWrittenTo(Rect(Point(dx, dy), Size(w, h)));
+}
+
+void SoftwareSurface::RenderToScreen(const Rect& src,
+                                     const Rect& dst,
+                                     int alpha) const {
+  SpriteQuad quad;
+  if (!MakeQuad(src, dst, &quad))
+    return;
+
+  std::fill(quad.alpha, quad.alpha + 4, alpha);
+  system_->Draw(*this, SPRITE_BLEND_ALPHA, quad);
+}
+
+void SoftwareSurface::RenderToScreenAsColorMask(const Rect& src,
+                                                const Rect& dst,
+                                                const RGBAColour& colour,
+                                                int filter) const {
+  if (filter == 0) {
+    Rect clipped_src = src;
+    Rect clipped_dst = dst;
+    if (ClipToSurface(&clipped_src, &clipped_dst))
+      system_->DrawColourMask(*this, clipped_src, clipped_dst, colour);
+  } else {
+    SpriteQuad quad;
+    if (!MakeQuad(src, dst, &quad))
+      return;
+
+    // Texture has always drawn this with its texture coordinates truncated
+    // to integers.
+    quad.u1 = static_cast<int>(quad.u1);
+    quad.v1 = static_cast<int>(quad.v1);
+    quad.u2 = static_cast<int>(quad.u2);
+    quad.v2 = static_cast<int>(quad.v2);
+    quad.red = colour.r();
+    quad.green = colour.g();
+    quad.blue = colour.b();
+    std::fill(quad.alpha, quad.alpha + 4, colour.a());
+    system_->Draw(*this, SPRITE_BLEND_ALPHA, quad);
+  }
+}
+
+void SoftwareSurface::RenderToScreen(const Rect& src,
+                                     const Rect& dst,
+                                     const int opacity[4]) const {
+  SpriteQuad quad;
+  if (!MakeQuad(src, dst, &quad))
+    return;
+
+  std::copy(opacity, opacity + 4, quad.alpha);
+
+  // Blend when we have less opacity
+  bool translucent =
+      std::find_if(opacity, opacity + 4, [](int o) { return o < 255; }) !=
+      opacity + 4;
+  system_->Draw(*this, translucent ? SPRITE_BLEND_ALPHA : SPRITE_BLEND_REPLACE,
+                quad);
+}
+
+void SoftwareSurface::RenderToScreenAsObject(const GraphicsObject& go,
+                                             const Rect& src,
+                                             const Rect& dst,
+                                             int alpha) const {
+  SpriteQuad quad;
+  if (!MakeQuad(src, dst, &quad))
+    return;
+
+  SpriteBlendMode blend;
+  switch (go.composite_mode()) {
+    case 0:
+      blend = SPRITE_BLEND_ALPHA;
+      break;
+    case 1:
+      blend = SPRITE_BLEND_ADD;
+      break;
+    case 2:
+      blend = SPRITE_BLEND_SUBTRACT;
+      break;
+    default: {
+      std::ostringstream oss;
+      oss << "Invalid composite_mode in render: " << go.composite_mode();
+      throw SystemError(oss.str());
+    }
+  }
+
+  std::fill(quad.alpha, quad.alpha + 4, alpha);
+
+  // Rotate the image around the point (origin + position + reporigin)
+  quad.rotation = float(go.rotation()) / 10;
+  quad.pivot_x = ((quad.x2 - quad.x1) / 2.0f) + go.rep_origin_x();
+  quad.pivot_y = ((quad.y2 - quad.y1) / 2.0f) + go.rep_origin_y();
+
+  quad.effects = SpriteEffects::FromGraphicsObject(go);
+  system_->Draw(*this, blend, quad);
+}
+
+int SoftwareSurface::GetNumPatterns() const { return region_table_.size(); }
+
+const Surface::GrpRect& SoftwareSurface::GetPattern(int patt_no) const {
+  if (patt_no < region_table_.size())
+    return region_table_[patt_no];
+  else
+    return region_table_[0];
+}
+
+void SoftwareSurface::GetDCPixel(const Point& pos,
+                                 int& r,
+                                 int& g,
+                                 int& b) const {
+  r = g = b = 0;
+  if (pos.x() < 0 || pos.y() < 0 || pos.x() >= size_.width() ||
+      pos.y() >= size_.height())
+    return;
+
+  uint32_t pixel = pixels_[pos.y() * size_.width() + pos.x()];
+  r = (pixel >> kRedShift) & 0xff;
+  g = (pixel >> kGreenShift) & 0xff;
+  b = (pixel >> kBlueShift) & 0xff;
+}
+
+std::shared_ptr<Surface> SoftwareSurface::ClipAsColorMask(const Rect& clip_rect,
+                                                          int r,
+                                                          int g,
+                                                          int b) const {
+  // Pixels of the key colour become fully transparent and everything else
+  // fully opaque, as with SDL's colour keyed blit.
+  const uint32_t key = (r << kRedShift) | (g << kGreenShift) |
+                       (b << kBlueShift);
+  std::vector<uint32_t> clipped(
+      std::max(0, clip_rect.width()) * std::max(0, clip_rect.height()), 0);
+  Rect area = clip_rect.Intersection(GetRect());
+  for (int y = area.y(); y < area.y2(); ++y) {
+    const uint32_t* in = pixels_.data() + y * size_.width();
+    uint32_t* out = clipped.data() + (y - clip_rect.y()) * clip_rect.width() -
+                    clip_rect.x();
+    for (int x = area.x(); x < area.x2(); ++x) {
+      uint32_t colour = in[x] & kColourMask;
+      out[x] = colour == key ? 0 : (colour | kAlphaMask);
+    }
+  }
+
+  return std::shared_ptr<Surface>(new SoftwareSurface(
+      system_, clip_rect.size(), &clipped, std::vector<GrpRect>()));
+}
+
+Surface* SoftwareSurface::Clone() const {
+  std::vector<uint32_t> pixels(pixels_);
+  return new SoftwareSurface(system_, size_, &pixels, region_table_);
+}
+
+void SoftwareSurface::BuildRegionTable(const Size& size) {
+  GrpRect rect;
+  rect.rect = Rect(Point(0, 0), size);
+  rect.originX = 0;
+  rect.originY = 0;
+  region_table_.clear();
+  region_table_.push_back(rect);
+}
+
+template <typename RowKernel>
+void SoftwareSurface::TransformRows(const Rect& area,
+                                    const RowKernel& kernel) {
+  Rect clipped = area.Intersection(GetRect());
+  if (clipped.width() <= 0 || clipped.height() <= 0)
+    return;
+
+  RasterImage pixels = image();
+  for (int y = clipped.y(); y < clipped.y2(); ++y)
+    kernel(pixels.Row(y) + clipped.x(), clipped.width());
+
+  MarkWrittenTo(clipped);
+}
+
+bool SoftwareSurface::ClipToSurface(Rect* src, Rect* dst) const {
+  int x1 = src->x(), y1 = src->y(), w1 = src->width(), h1 = src->height();
+  int width = size_.width();
+  int height = size_.height();
+  if (w1 == 0 || h1 == 0 ||
+      !(x1 + w1 >= 0 && x1 < width && y1 + h1 >= 0 && y1 < height))
+    return false;
+
+  // Trim the source to the surface and move the destination edges by the
+  // same proportion.
+  int vir_x = std::max(x1, 0);
+  int vir_y = std::max(y1, 0);
+  int w = std::min(x1 + w1, width) - vir_x;
+  int h = std::min(y1 + h1, height) - vir_y;
+  int dx1 = our_round(dst->x() + dst->width() * ((vir_x - x1) / float(w1)));
+  int dx2 = our_round(dx1 + dst->width() * (w / float(w1)));
+  int dy1 = our_round(dst->y() + dst->height() * ((vir_y - y1) / float(h1)));
+  int dy2 = our_round(dy1 + dst->height() * (h / float(h1)));
+
+  *src = Rect::REC(vir_x, vir_y, w, h);
+  *dst = Rect::GRP(dx1, dy1, dx2, dy2);
+  return true;
+}
+
+bool SoftwareSurface::MakeQuad(const Rect& src,
+                               const Rect& dst,
+                               SpriteQuad* quad) const {
+  Rect clipped_src = src;
+  Rect clipped_dst = dst;
+  if (!ClipToSurface(&clipped_src, &clipped_dst))
+    return false;
+
+  quad->x1 = clipped_dst.x();
+  quad->y1 = clipped_dst.y();
+  quad->x2 = clipped_dst.x2();
+  quad->y2 = clipped_dst.y2();
+  quad->u1 = float(clipped_src.x()) / size_.width();
+  quad->v1 = float(clipped_src.y()) / size_.height();
+  quad->u2 = float(clipped_src.x2()) / size_.width();
+  quad->v2 = float(clipped_src.y2()) / size_.height();
+  return true;
+}
+
+void SoftwareSurface::MarkWrittenTo(const Rect& area) {
+  if (is_dc0_ && system_)
+    system_->MarkScreenAsDirty(GUT_DRAW_DC0, area);
+}
@@ -0,0 +1,149 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#ifndef SRC_SYSTEMS_SOFTWARE_SOFTWARE_SURFACE_H_
+#define SRC_SYSTEMS_SOFTWARE_SOFTWARE_SURFACE_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "systems/base/surface.h"
+#include "systems/base/tone_curve.h"
+#include "systems/software/software_rasterizer.h"
+
+class GraphicsObject;
+class SoftwareGraphicsSystem;
+
+// A Surface kept entirely in memory as 32-bit 0xAARRGGBB pixels (the layout
+// the image decoders produce). Blits and colour operations behave like
+// SDLSurface's; the RenderToScreen*() family draws into the frame
+// SoftwareGraphicsSystem is putting together instead of queueing textured
+// quads for OpenGL.
+class SoftwareSurface : public Surface {
+ public:
+  // An unallocated surface, for DCs which haven't been used yet.
+  explicit SoftwareSurface(SoftwareGraphicsSystem* system);
+
+  // A black surface of |size| with a single region.
+  SoftwareSurface(SoftwareGraphicsSystem* system, const Size& size);
+
+  // Takes |pixels|, which must hold |size|'s worth of pixels.
+  SoftwareSurface(SoftwareGraphicsSystem* system,
+                  const Size& size,
+                  std::vector<uint32_t>* pixels,
+                  const std::vector<GrpRect>& region_table);
+  ~SoftwareSurface();
+
+  bool allocated() const { return !pixels_.empty(); }
+
+  void allocate(const Size& size);
+  void allocate(const Size& size, bool is_dc0);
+  void deallocate();
+
+  // The pixels, for the rasterizer.
+  RasterImage image() const;
+
+  // Sets the alpha of every pixel to 0xff.
+  void MakeOpaque();
+
+  virtual void SetIsMask(const bool is) override { is_mask_ = is; }
+
+  // Surface:
+  virtual void Fill(const RGBAColour& colour) override;
+  virtual void Fill(const RGBAColour& colour, const Rect& area) override;
+  virtual void ToneCurve(const ToneCurveRGBMap effect,
+                         const Rect& area) override;
+  virtual void Invert(const Rect& area) override;
+  virtual void Mono(const Rect& area) override;
+  virtual void ApplyColour(const RGBColour& colour, const Rect& area) override;
+  virtual Size GetSize() const override;
+  virtual void BlitToSurface(Surface& dest_surface,
+                             const Rect& src,
+                             const Rect& dst,
+                             int alpha = 255,
+                             bool use_src_alpha = true) const override;
+  virtual void RenderToScreen(const Rect& src,
+                              const Rect& dst,
+                              int alpha = 255) const override;
+  virtual void RenderToScreenAsColorMask(const Rect& src,
+                                         const Rect& dst,
+                                         const RGBAColour& colour,
+                                         int filter) const override;
+  virtual void RenderToScreen(const Rect& src,
+                              const Rect& dst,
+                              const int opacity[4]) const override;
+  virtual void RenderToScreenAsObject(const GraphicsObject& go,
+                                      const Rect& src,
+                                      const Rect& dst,
+                                      int alpha) const override;
+  virtual int GetNumPatterns() const override;
+  virtual const GrpRect& GetPattern(int patt_no) const override;
+  virtual void GetDCPixel(const Point& pos,
+                          int& r,
+                          int& g,
+                          int& b) const override;
+  virtual std::shared_ptr<Surface> ClipAsColorMask(const Rect& clip_rect,
+                                                   int r,
+                                                   int g,
+                                                   int b) const override;
+  virtual Surface* Clone() const override;
+
+ private:
+  void BuildRegionTable(const Size& size);
+
+  // Runs |kernel| over each row of |area|, clipped to the surface, and
+  // reports the change.
+  template <typename RowKernel>
+  void TransformRows(const Rect& area, const RowKernel& kernel);
+
+  // Trims |src| to the surface and |dst| in proportion, or returns false if
+  // |src| is off the surface. Mirrors Texture::filterCoords().
+  bool ClipToSurface(Rect* src, Rect* dst) const;
+
+  // Builds the quad for drawing |src| at |dst|, or returns false if there's
+  // nothing to draw.
+  bool MakeQuad(const Rect& src, const Rect& dst, SpriteQuad* quad) const;
+
+  // Tells the graphics system that |area| changed if we're DC0 or the
+  // haikei.
+  void MarkWrittenTo(const Rect& area);
+
+  SoftwareGraphicsSystem* system_;
+
+  Size size_;
+  std::vector<uint32_t> pixels_;
+
+  std::vector<GrpRect> region_table_;
+
+  // Whether this is DC0 or the haikei, which are shown on screen.
+  bool is_dc0_;
+
+  bool is_mask_;
+};
+
+#endif  // SRC_SYSTEMS_SOFTWARE_SOFTWARE_SURFACE_H_
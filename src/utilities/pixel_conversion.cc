@@ -0,0 +1,635 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "utilities/pixel_conversion.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RLVM_PIXEL_SSE2 1
+#if defined(__GNUC__)
+#include <immintrin.h>
+#define RLVM_PIXEL_X86_DISPATCH 1
+#endif
+#elif defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_neon.h>
+#define RLVM_PIXEL_NEON 1
+#endif
+
+namespace {
+
+const uint32_t kAlphaMask = 0xff000000;
+
+// How many pixels IsFullyOpaque() looks at between checks for an early out.
+const int kOpaqueScanBlock = 256;
+
+// MonoColourChannels() weights, summing to 1 << kMonoShift.
+const int kMonoShift = 15;
+const uint32_t kMonoRed = 9830;
+const uint32_t kMonoGreen = 19333;
+const uint32_t kMonoBlue = 3605;
+
+inline uint32_t ChannelMask(int red_shift, int green_shift, int blue_shift) {
+  return (0xffu << red_shift) | (0xffu << green_shift) | (0xffu << blue_shift);
+}
+
+inline uint32_t ReadPixel(const unsigned char* s) {
+  return uint32_t(s[0]) | (uint32_t(s[1]) << 8) | (uint32_t(s[2]) << 16) |
+         (uint32_t(s[3]) << 24);
+}
+
+// -----------------------------------------------------------------------
+// Scalar versions
+// -----------------------------------------------------------------------
+
+void ExpandRGBToRGBAScalar(const unsigned char* s, uint32_t* d, int count) {
+  for (int i = 0; i < count; ++i) {
+    *d++ = uint32_t(s[0]) | (uint32_t(s[1]) << 8) | (uint32_t(s[2]) << 16) |
+           kAlphaMask;
+    s += 3;
+  }
+}
+
+uint32_t CopyRGBAPixelsScalar(const unsigned char* s, uint32_t* d, int count) {
+  uint32_t all = kAlphaMask;
+  for (int i = 0; i < count; ++i) {
+    uint32_t pixel = ReadPixel(s);
+    all &= pixel;
+    *d++ = pixel;
+    s += 4;
+  }
+  return all;
+}
+
+uint32_t CopyRGBAPixelsReversedScalar(const unsigned char* s,
+                                      uint32_t* d,
+                                      int count,
+                                      uint32_t alpha_or) {
+  uint32_t all = kAlphaMask;
+  for (int i = 0; i < count; ++i) {
+    uint32_t pixel = uint32_t(s[2]) | (uint32_t(s[1]) << 8) |
+                     (uint32_t(s[0]) << 16) | (uint32_t(s[3]) << 24) |
+                     alpha_or;
+    all &= pixel;
+    *d++ = pixel;
+    s += 4;
+  }
+  return all;
+}
+
+uint32_t MergeAlphaMaskScalar(const unsigned char* m, uint32_t* d, int count) {
+  uint32_t all = kAlphaMask;
+  for (int i = 0; i < count; ++i) {
+    *d |= uint32_t(*m++) << 24;
+    all &= *d++;
+  }
+  return all;
+}
+
+// Returns the number of leading pixels which are fully opaque.
+int CountOpaqueScalar(const uint32_t* p, int count) {
+  for (int i = 0; i < count; ++i) {
+    if ((p[i] & kAlphaMask) != kAlphaMask)
+      return i;
+  }
+  return count;
+}
+
+// Byte lookups don't vectorize without a gather, which is slower than this
+// on every CPU we target, so this is the only version.
+void MapColourChannelsScalar(uint32_t* p,
+                             int count,
+                             const uint8_t* red,
+                             const uint8_t* green,
+                             const uint8_t* blue,
+                             int rs,
+                             int gs,
+                             int bs) {
+  const uint32_t keep = ~ChannelMask(rs, gs, bs);
+  for (int i = 0; i < count; ++i) {
+    uint32_t v = p[i];
+    p[i] = (v & keep) | (uint32_t(red[(v >> rs) & 0xff]) << rs) |
+           (uint32_t(green[(v >> gs) & 0xff]) << gs) |
+           (uint32_t(blue[(v >> bs) & 0xff]) << bs);
+  }
+}
+
+void InvertColourChannelsScalar(uint32_t* p, int count, uint32_t mask) {
+  for (int i = 0; i < count; ++i)
+    p[i] ^= mask;
+}
+
+void MonoColourChannelsScalar(uint32_t* p, int count, int rs, int gs, int bs) {
+  const uint32_t keep = ~ChannelMask(rs, gs, bs);
+  for (int i = 0; i < count; ++i) {
+    uint32_t v = p[i];
+    uint32_t grey = (kMonoRed * ((v >> rs) & 0xff) +
+                     kMonoGreen * ((v >> gs) & 0xff) +
+                     kMonoBlue * ((v >> bs) & 0xff)) >> kMonoShift;
+    p[i] = (v & keep) | (grey << rs) | (grey << gs) | (grey << bs);
+  }
+}
+
+// -----------------------------------------------------------------------
+// SSE2 versions
+// -----------------------------------------------------------------------
+
+#if defined(RLVM_PIXEL_SSE2)
+
+inline bool AlphaIsOpaque(__m128i acc) {
+  const __m128i alpha = _mm_set1_epi32(kAlphaMask);
+  return _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(acc, alpha),
+                                           alpha)) == 0xffff;
+}
+
+uint32_t CopyRGBAPixelsSSE2(const unsigned char* s, uint32_t* d, int count) {
+  __m128i acc = _mm_set1_epi32(-1);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), v);
+    acc = _mm_and_si128(acc, v);
+  }
+  uint32_t all = CopyRGBAPixelsScalar(s + i * 4, d + i, count - i);
+  return AlphaIsOpaque(acc) ? all : 0;
+}
+
+uint32_t CopyRGBAPixelsReversedSSE2(const unsigned char* s,
+                                    uint32_t* d,
+                                    int count,
+                                    uint32_t alpha_or) {
+  const __m128i keep = _mm_set1_epi32(0xff00ff00);
+  const __m128i low = _mm_set1_epi32(0x000000ff);
+  const __m128i alpha = _mm_set1_epi32(alpha_or);
+  __m128i acc = _mm_set1_epi32(-1);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 4));
+    __m128i r = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(v, keep),
+                     _mm_and_si128(_mm_srli_epi32(v, 16), low)),
+        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, low), 16), alpha));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), r);
+    acc = _mm_and_si128(acc, r);
+  }
+  uint32_t all =
+      CopyRGBAPixelsReversedScalar(s + i * 4, d + i, count - i, alpha_or);
+  return AlphaIsOpaque(acc) ? all : 0;
+}
+
+uint32_t MergeAlphaMaskSSE2(const unsigned char* m, uint32_t* d, int count) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_set1_epi32(-1);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m + i));
+    // Move each mask byte to the top byte of its own 32-bit lane.
+    __m128i lo16 = _mm_unpacklo_epi8(zero, mask);
+    __m128i hi16 = _mm_unpackhi_epi8(zero, mask);
+    __m128i parts[4] = {_mm_unpacklo_epi16(zero, lo16),
+                        _mm_unpackhi_epi16(zero, lo16),
+                        _mm_unpacklo_epi16(zero, hi16),
+                        _mm_unpackhi_epi16(zero, hi16)};
+    for (int j = 0; j < 4; ++j) {
+      __m128i* p = reinterpret_cast<__m128i*>(d + i + j * 4);
+      __m128i v = _mm_or_si128(_mm_loadu_si128(p), parts[j]);
+      _mm_storeu_si128(p, v);
+      acc = _mm_and_si128(acc, v);
+    }
+  }
+  uint32_t all = MergeAlphaMaskScalar(m + i, d + i, count - i);
+  return AlphaIsOpaque(acc) ? all : 0;
+}
+
+int CountOpaqueSSE2(const uint32_t* p, int count) {
+  int i = 0;
+  for (; i + kOpaqueScanBlock <= count; i += kOpaqueScanBlock) {
+    __m128i acc = _mm_set1_epi32(-1);
+    for (int j = 0; j < kOpaqueScanBlock; j += 4) {
+      acc = _mm_and_si128(
+          acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + j)));
+    }
+    if (!AlphaIsOpaque(acc))
+      return i + CountOpaqueScalar(p + i, kOpaqueScanBlock);
+  }
+  return i + CountOpaqueScalar(p + i, count - i);
+}
+
+void InvertColourChannelsSSE2(uint32_t* p, int count, uint32_t mask) {
+  const __m128i m = _mm_set1_epi32(mask);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i* q = reinterpret_cast<__m128i*>(p + i);
+    _mm_storeu_si128(q, _mm_xor_si128(_mm_loadu_si128(q), m));
+  }
+  InvertColourChannelsScalar(p + i, count - i, mask);
+}
+
+void MonoColourChannelsSSE2(uint32_t* p, int count, int rs, int gs, int bs) {
+  const __m128i byte = _mm_set1_epi32(0xff);
+  const __m128i keep = _mm_set1_epi32(~ChannelMask(rs, gs, bs));
+  const __m128i red_shift = _mm_cvtsi32_si128(rs);
+  const __m128i green_shift = _mm_cvtsi32_si128(gs);
+  const __m128i blue_shift = _mm_cvtsi32_si128(bs);
+  // There's no 32-bit multiply in SSE2, so pair red and green up in 16-bit
+  // halves and let pmaddwd do the multiplies and the first add.
+  const __m128i red_green_weights =
+      _mm_set1_epi32((kMonoGreen << 16) | kMonoRed);
+  const __m128i blue_weight = _mm_set1_epi32(kMonoBlue);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i* q = reinterpret_cast<__m128i*>(p + i);
+    __m128i v = _mm_loadu_si128(q);
+    __m128i r = _mm_and_si128(_mm_srl_epi32(v, red_shift), byte);
+    __m128i g = _mm_and_si128(_mm_srl_epi32(v, green_shift), byte);
+    __m128i b = _mm_and_si128(_mm_srl_epi32(v, blue_shift), byte);
+    __m128i sum = _mm_add_epi32(
+        _mm_madd_epi16(_mm_or_si128(r, _mm_slli_epi32(g, 16)),
+                       red_green_weights),
+        _mm_madd_epi16(b, blue_weight));
+    __m128i grey = _mm_srli_epi32(sum, kMonoShift);
+    __m128i out = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(v, keep), _mm_sll_epi32(grey, red_shift)),
+        _mm_or_si128(_mm_sll_epi32(grey, green_shift),
+                     _mm_sll_epi32(grey, blue_shift)));
+    _mm_storeu_si128(q, out);
+  }
+  MonoColourChannelsScalar(p + i, count - i, rs, gs, bs);
+}
+
+#endif  // RLVM_PIXEL_SSE2
+
+// -----------------------------------------------------------------------
+// SSSE3 / AVX2 versions, selected at runtime
+// -----------------------------------------------------------------------
+
+#if defined(RLVM_PIXEL_X86_DISPATCH)
+
+__attribute__((target("ssse3")))
+void ExpandRGBToRGBASSSE3(const unsigned char* s, uint32_t* d, int count) {
+  const __m128i shuffle =
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i alpha = _mm_set1_epi32(kAlphaMask);
+  int i = 0;
+  // Each iteration consumes 12 bytes but loads 16, so stop while there are
+  // still at least 16 readable bytes left.
+  for (; i + 6 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * 3));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i),
+                     _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+  }
+  ExpandRGBToRGBAScalar(s + i * 3, d + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void ExpandRGBToRGBAAVX2(const unsigned char* s, uint32_t* d, int count) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m256i alpha = _mm256_set1_epi32(kAlphaMask);
+  int i = 0;
+  for (; i + 10 <= count; i += 8) {
+    const unsigned char* p = s + i * 3;
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)),
+        1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i),
+                        _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle),
+                                        alpha));
+  }
+  ExpandRGBToRGBAScalar(s + i * 3, d + i, count - i);
+}
+
+__attribute__((target("avx2")))
+bool AlphaIsOpaqueAVX2(__m256i acc) {
+  const __m256i alpha = _mm256_set1_epi32(kAlphaMask);
+  return _mm256_movemask_epi8(_mm256_cmpeq_epi32(
+             _mm256_and_si256(acc, alpha), alpha)) == -1;
+}
+
+__attribute__((target("avx2")))
+uint32_t CopyRGBAPixelsAVX2(const unsigned char* s, uint32_t* d, int count) {
+  __m256i acc = _mm256_set1_epi32(-1);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i * 4));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), v);
+    acc = _mm256_and_si256(acc, v);
+  }
+  uint32_t all = CopyRGBAPixelsScalar(s + i * 4, d + i, count - i);
+  return AlphaIsOpaqueAVX2(acc) ? all : 0;
+}
+
+__attribute__((target("avx2")))
+uint32_t CopyRGBAPixelsReversedAVX2(const unsigned char* s,
+                                    uint32_t* d,
+                                    int count,
+                                    uint32_t alpha_or) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  const __m256i alpha = _mm256_set1_epi32(alpha_or);
+  __m256i acc = _mm256_set1_epi32(-1);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i * 4));
+    __m256i r = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i), r);
+    acc = _mm256_and_si256(acc, r);
+  }
+  uint32_t all =
+      CopyRGBAPixelsReversedScalar(s + i * 4, d + i, count - i, alpha_or);
+  return AlphaIsOpaqueAVX2(acc) ? all : 0;
+}
+
+__attribute__((target("avx2")))
+int CountOpaqueAVX2(const uint32_t* p, int count) {
+  int i = 0;
+  for (; i + kOpaqueScanBlock <= count; i += kOpaqueScanBlock) {
+    __m256i acc = _mm256_set1_epi32(-1);
+    for (int j = 0; j < kOpaqueScanBlock; j += 8) {
+      acc = _mm256_and_si256(
+          acc,
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + j)));
+    }
+    if (!AlphaIsOpaqueAVX2(acc))
+      return i + CountOpaqueScalar(p + i, kOpaqueScanBlock);
+  }
+  return i + CountOpaqueScalar(p + i, count - i);
+}
+
+#endif  // RLVM_PIXEL_X86_DISPATCH
+
+// -----------------------------------------------------------------------
+// NEON versions
+// -----------------------------------------------------------------------
+
+#if defined(RLVM_PIXEL_NEON)
+
+inline uint32_t AlphaLanesToMask(uint8x16_t acc) {
+  uint8_t lanes[16];
+  vst1q_u8(lanes, acc);
+  uint8_t all = 0xff;
+  for (int i = 0; i < 16; ++i)
+    all &= lanes[i];
+  return all == 0xff ? kAlphaMask : 0;
+}
+
+void ExpandRGBToRGBANEON(const unsigned char* s, uint32_t* d, int count) {
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x3_t rgb = vld3q_u8(s + i * 3);
+    uint8x16x4_t rgba;
+    rgba.val[0] = rgb.val[0];
+    rgba.val[1] = rgb.val[1];
+    rgba.val[2] = rgb.val[2];
+    rgba.val[3] = vdupq_n_u8(0xff);
+    vst4q_u8(reinterpret_cast<uint8_t*>(d + i), rgba);
+  }
+  ExpandRGBToRGBAScalar(s + i * 3, d + i, count - i);
+}
+
+uint32_t CopyRGBAPixelsNEON(const unsigned char* s, uint32_t* d, int count) {
+  uint8x16_t acc = vdupq_n_u8(0xff);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t v = vld4q_u8(s + i * 4);
+    vst4q_u8(reinterpret_cast<uint8_t*>(d + i), v);
+    acc = vandq_u8(acc, v.val[3]);
+  }
+  return AlphaLanesToMask(acc) &
+         CopyRGBAPixelsScalar(s + i * 4, d + i, count - i);
+}
+
+uint32_t CopyRGBAPixelsReversedNEON(const unsigned char* s,
+                                    uint32_t* d,
+                                    int count,
+                                    uint32_t alpha_or) {
+  const uint8x16_t alpha = vdupq_n_u8(alpha_or >> 24);
+  uint8x16_t acc = vdupq_n_u8(0xff);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t v = vld4q_u8(s + i * 4);
+    uint8x16_t tmp = v.val[0];
+    v.val[0] = v.val[2];
+    v.val[2] = tmp;
+    v.val[3] = vorrq_u8(v.val[3], alpha);
+    vst4q_u8(reinterpret_cast<uint8_t*>(d + i), v);
+    acc = vandq_u8(acc, v.val[3]);
+  }
+  return AlphaLanesToMask(acc) &
+         CopyRGBAPixelsReversedScalar(s + i * 4, d + i, count - i, alpha_or);
+}
+
+uint32_t MergeAlphaMaskNEON(const unsigned char* m, uint32_t* d, int count) {
+  uint8x16_t acc = vdupq_n_u8(0xff);
+  int i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8_t* p = reinterpret_cast<uint8_t*>(d + i);
+    uint8x16x4_t v = vld4q_u8(p);
+    v.val[3] = vorrq_u8(v.val[3], vld1q_u8(m + i));
+    vst4q_u8(p, v);
+    acc = vandq_u8(acc, v.val[3]);
+  }
+  return AlphaLanesToMask(acc) &
+         MergeAlphaMaskScalar(m + i, d + i, count - i);
+}
+
+int CountOpaqueNEON(const uint32_t* p, int count) {
+  const uint32x4_t alpha = vdupq_n_u32(kAlphaMask);
+  int i = 0;
+  for (; i + kOpaqueScanBlock <= count; i += kOpaqueScanBlock) {
+    uint32x4_t acc = vdupq_n_u32(0xffffffff);
+    for (int j = 0; j < kOpaqueScanBlock; j += 4)
+      acc = vandq_u32(acc, vld1q_u32(p + i + j));
+    uint32_t lanes[4];
+    vst1q_u32(lanes, vandq_u32(acc, alpha));
+    if ((lanes[0] & lanes[1] & lanes[2] & lanes[3]) != kAlphaMask)
+      return i + CountOpaqueScalar(p + i, kOpaqueScanBlock);
+  }
+  return i + CountOpaqueScalar(p + i, count - i);
+}
+
+void InvertColourChannelsNEON(uint32_t* p, int count, uint32_t mask) {
+  const uint32x4_t m = vdupq_n_u32(mask);
+  int i = 0;
+  for (; i + 4 <= count; i += 4)
+    vst1q_u32(p + i, veorq_u32(vld1q_u32(p + i), m));
+  InvertColourChannelsScalar(p + i, count - i, mask);
+}
+
+void MonoColourChannelsNEON(uint32_t* p, int count, int rs, int gs, int bs) {
+  const uint32x4_t byte = vdupq_n_u32(0xff);
+  const uint32x4_t keep = vdupq_n_u32(~ChannelMask(rs, gs, bs));
+  // vshlq with a negative count shifts right.
+  const int32x4_t red_down = vdupq_n_s32(-rs);
+  const int32x4_t green_down = vdupq_n_s32(-gs);
+  const int32x4_t blue_down = vdupq_n_s32(-bs);
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t v = vld1q_u32(p + i);
+    uint32x4_t sum =
+        vmulq_n_u32(vandq_u32(vshlq_u32(v, red_down), byte), kMonoRed);
+    sum = vmlaq_n_u32(
+        sum, vandq_u32(vshlq_u32(v, green_down), byte), kMonoGreen);
+    sum = vmlaq_n_u32(
+        sum, vandq_u32(vshlq_u32(v, blue_down), byte), kMonoBlue);
+    uint32x4_t grey = vshrq_n_u32(sum, kMonoShift);
+    uint32x4_t out = vorrq_u32(
+        vorrq_u32(vandq_u32(v, keep), vshlq_u32(grey, vnegq_s32(red_down))),
+        vorrq_u32(vshlq_u32(grey, vnegq_s32(green_down)),
+                  vshlq_u32(grey, vnegq_s32(blue_down))));
+    vst1q_u32(p + i, out);
+  }
+  MonoColourChannelsScalar(p + i, count - i, rs, gs, bs);
+}
+
+#endif  // RLVM_PIXEL_NEON
+
+// -----------------------------------------------------------------------
+// Dispatch
+// -----------------------------------------------------------------------
+
+struct PixelKernels {
+  const char* name;
+  void (*expand_rgb)(const unsigned char*, uint32_t*, int);
+  uint32_t (*copy_rgba)(const unsigned char*, uint32_t*, int);
+  uint32_t (*copy_rgba_reversed)(const unsigned char*, uint32_t*, int,
+                                 uint32_t);
+  uint32_t (*merge_alpha)(const unsigned char*, uint32_t*, int);
+  int (*count_opaque)(const uint32_t*, int);
+  void (*invert)(uint32_t*, int, uint32_t);
+  void (*mono)(uint32_t*, int, int, int, int);
+};
+
+PixelKernels ChooseKernels() {
+  PixelKernels k = {"scalar",
+                    ExpandRGBToRGBAScalar,
+                    CopyRGBAPixelsScalar,
+                    CopyRGBAPixelsReversedScalar,
+                    MergeAlphaMaskScalar,
+                    CountOpaqueScalar,
+                    InvertColourChannelsScalar,
+                    MonoColourChannelsScalar};
+#if defined(RLVM_PIXEL_SSE2)
+  k.name = "sse2";
+  k.copy_rgba = CopyRGBAPixelsSSE2;
+  k.copy_rgba_reversed = CopyRGBAPixelsReversedSSE2;
+  k.merge_alpha = MergeAlphaMaskSSE2;
+  k.count_opaque = CountOpaqueSSE2;
+  k.invert = InvertColourChannelsSSE2;
+  k.mono = MonoColourChannelsSSE2;
+#endif
+#if defined(RLVM_PIXEL_X86_DISPATCH)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    k.name = "ssse3";
+    k.expand_rgb = ExpandRGBToRGBASSSE3;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    k.name = "avx2";
+    k.expand_rgb = ExpandRGBToRGBAAVX2;
+    k.copy_rgba = CopyRGBAPixelsAVX2;
+    k.copy_rgba_reversed = CopyRGBAPixelsReversedAVX2;
+    k.count_opaque = CountOpaqueAVX2;
+  }
+#endif
+#if defined(RLVM_PIXEL_NEON)
+  k.name = "neon";
+  k.expand_rgb = ExpandRGBToRGBANEON;
+  k.copy_rgba = CopyRGBAPixelsNEON;
+  k.copy_rgba_reversed = CopyRGBAPixelsReversedNEON;
+  k.merge_alpha = MergeAlphaMaskNEON;
+  k.count_opaque = CountOpaqueNEON;
+  k.invert = InvertColourChannelsNEON;
+  k.mono = MonoColourChannelsNEON;
+#endif
+  return k;
+}
+
+const PixelKernels& Kernels() {
+  static const PixelKernels kernels = ChooseKernels();
+  return kernels;
+}
+
+inline const unsigned char* Bytes(const char* p) {
+  return reinterpret_cast<const unsigned char*>(p);
+}
+
+}  // namespace
+
+void ExpandRGBToRGBA(const char* src, uint32_t* dest, int count) {
+  Kernels().expand_rgb(Bytes(src), dest, count);
+}
+
+bool CopyRGBAPixels(const char* src, uint32_t* dest, int count) {
+  return Kernels().copy_rgba(Bytes(src), dest, count) == kAlphaMask;
+}
+
+bool CopyRGBAPixelsReversed(const char* src,
+                            uint32_t* dest,
+                            int count,
+                            uint32_t alpha_or) {
+  return Kernels().copy_rgba_reversed(Bytes(src), dest, count, alpha_or) ==
+         kAlphaMask;
+}
+
+bool MergeAlphaMask(const char* mask, uint32_t* pixels, int count) {
+  return Kernels().merge_alpha(Bytes(mask), pixels, count) == kAlphaMask;
+}
+
+bool IsFullyOpaque(const uint32_t* pixels, int count) {
+  return Kernels().count_opaque(pixels, count) == count;
+}
+
+void MapColourChannels(uint32_t* pixels,
+                       int count,
+                       const uint8_t* red_table,
+                       const uint8_t* green_table,
+                       const uint8_t* blue_table,
+                       int red_shift,
+                       int green_shift,
+                       int blue_shift) {
+  MapColourChannelsScalar(pixels, count, red_table, green_table, blue_table,
+                          red_shift, green_shift, blue_shift);
+}
+
+void InvertColourChannels(uint32_t* pixels, int count, uint32_t colour_mask) {
+  Kernels().invert(pixels, count, colour_mask);
+}
+
+void MonoColourChannels(uint32_t* pixels,
+                        int count,
+                        int red_shift,
+                        int green_shift,
+                        int blue_shift) {
+  Kernels().mono(pixels, count, red_shift, green_shift, blue_shift);
+}
+
+const char* GetPixelConversionBackendName() { return Kernels().name; }
@@ -0,0 +1,99 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_UTILITIES_PIXEL_CONVERSION_H_
+#define SRC_UTILITIES_PIXEL_CONVERSION_H_
+
+#include <cstdint>
+
+// Pixel conversion kernels used by the xclannad image decoders. Every kernel
+// writes native 32-bit pixels with the alpha channel in the top byte, which is
+// the layout SDLGraphicsSystem hands to SDL_CreateRGBSurfaceFrom().
+//
+// The kernels that produce alpha also report whether every pixel they wrote
+// was fully opaque, so that the "does this image need an alpha mask?" decision
+// falls out of the copy instead of requiring a second pass over the image.
+//
+// SSE2 is used on x86 builds, with SSSE3 and AVX2 variants picked at runtime
+// when the CPU supports them; NEON is used on little endian ARM. Everything
+// else goes through the scalar versions.
+
+// Expands |count| packed 3 byte pixels into |dest|, setting alpha to 0xff.
+void ExpandRGBToRGBA(const char* src, uint32_t* dest, int count);
+
+// Copies |count| little endian 32-bit pixels into |dest|. Returns true if
+// every pixel copied was fully opaque.
+bool CopyRGBAPixels(const char* src, uint32_t* dest, int count);
+
+// Copies |count| 32-bit pixels into |dest|, swapping the first and third
+// bytes of each and or-ing in |alpha_or|. Returns true if every pixel written
+// was fully opaque.
+bool CopyRGBAPixelsReversed(const char* src,
+                            uint32_t* dest,
+                            int count,
+                            uint32_t alpha_or);
+
+// Ors |count| 8-bit mask values into the alpha channel of |pixels|. Returns
+// true if every resulting pixel is fully opaque.
+bool MergeAlphaMask(const char* mask, uint32_t* pixels, int count);
+
+// Returns true if every one of the |count| pixels has an alpha of 0xff.
+bool IsFullyOpaque(const uint32_t* pixels, int count);
+
+// -----------------------------------------------------------------------
+
+// Colour operations on 32-bit pixels with 8-bit colour channels at the bit
+// positions |red_shift|, |green_shift| and |blue_shift|, used by the grp
+// colour commands on DCs. The other byte (alpha) is never touched.
+
+// Replaces each colour channel with its entry in the matching 256 entry
+// table. Covers tone curves, #colour and anything else that maps each
+// channel on its own.
+void MapColourChannels(uint32_t* pixels,
+                       int count,
+                       const uint8_t* red_table,
+                       const uint8_t* green_table,
+                       const uint8_t* blue_table,
+                       int red_shift,
+                       int green_shift,
+                       int blue_shift);
+
+// Inverts the bits of each pixel that are set in |colour_mask|.
+void InvertColourChannels(uint32_t* pixels, int count, uint32_t colour_mask);
+
+// Replaces each colour channel with the pixel's luminance,
+// (0.3 * r + 0.59 * g + 0.11 * b) in 15 bit fixed point.
+void MonoColourChannels(uint32_t* pixels,
+                        int count,
+                        int red_shift,
+                        int green_shift,
+                        int blue_shift);
+
+// Returns the name of the instruction set the kernels above dispatch to, for
+// debug output and benchmarks.
+const char* GetPixelConversionBackendName();
+
+#endif  // SRC_UTILITIES_PIXEL_CONVERSION_H_
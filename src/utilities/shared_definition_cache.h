@@ -0,0 +1,136 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef SRC_UTILITIES_SHARED_DEFINITION_CACHE_H_
+#define SRC_UTILITIES_SHARED_DEFINITION_CACHE_H_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Hands out a single shared, immutable copy of something parsed from a game
+// file (such as the frame tables of an ANM or GAN file) to every object that
+// asks for the same key, instead of each object parsing its own.
+//
+// Only weak references are kept, so a definition is freed as soon as the last
+// object using it goes away, and parsed again the next time it's needed.
+//
+// |Definition| must have a size_t MemoryUsage() const method for the
+// statistics.
+template <typename Definition>
+class SharedDefinitionCache {
+ public:
+  typedef std::function<std::shared_ptr<const Definition>()> Loader;
+
+  SharedDefinitionCache() : loads_(0), hits_(0), last_sweep_size_(0) {}
+
+  // Returns the definition for |key|, calling |load| to create it if nobody
+  // is currently using one. Anything |load| throws is passed on.
+  std::shared_ptr<const Definition> Get(const std::string& key,
+                                        const Loader& load) {
+    typename Map::iterator it = definitions_.find(key);
+    if (it != definitions_.end()) {
+      std::shared_ptr<const Definition> definition = it->second.lock();
+      if (definition) {
+        hits_++;
+        return definition;
+      }
+    }
+
+    std::shared_ptr<const Definition> definition = load();
+    loads_++;
+    definitions_[key] = definition;
+
+    // Forget about dead definitions every so often.
+    if (definitions_.size() > 2 * last_sweep_size_ + 16) {
+      for (it = definitions_.begin(); it != definitions_.end();) {
+        if (it->second.expired())
+          it = definitions_.erase(it);
+        else
+          ++it;
+      }
+      last_sweep_size_ = definitions_.size();
+    }
+
+    return definition;
+  }
+
+  // Number of distinct definitions currently in use.
+  size_t live_count() const {
+    size_t count = 0;
+    for (const auto& entry : definitions_) {
+      if (!entry.second.expired())
+        count++;
+    }
+    return count;
+  }
+
+  // Number of objects currently holding a definition.
+  size_t user_count() const {
+    size_t count = 0;
+    for (const auto& entry : definitions_)
+      count += entry.second.use_count();
+    return count;
+  }
+
+  // Bytes used by the live definitions, and the bytes saved by sharing them
+  // instead of every user having its own copy.
+  size_t bytes_used() const { return SumMemoryUsage(false); }
+  size_t bytes_saved() const { return SumMemoryUsage(true); }
+
+  // Number of times Get() had to call its loader, and times it didn't.
+  int loads() const { return loads_; }
+  int hits() const { return hits_; }
+
+ private:
+  typedef std::unordered_map<std::string, std::weak_ptr<const Definition>>
+      Map;
+
+  size_t SumMemoryUsage(bool duplicates_only) const {
+    size_t bytes = 0;
+    for (const auto& entry : definitions_) {
+      std::shared_ptr<const Definition> definition = entry.second.lock();
+      if (definition) {
+        // Don't count the reference we just took.
+        size_t users = definition.use_count() - 1;
+        bytes += (duplicates_only ? users - 1 : 1) * definition->MemoryUsage();
+      }
+    }
+    return bytes;
+  }
+
+  Map definitions_;
+
+  int loads_;
+  int hits_;
+
+  // Size of |definitions_| after expired entries were last removed.
+  size_t last_sweep_size_;
+};
+
+#endif  // SRC_UTILITIES_SHARED_DEFINITION_CACHE_H_
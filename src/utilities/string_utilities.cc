@@ -30,6 +30,7 @@
 #include <string>
 
 #include "encodings/codepage.h"
+#include "encodings/utf8_transcoder.h"
 #include "utilities/exception.h"
 #include "utf8cpp/utf8.h"
 
@@ -63,11 +64,7 @@ string UnicodeToUTF8(const std::wstring& widestring) {
 }
 
 string cp932toUTF8(const string& line, int transformation) {
-  if (line.empty())
-    return line;
-
-  std::wstring ws = cp932toUnicode(line, transformation);
-  return UnicodeToUTF8(ws);
+  return Utf8Transcoder::ForTransformation(transformation).Transcode(line);
 }
 
 bool IsOpeningQuoteMark(int codepoint) {
@@ -59,7 +59,8 @@ std::string TransformationName(int transformation);
 // Converts a UTF-16 string to a UTF-8 one.
 std::string UnicodeToUTF8(const std::wstring& widestring);
 
-// For convenience. Combines the two above functions.
+// Produces the same result as combining the two above functions, but goes
+// straight to UTF-8 through Utf8Transcoder.
 std::string cp932toUTF8(const std::string& line, int transformation);
 
 // Returns true if codepoint is either of the Japanese quote marks or '('.
@@ -0,0 +1,102 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <vector>
+
+#include "systems/base/atlas_page.h"
+
+namespace {
+
+// Places |count| |width| x |height| images the way TexturePage::Allocate()
+// does: on the first page with room, opening a new page when none has any.
+// Returns the pages used; images that aren't packable get none.
+std::vector<std::unique_ptr<AtlasPage>> PackImages(int count,
+                                                   int width,
+                                                   int height) {
+  std::vector<std::unique_ptr<AtlasPage>> pages;
+  if (!AtlasPage::IsPackable(width, height))
+    return pages;
+
+  for (int i = 0; i < count; ++i) {
+    Rect slot;
+    bool placed = false;
+    for (std::unique_ptr<AtlasPage>& page : pages) {
+      if (page->AllocateSlot(width, height, &slot)) {
+        placed = true;
+        break;
+      }
+    }
+    if (!placed) {
+      pages.emplace_back(new AtlasPage(AtlasPage::kPageSize));
+      EXPECT_TRUE(pages.back()->AllocateSlot(width, height, &slot));
+    }
+  }
+  return pages;
+}
+
+}  // namespace
+
+TEST(AtlasPageTest, LargestPackedImagesFitFourToAPage) {
+  int size = AtlasPage::kMaxPackedSize;
+  std::vector<std::unique_ptr<AtlasPage>> pages = PackImages(8, size, size);
+  ASSERT_EQ(2u, pages.size());
+  EXPECT_EQ(4, pages[0]->slot_count());
+  EXPECT_EQ(4, pages[1]->slot_count());
+}
+
+TEST(AtlasPageTest, TilesOfLargeImagesGetTheirOwnTextures) {
+  // CGs are cut into 512 pixel tiles without NPOT textures; with padding,
+  // only one of those would fit on a page.
+  EXPECT_FALSE(AtlasPage::IsPackable(512, 512));
+  EXPECT_FALSE(AtlasPage::IsPackable(512, 64));
+  EXPECT_FALSE(AtlasPage::IsPackable(64, 512));
+  EXPECT_TRUE(PackImages(6, 512, 512).empty());
+}
+
+TEST(AtlasPageTest, QuarterSizeImagesShareAPage) {
+  // Three across and three down: the padding of the third column leaves the
+  // fourth one texel short.
+  std::vector<std::unique_ptr<AtlasPage>> pages = PackImages(12, 256, 256);
+  ASSERT_EQ(2u, pages.size());
+  EXPECT_EQ(9, pages[0]->slot_count());
+  EXPECT_EQ(3, pages[1]->slot_count());
+}
+
+TEST(AtlasPageTest, FreedSlotsAreReused) {
+  AtlasPage page(AtlasPage::kPageSize);
+  Rect first, second;
+  ASSERT_TRUE(page.AllocateSlot(300, 200, &first));
+  ASSERT_TRUE(page.AllocateSlot(300, 200, &second));
+  page.Free(first);
+  EXPECT_EQ(1, page.slot_count());
+
+  Rect again;
+  ASSERT_TRUE(page.AllocateSlot(300, 200, &again));
+  EXPECT_EQ(first, again);
+}
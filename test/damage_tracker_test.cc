@@ -0,0 +1,142 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "gtest/gtest.h"
+
+#include "systems/base/damage_tracker.h"
+
+namespace {
+
+// Starts a tracker with a 640x480 screen and the initial full frame already
+// drawn, so tests see only their own damage.
+void Prime(DamageTracker* tracker) {
+  tracker->set_screen(Rect::REC(0, 0, 640, 480));
+  tracker->FinishTracking();
+  tracker->FrameDrawn(tracker->Decide());
+}
+
+}  // namespace
+
+TEST(DamageTrackerTest, FirstFrameIsFull) {
+  DamageTracker tracker;
+  tracker.set_screen(Rect::REC(0, 0, 640, 480));
+  EXPECT_EQ(DamageTracker::FULL, tracker.Decide());
+}
+
+TEST(DamageTrackerTest, NothingChangedSkips) {
+  DamageTracker tracker;
+  Prime(&tracker);
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.FinishTracking();
+  tracker.FrameDrawn(tracker.Decide());
+
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::SKIP, tracker.Decide());
+  tracker.FrameDrawn(DamageTracker::SKIP);
+  EXPECT_EQ(1, tracker.skipped_frames());
+}
+
+TEST(DamageTrackerTest, MovedObjectDamagesOldAndNewRects) {
+  DamageTracker tracker;
+  Prime(&tracker);
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.FinishTracking();
+  tracker.FrameDrawn(tracker.Decide());
+
+  tracker.Track(1, Rect::REC(50, 40, 20, 20), 5);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::PARTIAL, tracker.Decide());
+  EXPECT_EQ(Rect::GRP(10, 10, 70, 60), tracker.bounds());
+}
+
+TEST(DamageTrackerTest, ChangedSignatureDamagesRect) {
+  DamageTracker tracker;
+  Prime(&tracker);
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.FinishTracking();
+  tracker.FrameDrawn(tracker.Decide());
+
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 6);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::PARTIAL, tracker.Decide());
+  EXPECT_EQ(Rect::REC(10, 10, 20, 20), tracker.bounds());
+}
+
+TEST(DamageTrackerTest, VanishedObjectDamagesItsLastRect) {
+  DamageTracker tracker;
+  Prime(&tracker);
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.Track(2, Rect::REC(100, 100, 5, 5), 5);
+  tracker.FinishTracking();
+  tracker.FrameDrawn(tracker.Decide());
+
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.FinishTracking();
+  EXPECT_EQ(Rect::REC(100, 100, 5, 5), tracker.bounds());
+  tracker.FrameDrawn(tracker.Decide());
+
+  // And it's forgotten afterwards.
+  tracker.Track(1, Rect::REC(10, 10, 20, 20), 5);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::SKIP, tracker.Decide());
+}
+
+TEST(DamageTrackerTest, UnknownRectChangesAreFull) {
+  DamageTracker tracker;
+  Prime(&tracker);
+  tracker.Track(1, Rect(), 5);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::FULL, tracker.Decide());
+  tracker.FrameDrawn(DamageTracker::FULL);
+
+  tracker.Track(1, Rect(), 5);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::SKIP, tracker.Decide());
+  tracker.FrameDrawn(DamageTracker::SKIP);
+
+  tracker.Track(1, Rect(), 6);
+  tracker.FinishTracking();
+  EXPECT_EQ(DamageTracker::FULL, tracker.Decide());
+}
+
+TEST(DamageTrackerTest, ReportedDamageIsClippedAndCanGoFull) {
+  DamageTracker tracker;
+  Prime(&tracker);
+  tracker.Add(Rect::REC(600, 460, 100, 100));
+  EXPECT_EQ(DamageTracker::PARTIAL, tracker.Decide());
+  EXPECT_EQ(Rect::REC(600, 460, 40, 20), tracker.bounds());
+
+  // Covering most of the screen isn't worth a scissored redraw.
+  tracker.Add(Rect::REC(0, 0, 600, 400));
+  EXPECT_EQ(DamageTracker::FULL, tracker.Decide());
+  tracker.FrameDrawn(DamageTracker::FULL);
+  EXPECT_EQ(2, tracker.full_frames());
+
+  tracker.Add(Rect::REC(-50, -50, 10, 10));
+  EXPECT_EQ(DamageTracker::SKIP, tracker.Decide());
+}
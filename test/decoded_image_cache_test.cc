@@ -0,0 +1,183 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "systems/base/decoded_image_cache.h"
+
+namespace fs = boost::filesystem;
+
+class DecodedImageCacheTest : public ::testing::Test {
+ protected:
+  DecodedImageCacheTest()
+      : root_(fs::temp_directory_path() /
+              fs::unique_path("rlvm-image-cache-%%%%-%%%%")) {
+    fs::create_directories(root_);
+    source_ = root_ / "bg001.g00";
+    WriteSource(source_, "original contents");
+  }
+
+  ~DecodedImageCacheTest() {
+    boost::system::error_code ec;
+    fs::remove_all(root_, ec);
+  }
+
+  void WriteSource(const fs::path& path, const std::string& contents) {
+    std::ofstream out(path.string().c_str(), std::ios::binary);
+    out << contents;
+  }
+
+  std::vector<uint32_t> MakePixels(int count, uint32_t seed) {
+    std::vector<uint32_t> pixels(count);
+    for (int i = 0; i < count; ++i)
+      pixels[i] = seed * 2654435761u + i;
+    return pixels;
+  }
+
+  std::vector<Surface::GrpRect> MakeRegions() {
+    std::vector<Surface::GrpRect> regions(2);
+    regions[0].rect = Rect::REC(0, 0, 4, 3);
+    regions[0].originX = 1;
+    regions[0].originY = 2;
+    regions[1].rect = Rect::REC(4, 0, 4, 3);
+    regions[1].originX = 3;
+    regions[1].originY = 4;
+    return regions;
+  }
+
+  fs::path root_;
+  fs::path source_;
+};
+
+TEST_F(DecodedImageCacheTest, MissThenHit) {
+  DecodedImageCache cache(root_ / "cache", 1024 * 1024);
+  EXPECT_TRUE(cache.Lookup(source_) == nullptr);
+
+  std::vector<uint32_t> pixels = MakePixels(8 * 3, 1);
+  std::vector<Surface::GrpRect> regions = MakeRegions();
+  cache.Store(source_, 8, 3, true,
+              reinterpret_cast<const char*>(pixels.data()), regions);
+
+  std::unique_ptr<DecodedImageCache::Entry> entry = cache.Lookup(source_);
+  ASSERT_TRUE(entry != nullptr);
+  EXPECT_EQ(8, entry->width());
+  EXPECT_EQ(3, entry->height());
+  EXPECT_TRUE(entry->has_alpha());
+  EXPECT_EQ(0, memcmp(pixels.data(), entry->pixels(), pixels.size() * 4));
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(entry->pixels()) % 16);
+
+  ASSERT_EQ(2u, entry->region_table().size());
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(regions[i].rect, entry->region_table()[i].rect);
+    EXPECT_EQ(regions[i].originX, entry->region_table()[i].originX);
+    EXPECT_EQ(regions[i].originY, entry->region_table()[i].originY);
+  }
+
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+}
+
+TEST_F(DecodedImageCacheTest, PersistsAcrossInstances) {
+  std::vector<uint32_t> pixels = MakePixels(8 * 3, 2);
+  {
+    DecodedImageCache cache(root_ / "cache", 1024 * 1024);
+    cache.Store(source_, 8, 3, false,
+                reinterpret_cast<const char*>(pixels.data()), MakeRegions());
+  }
+
+  DecodedImageCache cache(root_ / "cache", 1024 * 1024);
+  EXPECT_LT(0u, cache.current_bytes());
+  std::unique_ptr<DecodedImageCache::Entry> entry = cache.Lookup(source_);
+  ASSERT_TRUE(entry != nullptr);
+  EXPECT_FALSE(entry->has_alpha());
+  EXPECT_EQ(0, memcmp(pixels.data(), entry->pixels(), pixels.size() * 4));
+}
+
+TEST_F(DecodedImageCacheTest, ChangedSourceIsAMiss) {
+  DecodedImageCache cache(root_ / "cache", 1024 * 1024);
+  std::vector<uint32_t> pixels = MakePixels(8 * 3, 3);
+  cache.Store(source_, 8, 3, false,
+              reinterpret_cast<const char*>(pixels.data()), MakeRegions());
+  ASSERT_TRUE(cache.Lookup(source_) != nullptr);
+
+  // A different size changes the key even if the mtime doesn't move.
+  WriteSource(source_, "patched contents, now longer");
+  EXPECT_TRUE(cache.Lookup(source_) == nullptr);
+
+  // Same for a different mtime with the same size.
+  cache.Store(source_, 8, 3, false,
+              reinterpret_cast<const char*>(pixels.data()), MakeRegions());
+  ASSERT_TRUE(cache.Lookup(source_) != nullptr);
+  fs::last_write_time(source_, fs::last_write_time(source_) - 100);
+  EXPECT_TRUE(cache.Lookup(source_) == nullptr);
+}
+
+TEST_F(DecodedImageCacheTest, EvictsLeastRecentlyUsed) {
+  // Room for roughly two 32x32 images.
+  DecodedImageCache cache(root_ / "cache", 2 * 32 * 32 * 4 + 1024);
+  std::vector<uint32_t> pixels = MakePixels(32 * 32, 4);
+  const char* data = reinterpret_cast<const char*>(pixels.data());
+
+  std::vector<fs::path> sources;
+  for (int i = 0; i < 3; ++i) {
+    sources.push_back(root_ / ("cg0" + std::to_string(i) + ".g00"));
+    WriteSource(sources.back(), "image " + std::to_string(i));
+  }
+
+  cache.Store(sources[0], 32, 32, false, data, MakeRegions());
+  cache.Store(sources[1], 32, 32, false, data, MakeRegions());
+
+  // Make the first entry look old, then use it so it becomes the most
+  // recently used one again; the second entry should be the one to go.
+  for (fs::directory_iterator it(root_ / "cache"), end; it != end; ++it)
+    fs::last_write_time(it->path(), std::time(NULL) - 1000);
+  ASSERT_TRUE(cache.Lookup(sources[0]) != nullptr);
+
+  cache.Store(sources[2], 32, 32, false, data, MakeRegions());
+  EXPECT_GE(cache.max_bytes(), cache.current_bytes());
+  EXPECT_TRUE(cache.Lookup(sources[0]) != nullptr);
+  EXPECT_TRUE(cache.Lookup(sources[1]) == nullptr);
+  EXPECT_TRUE(cache.Lookup(sources[2]) != nullptr);
+}
+
+TEST_F(DecodedImageCacheTest, ImagesLargerThanTheCapAreNotStored) {
+  DecodedImageCache cache(root_ / "cache", 1024);
+  std::vector<uint32_t> pixels = MakePixels(32 * 32, 5);
+  cache.Store(source_, 32, 32, false,
+              reinterpret_cast<const char*>(pixels.data()), MakeRegions());
+  EXPECT_TRUE(cache.Lookup(source_) == nullptr);
+  EXPECT_EQ(0u, cache.current_bytes());
+}
@@ -0,0 +1,227 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "systems/base/drift_particles.h"
+
+namespace {
+
+struct Start {
+  int x;
+  int y;
+  int start_time;
+};
+
+struct Position {
+  int x;
+  int y;
+  int pattern;
+};
+
+// What DriftGraphicsObject::Render() used to compute for each particle.
+Position ReferencePosition(const DriftParticles::Motion& motion,
+                           const Start& particle,
+                           int current_time) {
+  Position out;
+  out.pattern = motion.start_pattern;
+  if (motion.use_animation && motion.end_pattern > motion.start_pattern) {
+    int number_of_patterns = motion.end_pattern - motion.start_pattern + 1;
+    int frame_time = motion.animation_time / number_of_patterns;
+    int frame_number = ((current_time - particle.start_time) / frame_time) %
+                       number_of_patterns;
+    out.pattern = motion.start_pattern + frame_number;
+  }
+
+  int width = motion.area.width();
+  int height = motion.area.height();
+  double scaled_amplitude =
+      width * DriftParticles::ScaleAmplitude(motion.amplitude);
+
+  int dest_x = particle.x;
+  int dest_y = particle.y;
+  dest_y += height *
+            (static_cast<double>((current_time - particle.start_time) %
+                                 motion.yspeed) /
+             static_cast<double>(motion.yspeed));
+  if (motion.period != 0 && motion.amplitude != 0) {
+    double result = sin((static_cast<double>(current_time -
+                                             particle.start_time) /
+                         motion.period) *
+                        (2 * 3.14));
+    dest_x += scaled_amplitude * result;
+  }
+  if (motion.use_drift) {
+    dest_x -= width * (static_cast<double>((current_time -
+                                            particle.start_time) %
+                                           motion.drift_speed) /
+                       static_cast<double>(motion.drift_speed));
+  }
+
+  if (dest_x < 0)
+    dest_x += width;
+  else
+    dest_x %= width;
+  if (dest_y < 0)
+    dest_y += height;
+  else
+    dest_y %= height;
+
+  out.x = dest_x;
+  out.y = dest_y;
+  return out;
+}
+
+DriftParticles::Motion SnowMotion() {
+  DriftParticles::Motion motion;
+  motion.area = Rect::REC(0, 0, 640, 480);
+  motion.use_animation = true;
+  motion.start_pattern = 2;
+  motion.end_pattern = 6;
+  motion.animation_time = 1000;
+  motion.yspeed = 5000;
+  motion.period = 3000;
+  motion.amplitude = 150;
+  motion.use_drift = true;
+  motion.drift_speed = 7000;
+  return motion;
+}
+
+// A fixed sequence of starting points, so failures are reproducible.
+std::vector<Start> MakeStarts(int count, const Rect& area) {
+  std::vector<Start> starts;
+  unsigned int seed = 12345;
+  for (int i = 0; i < count; ++i) {
+    seed = seed * 1103515245 + 12345;
+    Start start = {int(seed % area.width()), int((seed >> 8) % area.height()),
+                   int(i * 16)};
+    starts.push_back(start);
+  }
+  return starts;
+}
+
+}  // namespace
+
+TEST(DriftParticlesTest, MatchesOldMotion) {
+  DriftParticles::Motion motion = SnowMotion();
+  // An odd count, so the tail after the two-at-a-time loop is covered.
+  std::vector<Start> starts = MakeStarts(37, motion.area);
+
+  DriftParticles particles;
+  for (const Start& start : starts)
+    particles.Add(start.x, start.y, start.start_time);
+  ASSERT_EQ(37, particles.size());
+
+  for (int amplitude : {100, 150, 250}) {
+    motion.amplitude = amplitude;
+    for (int time = 600; time < 60000; time += 1237) {
+      particles.Update(motion, time);
+      for (int i = 0; i < particles.size(); ++i) {
+        Position expected = ReferencePosition(motion, starts[i], time);
+        EXPECT_EQ(expected.y, particles.dest_y()[i]);
+        EXPECT_EQ(expected.pattern, particles.pattern()[i]);
+
+        // The sine table may round the sway to the neighbouring pixel, which
+        // can also land on the other side of the wrap.
+        int off_by = (particles.dest_x()[i] - expected.x + 640) % 640;
+        EXPECT_TRUE(off_by == 0 || off_by == 1 || off_by == 639)
+            << "particle " << i << " at " << time << ": expected "
+            << expected.x << ", got " << particles.dest_x()[i];
+      }
+    }
+  }
+}
+
+TEST(DriftParticlesTest, ZeroSpeedsStandStill) {
+  DriftParticles::Motion motion = SnowMotion();
+  motion.yspeed = 0;
+  motion.drift_speed = 0;
+  motion.period = 0;
+  motion.animation_time = 0;
+
+  DriftParticles particles;
+  particles.Add(10, 20, 0);
+  particles.Add(30, 40, 100);
+  particles.Add(50, 60, 200);
+  particles.Update(motion, 5000);
+
+  EXPECT_EQ(10, particles.dest_x()[0]);
+  EXPECT_EQ(20, particles.dest_y()[0]);
+  EXPECT_EQ(30, particles.dest_x()[1]);
+  EXPECT_EQ(40, particles.dest_y()[1]);
+  EXPECT_EQ(50, particles.dest_x()[2]);
+  EXPECT_EQ(60, particles.dest_y()[2]);
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(2, particles.pattern()[i]);
+}
+
+TEST(DriftParticlesTest, TableSineIsCloseToSin) {
+  for (double radians = -20; radians < 20; radians += 0.0137)
+    EXPECT_NEAR(sin(radians), DriftParticles::TableSine(radians), 1e-5);
+}
+
+TEST(DriftParticlesTest, DISABLED_ThousandsOfParticlesBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kFrames = 1000;
+  DriftParticles::Motion motion = SnowMotion();
+
+  for (int count : {1000, 10000}) {
+    std::vector<Start> starts = MakeStarts(count, motion.area);
+    DriftParticles particles;
+    for (const Start& start : starts)
+      particles.Add(start.x, start.y, start.start_time);
+
+    int checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < kFrames; ++frame) {
+      for (const Start& particle : starts) {
+        Position p = ReferencePosition(motion, particle, 20000 + frame * 16);
+        checksum += p.x + p.y + p.pattern;
+      }
+    }
+    double one_at_a_time =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (int frame = 0; frame < kFrames; ++frame) {
+      particles.Update(motion, 20000 + frame * 16);
+      checksum += particles.dest_x()[frame % count];
+    }
+    double batched =
+        std::chrono::duration<double>(Clock::now() - start).count();
+
+    double per_particle = 1e9 / (double(kFrames) * count);
+    std::cerr << count << " particles: one at a time "
+              << one_at_a_time * per_particle << " ns/particle, batched "
+              << batched * per_particle << " ns/particle (" << checksum
+              << ")" << std::endl;
+  }
+}
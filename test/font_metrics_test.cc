@@ -0,0 +1,129 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include "systems/base/font_metrics.h"
+
+TEST(FontMetricsTest, StoresAndFindsAdvances) {
+  FontMetrics metrics;
+  EXPECT_EQ(FontMetrics::kUnknown, metrics.Advance(25, 0, 'A'));
+
+  metrics.SetAdvance(25, 0, 'A', 14);
+  metrics.SetAdvance(25, 0, 0x3042, 25);
+  EXPECT_EQ(14, metrics.Advance(25, 0, 'A'));
+  EXPECT_EQ(25, metrics.Advance(25, 0, 0x3042));
+
+  // Neighbours on the same page, other sizes and other styles stay unknown.
+  EXPECT_EQ(FontMetrics::kUnknown, metrics.Advance(25, 0, 'B'));
+  EXPECT_EQ(FontMetrics::kUnknown, metrics.Advance(24, 0, 'A'));
+  EXPECT_EQ(FontMetrics::kUnknown, metrics.Advance(25, 2, 'A'));
+
+  // A zero width (combining marks, missing glyphs) is a real answer.
+  metrics.SetAdvance(25, 0, 0x0301, 0);
+  EXPECT_EQ(0, metrics.Advance(25, 0, 0x0301));
+}
+
+TEST(FontMetricsTest, OnlyPlainBmpTextIsDense) {
+  FontMetrics metrics;
+  metrics.SetAdvance(25, 0, 'a', 12);
+  metrics.SetAdvance(25, 0, 'z', 12);
+  EXPECT_EQ(1, metrics.page_count());
+  metrics.SetAdvance(25, 0, 0x3042, 25);
+  metrics.SetAdvance(26, 0, 'a', 13);
+  EXPECT_EQ(3, metrics.page_count());
+
+  // Italics, huge sizes and astral characters don't allocate pages.
+  metrics.SetAdvance(25, 2, 'a', 13);
+  metrics.SetAdvance(400, 0, 'a', 190);
+  metrics.SetAdvance(25, 0, 0x1f600, 25);
+  EXPECT_EQ(3, metrics.page_count());
+  EXPECT_EQ(13, metrics.Advance(25, 2, 'a'));
+  EXPECT_EQ(190, metrics.Advance(400, 0, 'a'));
+  EXPECT_EQ(25, metrics.Advance(25, 0, 0x1f600));
+  EXPECT_EQ(12, metrics.Advance(25, 0, 'a'));
+}
+
+TEST(FontMetricsTest, Clear) {
+  FontMetrics metrics;
+  metrics.SetAdvance(25, 0, 'a', 12);
+  metrics.SetAdvance(25, 2, 'a', 13);
+  metrics.Clear();
+  EXPECT_EQ(0, metrics.page_count());
+  EXPECT_EQ(FontMetrics::kUnknown, metrics.Advance(25, 0, 'a'));
+  EXPECT_EQ(FontMetrics::kUnknown, metrics.Advance(25, 2, 'a'));
+}
+
+// Line breaking asks for the width of every character of every line. Compares
+// the dense tables against the map of (size, style, codepoint) that
+// GlyphCache used to keep.
+TEST(FontMetricsTest, DISABLED_LookupThroughputBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::tuple<int, int, uint32_t> Key;
+  const int kPasses = 20000;
+
+  // A line of English with some full width punctuation mixed in, the way
+  // translated games tend to look.
+  std::u32string line =
+      U"「It's been a long time, hasn't it?」 She smiled, and for a "
+      U"moment the town looked the way it did back then…";
+
+  FontMetrics metrics;
+  std::map<Key, int> advances;
+  for (int size = 20; size <= 30; ++size) {
+    for (char32_t c : line) {
+      metrics.SetAdvance(size, 0, c, size / 2);
+      advances[Key(size, 0, c)] = size / 2;
+    }
+  }
+
+  int64_t checksum = 0;
+  Clock::time_point start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (char32_t c : line)
+      checksum += advances.find(Key(25, 0, c))->second;
+  }
+  double map = std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (char32_t c : line)
+      checksum -= metrics.Advance(25, 0, c);
+  }
+  double dense = std::chrono::duration<double>(Clock::now() - start).count();
+
+  EXPECT_EQ(0, checksum);
+  double lookups = double(line.size()) * kPasses / 1e6;
+  std::cerr << "map " << lookups / map << "M lookups/s, dense tables "
+            << lookups / dense << "M lookups/s" << std::endl;
+}
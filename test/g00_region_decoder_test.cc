@@ -0,0 +1,244 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xclannad/file.h"
+
+namespace {
+
+struct TestBlock {
+  int region;
+  int x, y, w, h;
+  uint32_t colour;
+};
+
+void AppendInt(std::string* out, int value) {
+  for (int i = 0; i < 4; ++i)
+    out->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+}
+
+void AppendShort(std::string* out, int value) {
+  out->push_back(static_cast<char>(value & 0xff));
+  out->push_back(static_cast<char>((value >> 8) & 0xff));
+}
+
+// Builds a G00 type 2 file with one region per entry in |regions|, filled
+// with the pixel blocks in |blocks|. The LZ stream only uses literals.
+std::string MakeG00(int width,
+                    int height,
+                    const std::vector<GRPCONV::REGION>& regions,
+                    const std::vector<TestBlock>& blocks) {
+  std::string region_data;
+  std::vector<int> offsets, lengths;
+  int index_size = 4 + regions.size() * 8;
+  for (size_t i = 0; i < regions.size(); ++i) {
+    std::string body(0x74, '\0');
+    for (const TestBlock& block : blocks) {
+      if (block.region != static_cast<int>(i))
+        continue;
+      std::string header(0x5c, '\0');
+      std::string fields;
+      AppendShort(&fields, block.x);
+      AppendShort(&fields, block.y);
+      AppendShort(&fields, 0);
+      AppendShort(&fields, block.w);
+      AppendShort(&fields, block.h);
+      header.replace(0, fields.size(), fields);
+      body += header;
+      for (int p = 0; p < block.w * block.h; ++p)
+        AppendInt(&body, block.colour + p);
+    }
+    offsets.push_back(index_size + region_data.size());
+    lengths.push_back(body.size());
+    region_data += body;
+  }
+
+  std::string uncompressed;
+  AppendInt(&uncompressed, regions.size());
+  for (size_t i = 0; i < regions.size(); ++i) {
+    AppendInt(&uncompressed, offsets[i]);
+    AppendInt(&uncompressed, lengths[i]);
+  }
+  uncompressed += region_data;
+
+  std::string compressed;
+  for (size_t i = 0; i < uncompressed.size(); i += 8) {
+    compressed.push_back(static_cast<char>(0xff));
+    compressed += uncompressed.substr(i, 8);
+  }
+
+  std::string file;
+  file.push_back(2);
+  AppendShort(&file, width);
+  AppendShort(&file, height);
+  AppendInt(&file, regions.size());
+  for (const GRPCONV::REGION& region : regions) {
+    AppendInt(&file, region.x1);
+    AppendInt(&file, region.y1);
+    AppendInt(&file, region.x2);
+    AppendInt(&file, region.y2);
+    AppendInt(&file, region.origin_x);
+    AppendInt(&file, region.origin_y);
+  }
+  AppendInt(&file, compressed.size() + 8);
+  AppendInt(&file, uncompressed.size());
+  file += compressed;
+  return file;
+}
+
+GRPCONV::REGION MakeRegion(int x1, int y1, int x2, int y2) {
+  GRPCONV::REGION region = {x1, y1, x2, y2, 0, 0};
+  return region;
+}
+
+// Four 64x64 patterns side by side on a 256x64 canvas.
+std::string MakeStripG00() {
+  std::vector<GRPCONV::REGION> regions;
+  std::vector<TestBlock> blocks;
+  for (int i = 0; i < 4; ++i) {
+    regions.push_back(MakeRegion(i * 64, 0, i * 64 + 63, 63));
+    blocks.push_back({i, 0, 0, 64, 32, 0xff000000u + i * 0x10000});
+    blocks.push_back({i, 8, 32, 48, 32, 0x80000000u + i * 0x10000});
+  }
+  return MakeG00(256, 64, regions, blocks);
+}
+
+std::unique_ptr<GRPCONV> Converter(const std::string& file) {
+  return std::unique_ptr<GRPCONV>(
+      GRPCONV::AssignConverter(file.data(), file.size(), "test.g00"));
+}
+
+}  // namespace
+
+TEST(G00RegionDecoderTest, RegionsMatchFullRead) {
+  std::string file = MakeStripG00();
+  std::unique_ptr<GRPCONV> conv = Converter(file);
+  ASSERT_TRUE(conv != nullptr);
+  ASSERT_EQ(256, conv->Width());
+
+  std::vector<uint32_t> full(256 * 64 + 256);
+  ASSERT_TRUE(conv->Read(reinterpret_cast<char*>(full.data())));
+  EXPECT_EQ(GRPCONV::OPACITY_TRANSLUCENT, conv->opacity);
+
+  std::unique_ptr<G00RegionDecoder> decoder(conv->DecompressRegions());
+  ASSERT_TRUE(decoder != nullptr);
+  ASSERT_EQ(4, decoder->RegionCount());
+  EXPECT_FALSE(decoder->RegionsOverlap());
+  EXPECT_EQ(4 * (64 * 32 + 48 * 32), decoder->PixelCount());
+
+  // Copying the regions one at a time, in any order, gives the same image.
+  std::vector<uint32_t> piecewise(256 * 64, 0);
+  for (int i : {2, 0, 3, 1})
+    decoder->CopyRegion(i, reinterpret_cast<char*>(piecewise.data()));
+  EXPECT_TRUE(std::equal(piecewise.begin(), piecewise.end(), full.begin()));
+
+  // And each region only touches its own area.
+  const G00RegionDecoder::Area& area = decoder->RegionArea(1);
+  EXPECT_EQ(64, area.x1);
+  EXPECT_EQ(0, area.y1);
+  EXPECT_EQ(128, area.x2);
+  EXPECT_EQ(64, area.y2);
+  std::vector<uint32_t> single(256 * 64, 0);
+  decoder->CopyRegion(1, reinterpret_cast<char*>(single.data()));
+  for (int y = 0; y < 64; ++y) {
+    for (int x = 0; x < 256; ++x) {
+      uint32_t pixel = single[y * 256 + x];
+      if (x < 64 || x >= 128)
+        ASSERT_EQ(0u, pixel) << x << "," << y;
+      else
+        ASSERT_EQ(full[y * 256 + x], pixel) << x << "," << y;
+    }
+  }
+}
+
+TEST(G00RegionDecoderTest, OpacityOfCopies) {
+  std::vector<GRPCONV::REGION> regions = {MakeRegion(0, 0, 15, 15),
+                                          MakeRegion(16, 0, 31, 15)};
+  std::vector<TestBlock> blocks = {{0, 0, 0, 16, 16, 0xff000000u},
+                                   {1, 0, 0, 16, 16, 0x7f000000u}};
+  std::string file = MakeG00(32, 16, regions, blocks);
+  std::unique_ptr<GRPCONV> conv = Converter(file);
+  ASSERT_TRUE(conv != nullptr);
+  std::unique_ptr<G00RegionDecoder> decoder(conv->DecompressRegions());
+  ASSERT_TRUE(decoder != nullptr);
+
+  std::vector<uint32_t> image(32 * 16, 0);
+  EXPECT_TRUE(decoder->CopyRegion(0, reinterpret_cast<char*>(image.data())));
+  EXPECT_FALSE(decoder->CopyRegion(1, reinterpret_cast<char*>(image.data())));
+  EXPECT_FALSE(decoder->CopyAllRegions(reinterpret_cast<char*>(image.data())));
+}
+
+TEST(G00RegionDecoderTest, DetectsOverlapAndClipsToCanvas) {
+  std::vector<GRPCONV::REGION> regions = {MakeRegion(0, 0, 15, 15),
+                                          MakeRegion(8, 0, 15, 15)};
+  // The second block hangs 8 pixels off the right of the canvas.
+  std::vector<TestBlock> blocks = {{0, 0, 0, 16, 16, 0xff000000u},
+                                   {1, 0, 4, 16, 4, 0xff100000u}};
+  std::string file = MakeG00(16, 16, regions, blocks);
+  std::unique_ptr<GRPCONV> conv = Converter(file);
+  ASSERT_TRUE(conv != nullptr);
+  std::unique_ptr<G00RegionDecoder> decoder(conv->DecompressRegions());
+  ASSERT_TRUE(decoder != nullptr);
+  EXPECT_TRUE(decoder->RegionsOverlap());
+  EXPECT_EQ(16 * 16 + 8 * 4, decoder->PixelCount());
+
+  // Later regions still win where they overlap.
+  std::vector<uint32_t> image(16 * 16 + 256);
+  ASSERT_TRUE(conv->Read(reinterpret_cast<char*>(image.data())));
+  EXPECT_EQ(0xff100000u, image[4 * 16 + 8]);
+  EXPECT_EQ(0xff100000u + 16 * 3 + 7, image[7 * 16 + 15]);
+  EXPECT_EQ(0xff000000u + 8 * 16 + 8, image[8 * 16 + 8]);
+}
+
+TEST(G00RegionDecoderTest, ParallelCopyMatchesSequential) {
+  // Big enough to clear the threshold for using worker threads.
+  std::vector<GRPCONV::REGION> regions;
+  std::vector<TestBlock> blocks;
+  for (int i = 0; i < 16; ++i) {
+    int x = (i % 4) * 256, y = (i / 4) * 256;
+    regions.push_back(MakeRegion(x, y, x + 255, y + 255));
+    blocks.push_back({i, 0, 0, 256, 256, 0xff000000u + i * 0x100000});
+  }
+  std::string file = MakeG00(1024, 1024, regions, blocks);
+  std::unique_ptr<GRPCONV> conv = Converter(file);
+  ASSERT_TRUE(conv != nullptr);
+  std::unique_ptr<G00RegionDecoder> decoder(conv->DecompressRegions());
+  ASSERT_TRUE(decoder != nullptr);
+
+  std::vector<uint32_t> parallel(1024 * 1024, 0);
+  EXPECT_TRUE(decoder->CopyAllRegions(reinterpret_cast<char*>(parallel.data())));
+  std::vector<uint32_t> sequential(1024 * 1024, 0);
+  for (int i = 0; i < decoder->RegionCount(); ++i)
+    decoder->CopyRegion(i, reinterpret_cast<char*>(sequential.data()));
+  EXPECT_TRUE(parallel == sequential);
+}
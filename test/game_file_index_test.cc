@@ -0,0 +1,163 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "systems/base/game_file_index.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::vector<std::string> kFileTypes = {"g00", "pdt", "anm", "ogg"};
+const std::vector<std::string> kImageTypes = {"g00", "pdt"};
+const std::vector<std::string> kPdtFirst = {"pdt", "g00"};
+
+}  // namespace
+
+class GameFileIndexTest : public ::testing::Test {
+ protected:
+  GameFileIndexTest()
+      : root_(fs::temp_directory_path() /
+              fs::unique_path("rlvm-file-index-%%%%-%%%%")),
+        folders_({"g00", "bgm"}) {
+    game_ = root_ / "game";
+    fs::create_directories(game_ / "G00" / "Sub");
+    fs::create_directories(game_ / "bgm");
+    fs::create_directories(game_ / "notindexed");
+    Touch(game_ / "G00" / "BG001.g00");
+    Touch(game_ / "G00" / "bg001.PDT");
+    Touch(game_ / "G00" / "Sub" / "chr01.anm");
+    Touch(game_ / "G00" / "readme.txt");
+    Touch(game_ / "bgm" / "track01.ogg");
+    Touch(game_ / "notindexed" / "secret.g00");
+    saved_index_ = root_ / "saved_index";
+  }
+
+  ~GameFileIndexTest() {
+    boost::system::error_code ec;
+    fs::remove_all(root_, ec);
+  }
+
+  void Touch(const fs::path& path) {
+    std::ofstream out(path.string().c_str());
+  }
+
+  // Makes every directory look old, so that touching one is guaranteed to
+  // change its modification time even within the same second.
+  void AgeDirectories() {
+    std::time_t old = std::time(NULL) - 1000;
+    fs::last_write_time(game_, old);
+    for (fs::recursive_directory_iterator it(game_), end; it != end; ++it) {
+      if (fs::is_directory(it->status()))
+        fs::last_write_time(it->path(), old);
+    }
+  }
+
+  fs::path root_;
+  fs::path game_;
+  std::vector<std::string> folders_;
+  fs::path saved_index_;
+};
+
+TEST_F(GameFileIndexTest, FindsFilesInPriorityOrder) {
+  GameFileIndex index(kFileTypes);
+  index.RegisterExtensionList(&kImageTypes);
+  index.StartBuild(game_, folders_, fs::path());
+
+  EXPECT_EQ(game_ / "G00" / "BG001.g00", index.Find("bg001", kImageTypes));
+  EXPECT_EQ(game_ / "G00" / "bg001.PDT", index.Find("bg001", kPdtFirst));
+  EXPECT_EQ(game_ / "G00" / "Sub" / "chr01.anm",
+            index.Find("chr01", kFileTypes));
+  EXPECT_EQ(game_ / "bgm" / "track01.ogg", index.Find("track01", kFileTypes));
+  EXPECT_EQ(4u, index.size());
+
+  // Wrong extension, unindexed type, or outside the #FOLDNAME directories.
+  EXPECT_TRUE(index.Find("chr01", kImageTypes).empty());
+  EXPECT_TRUE(index.Find("readme", kFileTypes).empty());
+  EXPECT_TRUE(index.Find("secret", kFileTypes).empty());
+  EXPECT_TRUE(index.Find("missing", kFileTypes).empty());
+}
+
+TEST_F(GameFileIndexTest, ReusesSavedIndexUntilADirectoryChanges) {
+  AgeDirectories();
+  {
+    GameFileIndex index(kFileTypes);
+    index.StartBuild(game_, folders_, saved_index_);
+    index.WaitUntilBuilt();
+    EXPECT_FALSE(index.loaded_from_saved_index());
+  }
+  ASSERT_TRUE(fs::exists(saved_index_));
+
+  {
+    GameFileIndex index(kFileTypes);
+    index.StartBuild(game_, folders_, saved_index_);
+    EXPECT_EQ(game_ / "bgm" / "track01.ogg",
+              index.Find("track01", kFileTypes));
+    EXPECT_TRUE(index.loaded_from_saved_index());
+    EXPECT_EQ(4u, index.size());
+  }
+
+  // A new file in a subdirectory makes the saved index stale.
+  Touch(game_ / "G00" / "Sub" / "chr02.anm");
+  GameFileIndex index(kFileTypes);
+  index.StartBuild(game_, folders_, saved_index_);
+  EXPECT_EQ(game_ / "G00" / "Sub" / "chr02.anm",
+            index.Find("chr02", kFileTypes));
+  EXPECT_FALSE(index.loaded_from_saved_index());
+}
+
+TEST_F(GameFileIndexTest, SavedIndexForOtherFoldersIsIgnored) {
+  {
+    GameFileIndex index(kFileTypes);
+    index.StartBuild(game_, {"bgm"}, saved_index_);
+    EXPECT_TRUE(index.Find("bg001", kImageTypes).empty());
+  }
+
+  GameFileIndex index(kFileTypes);
+  index.StartBuild(game_, folders_, saved_index_);
+  EXPECT_FALSE(index.Find("bg001", kImageTypes).empty());
+  EXPECT_FALSE(index.loaded_from_saved_index());
+}
+
+TEST_F(GameFileIndexTest, CorruptSavedIndexIsRebuilt) {
+  {
+    std::ofstream out(saved_index_.string().c_str());
+    out << "not an index";
+  }
+
+  GameFileIndex index(kFileTypes);
+  index.StartBuild(game_, folders_, saved_index_);
+  EXPECT_EQ(game_ / "bgm" / "track01.ogg", index.Find("track01", kFileTypes));
+  EXPECT_FALSE(index.loaded_from_saved_index());
+}
@@ -0,0 +1,205 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "systems/base/colour.h"
+#include "systems/base/glyph_cache.h"
+
+namespace {
+
+// A |width| x |height| cell with a filled box of ink, its coverage rising
+// across each row.
+std::vector<uint8_t> MakeCoverage(int width, int height, const Rect& ink) {
+  std::vector<uint8_t> coverage(width * height, 0);
+  for (int y = ink.y(); y < ink.y2(); ++y) {
+    for (int x = ink.x(); x < ink.x2(); ++x)
+      coverage[y * width + x] = 40 + 30 * (x - ink.x()) + y;
+  }
+  return coverage;
+}
+
+// pygame's ALPHA_BLEND, as pygame_AlphaBlit() applies it to each pixel of a
+// TTF_RenderUTF8_Blended() surface.
+uint32_t ReferenceBlend(uint32_t dest, const RGBColour& colour, int sA) {
+  int dR = (dest >> 16) & 0xff, dG = (dest >> 8) & 0xff, dB = dest & 0xff;
+  int dA = dest >> 24;
+  int sR = colour.r(), sG = colour.g(), sB = colour.b();
+  if (dA) {
+    dR = ((dR << 8) + (sR - dR) * sA + sR) >> 8;
+    dG = ((dG << 8) + (sG - dG) * sA + sG) >> 8;
+    dB = ((dB << 8) + (sB - dB) * sA + sB) >> 8;
+    dA = sA + dA - ((sA * dA) / 255);
+  } else {
+    dR = sR;
+    dG = sG;
+    dB = sB;
+    dA = sA;
+  }
+  return (uint32_t(dA) << 24) | (dR << 16) | (dG << 8) | dB;
+}
+
+}  // namespace
+
+TEST(GlyphCacheTest, StoresTrimmedCoverage) {
+  GlyphCache cache(64, 1);
+  GlyphCache::Key key(25, 0, 0x3042);
+  EXPECT_TRUE(cache.Find(key) == NULL);
+
+  Rect ink = Rect::GRP(2, 1, 5, 4);
+  std::vector<uint8_t> coverage = MakeCoverage(7, 6, ink);
+  const GlyphCache::Glyph* stored = cache.Store(key, 7, 6, &coverage[0], 7);
+  ASSERT_TRUE(stored != NULL);
+  EXPECT_EQ(Size(7, 6), stored->cell);
+  EXPECT_EQ(ink, stored->ink);
+
+  const GlyphCache::Glyph* glyph = cache.Find(key);
+  ASSERT_TRUE(glyph != NULL);
+  for (int y = 0; y < 6; ++y) {
+    for (int x = 0; x < 7; ++x)
+      EXPECT_EQ(coverage[y * 7 + x], cache.CoverageAt(*glyph, x, y));
+  }
+
+  // Other sizes and styles are different glyphs.
+  EXPECT_TRUE(cache.Find(GlyphCache::Key(26, 0, 0x3042)) == NULL);
+  EXPECT_TRUE(cache.Find(GlyphCache::Key(25, 2, 0x3042)) == NULL);
+
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(3, cache.misses());
+}
+
+TEST(GlyphCacheTest, BlankGlyphsTakeNoAtlasSpace) {
+  GlyphCache cache(64, 1);
+  std::vector<uint8_t> coverage(12 * 25, 0);
+  const GlyphCache::Glyph* glyph =
+      cache.Store(GlyphCache::Key(25, 0, ' '), 12, 25, &coverage[0], 12);
+  ASSERT_TRUE(glyph != NULL);
+  EXPECT_EQ(Size(12, 25), glyph->cell);
+  EXPECT_EQ(0, cache.page_count());
+}
+
+TEST(GlyphCacheTest, FlushesWhenTheAtlasIsFull) {
+  GlyphCache cache(8, 1);
+  std::vector<uint8_t> coverage = MakeCoverage(8, 8, Rect::GRP(0, 0, 8, 8));
+  GlyphCache::Key first(25, 0, 'a');
+  GlyphCache::Key second(25, 0, 'b');
+
+  ASSERT_TRUE(cache.Store(first, 8, 8, &coverage[0], 8) != NULL);
+  ASSERT_TRUE(cache.Store(second, 8, 8, &coverage[0], 8) != NULL);
+  EXPECT_EQ(1, cache.flushes());
+  EXPECT_EQ(1, cache.page_count());
+  EXPECT_TRUE(cache.Find(first) == NULL);
+  EXPECT_TRUE(cache.Find(second) != NULL);
+
+  // Bigger than a page never fits.
+  std::vector<uint8_t> big = MakeCoverage(9, 9, Rect::GRP(0, 0, 9, 9));
+  EXPECT_TRUE(cache.Store(GlyphCache::Key(25, 0, 'c'), 9, 9, &big[0], 9) ==
+              NULL);
+}
+
+TEST(GlyphCacheTest, CompositeMatchesAlphaBlit) {
+  GlyphCache cache(64, 1);
+  Rect ink = Rect::GRP(1, 2, 6, 7);
+  std::vector<uint8_t> coverage = MakeCoverage(8, 9, ink);
+  const GlyphCache::Glyph* glyph =
+      cache.Store(GlyphCache::Key(25, 0, 'x'), 8, 9, &coverage[0], 8);
+  ASSERT_TRUE(glyph != NULL);
+
+  // A destination with some fully transparent pixels, drawn to hanging off
+  // the bottom right corner so clipping is covered too.
+  const int kWidth = 12, kHeight = 10;
+  std::vector<uint32_t> pixels(kWidth * kHeight);
+  for (int i = 0; i < kWidth * kHeight; ++i)
+    pixels[i] = i % 5 == 0 ? 0x00102030 : 0x80000000u + i * 0x010305u;
+  std::vector<uint32_t> expected = pixels;
+
+  RGBColour colour(200, 100, 50);
+  Point origin(6, 4);
+  for (int y = 0; y < 9; ++y) {
+    for (int x = 0; x < 8; ++x) {
+      int dx = origin.x() + x, dy = origin.y() + y;
+      if (dx < kWidth && dy < kHeight) {
+        uint32_t& pixel = expected[dy * kWidth + dx];
+        pixel = ReferenceBlend(pixel, colour, coverage[y * 8 + x]);
+      }
+    }
+  }
+
+  GlyphCache::Target target;
+  target.pixels = reinterpret_cast<uint8_t*>(&pixels[0]);
+  target.pitch = kWidth * 4;
+  target.size = Size(kWidth, kHeight);
+  cache.Composite(*glyph, colour, origin, target);
+  for (int i = 0; i < kWidth * kHeight; ++i)
+    EXPECT_EQ(expected[i], pixels[i]) << "pixel " << i;
+}
+
+TEST(GlyphCacheTest, DISABLED_DialoguePageBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kPages = 2000;
+  const int kCharactersPerPage = 120;
+  const int kDistinctCharacters = 600;
+
+  GlyphCache cache(1024, 4);
+  std::vector<uint8_t> coverage =
+      MakeCoverage(25, 25, Rect::GRP(2, 3, 23, 24));
+  std::vector<uint32_t> window(640 * 120, 0x80000000u);
+  GlyphCache::Target target;
+  target.pixels = reinterpret_cast<uint8_t*>(&window[0]);
+  target.pitch = 640 * 4;
+  target.size = Size(640, 120);
+
+  // Character frequencies in dialogue are skewed; the most common few
+  // hundred make up almost all of the text.
+  unsigned int seed = 1;
+  Clock::time_point start = Clock::now();
+  for (int page = 0; page < kPages; ++page) {
+    for (int i = 0; i < kCharactersPerPage; ++i) {
+      seed = seed * 1103515245 + 12345;
+      int rank = (seed >> 16) % kDistinctCharacters;
+      rank = rank * rank / kDistinctCharacters;
+      GlyphCache::Key key(25, 0, 0x4e00 + rank);
+      const GlyphCache::Glyph* glyph = cache.Find(key);
+      if (!glyph)
+        glyph = cache.Store(key, 25, 25, &coverage[0], 25);
+      Point origin((i % 24) * 26, (i / 24) * 24);
+      cache.Composite(*glyph, RGBColour(0, 0, 0), origin + Point(2, 2),
+                      target);
+      cache.Composite(*glyph, RGBColour::White(), origin, target);
+    }
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  int glyphs = kPages * kCharactersPerPage;
+  std::cerr << glyphs << " glyphs with shadows: " << int(glyphs / seconds)
+            << " glyphs/s, " << cache.hits() * 100 / glyphs << "% hits, "
+            << cache.page_count() << " atlas pages" << std::endl;
+}
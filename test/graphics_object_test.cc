@@ -342,15 +342,16 @@ class MutatorTest : public ObjectMutator {
 
   bool called() const { return called_; }
 
-  virtual bool operator()(RLMachine& machine, GraphicsObject& object) override {
+  virtual bool operator()(ObjectMutatorBatch& batch,
+                          GraphicsObject& object) override {
     called_ = true;
     return false;
   }
 
   virtual void SetToEnd(RLMachine& machine, GraphicsObject& object) override {}
   virtual ObjectMutator* Clone() const override { return NULL; }
-  virtual void PerformSetting(RLMachine& machine, GraphicsObject& object)
-      override {}
+  virtual void PerformSetting(ObjectMutatorBatch& batch,
+                              GraphicsObject& object) override {}
 
  private:
   bool called_;
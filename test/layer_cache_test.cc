@@ -0,0 +1,181 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "systems/base/layer_cache.h"
+
+namespace {
+
+// Plans one frame of |signatures|, keyed by position.
+void PlanFrame(LayerCache* cache, const std::vector<uint64_t>& signatures) {
+  cache->BeginFrame();
+  for (size_t i = 0; i < signatures.size(); ++i)
+    cache->Add(i, signatures[i]);
+  cache->EndFrame();
+}
+
+// Plans frames of |signatures| until they've been stable long enough to be
+// cached.
+void Settle(LayerCache* cache, const std::vector<uint64_t>& signatures) {
+  for (int i = 0; i < LayerCache::kMinStableFrames; ++i)
+    PlanFrame(cache, signatures);
+}
+
+}  // namespace
+
+TEST(LayerCacheTest, NewItemsAreNotCached) {
+  LayerCache cache;
+  PlanFrame(&cache, {1, 2, 3});
+  EXPECT_EQ(0, cache.cached_count());
+  EXPECT_FALSE(cache.needs_rebuild());
+}
+
+TEST(LayerCacheTest, StaticSceneIsBuiltOnceThenReused) {
+  LayerCache cache;
+  std::vector<uint64_t> scene = {1, 2, 3, 4};
+  Settle(&cache, scene);
+  EXPECT_EQ(4, cache.cached_count());
+  EXPECT_TRUE(cache.needs_rebuild());
+
+  PlanFrame(&cache, scene);
+  EXPECT_EQ(4, cache.cached_count());
+  EXPECT_FALSE(cache.needs_rebuild());
+  EXPECT_EQ(1, cache.rebuilds());
+  EXPECT_EQ(1, cache.reuses());
+}
+
+TEST(LayerCacheTest, AnimatingItemEndsTheCachedRun) {
+  LayerCache cache;
+  std::vector<uint64_t> scene = {1, 2, 3, 4, 5};
+  Settle(&cache, scene);
+  PlanFrame(&cache, scene);
+
+  // Everything from the first changing item up is drawn live, including the
+  // static items above it.
+  for (int frame = 0; frame < 5; ++frame) {
+    scene[2] = 100 + frame;
+    PlanFrame(&cache, scene);
+    EXPECT_EQ(2, cache.cached_count());
+    EXPECT_EQ(frame == 0, cache.needs_rebuild());
+  }
+}
+
+TEST(LayerCacheTest, ChangeInsideTheRunRebuilds) {
+  LayerCache cache;
+  std::vector<uint64_t> scene = {1, 2, 3};
+  Settle(&cache, scene);
+  PlanFrame(&cache, scene);
+  EXPECT_FALSE(cache.needs_rebuild());
+
+  // A one off change drops the item out of the run until it's been stable
+  // again, then the layer is rebuilt with it.
+  scene[1] = 20;
+  PlanFrame(&cache, scene);
+  EXPECT_EQ(0, cache.cached_count());
+  for (int i = 1; i < LayerCache::kMinStableFrames; ++i)
+    PlanFrame(&cache, scene);
+  EXPECT_EQ(3, cache.cached_count());
+  EXPECT_TRUE(cache.needs_rebuild());
+}
+
+TEST(LayerCacheTest, RemovedItemRebuilds) {
+  LayerCache cache;
+  Settle(&cache, {1, 2, 3});
+  PlanFrame(&cache, {1, 2, 3});
+
+  cache.BeginFrame();
+  cache.Add(0, 1);
+  cache.Add(2, 3);
+  cache.EndFrame();
+  EXPECT_EQ(2, cache.cached_count());
+  EXPECT_TRUE(cache.needs_rebuild());
+}
+
+TEST(LayerCacheTest, SingleItemIsNotCached) {
+  LayerCache cache;
+  std::vector<uint64_t> scene = {1, 2};
+  Settle(&cache, scene);
+  scene[1] = 3;
+  PlanFrame(&cache, scene);
+  EXPECT_EQ(0, cache.cached_count());
+}
+
+TEST(LayerCacheTest, InvalidateForcesRebuild) {
+  LayerCache cache;
+  std::vector<uint64_t> scene = {1, 2, 3};
+  Settle(&cache, scene);
+  PlanFrame(&cache, scene);
+  EXPECT_FALSE(cache.needs_rebuild());
+
+  cache.Invalidate();
+  PlanFrame(&cache, scene);
+  EXPECT_TRUE(cache.needs_rebuild());
+}
+
+// Not run by default; pass --gtest_also_run_disabled_tests to get numbers.
+// An object heavy scene: a background and 250 static objects (sprites,
+// buttons, parts of the UI) with a handful of animating objects on top.
+// Reports the planning overhead and how many draws a frame still needs.
+TEST(LayerCacheTest, DISABLED_ObjectHeavySceneBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kStaticItems = 251;
+  const int kAnimatingItems = 6;
+  const int kFrames = 20000;
+
+  std::vector<uint64_t> scene(kStaticItems + kAnimatingItems);
+  for (size_t i = 0; i < scene.size(); ++i)
+    scene[i] = i * 7919;
+
+  LayerCache cache;
+  long long draws = 0;
+  Clock::time_point start = Clock::now();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    for (int i = 0; i < kAnimatingItems; ++i)
+      scene[kStaticItems + i] = frame;
+    PlanFrame(&cache, scene);
+
+    // One draw for the layer, then everything above it.
+    draws += scene.size() - cache.cached_count();
+    if (cache.cached_count())
+      draws++;
+    if (cache.needs_rebuild())
+      draws += cache.cached_count();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cerr << "Planning " << scene.size() << " items: "
+            << seconds / kFrames * 1e6 << " us/frame\n"
+            << "Draws per frame: " << double(draws) / kFrames << " with the "
+            << "layer cache, " << scene.size() << " without ("
+            << cache.rebuilds() << " rebuilds)" << std::endl;
+  EXPECT_EQ(1, cache.rebuilds());
+}
@@ -0,0 +1,224 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "systems/base/graphics_object.h"
+#include "systems/base/object_mutator.h"
+#include "systems/base/object_mutator_batch.h"
+#include "utilities/math_util.h"
+
+namespace {
+
+struct Track {
+  int begin;
+  int duration;
+  int type;
+  int start;
+  int end;
+};
+
+// What ObjectMutator::GetValueForTime() used to compute, one track at a time.
+int ReferenceValue(const Track& track, unsigned int ticks) {
+  if (ticks < unsigned(track.begin))
+    return track.start;
+  if (ticks < unsigned(track.begin + track.duration)) {
+    return InterpolateBetween(track.begin, ticks, track.begin + track.duration,
+                              track.start, track.end, track.type);
+  }
+  return track.end;
+}
+
+// Milliseconds since |epoch|. Reads the clock like SDL_GetTicks() does.
+unsigned int TicksSince(std::chrono::steady_clock::time_point epoch) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - epoch).count();
+}
+
+std::vector<Track> MakeTracks(int count, unsigned int seed) {
+  srand(seed);
+  std::vector<Track> tracks(count);
+  for (Track& track : tracks) {
+    track.begin = 1000 + rand() % 2000;
+    track.duration = rand() % 1500;
+    track.type = rand() % 3;
+    track.start = rand() % 2000 - 1000;
+    track.end = rand() % 2000 - 1000;
+  }
+  return tracks;
+}
+
+}  // namespace
+
+TEST(ObjectMutatorBatchTest, MatchesScalarInterpolation) {
+  // 37 tracks so that the vector loop leaves some for the scalar tail.
+  std::vector<Track> tracks = MakeTracks(37, 1);
+  GraphicsObject object;
+
+  ObjectMutatorBatch batch;
+  for (unsigned int ticks = 900; ticks < 4700; ticks += 7) {
+    batch.Begin(ticks);
+    for (const Track& track : tracks) {
+      batch.Add(&object, &GraphicsObject::SetX, track.begin, track.duration,
+                track.type, track.start, track.end);
+    }
+    batch.Evaluate();
+
+    ASSERT_EQ(static_cast<int>(tracks.size()), batch.size());
+    for (size_t i = 0; i < tracks.size(); ++i) {
+      EXPECT_EQ(ReferenceValue(tracks[i], ticks), batch.values()[i])
+          << "track " << i << " at " << ticks;
+    }
+  }
+}
+
+TEST(ObjectMutatorBatchTest, ZeroDurationIsAtItsEndOnceStarted) {
+  GraphicsObject object;
+  ObjectMutatorBatch batch;
+
+  batch.Begin(99);
+  batch.Add(&object, &GraphicsObject::SetX, 100, 0, 0, 10, 20);
+  batch.Evaluate();
+  EXPECT_EQ(10, batch.values()[0]);
+
+  batch.Begin(100);
+  batch.Add(&object, &GraphicsObject::SetX, 100, 0, 0, 10, 20);
+  batch.Evaluate();
+  EXPECT_EQ(20, batch.values()[0]);
+}
+
+TEST(ObjectMutatorBatchTest, AppliesSettersInOrder) {
+  GraphicsObject object;
+  ObjectMutatorBatch batch;
+  batch.Begin(500);
+  EXPECT_TRUE(batch.is_open());
+
+  batch.Add(&object, &GraphicsObject::SetX, 0, 1000, 0, 0, 100);
+  batch.Add(&object, &GraphicsObject::SetXAdjustment, 3, 0, 1000, 0, 0, -40);
+  batch.Add(&object, &GraphicsObject::SetX, 0, 1000, 0, 0, 300);
+  EXPECT_EQ(3, batch.size());
+
+  EXPECT_TRUE(batch.Apply());
+  EXPECT_FALSE(batch.is_open());
+  EXPECT_EQ(150, object.x());
+  EXPECT_EQ(-20, object.x_adjustment(3));
+
+  // Nothing added, nothing set.
+  batch.Begin(600);
+  EXPECT_FALSE(batch.Apply());
+}
+
+TEST(ObjectMutatorBatchTest, MutatorsAddToTheBatch) {
+  GraphicsObject object;
+  OneIntObjectMutator mutator(
+      "objEveAlpha", 1000, 400, 100, 0, 255, 55, &GraphicsObject::SetAlpha);
+
+  // Nothing happens during the delay.
+  ObjectMutatorBatch batch;
+  batch.Begin(1100);
+  EXPECT_FALSE(mutator(batch, object));
+  EXPECT_EQ(0, batch.size());
+  batch.Apply();
+
+  batch.Begin(1300);
+  EXPECT_FALSE(mutator(batch, object));
+  batch.Apply();
+  EXPECT_EQ(155, object.raw_alpha());
+
+  batch.Begin(1501);
+  EXPECT_TRUE(mutator(batch, object));
+  batch.Apply();
+  EXPECT_EQ(55, object.raw_alpha());
+}
+
+// Thousands of objects each moving and fading at once, as in the credits of
+// some games. Compares the batch against evaluating and setting each track
+// on its own with a fresh read of the clock, which is what every mutator used
+// to do.
+TEST(ObjectMutatorBatchTest, DISABLED_ThousandsOfMutatorsBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kObjects = 4096;
+  const int kFrames = 500;
+
+  std::vector<GraphicsObject> objects(kObjects);
+  std::vector<std::unique_ptr<ObjectMutator>> mutators;
+  for (int i = 0; i < kObjects; ++i) {
+    int type = i % 8 == 0 ? 1 : 0;
+    mutators.emplace_back(new OneIntObjectMutator(
+        "objEveAlpha", i % 50, 20000, 0, type, 0, 255,
+        &GraphicsObject::SetAlpha));
+    mutators.emplace_back(new TwoIntObjectMutator(
+        "objEveMove", i % 50, 20000, 0, type, 0, 640, &GraphicsObject::SetX,
+        0, 480, &GraphicsObject::SetY));
+  }
+
+  std::vector<Track> tracks;
+  std::vector<ObjectMutatorBatch::Setter> setters;
+  for (int i = 0; i < kObjects; ++i) {
+    int type = i % 8 == 0 ? 1 : 0;
+    Track alpha = {i % 50, 20000, type, 0, 255};
+    Track x = {i % 50, 20000, type, 0, 640};
+    Track y = {i % 50, 20000, type, 0, 480};
+    tracks.push_back(alpha);
+    setters.push_back(&GraphicsObject::SetAlpha);
+    tracks.push_back(x);
+    setters.push_back(&GraphicsObject::SetX);
+    tracks.push_back(y);
+    setters.push_back(&GraphicsObject::SetY);
+  }
+
+  Clock::time_point start = Clock::now();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    for (size_t i = 0; i < tracks.size(); ++i) {
+      unsigned int ticks = 100 + frame * 16 + TicksSince(start);
+      (objects[i / 3].*setters[i])(ReferenceValue(tracks[i], ticks));
+    }
+  }
+  double one_at_a_time =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  ObjectMutatorBatch batch;
+  start = Clock::now();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    batch.Begin(100 + frame * 16 + TicksSince(start));
+    for (size_t i = 0; i < mutators.size(); ++i)
+      (*mutators[i])(batch, objects[i / 2]);
+    batch.Apply();
+  }
+  double batched =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  double per_track = 1e9 / (double(kFrames) * tracks.size());
+  std::cerr << tracks.size() << " tracks: one at a time "
+            << one_at_a_time * per_track << " ns/track, batched "
+            << batched * per_track << " ns/track" << std::endl;
+}
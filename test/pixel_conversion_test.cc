@@ -0,0 +1,308 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "test_utils.h"
+#include "utilities/pixel_conversion.h"
+#include "xclannad/file.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Odd lengths so that every SIMD path also has to run its scalar tail.
+const int kPixelCounts[] = {0, 1, 3, 7, 15, 16, 17, 31, 257, 1031};
+
+std::vector<char> MakeNoise(int bytes, unsigned seed) {
+  std::vector<char> out(bytes);
+  for (int i = 0; i < bytes; ++i) {
+    seed = seed * 1103515245 + 12345;
+    out[i] = static_cast<char>(seed >> 16);
+  }
+  return out;
+}
+
+uint32_t Byte(const std::vector<char>& v, int i) {
+  return static_cast<unsigned char>(v[i]);
+}
+
+}  // namespace
+
+TEST(PixelConversionTest, ExpandRGBMatchesReference) {
+  for (int count : kPixelCounts) {
+    std::vector<char> src = MakeNoise(count * 3, count);
+    std::vector<uint32_t> dest(count);
+    ExpandRGBToRGBA(src.data(), dest.data(), count);
+    for (int i = 0; i < count; ++i) {
+      uint32_t expected = Byte(src, i * 3) | (Byte(src, i * 3 + 1) << 8) |
+                          (Byte(src, i * 3 + 2) << 16) | 0xff000000;
+      ASSERT_EQ(expected, dest[i]) << "count " << count << " pixel " << i;
+    }
+  }
+}
+
+TEST(PixelConversionTest, CopyRGBAMatchesReferenceAndReportsOpacity) {
+  for (int count : kPixelCounts) {
+    std::vector<char> src = MakeNoise(count * 4, count + 1);
+    for (int i = 0; i < count; ++i)
+      src[i * 4 + 3] = static_cast<char>(0xff);
+
+    std::vector<uint32_t> dest(count);
+    EXPECT_TRUE(CopyRGBAPixels(src.data(), dest.data(), count));
+    for (int i = 0; i < count; ++i) {
+      uint32_t expected = Byte(src, i * 4) | (Byte(src, i * 4 + 1) << 8) |
+                          (Byte(src, i * 4 + 2) << 16) | 0xff000000;
+      ASSERT_EQ(expected, dest[i]) << "count " << count << " pixel " << i;
+    }
+
+    // A single translucent pixel anywhere, including in the tail, must be
+    // noticed.
+    if (count) {
+      src[(count - 1) * 4 + 3] = 0x7f;
+      EXPECT_FALSE(CopyRGBAPixels(src.data(), dest.data(), count));
+      src[(count - 1) * 4 + 3] = static_cast<char>(0xff);
+      src[3] = 0;
+      EXPECT_FALSE(CopyRGBAPixels(src.data(), dest.data(), count));
+    }
+  }
+}
+
+TEST(PixelConversionTest, CopyRGBAReversedSwapsRedAndBlue) {
+  for (int count : kPixelCounts) {
+    std::vector<char> src = MakeNoise(count * 4, count + 2);
+    std::vector<uint32_t> dest(count);
+    EXPECT_TRUE(
+        CopyRGBAPixelsReversed(src.data(), dest.data(), count, 0xff000000));
+    for (int i = 0; i < count; ++i) {
+      uint32_t expected = Byte(src, i * 4 + 2) | (Byte(src, i * 4 + 1) << 8) |
+                          (Byte(src, i * 4) << 16) |
+                          (Byte(src, i * 4 + 3) << 24) | 0xff000000;
+      ASSERT_EQ(expected, dest[i]) << "count " << count << " pixel " << i;
+    }
+  }
+}
+
+TEST(PixelConversionTest, MergeAlphaMask) {
+  for (int count : kPixelCounts) {
+    std::vector<char> mask = MakeNoise(count, count + 3);
+    std::vector<uint32_t> pixels(count, 0x00123456);
+    std::vector<uint32_t> expected(count);
+    bool expected_opaque = true;
+    for (int i = 0; i < count; ++i) {
+      expected[i] = 0x00123456 | (Byte(mask, i) << 24);
+      expected_opaque &= Byte(mask, i) == 0xff;
+    }
+
+    EXPECT_EQ(expected_opaque,
+              MergeAlphaMask(mask.data(), pixels.data(), count));
+    EXPECT_EQ(expected, pixels);
+  }
+}
+
+TEST(PixelConversionTest, IsFullyOpaque) {
+  std::vector<uint32_t> pixels(2000, 0xff102030);
+  EXPECT_TRUE(IsFullyOpaque(pixels.data(), pixels.size()));
+
+  for (int position : {0, 255, 256, 1000, 1999}) {
+    pixels[position] = 0xfe102030;
+    EXPECT_FALSE(IsFullyOpaque(pixels.data(), pixels.size())) << position;
+    pixels[position] = 0xff102030;
+  }
+}
+
+TEST(PixelConversionTest, MapColourChannelsLeavesAlphaAlone) {
+  uint8_t tables[3][256];
+  for (int i = 0; i < 256; ++i) {
+    tables[0][i] = 255 - i;
+    tables[1][i] = i / 2;
+    tables[2][i] = i ^ 0x5a;
+  }
+
+  for (int count : kPixelCounts) {
+    std::vector<char> noise = MakeNoise(count * 4, count + 4);
+    std::vector<uint32_t> pixels(count);
+    CopyRGBAPixels(noise.data(), pixels.data(), count);
+    std::vector<uint32_t> original = pixels;
+
+    // The layout SDLSurface uses: 0xAARRGGBB.
+    MapColourChannels(pixels.data(), count, tables[0], tables[1], tables[2],
+                      16, 8, 0);
+    for (int i = 0; i < count; ++i) {
+      uint32_t v = original[i];
+      uint32_t expected = (v & 0xff000000) |
+                          (tables[0][(v >> 16) & 0xff] << 16) |
+                          (tables[1][(v >> 8) & 0xff] << 8) |
+                          tables[2][v & 0xff];
+      ASSERT_EQ(expected, pixels[i]) << "count " << count << " pixel " << i;
+    }
+  }
+}
+
+TEST(PixelConversionTest, InvertColourChannels) {
+  for (int count : kPixelCounts) {
+    std::vector<char> noise = MakeNoise(count * 4, count + 5);
+    std::vector<uint32_t> pixels(count);
+    CopyRGBAPixels(noise.data(), pixels.data(), count);
+    std::vector<uint32_t> original = pixels;
+
+    InvertColourChannels(pixels.data(), count, 0x00ffffff);
+    for (int i = 0; i < count; ++i) {
+      ASSERT_EQ(original[i] ^ 0x00ffffff, pixels[i])
+          << "count " << count << " pixel " << i;
+    }
+  }
+}
+
+TEST(PixelConversionTest, MonoColourChannelsMatchesReference) {
+  // Both the 0xAARRGGBB layout and one with the channels elsewhere.
+  const int kLayouts[][3] = {{16, 8, 0}, {0, 8, 24}};
+  for (const auto& layout : kLayouts) {
+    for (int count : kPixelCounts) {
+      std::vector<char> noise = MakeNoise(count * 4, count + 6);
+      std::vector<uint32_t> pixels(count);
+      CopyRGBAPixels(noise.data(), pixels.data(), count);
+      std::vector<uint32_t> original = pixels;
+
+      MonoColourChannels(pixels.data(), count, layout[0], layout[1],
+                         layout[2]);
+      uint32_t channels = (0xffu << layout[0]) | (0xffu << layout[1]) |
+                          (0xffu << layout[2]);
+      for (int i = 0; i < count; ++i) {
+        uint32_t v = original[i];
+        uint32_t r = (v >> layout[0]) & 0xff;
+        uint32_t g = (v >> layout[1]) & 0xff;
+        uint32_t b = (v >> layout[2]) & 0xff;
+        uint32_t grey = (9830 * r + 19333 * g + 3605 * b) >> 15;
+        uint32_t expected = (v & ~channels) | (grey << layout[0]) |
+                            (grey << layout[1]) | (grey << layout[2]);
+        ASSERT_EQ(expected, pixels[i]) << "count " << count << " pixel "
+                                       << i;
+
+        // Never more than one step away from the floating point formula.
+        int exact = int(0.3 * r + 0.59 * g + 0.11 * b);
+        ASSERT_LE(std::abs(exact - int(grey)), 1);
+      }
+    }
+  }
+
+  uint32_t white = 0xffffffff;
+  MonoColourChannels(&white, 1, 16, 8, 0);
+  EXPECT_EQ(0xffffffffu, white);
+}
+
+// Not run by default; pass --gtest_also_run_disabled_tests to get numbers.
+// Decodes every image in the test fixtures and a synthetic full screen CG
+// through the conversion kernels.
+TEST(PixelConversionTest, DISABLED_DecodeBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kIterations = 200;
+  std::cerr << "Pixel conversion backend: " << GetPixelConversionBackendName()
+            << std::endl;
+
+  fs::path root(locateTestCase("Gameroot"));
+  for (fs::recursive_directory_iterator it(root), end; it != end; ++it) {
+    std::string ext = it->path().extension().string();
+    if (ext != ".g00" && ext != ".pdt")
+      continue;
+
+    std::ifstream file(it->path().string().c_str(), std::ios::binary);
+    std::vector<char> data((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    std::unique_ptr<GRPCONV> conv(
+        GRPCONV::AssignConverter(data.data(), data.size(), "benchmark"));
+    if (!conv) {
+      std::cerr << it->path() << ": not a decodable image, skipped"
+                << std::endl;
+      continue;
+    }
+
+    std::vector<char> image(conv->Width() * conv->Height() * 4 + 1024);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < kIterations; ++i)
+      conv->Read(image.data());
+    double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    std::cerr << it->path() << ": "
+              << (conv->Width() * conv->Height() * double(kIterations)) /
+                     seconds / 1e6
+              << " Mpixel/s" << std::endl;
+  }
+
+  const int kPixels = 1280 * 720;
+  std::vector<char> rgb = MakeNoise(kPixels * 3, 1);
+  std::vector<char> rgba = MakeNoise(kPixels * 4, 2);
+  std::vector<uint32_t> dest(kPixels);
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kIterations; ++i)
+    ExpandRGBToRGBA(rgb.data(), dest.data(), kPixels);
+  double expand = std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  for (int i = 0; i < kIterations; ++i)
+    CopyRGBAPixels(rgba.data(), dest.data(), kPixels);
+  double copy = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::fill(dest.begin(), dest.end(), 0xffffffff);
+  start = Clock::now();
+  for (int i = 0; i < kIterations; ++i)
+    IsFullyOpaque(dest.data(), kPixels);
+  double scan = std::chrono::duration<double>(Clock::now() - start).count();
+
+  double mpixels = kPixels * double(kIterations) / 1e6;
+  uint8_t table[256];
+  for (int i = 0; i < 256; ++i)
+    table[i] = 255 - i;
+  start = Clock::now();
+  for (int i = 0; i < kIterations; ++i)
+    MapColourChannels(dest.data(), kPixels, table, table, table, 16, 8, 0);
+  double map = std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  for (int i = 0; i < kIterations; ++i)
+    MonoColourChannels(dest.data(), kPixels, 16, 8, 0);
+  double mono = std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cerr << "1280x720 RGB expand: " << mpixels / expand << " Mpixel/s\n"
+            << "1280x720 RGBA copy:  " << mpixels / copy << " Mpixel/s\n"
+            << "1280x720 alpha scan: " << mpixels / scan << " Mpixel/s\n"
+            << "1280x720 tone curve: " << mpixels / map << " Mpixel/s\n"
+            << "1280x720 mono:       " << mpixels / mono << " Mpixel/s"
+            << std::endl;
+}
@@ -0,0 +1,132 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <random>
+
+#include "systems/base/presentation_clock.h"
+
+namespace {
+
+// Presents |count| frames on a display refreshing every |interval|
+// milliseconds, starting at refresh |first|. Returns the last presentation.
+unsigned int PresentFrames(PresentationClock* clock,
+                           double interval,
+                           int first,
+                           int count) {
+  unsigned int ticks = 0;
+  for (int i = first; i < first + count; ++i) {
+    ticks = static_cast<unsigned int>(std::lround(i * interval));
+    clock->Presented(ticks);
+  }
+  return ticks;
+}
+
+}  // namespace
+
+TEST(PresentationClockTest, PredictsNowWithoutHistory) {
+  PresentationClock clock;
+  EXPECT_EQ(0, clock.refresh_interval());
+  EXPECT_EQ(1234u, clock.Predict(1234));
+
+  // A few frames aren't enough to go on.
+  PresentFrames(&clock, 1000.0 / 60, 1, 3);
+  EXPECT_EQ(0, clock.refresh_interval());
+  EXPECT_EQ(40u, clock.Predict(40));
+}
+
+TEST(PresentationClockTest, LearnsFractionalRefreshInterval) {
+  PresentationClock clock;
+  unsigned int last = PresentFrames(&clock, 1000.0 / 60, 1, 20);
+  EXPECT_NEAR(1000.0 / 60, clock.refresh_interval(), 0.1);
+
+  // Anything drawn before the next refresh shows up on it.
+  EXPECT_EQ(last + 17, clock.Predict(last + 1));
+  EXPECT_EQ(last + 17, clock.Predict(last + 12));
+
+  // Including something drawn at the instant of the last one.
+  EXPECT_EQ(last + 17, clock.Predict(last));
+
+  // Missing a refresh puts the frame on the one after.
+  EXPECT_EQ(last + 33, clock.Predict(last + 20));
+}
+
+TEST(PresentationClockTest, IgnoresMissedRefreshes) {
+  PresentationClock clock;
+  unsigned int ticks = 1000;
+  for (int i = 0; i < 20; ++i) {
+    // Every fifth frame misses a refresh.
+    ticks += (i % 5 == 4) ? 33 : 17;
+    clock.Presented(ticks);
+  }
+  EXPECT_NEAR(17, clock.refresh_interval(), 0.1);
+}
+
+TEST(PresentationClockTest, StallsForgetHistory) {
+  PresentationClock clock;
+  unsigned int last = PresentFrames(&clock, 10, 1, 10);
+  EXPECT_NEAR(10, clock.refresh_interval(), 0.01);
+
+  clock.Presented(last + 500);
+  EXPECT_EQ(0, clock.refresh_interval());
+  EXPECT_EQ(last + 503, clock.Predict(last + 503));
+}
+
+TEST(PresentationClockTest, UnpacedPresentationHasNoEstimate) {
+  PresentationClock clock;
+  std::mt19937 random(4);
+  std::uniform_int_distribution<int> interval(5, 45);
+  unsigned int ticks = 0;
+  for (int i = 0; i < 40; ++i) {
+    ticks += interval(random);
+    clock.Presented(ticks);
+  }
+  EXPECT_EQ(0, clock.refresh_interval());
+  EXPECT_EQ(ticks + 3, clock.Predict(ticks + 3));
+}
+
+TEST(PresentationClockTest, DoesNotPredictFarAhead) {
+  PresentationClock clock;
+  unsigned int last = PresentFrames(&clock, 1000.0 / 60, 1, 20);
+  EXPECT_EQ(last + 1000, clock.Predict(last + 1000));
+
+  clock.Reset();
+  EXPECT_EQ(last + 1, clock.Predict(last + 1));
+}
+
+TEST(PresentationClockTest, HandlesTickWraparound) {
+  PresentationClock clock;
+  unsigned int ticks = 0xffffffffu - 50;
+  for (int i = 0; i < 10; ++i) {
+    clock.Presented(ticks);
+    ticks += 16;
+  }
+  unsigned int last = ticks - 16;
+  EXPECT_NEAR(16, clock.refresh_interval(), 0.01);
+  EXPECT_EQ(last + 16, clock.Predict(last + 5));
+}
@@ -0,0 +1,170 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "systems/base/graphics_object.h"
+#include "systems/base/graphics_object_data.h"
+#include "systems/base/graphics_system.h"
+#include "test_system/test_system.h"
+
+#include "test_utils.h"
+
+namespace {
+
+// Object data that draws nothing, so that RenderObjects() only reports the
+// order it visits objects in.
+class StubObjectData : public GraphicsObjectData {
+ public:
+  virtual void Render(const GraphicsObject& go,
+                      const GraphicsObject* parent,
+                      std::ostream* tree) override {}
+  virtual int PixelWidth(const GraphicsObject& go) override { return 0; }
+  virtual int PixelHeight(const GraphicsObject& go) override { return 0; }
+  virtual GraphicsObjectData* Clone() const override {
+    return new StubObjectData;
+  }
+  virtual void Execute(RLMachine& machine) override {}
+  virtual std::shared_ptr<const Surface> CurrentSurface(
+      const GraphicsObject& go) override {
+    return std::shared_ptr<const Surface>();
+  }
+  virtual void ObjectInfo(std::ostream& tree) override {}
+};
+
+}  // namespace
+
+class RenderListTest : public FullSystemTest {
+ protected:
+  GraphicsObject& Object(int number) {
+    return system.graphics().GetObject(OBJ_FG, number);
+  }
+
+  void AddObject(int number, int z_order) {
+    GraphicsObject& obj = Object(number);
+    obj.SetObjectData(new StubObjectData);
+    obj.SetVisible(1);
+    obj.SetZOrder(z_order);
+  }
+
+  // Returns the numbers of the objects drawn, in drawing order.
+  std::string DrawOrder() {
+    std::ostringstream tree;
+    system.graphics().RenderObjects(&tree);
+
+    std::ostringstream order;
+    std::string line;
+    std::istringstream lines(tree.str());
+    while (std::getline(lines, line)) {
+      if (line.compare(0, 8, "Object #") == 0)
+        order << line.substr(8, line.size() - 9) << " ";
+    }
+    return order.str();
+  }
+};
+
+TEST_F(RenderListTest, FollowsZOrderChanges) {
+  AddObject(1, 0);
+  AddObject(2, 0);
+  AddObject(3, 0);
+  EXPECT_EQ("1 2 3 ", DrawOrder());
+
+  Object(1).SetZOrder(5);
+  EXPECT_EQ("2 3 1 ", DrawOrder());
+
+  Object(3).SetZLayer(-1);
+  EXPECT_EQ("3 2 1 ", DrawOrder());
+
+  Object(2).SetZDepth(10);
+  Object(2).SetZLayer(-1);
+  EXPECT_EQ("3 2 1 ", DrawOrder());
+  Object(3).SetZDepth(20);
+  EXPECT_EQ("2 3 1 ", DrawOrder());
+}
+
+TEST_F(RenderListTest, FollowsObjectLifetimeAndVisibility) {
+  AddObject(4, 0);
+  AddObject(8, 0);
+  EXPECT_EQ("4 8 ", DrawOrder());
+
+  Object(4).SetVisible(0);
+  EXPECT_EQ("8 ", DrawOrder());
+  Object(4).SetVisible(1);
+  EXPECT_EQ("4 8 ", DrawOrder());
+
+  system.graphics().FreeObjectData(8);
+  EXPECT_EQ("4 ", DrawOrder());
+
+  AddObject(2, 0);
+  EXPECT_EQ("2 4 ", DrawOrder());
+
+  // Copying an object over another one replaces it in the list too.
+  GraphicsObject copy(Object(2));
+  copy.SetZOrder(-3);
+  system.graphics().SetObject(OBJ_FG, 4, copy);
+  EXPECT_EQ("4 2 ", DrawOrder());
+
+  system.graphics().ClearAndPromoteObjects();
+  EXPECT_EQ("", DrawOrder());
+}
+
+// Not run by default; pass --gtest_also_run_disabled_tests to get numbers.
+// Measures the per frame cost of working out what to draw with a full layer
+// of live objects (256 by default), both when the list can be reused and when
+// one object is restacked every frame.
+TEST_F(RenderListTest, DISABLED_ManyObjectsBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kObjects = system.graphics().GetObjectLayerSize();
+  const int kFrames = 20000;
+  for (int i = 0; i < kObjects; ++i)
+    AddObject(i, (i * 37) % 11);
+
+  Clock::time_point start = Clock::now();
+  for (int frame = 0; frame < kFrames; ++frame)
+    system.graphics().RenderObjects(NULL);
+  double unchanged =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    Object(frame % kObjects).SetZOrder(frame % 13);
+    system.graphics().RenderObjects(NULL);
+  }
+  double restacked =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::cerr << kObjects << " objects, unchanged: "
+            << unchanged / kFrames * 1e6 << " us/frame\n"
+            << kObjects << " objects, one restacked per frame: "
+            << restacked / kFrames * 1e6 << " us/frame" << std::endl;
+}
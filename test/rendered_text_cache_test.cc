@@ -0,0 +1,100 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <memory>
+
+#include "systems/base/colour.h"
+#include "systems/base/rendered_text_cache.h"
+#include "test_system/mock_surface.h"
+
+namespace {
+
+RenderedTextCache::Key KeyFor(const std::string& text) {
+  return RenderedTextCache::Key(text, 20, 0, 0, RGBColour::White(), NULL, 0,
+                                true);
+}
+
+std::shared_ptr<Surface> SurfaceOf(int width, int height) {
+  return std::shared_ptr<Surface>(
+      MockSurface::Create("text", Size(width, height)));
+}
+
+}  // namespace
+
+TEST(RenderedTextCacheTest, MissThenHit) {
+  RenderedTextCache cache(1024 * 1024);
+  EXPECT_FALSE(cache.Find(KeyFor("Nagisa")));
+
+  std::shared_ptr<Surface> surface = SurfaceOf(120, 20);
+  cache.Store(KeyFor("Nagisa"), surface);
+  EXPECT_EQ(surface, cache.Find(KeyFor("Nagisa")));
+  EXPECT_EQ(120u * 20 * 4, cache.used_bytes());
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(1, cache.misses());
+
+  // Every property is part of the key.
+  RGBColour black = RGBColour::Black();
+  EXPECT_FALSE(cache.Find(RenderedTextCache::Key(
+      "Nagisa", 20, 0, 0, RGBColour::White(), &black, 0, true)));
+  EXPECT_FALSE(cache.Find(RenderedTextCache::Key(
+      "Nagisa", 20, 0, 0, RGBColour::White(), NULL, 0, false)));
+  EXPECT_FALSE(cache.Find(RenderedTextCache::Key(
+      "Nagisa", 20, 1, 0, RGBColour::White(), NULL, 0, true)));
+  EXPECT_FALSE(cache.Find(RenderedTextCache::Key(
+      "Nagisa", 20, 0, 0, RGBColour::White(), NULL, 10, true)));
+}
+
+TEST(RenderedTextCacheTest, EvictsLeastRecentlyUsed) {
+  // Room for two 10x10 surfaces.
+  RenderedTextCache cache(2 * 10 * 10 * 4);
+  cache.Store(KeyFor("a"), SurfaceOf(10, 10));
+  cache.Store(KeyFor("b"), SurfaceOf(10, 10));
+  ASSERT_TRUE(cache.Find(KeyFor("a")) != nullptr);
+
+  cache.Store(KeyFor("c"), SurfaceOf(10, 10));
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_TRUE(cache.Find(KeyFor("a")) != nullptr);
+  EXPECT_TRUE(cache.Find(KeyFor("b")) == nullptr);
+  EXPECT_TRUE(cache.Find(KeyFor("c")) != nullptr);
+  EXPECT_GE(cache.max_bytes(), cache.used_bytes());
+
+  // Too big to ever fit.
+  cache.Store(KeyFor("d"), SurfaceOf(100, 100));
+  EXPECT_TRUE(cache.Find(KeyFor("d")) == nullptr);
+  EXPECT_EQ(2u, cache.size());
+
+  // Storing an existing key replaces it.
+  std::shared_ptr<Surface> replacement = SurfaceOf(5, 5);
+  cache.Store(KeyFor("a"), replacement);
+  EXPECT_EQ(replacement, cache.Find(KeyFor("a")));
+  EXPECT_EQ(2u, cache.size());
+
+  cache.Clear();
+  EXPECT_EQ(0u, cache.size());
+  EXPECT_EQ(0u, cache.used_bytes());
+}
@@ -26,20 +26,89 @@
 
 #include "gtest/gtest.h"
 
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <set>
 #include <string>
+#include <vector>
 
 #include "libreallive/archive.h"
 #include "libreallive/intmemref.h"
 #include "machine/rlmachine.h"
 #include "systems/base/rlbabel_dll.h"
+#include "systems/base/text_window.h"
 #include "test_utils.h"
 #include "test_system/test_system.h"
+#include "test_system/test_text_system.h"
 #include "utilities/exception.h"
 
-class RLBabelTest : public FullSystemTest {};
+using libreallive::IntMemRef;
+using libreallive::STRS_LOCATION;
 
 const std::string rlBabel = "rlBabel";
 
+// A paragraph of translated dialogue, long enough to wrap several times.
+const char kParagraph[] =
+    "\"I don't think I've ever seen the town from up here,\" she said, "
+    "leaning on the railing. \"It looks so small. Like you could pick the "
+    "whole thing up and put it in your pocket.\"";
+
+class RLBabelTest : public FullSystemTest {
+ protected:
+  TestTextSystem& text_system() {
+    return dynamic_cast<TestTextSystem&>(system.text());
+  }
+
+  // Feeds |text| through rlBabel the way the game's bytecode does: it asks
+  // for one character at a time, advances the window by the returned width,
+  // and starts a new line when told to. Returns the lines it ended up with.
+  std::vector<std::string> BreakIntoLines(const std::string& text) {
+    if (!rlmachine.DllLoaded(rlBabel)) {
+      rlmachine.LoadDLL(0, rlBabel);
+      rlmachine.CallDLL(0, dllInitialise, 0, 0, 0, 0);
+    }
+
+    std::shared_ptr<TextWindow> window = system.text().GetCurrentWindow();
+    window->set_insertion_point_x(0);
+    window->set_insertion_point_y(0);
+
+    rlmachine.SetStringValue(STRS_LOCATION, 0, text);
+    rlmachine.CallDLL(0, dllTextoutStart, STRS_LOCATION << 16, 0, 0, 0);
+
+    std::vector<std::string> lines(1);
+    for (int i = 0; i < 10000; ++i) {
+      int rv = rlmachine.CallDLL(0, dllTextoutGetChar,
+                                 (STRS_LOCATION << 16) | 1, 0, 0, 0);
+      switch (rv) {
+        case getcPrintChar:
+          lines.back() += rlmachine.GetStringValue(STRS_LOCATION, 1);
+          window->set_insertion_point_x(
+              rlmachine.GetIntValue(IntMemRef('A', 0)));
+          break;
+        case getcNewLine:
+          window->set_insertion_point_x(0);
+          window->offset_insertion_point_y(window->line_height());
+          lines.emplace_back();
+          break;
+        case getcNewScreen:
+          window->set_insertion_point_x(0);
+          window->set_insertion_point_y(0);
+          lines.emplace_back();
+          break;
+        case getcEndOfString:
+          return lines;
+        case getcError:
+          ADD_FAILURE() << "rlBabel returned an error";
+          return lines;
+      }
+    }
+
+    ADD_FAILURE() << "rlBabel never reached the end of the string";
+    return lines;
+  }
+};
+
 TEST_F(RLBabelTest, Loading) {
   EXPECT_FALSE(rlmachine.DllLoaded(rlBabel));
   rlmachine.LoadDLL(0, rlBabel);
@@ -70,3 +139,52 @@ TEST_F(RLBabelTest, Initialization) {
   // TODO: Doing anything real with RLBabel requires that we have working
   // font metrics in TestSystem...
 }
+
+TEST_F(RLBabelTest, BreaksLinesBetweenWords) {
+  // Every character is 20 pixels wide in the test system, and the window is
+  // 550 pixels wide.
+  std::vector<std::string> expected = {
+      "\"I don't think I've ever",
+      "seen the town from up",
+      "here,\" she said, leaning",
+      "on the railing. \"It looks",
+      "so small. Like you could",
+      "pick the whole thing up",
+      "and put it in your",
+      "pocket.\""};
+  EXPECT_EQ(expected, BreakIntoLines(kParagraph));
+}
+
+TEST_F(RLBabelTest, CharacterWidthsAreMeasuredOnce) {
+  std::vector<std::string> lines = BreakIntoLines(kParagraph);
+  int measurements = text_system().char_width_measurements();
+  EXPECT_LT(0, measurements);
+  EXPECT_GE(int(std::set<char>(std::begin(kParagraph),
+                               std::end(kParagraph) - 1).size()),
+            measurements);
+
+  // Laying out the same text again is answered from the width tables, and
+  // comes out the same.
+  EXPECT_EQ(lines, BreakIntoLines(kParagraph));
+  EXPECT_EQ(measurements, text_system().char_width_measurements());
+}
+
+// Measures how fast rlBabel lays out text, asking for the width of every
+// remaining character of a line each time it starts a word.
+TEST_F(RLBabelTest, DISABLED_LineBreakingThroughputBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kPasses = 2000;
+
+  size_t characters = 0;
+  Clock::time_point start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (const std::string& line : BreakIntoLines(kParagraph))
+      characters += line.size();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  EXPECT_LT(0u, characters);
+  std::cerr << int(characters / seconds) << " characters/s, "
+            << text_system().char_width_measurements() << " widths measured"
+            << std::endl;
+}
@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 
+#include "machine/long_operation.h"
 #include "machine/memory.h"
 #include "machine/rlmachine.h"
 #include "machine/serialization.h"
@@ -43,6 +44,23 @@
 using namespace std;
 using namespace libreallive;
 
+// Counts how often it runs; finishes after |runs_needed| runs, or never if
+// that is negative.
+class CountingLongOperation : public LongOperation {
+ public:
+  CountingLongOperation(int runs_needed, int* runs)
+      : runs_needed_(runs_needed), runs_(runs) {}
+
+  virtual bool operator()(RLMachine& machine) override {
+    (*runs_)++;
+    return runs_needed_ >= 0 && *runs_ >= runs_needed_;
+  }
+
+ private:
+  int runs_needed_;
+  int* runs_;
+};
+
 class RLMachineTest : public FullSystemTest {
  protected:
   void setIntMemoryCountingFrom(RLMachine& saveMachine,
@@ -276,3 +294,31 @@ TEST_F(RLMachineTest, SerializationOfSavepointValues) {
     verifyStrMemoryCountingFrom(loadMachine, STRS_LOCATION, 0);
   }
 }
+
+TEST_F(RLMachineTest, TimeSliceStopsAtWaitingLongOperation) {
+  int runs = 0;
+  rlmachine.PushLongOperation(new CountingLongOperation(-1, &runs));
+  rlmachine.ExecuteTimeSlice();
+  EXPECT_EQ(1, runs);
+}
+
+// While fast forwarding, long operations that finish straight away don't end
+// the slice, but one that is still there after running does: it's waiting on
+// something that needs events pumped.
+TEST_F(RLMachineTest, FastForwardRunsThroughFinishedLongOperations) {
+  system.set_force_fast_forward();
+  ASSERT_LT(10u, system.graphics().skip_frame_interval());
+
+  int waiting_runs = 0;
+  int finishing_runs = 0;
+  rlmachine.PushLongOperation(new CountingLongOperation(-1, &waiting_runs));
+  rlmachine.PushLongOperation(new CountingLongOperation(1, &finishing_runs));
+  rlmachine.ExecuteTimeSlice();
+
+  EXPECT_EQ(1, finishing_runs);
+  EXPECT_EQ(1, waiting_runs);
+  EXPECT_TRUE(rlmachine.CurrentLongOperation() != nullptr);
+
+  rlmachine.ExecuteTimeSlice();
+  EXPECT_EQ(2, waiting_runs);
+}
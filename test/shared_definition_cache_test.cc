@@ -0,0 +1,104 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "utilities/shared_definition_cache.h"
+
+namespace {
+
+struct FakeDefinition {
+  explicit FakeDefinition(int value) : data(100, value) {}
+  size_t MemoryUsage() const { return data.size() * sizeof(int); }
+  std::vector<int> data;
+};
+
+typedef SharedDefinitionCache<FakeDefinition> FakeCache;
+
+}  // namespace
+
+TEST(SharedDefinitionCacheTest, SharesWhileInUse) {
+  FakeCache cache;
+  int loads = 0;
+  FakeCache::Loader load = [&]() {
+    loads++;
+    return std::make_shared<const FakeDefinition>(loads);
+  };
+
+  std::shared_ptr<const FakeDefinition> a = cache.Get("a.anm", load);
+  std::shared_ptr<const FakeDefinition> b = cache.Get("a.anm", load);
+  std::shared_ptr<const FakeDefinition> c = cache.Get("c.anm", load);
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(2, loads);
+  EXPECT_EQ(2, cache.loads());
+  EXPECT_EQ(1, cache.hits());
+
+  EXPECT_EQ(2u, cache.live_count());
+  EXPECT_EQ(3u, cache.user_count());
+  EXPECT_EQ(2 * 400u, cache.bytes_used());
+  EXPECT_EQ(400u, cache.bytes_saved());
+
+  // Once nobody uses a definition it is freed and loaded again next time.
+  a.reset();
+  b.reset();
+  EXPECT_EQ(1u, cache.live_count());
+  EXPECT_EQ(0u, cache.bytes_saved());
+  std::shared_ptr<const FakeDefinition> d = cache.Get("a.anm", load);
+  EXPECT_EQ(3, loads);
+  EXPECT_EQ(3, d->data[0]);
+}
+
+TEST(SharedDefinitionCacheTest, LoaderExceptionsPropagate) {
+  FakeCache cache;
+  EXPECT_THROW(cache.Get("bad.gan",
+                         []() -> std::shared_ptr<const FakeDefinition> {
+                           throw std::runtime_error("bad file");
+                         }),
+               std::runtime_error);
+  EXPECT_EQ(0u, cache.live_count());
+
+  std::shared_ptr<const FakeDefinition> good = cache.Get(
+      "bad.gan", []() { return std::make_shared<const FakeDefinition>(1); });
+  EXPECT_TRUE(good != nullptr);
+}
+
+TEST(SharedDefinitionCacheTest, ForgetsDeadEntries) {
+  FakeCache cache;
+  std::shared_ptr<const FakeDefinition> kept = cache.Get(
+      "kept", []() { return std::make_shared<const FakeDefinition>(0); });
+  for (int i = 0; i < 1000; ++i) {
+    cache.Get("temp" + std::to_string(i),
+              []() { return std::make_shared<const FakeDefinition>(1); });
+  }
+  EXPECT_EQ(1u, cache.live_count());
+  EXPECT_EQ(kept, cache.Get("kept", FakeCache::Loader()));
+}
@@ -0,0 +1,167 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "systems/base/shelf_packer.h"
+
+namespace {
+
+// Checks that no two rectangles, grown by |padding| to the right and
+// below, overlap and that they all lie on the page.
+void ExpectDisjoint(const ShelfPacker& packer,
+                    const std::vector<Rect>& rects,
+                    int padding) {
+  for (size_t i = 0; i < rects.size(); ++i) {
+    EXPECT_LE(0, rects[i].x());
+    EXPECT_LE(0, rects[i].y());
+    EXPECT_GE(packer.width(), rects[i].x2());
+    EXPECT_GE(packer.height(), rects[i].y2());
+
+    Rect padded = Rect::REC(rects[i].x(), rects[i].y(),
+                            rects[i].width() + padding,
+                            rects[i].height() + padding);
+    for (size_t j = i + 1; j < rects.size(); ++j) {
+      const Rect& other = rects[j];
+      bool overlaps = padded.x() < other.x2() && other.x() < padded.x2() &&
+                      padded.y() < other.y2() && other.y() < padded.y2();
+      EXPECT_FALSE(overlaps) << rects[i] << " and " << other;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(ShelfPackerTest, PacksWithoutOverlap) {
+  ShelfPacker packer(256, 256, 1);
+  std::vector<Rect> rects;
+  const int sizes[][2] = {{30, 20}, {100, 60}, {15, 15}, {60, 58},
+                          {90, 20}, {200, 10}, {7, 40},  {64, 64}};
+  for (const auto& size : sizes) {
+    Rect rect;
+    ASSERT_TRUE(packer.Allocate(size[0], size[1], &rect));
+    EXPECT_EQ(Size(size[0], size[1]), rect.size());
+    rects.push_back(rect);
+  }
+
+  EXPECT_EQ(8, packer.allocation_count());
+  ExpectDisjoint(packer, rects, 1);
+}
+
+TEST(ShelfPackerTest, PaddingIsDroppedAtThePageEdge) {
+  // Four exact quarters fit even though padding would push each pair past
+  // the edge of the page.
+  ShelfPacker packer(64, 64, 1);
+  std::vector<Rect> rects(4);
+  ASSERT_TRUE(packer.Allocate(31, 31, &rects[0]));
+  ASSERT_TRUE(packer.Allocate(32, 31, &rects[1]));
+  ASSERT_TRUE(packer.Allocate(31, 32, &rects[2]));
+  ASSERT_TRUE(packer.Allocate(32, 32, &rects[3]));
+  ExpectDisjoint(packer, rects, 1);
+
+  Rect rect;
+  EXPECT_FALSE(packer.Allocate(1, 1, &rect));
+}
+
+TEST(ShelfPackerTest, RejectsWhatDoesNotFit) {
+  ShelfPacker packer(128, 128, 1);
+  Rect rect;
+  EXPECT_FALSE(packer.Allocate(129, 10, &rect));
+  EXPECT_FALSE(packer.Allocate(10, 129, &rect));
+  EXPECT_FALSE(packer.Allocate(0, 10, &rect));
+
+  ASSERT_TRUE(packer.Allocate(128, 100, &rect));
+  EXPECT_FALSE(packer.Allocate(128, 100, &rect));
+  EXPECT_TRUE(packer.Allocate(128, 27, &rect));
+}
+
+TEST(ShelfPackerTest, FreedSpaceIsReused) {
+  ShelfPacker packer(128, 128, 0);
+  std::vector<Rect> rects(4);
+  for (Rect& rect : rects)
+    ASSERT_TRUE(packer.Allocate(32, 128, &rect));
+  EXPECT_EQ(128 * 128, packer.used_area());
+
+  // Two neighbouring holes merge into one wide enough for a bigger image.
+  Rect rect;
+  EXPECT_FALSE(packer.Allocate(64, 128, &rect));
+  packer.Free(rects[1]);
+  packer.Free(rects[2]);
+  ASSERT_TRUE(packer.Allocate(64, 128, &rect));
+  EXPECT_EQ(rects[1].origin(), rect.origin());
+
+  packer.Free(rect);
+  packer.Free(rects[0]);
+  packer.Free(rects[3]);
+  EXPECT_TRUE(packer.empty());
+  EXPECT_EQ(0, packer.used_area());
+}
+
+TEST(ShelfPackerTest, EmptyShelvesAreGivenBack) {
+  ShelfPacker packer(64, 64, 0);
+  Rect short_rect, tall_rect;
+  ASSERT_TRUE(packer.Allocate(64, 16, &short_rect));
+  packer.Free(short_rect);
+
+  // Without giving back the 16 pixel shelf, this wouldn't fit.
+  ASSERT_TRUE(packer.Allocate(64, 64, &tall_rect));
+  EXPECT_EQ(Point(0, 0), tall_rect.origin());
+}
+
+TEST(ShelfPackerTest, SmallImagesPreferSnugShelves) {
+  ShelfPacker packer(256, 256, 0);
+  Rect tall, short_one, small;
+  ASSERT_TRUE(packer.Allocate(32, 100, &tall));
+  ASSERT_TRUE(packer.Allocate(32, 10, &short_one));
+
+  // A 10 pixel image goes next to the other 10 pixel one, not into the 100
+  // pixel shelf.
+  ASSERT_TRUE(packer.Allocate(32, 10, &small));
+  EXPECT_EQ(short_one.y(), small.y());
+}
+
+TEST(ShelfPackerTest, MenuScreenFitsOnOnePage) {
+  // A typical menu: three-state button sheets, a digit strip and cursors,
+  // all of which should end up in the same texture.
+  ShelfPacker packer(1024, 1024, 1);
+  std::vector<Rect> rects;
+  for (int i = 0; i < 12; ++i) {
+    rects.push_back(Rect());
+    ASSERT_TRUE(packer.Allocate(240, 120, &rects.back())) << i;
+  }
+  for (int i = 0; i < 10; ++i) {
+    rects.push_back(Rect());
+    ASSERT_TRUE(packer.Allocate(160, 24, &rects.back())) << i;
+  }
+  for (int i = 0; i < 4; ++i) {
+    rects.push_back(Rect());
+    ASSERT_TRUE(packer.Allocate(32, 32, &rects.back())) << i;
+  }
+  ExpectDisjoint(packer, rects, 1);
+}
@@ -0,0 +1,318 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libreallive/gameexe.h"
+#include "systems/base/colour.h"
+#include "systems/base/graphics_object.h"
+#include "systems/base/graphics_object_of_file.h"
+#include "systems/base/system.h"
+#include "systems/software/software_graphics_system.h"
+#include "systems/software/software_rasterizer.h"
+#include "systems/software/software_surface.h"
+#include "test_system/software_test_system.h"
+#include "test_utils.h"
+
+namespace {
+
+// An image of |width| by |height| pixels, all |pixel|.
+std::vector<uint32_t> SolidPixels(int width, int height, uint32_t pixel) {
+  return std::vector<uint32_t>(width * height, pixel);
+}
+
+RasterImage ImageOf(std::vector<uint32_t>* pixels, int width, int height) {
+  return RasterImage(pixels->data(), width, height, width);
+}
+
+SpriteQuad MakeQuad(float x, float y, float w, float h) {
+  SpriteQuad quad;
+  quad.x1 = x;
+  quad.y1 = y;
+  quad.x2 = x + w;
+  quad.y2 = y + h;
+  return quad;
+}
+
+// Draws a single opaque |pixel| through |effects| and returns the result.
+uint32_t DrawWithEffects(uint32_t pixel, const SpriteEffects& effects) {
+  std::vector<uint32_t> texture(1, pixel);
+  std::vector<uint32_t> target(1, 0xff000000);
+  SpriteQuad quad = MakeQuad(0, 0, 1, 1);
+  quad.effects = effects;
+  RasterizeQuad(ImageOf(&texture, 1, 1), SPRITE_BLEND_ALPHA, quad,
+                Rect::REC(0, 0, 1, 1), ImageOf(&target, 1, 1));
+  return target[0];
+}
+
+}  // namespace
+
+TEST(SoftwareRasterizerTest, BlendModesMatchGL) {
+  uint32_t dst = 0xff0000ff;
+  BlendRow(SPRITE_BLEND_ALPHA, std::vector<uint32_t>(1, 0x80ff0000).data(),
+           &dst, 1, 255);
+  EXPECT_EQ(0xbf80007fu, dst);
+
+  dst = 0xff2000ff;
+  BlendRow(SPRITE_BLEND_ADD, std::vector<uint32_t>(1, 0x80ff0000).data(),
+           &dst, 1, 255);
+  EXPECT_EQ(0xffa000ffu, dst);
+
+  dst = 0xffff00ff;
+  BlendRow(SPRITE_BLEND_SUBTRACT, std::vector<uint32_t>(1, 0x80ff0000).data(),
+           &dst, 1, 255);
+  EXPECT_EQ(0xbf7f00ffu, dst);
+
+  dst = 0xff123456;
+  BlendRow(SPRITE_BLEND_REPLACE, std::vector<uint32_t>(1, 0x80ff0000).data(),
+           &dst, 1, 255);
+  EXPECT_EQ(0x80ff0000u, dst);
+}
+
+TEST(SoftwareRasterizerTest, WideBlendMatchesSinglePixels) {
+  // Long runs go through the SIMD kernels, single pixels don't.
+  std::mt19937 rng(1234);
+  std::vector<uint32_t> src(37), dst(37);
+  for (size_t i = 0; i < src.size(); ++i) {
+    src[i] = rng();
+    dst[i] = rng();
+  }
+  src[3] = 0xff336699;
+  src[4] = 0x00ffffff;
+
+  const SpriteBlendMode kModes[] = {SPRITE_BLEND_ALPHA, SPRITE_BLEND_ADD,
+                                    SPRITE_BLEND_SUBTRACT};
+  for (SpriteBlendMode mode : kModes) {
+    for (int alpha : {255, 100}) {
+      std::vector<uint32_t> wide = dst, single = dst;
+      BlendRow(mode, src.data(), wide.data(), wide.size(), alpha);
+      for (size_t i = 0; i < single.size(); ++i)
+        BlendRow(mode, &src[i], &single[i], 1, alpha);
+      EXPECT_EQ(single, wide) << "mode " << mode << ", alpha " << alpha;
+    }
+  }
+}
+
+TEST(SoftwareRasterizerTest, BlitKeepsDestinationAlpha) {
+  uint32_t dst = 0x400000ff;
+  BlitRow(std::vector<uint32_t>(1, 0x80ff0000).data(), &dst, 1, 255);
+  EXPECT_EQ(0x4080007fu, dst);
+}
+
+TEST(SoftwareRasterizerTest, UnscaledQuadCopiesTexels) {
+  std::vector<uint32_t> texture(4 * 4);
+  for (size_t i = 0; i < texture.size(); ++i)
+    texture[i] = 0xff000000 | i;
+  std::vector<uint32_t> target = SolidPixels(8, 8, 0xff000000);
+
+  // Draw the bottom right 2x2 texels at (5, 6), half off the target.
+  SpriteQuad quad = MakeQuad(5, 6, 2, 2);
+  quad.u1 = quad.v1 = 0.5f;
+  RasterizeQuad(ImageOf(&texture, 4, 4), SPRITE_BLEND_ALPHA, quad,
+                Rect::REC(0, 0, 8, 7), ImageOf(&target, 8, 8));
+
+  EXPECT_EQ(0xff00000au, target[6 * 8 + 5]);
+  EXPECT_EQ(0xff00000bu, target[6 * 8 + 6]);
+  EXPECT_EQ(0xff000000u, target[6 * 8 + 7]);
+  EXPECT_EQ(0xff000000u, target[7 * 8 + 5]);
+  EXPECT_EQ(0xff000000u, target[5 * 8 + 5]);
+}
+
+TEST(SoftwareRasterizerTest, ShrinkingSamplesNearestTexel) {
+  std::vector<uint32_t> texture = {0xffff0000, 0xff00ff00, 0xff0000ff,
+                                   0xffffffff};
+  std::vector<uint32_t> target = SolidPixels(2, 1, 0xff000000);
+  RasterizeQuad(ImageOf(&texture, 4, 1), SPRITE_BLEND_ALPHA,
+                MakeQuad(0, 0, 2, 1), Rect::REC(0, 0, 2, 1),
+                ImageOf(&target, 2, 1));
+  EXPECT_EQ(0xff00ff00u, target[0]);
+  EXPECT_EQ(0xffffffffu, target[1]);
+}
+
+TEST(SoftwareRasterizerTest, RotatesClockwiseAroundThePivot) {
+  // Red on top, blue below.
+  std::vector<uint32_t> texture = SolidPixels(4, 2, 0xffff0000);
+  for (int x = 0; x < 4; ++x)
+    texture[4 + x] = 0xff0000ff;
+  std::vector<uint32_t> target = SolidPixels(24, 24, 0xff000000);
+
+  SpriteQuad quad = MakeQuad(10, 10, 4, 2);
+  quad.rotation = 90;
+  quad.pivot_x = 2;
+  quad.pivot_y = 1;
+  RasterizeQuad(ImageOf(&texture, 4, 2), SPRITE_BLEND_ALPHA, quad,
+                Rect::REC(0, 0, 24, 24), ImageOf(&target, 24, 24));
+
+  // Turned on end around (12, 11), so the top row ends up on the right.
+  for (int y = 9; y < 13; ++y) {
+    EXPECT_EQ(0xff0000ffu, target[y * 24 + 11]) << "y = " << y;
+    EXPECT_EQ(0xffff0000u, target[y * 24 + 12]) << "y = " << y;
+    EXPECT_EQ(0xff000000u, target[y * 24 + 10]) << "y = " << y;
+    EXPECT_EQ(0xff000000u, target[y * 24 + 13]) << "y = " << y;
+  }
+  EXPECT_EQ(0xff000000u, target[8 * 24 + 12]);
+  EXPECT_EQ(0xff000000u, target[13 * 24 + 12]);
+}
+
+TEST(SoftwareRasterizerTest, ObjectEffects) {
+  SpriteEffects none;
+  EXPECT_EQ(0xff336699u, DrawWithEffects(0xff336699, none));
+
+  SpriteEffects invert;
+  invert.invert = 1.0f;
+  EXPECT_EQ(0xff00ffffu, DrawWithEffects(0xffff0000, invert));
+
+  SpriteEffects mono;
+  mono.mono = 1.0f;
+  EXPECT_EQ(0xff4c4c4cu, DrawWithEffects(0xffff0000, mono));
+
+  SpriteEffects tint;
+  tint.tint[2] = 1.0f;
+  EXPECT_EQ(0xff0000ffu, DrawWithEffects(0xff000000, tint));
+
+  SpriteEffects colour;
+  colour.colour[0] = 1.0f;
+  colour.colour[3] = 1.0f;
+  EXPECT_EQ(0xffff0000u, DrawWithEffects(0xff00ff00, colour));
+}
+
+TEST(SoftwareRasterizerTest, ColourMaskDarkensAndTints) {
+  std::vector<uint32_t> mask = {0xff000000, 0x00000000};
+  std::vector<uint32_t> target = SolidPixels(2, 1, 0xff808080);
+  RasterizeColourMask(ImageOf(&mask, 2, 1), Rect::REC(0, 0, 2, 1),
+                      Rect::REC(0, 0, 2, 1), RGBAColour(255, 0, 0, 255),
+                      Rect::REC(0, 0, 2, 1), ImageOf(&target, 2, 1));
+  EXPECT_EQ(0xff800000u, target[0]);
+  EXPECT_EQ(0xff808080u, target[1]);
+}
+
+class SoftwareGraphicsSystemTest : public ::testing::Test {
+ protected:
+  InjectingGraphicsSystem& graphics() { return system.graphics(); }
+
+  // Registers a solid |width| by |height| image as |name|.
+  void AddImage(const std::string& name, int width, int height,
+                const RGBAColour& colour) {
+    std::shared_ptr<Surface> surface = graphics().BuildSurface(
+        Size(width, height));
+    surface->Fill(colour);
+    graphics().InjectSurface(name, surface);
+  }
+
+  // Shows |name| as foreground object |num|.
+  GraphicsObject& Show(int num, const std::string& name, int x, int y) {
+    GraphicsObject& obj = graphics().GetObject(OBJ_FG, num);
+    obj.SetObjectData(new GraphicsObjectOfFile(system, name));
+    obj.SetX(x);
+    obj.SetY(y);
+    obj.SetZOrder(num);
+    obj.SetVisible(1);
+    return obj;
+  }
+
+  // Returns the RGB of |pos| on |surface|, as 0xRRGGBB.
+  uint32_t PixelAt(const Surface& surface, int x, int y) {
+    int r, g, b;
+    surface.GetDCPixel(Point(x, y), r, g, b);
+    return (r << 16) | (g << 8) | b;
+  }
+
+  SoftwareTestSystem system;
+};
+
+TEST_F(SoftwareGraphicsSystemTest, RendersCompositeModes) {
+  AddImage("grey", 64, 16, RGBAColour(0x80, 0x80, 0x80, 255));
+  AddImage("dim", 16, 16, RGBAColour(0x20, 0x40, 0x60, 255));
+  Show(0, "grey", 0, 0);
+  Show(1, "dim", 0, 0).SetCompositeMode(1);
+  Show(2, "dim", 32, 0).SetCompositeMode(2);
+  Show(3, "dim", 48, 0).SetAlpha(128);
+
+  std::shared_ptr<Surface> frame = graphics().RenderToSurface();
+  ASSERT_EQ(graphics().screen_size(), frame->GetSize());
+  EXPECT_EQ(0xa0c0e0u, PixelAt(*frame, 8, 8));
+  EXPECT_EQ(0x808080u, PixelAt(*frame, 24, 8));
+  EXPECT_EQ(0x604020u, PixelAt(*frame, 40, 8));
+  EXPECT_EQ(0x506070u, PixelAt(*frame, 56, 8));
+  EXPECT_EQ(0x000000u, PixelAt(*frame, 8, 24));
+}
+
+TEST_F(SoftwareGraphicsSystemTest, RendersObjectEffectsAndRotation) {
+  AddImage("red", 8, 8, RGBAColour(255, 0, 0, 255));
+  Show(0, "red", 0, 0).SetInvert(255);
+  Show(1, "red", 16, 0).SetMono(255);
+  GraphicsObject& rotated = Show(2, "red", 32, 0);
+  rotated.SetRotation(900);
+  rotated.SetTint(RGBColour(0, 0, 255));
+
+  std::shared_ptr<Surface> frame = graphics().RenderToSurface();
+  EXPECT_EQ(0x00ffffu, PixelAt(*frame, 4, 4));
+  EXPECT_EQ(0x4c4c4cu, PixelAt(*frame, 20, 4));
+  EXPECT_EQ(0xff00ffu, PixelAt(*frame, 36, 4));
+}
+
+TEST_F(SoftwareGraphicsSystemTest, RefreshKeepsLastFrameOnScreen) {
+  AddImage("white", 4, 4, RGBAColour::White());
+  Show(0, "white", 10, 10);
+  graphics().Refresh(NULL);
+
+  EXPECT_EQ(0xffffffffu, graphics().screen().image().Row(11)[11]);
+  EXPECT_EQ(0xff000000u, graphics().screen().image().Row(9)[9]);
+}
+
+TEST_F(SoftwareGraphicsSystemTest, DISABLED_DrawFrameBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kFrames = 200;
+
+  // A background and a screen of overlapping half transparent sprites.
+  Size screen = graphics().screen_size();
+  AddImage("bg", screen.width(), screen.height(),
+           RGBAColour(0x40, 0x60, 0x80, 255));
+  AddImage("sprite", 128, 128, RGBAColour(0xc0, 0x80, 0x40, 160));
+  Show(0, "bg", 0, 0);
+  for (int i = 1; i < 64; ++i) {
+    GraphicsObject& obj = Show(i, "sprite", (i * 53) % screen.width(),
+                               (i * 31) % screen.height());
+    if (i % 4 == 0)
+      obj.SetRotation(i * 70);
+  }
+
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < kFrames; ++i)
+    graphics().RenderToSurface();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cerr << "DrawFrame: " << kFrames / seconds << " frames/s at "
+            << screen.width() << "x" << screen.height() << std::endl;
+}
@@ -0,0 +1,164 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+
+#include "systems/base/sprite_batch.h"
+
+namespace {
+
+SpriteQuad MakeQuad(float x, float y, float w, float h) {
+  SpriteQuad quad;
+  quad.x1 = x;
+  quad.y1 = y;
+  quad.x2 = x + w;
+  quad.y2 = y + h;
+  return quad;
+}
+
+}  // namespace
+
+TEST(SpriteBatchTest, SplitsOnlyOnStateChanges) {
+  SpriteBatch batch;
+  EXPECT_TRUE(batch.empty());
+
+  // Different effects don't split a draw, they travel with the vertices.
+  SpriteQuad tinted = MakeQuad(0, 0, 10, 10);
+  tinted.effects.tint[0] = 0.5f;
+  tinted.effects.mono = 1.0f;
+  batch.Add(1, 7, SPRITE_BLEND_ALPHA, MakeQuad(0, 0, 10, 10));
+  batch.Add(1, 7, SPRITE_BLEND_ALPHA, tinted);
+
+  batch.Add(2, 7, SPRITE_BLEND_ALPHA, MakeQuad(0, 0, 10, 10));
+  batch.Add(2, 7, SPRITE_BLEND_ADD, MakeQuad(0, 0, 10, 10));
+  batch.Add(2, 0, SPRITE_BLEND_ADD, MakeQuad(0, 0, 10, 10));
+  batch.Add(2, 0, SPRITE_BLEND_ADD, MakeQuad(0, 0, 10, 10));
+
+  ASSERT_EQ(4u, batch.draws().size());
+  EXPECT_EQ(6, batch.quad_count());
+  EXPECT_EQ(24u, batch.vertices().size());
+
+  const SpriteBatch::Draw& first = batch.draws()[0];
+  EXPECT_EQ(1u, first.texture);
+  EXPECT_EQ(0, first.first_vertex);
+  EXPECT_EQ(8, first.vertex_count);
+  EXPECT_EQ(8, batch.draws()[1].first_vertex);
+  EXPECT_EQ(SPRITE_BLEND_ADD, batch.draws()[2].blend);
+  EXPECT_EQ(0u, batch.draws()[3].program);
+  EXPECT_EQ(8, batch.draws()[3].vertex_count);
+
+  EXPECT_FLOAT_EQ(0.0f, batch.vertices()[0].tint_light[0]);
+  EXPECT_FLOAT_EQ(0.5f, batch.vertices()[4].tint_light[0]);
+  EXPECT_FLOAT_EQ(1.0f, batch.vertices()[7].mono_invert[0]);
+
+  batch.Clear();
+  EXPECT_TRUE(batch.empty());
+  EXPECT_EQ(0, batch.quad_count());
+}
+
+TEST(SpriteBatchTest, CornersAndPerCornerAlpha) {
+  SpriteBatch batch;
+  SpriteQuad quad = MakeQuad(10, 20, 30, 40);
+  quad.u1 = 0.25f;
+  quad.v1 = 0.5f;
+  quad.u2 = 0.75f;
+  quad.v2 = 1.0f;
+  quad.red = 1;
+  quad.green = 2;
+  quad.blue = 3;
+  for (int i = 0; i < 4; ++i)
+    quad.alpha[i] = 10 * i;
+  batch.Add(1, 0, SPRITE_BLEND_REPLACE, quad);
+
+  const float xs[] = {10, 40, 40, 10}, ys[] = {20, 20, 60, 60};
+  const float us[] = {0.25f, 0.75f, 0.75f, 0.25f};
+  const float vs[] = {0.5f, 0.5f, 1.0f, 1.0f};
+  for (int i = 0; i < 4; ++i) {
+    const SpriteVertex& v = batch.vertices()[i];
+    EXPECT_FLOAT_EQ(xs[i], v.x) << i;
+    EXPECT_FLOAT_EQ(ys[i], v.y) << i;
+    EXPECT_FLOAT_EQ(us[i], v.u) << i;
+    EXPECT_FLOAT_EQ(vs[i], v.v) << i;
+    EXPECT_EQ(1, v.rgba[0]);
+    EXPECT_EQ(2, v.rgba[1]);
+    EXPECT_EQ(3, v.rgba[2]);
+    EXPECT_EQ(10 * i, v.rgba[3]);
+  }
+}
+
+TEST(SpriteBatchTest, RotationIsBakedAroundThePivot) {
+  SpriteBatch batch;
+  SpriteQuad quad = MakeQuad(100, 100, 20, 10);
+  quad.rotation = 90;
+  quad.pivot_x = 10;
+  quad.pivot_y = 5;
+  batch.Add(1, 0, SPRITE_BLEND_ALPHA, quad);
+
+  // glRotatef(90) around (110, 105) with y pointing down the screen: the top
+  // left corner ends up at the top right.
+  const float xs[] = {115, 115, 105, 105}, ys[] = {95, 115, 115, 95};
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NEAR(xs[i], batch.vertices()[i].x, 1e-3) << i;
+    EXPECT_NEAR(ys[i], batch.vertices()[i].y, 1e-3) << i;
+  }
+}
+
+TEST(SpriteBatchTest, EffectsDefaultToNothing) {
+  SpriteEffects effects;
+  EXPECT_FALSE(effects.Any());
+  effects.colour[3] = 0.1f;
+  EXPECT_TRUE(effects.Any());
+}
+
+// Not run by default; pass --gtest_also_run_disabled_tests to get numbers.
+// Queues a screen's worth of objects, alternating between a few textures the
+// way a typical scene does.
+TEST(SpriteBatchTest, DISABLED_QueueBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kFrames = 1000;
+  const int kSprites = 256;
+
+  SpriteBatch batch;
+  SpriteQuad quad = MakeQuad(0, 0, 64, 64);
+  quad.rotation = 15;
+  int draws = 0;
+  Clock::time_point start = Clock::now();
+  for (int frame = 0; frame < kFrames; ++frame) {
+    for (int i = 0; i < kSprites; ++i)
+      batch.Add(1 + i / 64, 1, SPRITE_BLEND_ALPHA, quad);
+    draws += batch.draws().size();
+    batch.Clear();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cerr << kSprites << " sprites in " << draws / kFrames
+            << " draws per frame, "
+            << (kFrames * double(kSprites)) / seconds / 1e6
+            << " Msprites/s queued" << std::endl;
+}
@@ -35,7 +35,7 @@ MockTextWindow::MockTextWindow(System& system, int win)
     : TestTextWindow(system, win) {
   ON_CALL(*this, SetFontColor(_))
       .WillByDefault(Invoke(this, &MockTextWindow::ConcreteSetFontColor));
-  ON_CALL(*this, DisplayCharacter(_, _))
+  ON_CALL(*this, DisplayCharacterAt(_, _))
       .WillByDefault(Invoke(this, &MockTextWindow::ConcreteDisplayChar));
   ON_CALL(*this, GetTextSurface())
       .WillByDefault(Invoke(this, &MockTextWindow::ConcreteTextSurface));
@@ -31,6 +31,7 @@
 #include <vector>
 
 #include "gmock/gmock.h"
+#include "systems/base/text_layout.h"
 #include "test_system/test_text_window.h"
 
 // A TextWindow that acts as a mock, but delegates to a TestTextWindow.
@@ -40,7 +41,7 @@ class MockTextWindow : public TestTextWindow {
   virtual ~MockTextWindow();
 
   MOCK_METHOD1(SetFontColor, void(const std::vector<int>&));
-  MOCK_METHOD2(DisplayCharacter, bool(const std::string&, const std::string&));
+  MOCK_METHOD2(DisplayCharacterAt, bool(const TextLayout&, int));
   MOCK_METHOD0(GetTextSurface, std::shared_ptr<Surface>());
   MOCK_METHOD1(RenderNameInBox, void(const std::string&));
   MOCK_METHOD0(clearWin, void());
@@ -54,9 +55,8 @@ class MockTextWindow : public TestTextWindow {
   void ConcreteSetFontColor(const std::vector<int>& colour_data) {
     TestTextWindow::SetFontColor(colour_data);
   }
-  bool ConcreteDisplayChar(const std::string& current,
-                           const std::string& next) {
-    return TestTextWindow::DisplayCharacter(current, next);
+  bool ConcreteDisplayChar(const TextLayout& layout, int index) {
+    return TestTextWindow::DisplayCharacterAt(layout, index);
   }
 
   std::shared_ptr<Surface> ConcreteTextSurface() {
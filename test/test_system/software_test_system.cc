@@ -0,0 +1,83 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "test_system/software_test_system.h"
+
+#include <string>
+
+// -----------------------------------------------------------------------
+// InjectingGraphicsSystem
+// -----------------------------------------------------------------------
+
+InjectingGraphicsSystem::InjectingGraphicsSystem(System& system,
+                                                 Gameexe& gameexe)
+    : SoftwareGraphicsSystem(system, gameexe), use_transitions_(true) {}
+
+InjectingGraphicsSystem::~InjectingGraphicsSystem() {}
+
+void InjectingGraphicsSystem::InjectSurface(
+    const std::string& name,
+    const std::shared_ptr<Surface>& surface) {
+  surfaces_[name] = surface;
+}
+
+bool InjectingGraphicsSystem::DrawTransition(const Surface& from,
+                                             const Surface& to,
+                                             const Transition& transition) {
+  return use_transitions_ &&
+         SoftwareGraphicsSystem::DrawTransition(from, to, transition);
+}
+
+std::shared_ptr<const Surface> InjectingGraphicsSystem::LoadSurfaceFromFile(
+    const std::string& short_filename) {
+  return surfaces_.at(short_filename);
+}
+
+// -----------------------------------------------------------------------
+// MinimalGameexe
+// -----------------------------------------------------------------------
+
+MinimalGameexe::MinimalGameexe() { gameexe_("SCREENSIZE_MOD") = 0; }
+
+// -----------------------------------------------------------------------
+// SoftwareTestSystem
+// -----------------------------------------------------------------------
+
+SoftwareTestSystem::SoftwareTestSystem()
+    : graphics_(*this, gameexe_),
+      event_(gameexe_),
+      text_(*this, gameexe_),
+      sound_(*this) {}
+
+SoftwareTestSystem::~SoftwareTestSystem() {}
+
+void SoftwareTestSystem::Run(RLMachine& machine) {}
+
+InjectingGraphicsSystem& SoftwareTestSystem::graphics() { return graphics_; }
+EventSystem& SoftwareTestSystem::event() { return event_; }
+Gameexe& SoftwareTestSystem::gameexe() { return gameexe_; }
+TextSystem& SoftwareTestSystem::text() { return text_; }
+SoundSystem& SoftwareTestSystem::sound() { return sound_; }
@@ -0,0 +1,97 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#ifndef TEST_TEST_SYSTEM_SOFTWARE_TEST_SYSTEM_H_
+#define TEST_TEST_SYSTEM_SOFTWARE_TEST_SYSTEM_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "libreallive/gameexe.h"
+#include "systems/base/system.h"
+#include "systems/software/software_graphics_system.h"
+#include "test_system/test_event_system.h"
+#include "test_system/test_sound_system.h"
+#include "test_system/test_text_system.h"
+
+// A SoftwareGraphicsSystem which hands out surfaces registered by the test
+// instead of loading image files, and which can be told to refuse
+// DrawTransition() so a test can compare against the fallback drawing.
+class InjectingGraphicsSystem : public SoftwareGraphicsSystem {
+ public:
+  InjectingGraphicsSystem(System& system, Gameexe& gameexe);
+  virtual ~InjectingGraphicsSystem();
+
+  void InjectSurface(const std::string& name,
+                     const std::shared_ptr<Surface>& surface);
+
+  void set_use_transitions(bool use) { use_transitions_ = use; }
+
+  // GraphicsSystem:
+  virtual bool DrawTransition(const Surface& from,
+                              const Surface& to,
+                              const Transition& transition) override;
+
+ private:
+  virtual std::shared_ptr<const Surface> LoadSurfaceFromFile(
+      const std::string& short_filename) override;
+
+  std::map<std::string, std::shared_ptr<Surface>> surfaces_;
+
+  bool use_transitions_;
+};
+
+// The Gameexe.ini keys a graphics system needs, set up before the
+// SoftwareTestSystem's members are built.
+struct MinimalGameexe {
+  MinimalGameexe();
+
+  Gameexe gameexe_;
+};
+
+// Like TestSystem, but draws for real.
+class SoftwareTestSystem : private MinimalGameexe, public System {
+ public:
+  SoftwareTestSystem();
+  virtual ~SoftwareTestSystem();
+
+  // Implementation of System:
+  virtual void Run(RLMachine& machine) override;
+  virtual InjectingGraphicsSystem& graphics() override;
+  virtual EventSystem& event() override;
+  virtual Gameexe& gameexe() override;
+  virtual TextSystem& text() override;
+  virtual SoundSystem& sound() override;
+
+ private:
+  InjectingGraphicsSystem graphics_;
+  TestEventSystem event_;
+  TestTextSystem text_;
+  TestSoundSystem sound_;
+};
+
+#endif  // TEST_TEST_SYSTEM_SOFTWARE_TEST_SYSTEM_H_
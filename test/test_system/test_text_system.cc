@@ -36,7 +36,7 @@
 #include "utf8cpp/utf8.h"
 
 TestTextSystem::TestTextSystem(System& system, Gameexe& gexe)
-    : TextSystem(system, gexe) {}
+    : TextSystem(system, gexe), char_width_measurements_(0) {}
 
 TestTextSystem::~TestTextSystem() {}
 
@@ -71,7 +71,8 @@ Size TestTextSystem::RenderGlyphOnto(
   return Size(20, 20);
 }
 
-int TestTextSystem::GetCharWidth(int size, uint16_t codepoint) {
+int TestTextSystem::MeasureCharWidth(int size, uint16_t codepoint) {
+  char_width_measurements_++;
   return 20;
 }
 
@@ -55,15 +55,21 @@ class TestTextSystem : public TextSystem {
                                int insertion_point_x,
                                int insertion_point_y,
                                const std::shared_ptr<Surface>& destination) override;
-  virtual int GetCharWidth(int size, uint16_t codepoint) override;
   bool FontIsMonospaced() override;
 
   const std::vector<std::tuple<std::string, int, int>>& glyphs() {
     return rendered_glyps_;
   }
 
+  // How many times GetCharWidth() had to ask the "font" for a width.
+  int char_width_measurements() const { return char_width_measurements_; }
+
+ protected:
+  virtual int MeasureCharWidth(int size, uint16_t codepoint) override;
+
  private:
   std::vector<std::tuple<std::string, int, int>> rendered_glyps_;
+  int char_width_measurements_;
 };
 
 #endif  // TEST_TEST_SYSTEM_TEST_TEXT_SYSTEM_H_
@@ -32,6 +32,7 @@
 #include <string>
 
 #include "systems/base/rect.h"
+#include "systems/base/text_layout.h"
 #include "test_system/mock_surface.h"
 
 using std::ostringstream;
@@ -66,12 +67,11 @@ void TestTextWindow::SetFontColor(const std::vector<int>& colour_data) {
   TextWindow::SetFontColor(colour_data);
 }
 
-bool TestTextWindow::DisplayCharacter(const std::string& current,
-                                      const std::string& next) {
-  bool ret = TextWindow::DisplayCharacter(current, next);
-  // Must record after we've called superclass because DisplayCharacter() can
+bool TestTextWindow::DisplayCharacterAt(const TextLayout& layout, int index) {
+  bool ret = TextWindow::DisplayCharacterAt(layout, index);
+  // Must record after we've called superclass because DisplayCharacterAt() can
   // linebreak.
-  current_contents_ += current;
+  current_contents_ += layout.Character(index);
   return ret;
 }
 
@@ -39,8 +39,8 @@ class TestTextWindow : public TextWindow {
   virtual void SetFontColor(const std::vector<int>& colour_data) override;
   virtual std::shared_ptr<Surface> GetTextSurface() override;
   virtual std::shared_ptr<Surface> GetNameSurface() override;
-  virtual bool DisplayCharacter(const std::string& current,
-                                const std::string& next) override;
+  virtual bool DisplayCharacterAt(const TextLayout& layout,
+                                  int index) override;
 
   virtual void RenderNameInBox(const std::string& utf8str);
   virtual void ClearWin() override;
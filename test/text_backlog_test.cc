@@ -0,0 +1,128 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <string>
+
+#include "systems/base/text_backlog.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+std::string MakePage(int number, int size) {
+  std::string page(size, 'a' + number % 26);
+  page[0] = number;
+  return page;
+}
+
+}  // namespace
+
+TEST(TextBacklogTest, AppendsAndReadsPages) {
+  TextBacklog backlog(1024, fs::path());
+  EXPECT_TRUE(backlog.empty());
+  EXPECT_FALSE(backlog.spilled());
+
+  for (int i = 0; i < 3; ++i)
+    backlog.Append(MakePage(i, 10 + i));
+
+  EXPECT_EQ(0, backlog.begin_page());
+  EXPECT_EQ(3, backlog.end_page());
+  EXPECT_EQ(33u, backlog.used_bytes());
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(MakePage(i, 10 + i), backlog.Page(i));
+}
+
+TEST(TextBacklogTest, EvictsTheOldestPagesItOverwrites) {
+  TextBacklog backlog(100, fs::path());
+  for (int i = 0; i < 3; ++i)
+    backlog.Append(MakePage(i, 30));
+
+  // Doesn't fit after page 2, so it wraps around over pages 0 and 1.
+  backlog.Append(MakePage(3, 50));
+  EXPECT_EQ(2, backlog.begin_page());
+  EXPECT_EQ(4, backlog.end_page());
+  EXPECT_EQ(MakePage(2, 30), backlog.Page(2));
+  EXPECT_EQ(MakePage(3, 50), backlog.Page(3));
+
+  // Wrapping again takes page 2, left over from the last lap, along with the
+  // page 3 it overwrites.
+  backlog.Append(MakePage(4, 60));
+  EXPECT_EQ(4, backlog.begin_page());
+  EXPECT_EQ(5, backlog.end_page());
+  EXPECT_EQ(MakePage(4, 60), backlog.Page(4));
+  EXPECT_EQ(60u, backlog.used_bytes());
+
+  backlog.Append(MakePage(5, 40));
+  EXPECT_EQ(4, backlog.begin_page());
+  EXPECT_EQ(MakePage(4, 60), backlog.Page(4));
+  EXPECT_EQ(MakePage(5, 40), backlog.Page(5));
+}
+
+TEST(TextBacklogTest, PopFrontAndClearKeepNumbering) {
+  TextBacklog backlog(1024, fs::path());
+  for (int i = 0; i < 4; ++i)
+    backlog.Append(MakePage(i, 10));
+
+  backlog.PopFront();
+  EXPECT_EQ(1, backlog.begin_page());
+  EXPECT_EQ(MakePage(1, 10), backlog.Page(1));
+
+  backlog.Clear();
+  EXPECT_TRUE(backlog.empty());
+  EXPECT_EQ(4, backlog.begin_page());
+  EXPECT_EQ(0u, backlog.used_bytes());
+
+  // Pages too big for the whole buffer are dropped.
+  backlog.Append(std::string(2048, 'x'));
+  EXPECT_TRUE(backlog.empty());
+  backlog.Append(MakePage(4, 10));
+  EXPECT_EQ(MakePage(4, 10), backlog.Page(4));
+}
+
+TEST(TextBacklogTest, SpillsToAMappedFile) {
+  fs::path root =
+      fs::temp_directory_path() / fs::unique_path("rlvm-backlog-%%%%-%%%%");
+  fs::create_directories(root);
+  fs::path spill = root / "backlog.dat";
+  {
+    TextBacklog backlog(4096, spill);
+    ASSERT_TRUE(backlog.spilled());
+    EXPECT_EQ(4096u, fs::file_size(spill));
+
+    for (int i = 0; i < 200; ++i)
+      backlog.Append(MakePage(i, 50));
+    EXPECT_EQ(MakePage(199, 50), backlog.Page(199));
+    EXPECT_EQ(MakePage(backlog.begin_page(), 50),
+              backlog.Page(backlog.begin_page()));
+  }
+
+  boost::system::error_code ec;
+  fs::remove_all(root, ec);
+}
@@ -0,0 +1,127 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "systems/base/text_layout.h"
+#include "utf8cpp/utf8.h"
+#include "utilities/string_utilities.h"
+
+TEST(TextLayoutTest, SplitsCharacters) {
+  // "あ、x" with an embedded NUL.
+  std::string text("\xe3\x81\x82\xe3\x80\x81\0x", 8);
+  TextLayout layout(text);
+
+  ASSERT_EQ(3, layout.size());
+  EXPECT_EQ(0x3042, layout.codepoint(0));
+  EXPECT_EQ(0x3001, layout.codepoint(1));
+  EXPECT_EQ('x', layout.codepoint(2));
+  EXPECT_EQ(0, layout.codepoint(3));
+
+  EXPECT_EQ("\xe3\x80\x81", layout.Character(1));
+  EXPECT_EQ("x", layout.Character(2));
+  EXPECT_EQ("", layout.Character(3));
+  EXPECT_EQ("\xe3\x80\x81x", layout.Characters(1, 3));
+  EXPECT_EQ("", layout.Characters(2, 2));
+}
+
+TEST(TextLayoutTest, EmptyText) {
+  TextLayout layout("");
+  EXPECT_EQ(0, layout.size());
+  EXPECT_EQ(0, layout.codepoint(0));
+  EXPECT_EQ("", layout.Character(0));
+}
+
+TEST(TextLayoutTest, FindsLookaheadRuns) {
+  // "あ、」い"
+  TextLayout japanese("\xe3\x81\x82\xe3\x80\x81\xe3\x80\x8d\xe3\x81\x84");
+  EXPECT_FALSE(japanese.is_kinsoku(0));
+  EXPECT_TRUE(japanese.is_kinsoku(1));
+  EXPECT_TRUE(japanese.is_kinsoku(2));
+  EXPECT_FALSE(japanese.is_kinsoku(3));
+  EXPECT_EQ(3, japanese.lookahead_end(0));
+  EXPECT_EQ(3, japanese.lookahead_end(1));
+  EXPECT_EQ(3, japanese.lookahead_end(2));
+  EXPECT_EQ(4, japanese.lookahead_end(3));
+
+  // Roman words run up to the next space; the last word runs to the end.
+  TextLayout roman("ab cd.");
+  EXPECT_EQ(2, roman.lookahead_end(0));
+  EXPECT_EQ(2, roman.lookahead_end(1));
+  EXPECT_EQ(6, roman.lookahead_end(2));
+  EXPECT_EQ(6, roman.lookahead_end(3));
+  EXPECT_TRUE(roman.is_kinsoku(5));
+}
+
+// Compares the line breaker's per character lookahead on a long message when
+// the rest of the message is copied and rescanned for every character (as
+// TextoutLongOperation used to do) against a layout built once.
+TEST(TextLayoutTest, DISABLED_LongMessageBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kMessages = 2000;
+
+  std::string message;
+  for (int i = 0; i < 40; ++i)
+    message += "\xe3\x81\x82\xe3\x81\x84\xe3\x80\x81Hello there. ";
+
+  long checksum = 0;
+  Clock::time_point start = Clock::now();
+  for (int m = 0; m < kMessages; ++m) {
+    std::string::const_iterator it = message.begin();
+    std::string::const_iterator end = message.end();
+    while (it != end) {
+      utf8::next(it, end);
+      const std::string rest(it, end);
+      std::string::const_iterator cur = rest.begin();
+      while (cur != rest.end()) {
+        int point = utf8::next(cur, rest.end());
+        if (!IsKinsoku(point) && !IsWrappingRomanCharacter(point))
+          break;
+        checksum += point;
+      }
+    }
+  }
+  double rescan = std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  for (int m = 0; m < kMessages; ++m) {
+    TextLayout layout(message);
+    for (int i = 0; i < layout.size(); ++i) {
+      for (int j = i + 1; j < layout.lookahead_end(i); ++j)
+        checksum -= layout.codepoint(j);
+    }
+  }
+  double laid_out = std::chrono::duration<double>(Clock::now() - start).count();
+
+  EXPECT_EQ(0, checksum);
+  std::cerr << message.size() << " byte message: rescan "
+            << int(rescan * 1e6 / kMessages) << "us, layout "
+            << int(laid_out * 1e6 / kMessages) << "us" << std::endl;
+}
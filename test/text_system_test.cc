@@ -38,6 +38,8 @@
 
 #include "test_utils.h"
 
+#include <chrono>
+#include <iostream>
 #include <string>
 #include <memory>
 
@@ -357,6 +359,30 @@ TEST_F(TextSystemTest, TestEmoji) {
   }
 }
 
+// Text objects and name boxes showing the same string share one rendering.
+TEST_F(TextSystemTest, RenderTextIsCached) {
+  TestTextSystem& sys = GetTextSystem();
+  std::shared_ptr<Surface> first =
+      sys.RenderText("One", 20, 0, 0, RGBColour::White(), NULL, 3);
+  std::shared_ptr<Surface> second =
+      sys.RenderText("One", 20, 0, 0, RGBColour::White(), NULL, 3);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(3, sys.glyphs().size());
+  EXPECT_EQ(1, sys.rendered_text_cache().hits());
+
+  RGBColour shadow = RGBColour::Black();
+  EXPECT_NE(first, sys.RenderText("One", 20, 0, 0, RGBColour::White(),
+                                  &shadow, 3));
+  EXPECT_NE(first, sys.RenderText("One", 20, 0, 0, RGBColour::Black(),
+                                  NULL, 3));
+  EXPECT_NE(first, sys.RenderText("One", 24, 0, 0, RGBColour::White(),
+                                  NULL, 3));
+  EXPECT_EQ(4u, sys.rendered_text_cache().size());
+
+  sys.Reset();
+  EXPECT_EQ(0u, sys.rendered_text_cache().size());
+}
+
 // If we return an empty surface, we crash. Make sure passing an empty string
 // doesn't return an empty surface.
 TEST_F(TextSystemTest, TestEmptyString) {
@@ -366,3 +392,65 @@ TEST_F(TextSystemTest, TestEmptyString) {
   EXPECT_GT(text_surface->GetSize().width(), 0);
   EXPECT_GT(text_surface->GetSize().height(), 0);
 }
+
+// -----------------------------------------------------------------------
+
+// While fast forwarding, text is laid out as usual but isn't rasterized until
+// the window is rendered.
+TEST_F(TextSystemTest, FastForwardDefersGlyphs) {
+  TestTextSystem& sys = GetTextSystem();
+  system.set_force_fast_forward();
+
+  WriteString("Skip me.", true);
+  EXPECT_EQ("Skip me.", GetTextWindow(0).current_contents());
+  EXPECT_EQ(0, sys.glyphs().size());
+
+  GetTextWindow(0).Render(NULL);
+  ASSERT_EQ(8, sys.glyphs().size());
+  EXPECT_EQ("S", get<0>(sys.glyphs()[0]));
+
+  // Nothing is rasterized twice.
+  GetTextWindow(0).Render(NULL);
+  EXPECT_EQ(8, sys.glyphs().size());
+}
+
+// Pages skipped past before the screen is rendered are never rasterized.
+TEST_F(TextSystemTest, SkippedPagesAreNotRasterized) {
+  TestTextSystem& sys = GetTextSystem();
+  system.set_force_fast_forward();
+
+  WriteString("Page one.", true);
+  SnapshotAndClear();
+  WriteString("Page two.", true);
+
+  GetTextWindow(0).Render(NULL);
+  EXPECT_EQ(9, sys.glyphs().size());
+}
+
+// Writes full pages of text and flips to the next page, as a skip through
+// already read text does, and reports how many pages a second get through
+// with and without fast forwarding.
+TEST_F(TextSystemTest, DISABLED_SkippedPagesPerSecondBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kPages = 5000;
+  const std::string page =
+      "\xe3\x80\x8c\xe3\x81\x82\xe3\x81\x84\xe3\x81\x86\xe3\x80\x8d"
+      "A line of dialogue that goes on for a while, as they do.";
+
+  double seconds[2];
+  for (int fast_forward = 0; fast_forward < 2; ++fast_forward) {
+    if (fast_forward)
+      system.set_force_fast_forward();
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < kPages; ++i) {
+      WriteString(page, true);
+      SnapshotAndClear();
+    }
+    seconds[fast_forward] =
+        std::chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  std::cerr << "Pages/s: " << int(kPages / seconds[0]) << " displayed, "
+            << int(kPages / seconds[1]) << " skipped" << std::endl;
+}
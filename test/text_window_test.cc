@@ -136,6 +136,22 @@ TEST_F(TextWindowTest, KanonLikePositioning) {
   EXPECT_EQ(Rect(0, 344, Size(640, 122)), window.GetWindowRect());
 }
 
+// The window's chrome positions are cached, so moving or resizing the window
+// has to throw them away.
+TEST_F(TextWindowTest, LayoutFollowsWindowChanges) {
+  kanonLikeTextbox();
+
+  TestTextWindow window(system, 0);
+  EXPECT_EQ(Point(53, 373), window.GetTextSurfaceRect().origin());
+
+  window.SetWindowPosition({0, 0, 20});
+  EXPECT_EQ(Rect(0, 20, Size(640, 122)), window.GetWindowRect());
+  EXPECT_EQ(Point(53, 49), window.GetTextSurfaceRect().origin());
+
+  window.SetTextboxPadding({5, 0, 6, 0});
+  EXPECT_EQ(Point(6, 25), window.GetTextSurfaceRect().origin());
+}
+
 // Tests that a text box like the one in Princess Brave (origin 2, positioned
 // significantly offscreen) has its GetWindowRect() calculated correctly from the
 // gameexe data.
@@ -0,0 +1,300 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "effects/effect.h"
+#include "effects/effect_factory.h"
+#include "libreallive/archive.h"
+#include "machine/rlmachine.h"
+#include "systems/software/software_surface.h"
+#include "test_system/software_test_system.h"
+#include "test_system/test_event_system.h"
+#include "test_utils.h"
+
+// The \#SEL parameters of one transition. Outside the anonymous namespace
+// because gtest's parameter factory, a header template, holds a copy.
+struct TransitionCase {
+  int style;
+  int direction;
+  int interpolation;
+  int xsize;
+  int ysize;
+};
+
+std::ostream& operator<<(std::ostream& os, const TransitionCase& c) {
+  return os << "style " << c.style << ", direction " << c.direction
+            << ", interpolation " << c.interpolation << ", size " << c.xsize
+            << "x" << c.ysize;
+}
+
+namespace {
+
+// Helper to specify the return value of GetTicks().
+class TransitionTicks : public EventSystemMockHandler {
+ public:
+  TransitionTicks() : ticks_(0) {}
+  void set_ticks(unsigned int ticks) { ticks_ = ticks; }
+  virtual unsigned int GetTicks() const override { return ticks_; }
+
+ private:
+  unsigned int ticks_;
+};
+
+// An effect that draws nothing and records the times it's drawn at.
+class RecordingEffect : public Effect {
+ public:
+  RecordingEffect(RLMachine& machine,
+                  std::shared_ptr<Surface> src,
+                  std::shared_ptr<Surface> dst,
+                  const Size& size,
+                  int time)
+      : Effect(machine, src, dst, size, time), last_time_(-1) {}
+
+  int last_time() const { return last_time_; }
+
+ protected:
+  virtual void PerformEffectForTime(RLMachine& machine,
+                                    int currentTime) override {
+    last_time_ = currentTime;
+  }
+
+ private:
+  virtual bool BlitOriginalImage() const override { return false; }
+
+  int last_time_;
+};
+
+class TransitionTestBase {
+ protected:
+  TransitionTestBase()
+      : arc_(locateTestCase("Module_Str_SEEN/strcpy_0.TXT")),
+        machine_(system_, arc_),
+        ticks_(new TransitionTicks) {
+    dynamic_cast<TestEventSystem&>(system_.event()).SetMockHandler(ticks_);
+  }
+
+  // A screen sized image, patterned so that misplaced pixels show.
+  std::shared_ptr<Surface> MakeImage(uint32_t seed) {
+    Size size = system_.graphics().screen_size();
+    std::vector<uint32_t> pixels(size.width() * size.height());
+    for (int y = 0; y < size.height(); ++y) {
+      for (int x = 0; x < size.width(); ++x) {
+        uint32_t r = (x * 3 + seed) & 0xff;
+        uint32_t g = (y * 5 + seed * 7) & 0xff;
+        uint32_t b = (x + y + seed * 13) & 0xff;
+        pixels[y * size.width() + x] = 0xff000000 | (r << 16) | (g << 8) | b;
+      }
+    }
+    return std::shared_ptr<Surface>(new SoftwareSurface(
+        &system_.graphics(), size, &pixels, std::vector<Surface::GrpRect>()));
+  }
+
+  // Draws the frame of |effect| at |time| and returns the screen.
+  std::vector<uint32_t> DrawFrame(Effect& effect,
+                                  unsigned int time,
+                                  bool use_transitions) {
+    system_.graphics().set_use_transitions(use_transitions);
+    ticks_->set_ticks(time);
+    effect(machine_);
+
+    RasterImage screen = system_.graphics().screen().image();
+    std::vector<uint32_t> pixels;
+    for (int y = 0; y < screen.height; ++y)
+      pixels.insert(pixels.end(), screen.Row(y), screen.Row(y) + screen.width);
+    return pixels;
+  }
+
+  libreallive::Archive arc_;
+  SoftwareTestSystem system_;
+  RLMachine machine_;
+  std::shared_ptr<TransitionTicks> ticks_;
+};
+
+class TransitionTest : public TransitionTestBase,
+                       public ::testing::TestWithParam<TransitionCase> {};
+
+class TransitionTimingTest : public TransitionTestBase,
+                             public ::testing::Test {};
+
+// Whether every channel of |a| and |b| is within |tolerance|.
+bool PixelsMatch(uint32_t a, uint32_t b, int tolerance) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    int difference = int((a >> shift) & 0xff) - int((b >> shift) & 0xff);
+    if (std::abs(difference) > tolerance)
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+// Every transition drawn in one pass has to look like the old drawing code's
+// output, which is what it replaces.
+TEST_P(TransitionTest, MatchesFallbackDrawing) {
+  const TransitionCase& c = GetParam();
+  std::shared_ptr<Surface> to = MakeImage(1);
+  std::shared_ptr<Surface> from = MakeImage(2);
+
+  ticks_->set_ticks(1000);
+  std::unique_ptr<Effect> effect(EffectFactory::Build(machine_, to, from, 800,
+                                                      c.style, c.direction,
+                                                      c.interpolation, c.xsize,
+                                                      c.ysize, 0, 0, 0));
+
+  int width = system_.graphics().screen_size().width();
+  for (int time : {0, 85, 250, 400, 555, 799}) {
+    std::vector<uint32_t> one_pass = DrawFrame(*effect, 1000 + time, true);
+    std::vector<uint32_t> fallback = DrawFrame(*effect, 1000 + time, false);
+    ASSERT_EQ(fallback.size(), one_pass.size());
+
+    int mismatches = 0;
+    for (size_t i = 0; i < fallback.size(); ++i) {
+      if (!PixelsMatch(fallback[i], one_pass[i], 2)) {
+        if (mismatches == 0) {
+          ADD_FAILURE() << "At time " << time << ", pixel (" << i % width
+                        << ", " << i / width << ") is " << std::hex
+                        << one_pass[i] << " instead of " << fallback[i];
+        }
+        ++mismatches;
+      }
+    }
+    EXPECT_EQ(0, mismatches) << "at time " << time;
+  }
+}
+
+const TransitionCase transition_cases[] = {
+    // Fade
+    {0, 0, 0, 0, 0},
+    // Wipe, with and without a soft edge
+    {10, 0, 0, 0, 0}, {10, 1, 0, 0, 0}, {10, 2, 0, 0, 0}, {10, 3, 0, 0, 0},
+    {10, 0, 3, 0, 0}, {10, 1, 3, 0, 0}, {10, 2, 3, 0, 0}, {10, 3, 3, 0, 0},
+    // Scroll, squash and slide
+    {15, 0, 0, 0, 0}, {15, 1, 0, 0, 0}, {15, 2, 0, 0, 0}, {15, 3, 0, 0, 0},
+    {16, 0, 0, 0, 0}, {16, 1, 0, 0, 0}, {16, 2, 0, 0, 0}, {16, 3, 0, 0, 0},
+    {17, 0, 0, 0, 0}, {17, 1, 0, 0, 0}, {17, 2, 0, 0, 0}, {17, 3, 0, 0, 0},
+    {18, 0, 0, 0, 0}, {18, 1, 0, 0, 0}, {18, 2, 0, 0, 0}, {18, 3, 0, 0, 0},
+    {20, 0, 0, 0, 0}, {20, 1, 0, 0, 0}, {20, 2, 0, 0, 0}, {20, 3, 0, 0, 0},
+    {21, 0, 0, 0, 0}, {21, 1, 0, 0, 0}, {21, 2, 0, 0, 0}, {21, 3, 0, 0, 0},
+    // Blind
+    {120, 0, 0, 16, 0}, {120, 1, 0, 16, 0}, {120, 2, 0, 0, 24},
+    {120, 3, 0, 0, 24},
+    // Diagonal wipe
+    {130, 0, 0, 0, 0}, {130, 1, 0, 0, 0}, {130, 2, 0, 0, 0}, {130, 3, 0, 0, 0},
+    {130, 0, 4, 0, 0}, {130, 1, 4, 0, 0}, {130, 2, 4, 0, 0}, {130, 3, 4, 0, 0},
+};
+
+INSTANTIATE_TEST_CASE_P(SelStyles,
+                        TransitionTest,
+                        ::testing::ValuesIn(transition_cases));
+
+// -----------------------------------------------------------------------
+
+namespace {
+
+// Runs |effect| on a simulated 60Hz display, with the game loop taking a
+// random 1-12ms after each refresh before it draws, and returns the
+// difference between the time each frame was drawn for and the time it was
+// shown at. With |presentation_timing| off, the effect is stepped by when it's
+// drawn, as it used to be.
+std::vector<double> PacingErrors(SoftwareTestSystem& system,
+                                 RLMachine& machine,
+                                 TransitionTicks& ticks,
+                                 bool presentation_timing) {
+  InjectingGraphicsSystem& graphics = system.graphics();
+  graphics.set_refresh_interval(1000.0 / 60);
+  graphics.presentation_clock().Reset();
+
+  std::mt19937 random(60);
+  std::uniform_int_distribution<int> work(1, 12);
+
+  unsigned int start = 5000;
+  ticks.set_ticks(start);
+  RecordingEffect effect(machine, std::shared_ptr<Surface>(),
+                         std::shared_ptr<Surface>(),
+                         graphics.screen_size(), 2000);
+
+  std::vector<double> errors;
+  unsigned int now = start;
+  while (true) {
+    if (!presentation_timing)
+      graphics.presentation_clock().Reset();
+    ticks.set_ticks(now);
+    if (effect(machine))
+      break;
+
+    // Give the clock a few frames to settle.
+    unsigned int shown = graphics.last_presented() - start;
+    if (now - start > 200)
+      errors.push_back(double(effect.last_time()) - double(shown));
+
+    now = graphics.last_presented() + work(random);
+  }
+
+  graphics.set_refresh_interval(0);
+  return errors;
+}
+
+double StandardDeviation(const std::vector<double>& values) {
+  double mean = 0;
+  for (double value : values)
+    mean += value;
+  mean /= values.size();
+
+  double variance = 0;
+  for (double value : values)
+    variance += (value - mean) * (value - mean);
+  return std::sqrt(variance / values.size());
+}
+
+}  // namespace
+
+TEST_F(TransitionTimingTest, EffectsAreTimedByPresentation) {
+  std::vector<double> errors = PacingErrors(system_, machine_, *ticks_, true);
+  ASSERT_LT(50u, errors.size());
+  for (double error : errors)
+    EXPECT_GE(1.0, std::fabs(error));
+}
+
+// Not a correctness test; reports how evenly an effect moves on screen.
+TEST_F(TransitionTimingTest, DISABLED_FramePacingJitterBenchmark) {
+  for (bool presentation_timing : {false, true}) {
+    std::vector<double> errors =
+        PacingErrors(system_, machine_, *ticks_, presentation_timing);
+    std::cerr << (presentation_timing ? "Presentation" : "Draw call")
+              << " timing: " << errors.size()
+              << " frames, jitter (stddev of drawn - shown time) "
+              << StandardDeviation(errors) << "ms" << std::endl;
+  }
+}
@@ -0,0 +1,289 @@
+// -*- Mode: C++; tab-width:2; indent-tabs-mode: nil; c-basic-offset: 2 -*-
+// vi:tw=80:et:ts=2:sts=2
+//
+// -----------------------------------------------------------------------
+//
+// This file is part of RLVM, a RealLive virtual machine clone.
+//
+// -----------------------------------------------------------------------
+//
+// Copyright (C) 2016 Elliot Glaysher
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+// -----------------------------------------------------------------------
+
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "encodings/cp932.h"
+#include "encodings/cp936.h"
+#include "encodings/cp949.h"
+#include "encodings/utf8_transcoder.h"
+#include "encodings/western.h"
+#include "libreallive/archive.h"
+#include "libreallive/bytecode.h"
+#include "libreallive/scenario.h"
+#include "test_utils.h"
+#include "utilities/string_utilities.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+std::unique_ptr<Codepage> MakeCodepage(int transformation) {
+  switch (transformation) {
+    case 1:
+      return std::unique_ptr<Codepage>(new Cp936);
+    case 2:
+      return std::unique_ptr<Codepage>(new Cp1252);
+    case 3:
+      return std::unique_ptr<Codepage>(new Cp949);
+    default:
+      return std::unique_ptr<Codepage>(new Cp932);
+  }
+}
+
+// The byte sequences each codepage has table entries for.
+bool IsLead(int transformation, int c) {
+  switch (transformation) {
+    case 1:
+      return c >= 0x81 && c <= 0xfe;
+    case 2:
+      return false;
+    case 3:
+      return c >= 0x81 && c <= 0xc8;
+    default:
+      return shiftjis_lead_byte(c);
+  }
+}
+
+bool IsSingle(int transformation, int c) {
+  if (IsLead(transformation, c))
+    return false;
+  switch (transformation) {
+    case 1:
+    case 3:
+      return c < 0x80;
+    default:
+      return true;
+  }
+}
+
+bool IsTrail(int transformation, int c) {
+  switch (transformation) {
+    case 1:
+      return c >= 0x40 && c <= 0xfe;
+    case 3:
+      return c >= 0x41 && c <= 0xfe;
+    default:
+      return c != 0;
+  }
+}
+
+std::string Transcode(const Utf8Transcoder& transcoder,
+                      const std::string& in) {
+  std::string out;
+  transcoder.Append(in.data(), in.size(), &out);
+  return out;
+}
+
+std::string Reference(const Codepage& codepage, const std::string& in) {
+  return UnicodeToUTF8(codepage.ConvertString(in));
+}
+
+std::vector<std::string> TextoutsFromTestScenarios() {
+  fs::path root =
+      fs::path(locateTestCase("Module_Sys_SEEN/dumb.TXT")).parent_path()
+          .parent_path();
+  std::vector<std::string> text;
+  for (fs::recursive_directory_iterator it(root), end; it != end; ++it) {
+    if (it->path().extension() != ".TXT")
+      continue;
+
+    libreallive::Archive archive(it->path().string());
+    for (auto const& scenario_pos : archive) {
+      libreallive::Scenario* scenario =
+          archive.GetScenario(scenario_pos.first);
+      if (!scenario)
+        continue;
+      for (auto const& element : *scenario) {
+        const libreallive::TextoutElement* textout =
+            dynamic_cast<const libreallive::TextoutElement*>(element.get());
+        if (textout)
+          text.push_back(textout->GetText());
+      }
+    }
+  }
+  return text;
+}
+
+}  // namespace
+
+TEST(Utf8TranscoderTest, MatchesCodepageForEveryCharacter) {
+  for (int transformation = 0; transformation < 4; ++transformation) {
+    SCOPED_TRACE(TransformationName(transformation));
+    std::unique_ptr<Codepage> codepage = MakeCodepage(transformation);
+    Utf8Transcoder transcoder(transformation);
+
+    std::string all;
+    for (int c = 1; c < 256; ++c) {
+      if (!IsSingle(transformation, c))
+        continue;
+      std::string single(1, char(c));
+      ASSERT_EQ(Reference(*codepage, single), Transcode(transcoder, single))
+          << "byte " << c;
+      all += single;
+    }
+
+    for (int lead = 0x80; lead < 256; ++lead) {
+      if (!IsLead(transformation, lead))
+        continue;
+      for (int trail = 1; trail < 256; ++trail) {
+        if (!IsTrail(transformation, trail))
+          continue;
+        std::string pair{char(lead), char(trail)};
+        ASSERT_EQ(Reference(*codepage, pair), Transcode(transcoder, pair))
+            << "bytes " << lead << ", " << trail;
+        all += pair;
+      }
+    }
+
+    EXPECT_EQ(Reference(*codepage, all), Transcode(transcoder, all));
+  }
+}
+
+TEST(Utf8TranscoderTest, AsciiRunsOfEveryLength) {
+  Cp932 codepage;
+  Utf8Transcoder transcoder(0);
+  // "マジ？" and a half-width "ｱ" around ASCII runs that straddle the
+  // sixteen byte blocks at every offset.
+  for (int length = 0; length < 40; ++length) {
+    std::string ascii;
+    for (int i = 0; i < length; ++i)
+      ascii += char('a' + i % 26);
+    std::string in = "\x83\x7d" + ascii + "\x83\x57\x81\x48" + ascii + "\xb1";
+    EXPECT_EQ(Reference(codepage, in), Transcode(transcoder, in));
+    EXPECT_EQ(Reference(codepage, ascii), Transcode(transcoder, ascii));
+  }
+}
+
+TEST(Utf8TranscoderTest, StopsAtNulAndDanglingLeadByte) {
+  Utf8Transcoder transcoder(0);
+  EXPECT_EQ("ab", Transcode(transcoder, std::string("ab\0cd", 5)));
+  EXPECT_EQ(std::string(20, 'a'),
+            Transcode(transcoder, std::string(20, 'a') +
+                                      std::string("\0", 1) +
+                                      std::string(20, 'c')));
+  EXPECT_EQ("\xe3\x83\x9e", Transcode(transcoder, "\x83\x7d\x83"));
+  EXPECT_EQ("a", Transcode(transcoder, std::string("a\x83\0\x7d", 4)));
+
+  // Bytes outside the tables come out as U+FFFD instead of reading past them;
+  // a lone 0x80 is the euro sign in Cp936.
+  Utf8Transcoder korean(3);
+  EXPECT_EQ("\xef\xbf\xbd" "a", Transcode(korean, "\x80" "a"));
+  Utf8Transcoder chinese(1);
+  EXPECT_EQ("\xe2\x82\xac" "a", Transcode(chinese, "\x80" "a"));
+}
+
+TEST(Utf8TranscoderTest, UnmappedLeadBytesKeepTheirTrailByte) {
+  // Cp949's table covers leads up to 0xc8. A hanja (0xca 0xa1) or a user
+  // defined character (0xfe 0xa1) is one unknown character, and the "가"
+  // (0xb0 0xa1) after it must survive.
+  Cp949 codepage;
+  Utf8Transcoder korean(3);
+  const std::string ga = "\xb0\xa1";
+  ASSERT_EQ("\xea\xb0\x80", Reference(codepage, ga));
+  EXPECT_EQ("\xef\xbf\xbd\xea\xb0\x80",
+            Transcode(korean, "\xca\xa1" + ga));
+  EXPECT_EQ("\xef\xbf\xbd\xea\xb0\x80",
+            Transcode(korean, "\xfe\xa1" + ga));
+  EXPECT_EQ("\xef\xbf\xbd" "a", Transcode(korean, "\xc9\x30" "a"));
+  for (int lead = 0x81; lead <= 0xfe; ++lead) {
+    std::string in = std::string(1, char(lead)) + "\xa1" + ga;
+    std::string out = Transcode(korean, in);
+    ASSERT_LE(3u, out.size()) << "lead " << lead;
+    EXPECT_EQ("\xea\xb0\x80", out.substr(out.size() - 3)) << "lead " << lead;
+  }
+}
+
+TEST(Utf8TranscoderTest, MemoizesShortStrings) {
+  Utf8Transcoder transcoder(0);
+  const std::string name = "\x8f\x48\x90\x6c";  // "秋人"
+  EXPECT_EQ("\xe7\xa7\x8b\xe4\xba\xba", transcoder.Transcode(name));
+  EXPECT_EQ("\xe7\xa7\x8b\xe4\xba\xba", transcoder.Transcode(name));
+  EXPECT_EQ(1, transcoder.memo_hits());
+  EXPECT_EQ(1, transcoder.memo_misses());
+
+  std::string long_text;
+  for (size_t i = 0; i <= Utf8Transcoder::kMaxMemoBytes / 2; ++i)
+    long_text += name.substr(0, 2);
+  transcoder.Transcode(long_text);
+  transcoder.Transcode(long_text);
+  EXPECT_EQ(1, transcoder.memo_hits());
+  EXPECT_EQ(1, transcoder.memo_misses());
+
+  EXPECT_EQ("", transcoder.Transcode(""));
+}
+
+TEST(Utf8TranscoderTest, DISABLED_SeenTextThroughputBenchmark) {
+  typedef std::chrono::steady_clock Clock;
+  const int kPasses = 200;
+
+  std::vector<std::string> text = TextoutsFromTestScenarios();
+  size_t bytes = 0;
+  for (const std::string& line : text)
+    bytes += line.size();
+  ASSERT_LT(0u, bytes);
+
+  size_t checksum = 0;
+  Clock::time_point start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (const std::string& line : text)
+      checksum += UnicodeToUTF8(cp932toUnicode(line, 0)).size();
+  }
+  double old_path = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Utf8Transcoder& transcoder = Utf8Transcoder::ForTransformation(0);
+  start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (const std::string& line : text) {
+      std::string out;
+      transcoder.Append(line.data(), line.size(), &out);
+      checksum -= out.size();
+    }
+  }
+  double tables = std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (const std::string& line : text)
+      checksum += transcoder.Transcode(line).size();
+  }
+  double memoized = std::chrono::duration<double>(Clock::now() - start).count();
+
+  EXPECT_LT(0u, checksum);
+  double megabytes = double(bytes) * kPasses / (1024 * 1024);
+  std::cerr << text.size() << " textouts, " << bytes << " bytes: wstring "
+            << int(megabytes / old_path) << " MB/s, tables "
+            << int(megabytes / tables) << " MB/s, memoized "
+            << int(megabytes / memoized) << " MB/s" << std::endl;
+}